@@ -1,4 +1,5 @@
 import 'dart:async';
+import 'dart:io';
 
 import 'package:dartllm/src/api/llm_model.dart';
 import 'package:dartllm/src/core/huggingface_client.dart';
@@ -9,6 +10,8 @@ import 'package:dartllm/src/models/global_config.dart';
 import 'package:dartllm/src/models/model_config.dart';
 import 'package:dartllm/src/models/model_info.dart';
 import 'package:dartllm/src/platform/binding_factory.dart';
+import 'package:dartllm/src/platform/isolate_pool.dart';
+import 'package:dartllm/src/platform/platform_binding.dart';
 import 'package:dartllm/src/utils/logger.dart';
 import 'package:dartllm/src/utils/path_utils.dart';
 import 'package:dartllm/src/utils/platform_utils.dart';
@@ -52,6 +55,9 @@ class DartLLM {
   /// HuggingFace client instance.
   static HuggingFaceClient? _huggingFaceClient;
 
+  /// Worker isolates models run on, if [GlobalConfig.isolateWorkers] is set.
+  static IsolatePool? _isolatePool;
+
   /// Private constructor to prevent instantiation.
   DartLLM._();
 
@@ -69,6 +75,18 @@ class DartLLM {
     return _modelCache!;
   }
 
+  /// Gets the binding a new model runs on.
+  ///
+  /// With [GlobalConfig.isolateWorkers] set, every model shares one pool of
+  /// worker isolates; otherwise each model gets a binding of its own.
+  static Future<PlatformBinding> _createBinding() async {
+    final workers = _globalConfig.isolateWorkers;
+    if (workers > 0) {
+      return _isolatePool ??= IsolatePool(size: workers);
+    }
+    return BindingFactory.create();
+  }
+
   /// Gets or creates the model downloader.
   static ModelDownloader _getDownloader() {
     _modelDownloader ??= ModelDownloader();
@@ -76,10 +94,24 @@ class DartLLM {
   }
 
   /// Gets or creates the HuggingFace client.
+  ///
+  /// Hub metadata is cached next to the models. `HF_ENDPOINT` selects a
+  /// mirror and `HF_HUB_OFFLINE=1` answers from cached metadata only, as
+  /// in the HuggingFace tools.
   static HuggingFaceClient _getHuggingFaceClient() {
-    _huggingFaceClient ??= HuggingFaceClient(
-      apiToken: _globalConfig.huggingFaceToken,
-    );
+    if (_huggingFaceClient == null) {
+      final cacheDir =
+          _globalConfig.defaultCacheDirectory ?? PathUtils.defaultModelCacheDir;
+      final environment = Platform.environment;
+      _huggingFaceClient = HuggingFaceClient(
+        apiToken: _globalConfig.huggingFaceToken,
+        endpoint:
+            environment['HF_ENDPOINT'] ?? HuggingFaceClient.defaultEndpoint,
+        metadataCacheDirectory:
+            cacheDir != null ? '$cacheDir/.huggingface' : null,
+        offline: environment['HF_HUB_OFFLINE'] == '1',
+      );
+    }
     return _huggingFaceClient!;
   }
 
@@ -112,7 +144,7 @@ class DartLLM {
   }) async {
     _logger.info('Loading model from: $path');
 
-    final binding = await BindingFactory.create();
+    final binding = await _createBinding();
     final engine = InferenceEngine(binding: binding);
 
     onProgress?.call(0.1);
@@ -182,7 +214,7 @@ class DartLLM {
     final cacheDir = cache.cacheDirectory;
     final tempPath = '$cacheDir/${PathUtils.getCacheFilename(downloadUrl)}';
 
-    final result = await downloader.download(
+    final result = await downloader.downloadSegmented(
       downloadUrl,
       tempPath,
       onProgress: (progress) {
@@ -200,6 +232,7 @@ class DartLLM {
       result.filePath,
       sourceUrl: downloadUrl,
       move: true,
+      sha256: result.sha256,
     );
 
     // Load the model
@@ -258,7 +291,7 @@ class DartLLM {
     final cacheDir = cache.cacheDirectory;
     final tempPath = '$cacheDir/${PathUtils.getCacheFilename(url)}';
 
-    final result = await downloader.download(
+    final result = await downloader.downloadSegmented(
       url,
       tempPath,
       onProgress: (progress) {
@@ -276,6 +309,7 @@ class DartLLM {
       result.filePath,
       sourceUrl: url,
       move: true,
+      sha256: result.sha256,
     );
 
     // Load the model
@@ -375,7 +409,7 @@ class DartLLM {
   static Future<ModelInfo> getModelInfo(String path) async {
     _logger.debug('Getting model info for: $path');
 
-    final binding = await BindingFactory.create();
+    final binding = await _createBinding();
     final engine = InferenceEngine(binding: binding);
 
     try {
@@ -482,6 +516,10 @@ class DartLLM {
 
     _modelCache = null;
 
+    // Models still loaded on the pool are freed with its workers.
+    _isolatePool?.dispose();
+    _isolatePool = null;
+
     _logger.debug('DartLLM resources disposed');
   }
 
@@ -1,6 +1,7 @@
 import 'dart:convert';
 import 'dart:io';
 
+import 'package:crypto/crypto.dart';
 import 'package:dartllm/src/core/exceptions/network_exception.dart';
 import 'package:dartllm/src/utils/logger.dart';
 
@@ -78,6 +79,13 @@ class HuggingFaceRepo {
 /// - Resolving download URLs
 /// - Fetching model metadata
 ///
+/// File listings and sizes are cached, in memory and, given a
+/// metadata cache directory, on disk. A cached answer younger than the
+/// metadata TTL is returned without a request; an older one is
+/// revalidated with `If-None-Match`, so an unchanged repository costs a
+/// `304 Not Modified`. When the network fails, or in offline mode, cached
+/// answers are returned however old they are.
+///
 /// Example usage:
 /// ```dart
 /// final client = HuggingFaceClient();
@@ -100,11 +108,14 @@ class HuggingFaceClient {
   static const String _loggerName = 'dartllm.core.huggingface';
   final DartLLMLogger _logger = DartLLMLogger(_loggerName);
 
+  /// Default HuggingFace Hub endpoint.
+  static const String defaultEndpoint = 'https://huggingface.co';
+
   /// Base URL for the HuggingFace API.
-  static const String _apiBaseUrl = 'https://huggingface.co/api';
+  final String _apiBaseUrl;
 
   /// Base URL for file downloads.
-  static const String _downloadBaseUrl = 'https://huggingface.co';
+  final String _downloadBaseUrl;
 
   /// HTTP client.
   final HttpClient _client;
@@ -112,12 +123,39 @@ class HuggingFaceClient {
   /// Optional API token for authenticated requests.
   final String? _apiToken;
 
+  /// Directory cached metadata is persisted in, or null for memory only.
+  final String? _metadataCacheDir;
+
+  /// How long cached metadata is used without revalidation.
+  final Duration _metadataTtl;
+
+  /// Whether to answer from cached metadata only.
+  final bool _offline;
+
+  /// Cached metadata by request URL.
+  final Map<String, _CachedMetadata> _metadata = {};
+
   /// Creates a HuggingFaceClient.
   ///
   /// [apiToken] is optional but allows access to private repos and
   /// increases rate limits.
-  HuggingFaceClient({String? apiToken})
-      : _apiToken = apiToken,
+  /// [endpoint] is the Hub to talk to, for mirrors.
+  /// [metadataCacheDirectory] persists cached metadata across runs.
+  /// [metadataTtl] is how long cached metadata is used without asking
+  /// the Hub whether it changed.
+  /// [offline] answers from cached metadata only, never the network.
+  HuggingFaceClient({
+    String? apiToken,
+    String endpoint = defaultEndpoint,
+    String? metadataCacheDirectory,
+    Duration metadataTtl = const Duration(hours: 1),
+    bool offline = false,
+  })  : _apiToken = apiToken,
+        _apiBaseUrl = '$endpoint/api',
+        _downloadBaseUrl = endpoint,
+        _metadataCacheDir = metadataCacheDirectory,
+        _metadataTtl = metadataTtl,
+        _offline = offline,
         _client = HttpClient() {
     _client.connectionTimeout = const Duration(seconds: 30);
     _client.idleTimeout = const Duration(seconds: 60);
@@ -172,7 +210,7 @@ class HuggingFaceClient {
       url += '/$path';
     }
 
-    final data = await _get(url);
+    final data = await _getCached(url);
 
     if (data is! List) {
       throw DownloadException(url,
@@ -250,18 +288,7 @@ class HuggingFaceClient {
   }) async {
     try {
       final url = getDownloadUrl(repoId, filename, branch: branch);
-      final uri = Uri.parse(url);
-      final request = await _client.headUrl(uri);
-      _addAuthHeader(request);
-
-      final response = await request.close();
-      await response.drain<void>();
-
-      if (response.statusCode == 200 && response.contentLength > 0) {
-        return response.contentLength;
-      }
-
-      return null;
+      return await _cachedRequest(url, head: true) as int?;
     } catch (e) {
       _logger.warning('Failed to get file size: $filename', e);
       return null;
@@ -341,6 +368,139 @@ class HuggingFaceClient {
     }
   }
 
+  /// Makes a GET request and returns parsed JSON, through the metadata
+  /// cache.
+  Future<dynamic> _getCached(String url) => _cachedRequest(url, head: false);
+
+  /// Returns the parsed JSON body of a GET, or the content length of a
+  /// HEAD when [head] is true, answering from the metadata cache while it
+  /// is fresh and revalidating it once it is not.
+  Future<Object?> _cachedRequest(String url, {required bool head}) async {
+    final cached = await _readCached(url);
+    if (cached != null &&
+        (_offline ||
+            DateTime.now().difference(cached.fetchedAt) < _metadataTtl)) {
+      _logger.debug('Metadata cache hit: $url');
+      return cached.value;
+    }
+    if (_offline) {
+      throw ConnectionException('Offline and no cached metadata for $url');
+    }
+
+    try {
+      final uri = Uri.parse(url);
+      final request =
+          head ? await _client.headUrl(uri) : await _client.getUrl(uri);
+      _addAuthHeader(request);
+      if (cached?.etag != null) {
+        request.headers.set(HttpHeaders.ifNoneMatchHeader, cached!.etag!);
+      }
+
+      final response = await request.close();
+
+      if (response.statusCode == HttpStatus.notModified && cached != null) {
+        await response.drain<void>();
+        _logger.debug('Metadata not modified: $url');
+        await _storeCached(url, cached.etag, cached.value);
+        return cached.value;
+      }
+
+      if (response.statusCode != 200) {
+        await response.drain<void>();
+        throw DownloadException(
+          url,
+          message: 'HTTP ${response.statusCode}: ${response.reasonPhrase}',
+          statusCode: response.statusCode,
+        );
+      }
+
+      final Object? value;
+      if (head) {
+        await response.drain<void>();
+        value = response.contentLength > 0 ? response.contentLength : null;
+      } else {
+        value = json.decode(await response.transform(utf8.decoder).join());
+      }
+
+      await _storeCached(
+          url, response.headers.value(HttpHeaders.etagHeader), value);
+      return value;
+    } on SocketException catch (e) {
+      if (cached != null) {
+        _logger.warning('Using cached metadata, Hub unreachable: $url', e);
+        return cached.value;
+      }
+      throw ConnectionException(
+        'Connection failed: ${e.message}',
+        host: e.address?.host,
+        cause: e,
+      );
+    } on HttpException catch (e) {
+      if (cached != null) {
+        _logger.warning('Using cached metadata, Hub unreachable: $url', e);
+        return cached.value;
+      }
+      rethrow;
+    } on FormatException catch (e) {
+      throw DownloadException(url,
+          message: 'Invalid JSON response: ${e.message}');
+    }
+  }
+
+  /// Cached metadata for [url] from memory or disk, or null.
+  Future<_CachedMetadata?> _readCached(String url) async {
+    final inMemory = _metadata[url];
+    if (inMemory != null || _metadataCacheDir == null) {
+      return inMemory;
+    }
+
+    final file = _metadataFile(url);
+    if (!await file.exists()) {
+      return null;
+    }
+    try {
+      final record =
+          jsonDecode(await file.readAsString()) as Map<String, dynamic>;
+      if (record['url'] != url) {
+        return null;
+      }
+      return _metadata[url] = _CachedMetadata.fromJson(record);
+    } catch (e) {
+      _logger.warning('Ignoring unreadable cached metadata: ${file.path}', e);
+      return null;
+    }
+  }
+
+  /// Caches [value] for [url] as fetched now.
+  Future<void> _storeCached(String url, String? etag, Object? value) async {
+    final entry = _CachedMetadata(
+      etag: etag,
+      fetchedAt: DateTime.now(),
+      value: value,
+    );
+    _metadata[url] = entry;
+
+    if (_metadataCacheDir == null) {
+      return;
+    }
+    try {
+      final file = _metadataFile(url);
+      await file.parent.create(recursive: true);
+      // Renamed into place so readers never see a partial file.
+      final temp = File('${file.path}.tmp');
+      await temp.writeAsString(jsonEncode({'url': url, ...entry.toJson()}));
+      await temp.rename(file.path);
+    } on FileSystemException catch (e) {
+      _logger.warning('Failed to persist cached metadata: $url', e);
+    }
+  }
+
+  /// The file metadata for [url] is persisted in.
+  File _metadataFile(String url) {
+    final key = sha256.convert(utf8.encode(url)).toString();
+    return File('$_metadataCacheDir/$key.json');
+  }
+
   /// Adds authorization header if token is configured.
   void _addAuthHeader(HttpClientRequest request) {
     if (_apiToken != null) {
@@ -348,3 +508,35 @@ class HuggingFaceClient {
     }
   }
 }
+
+/// A cached Hub response.
+class _CachedMetadata {
+  /// The ETag the Hub sent, used to revalidate.
+  final String? etag;
+
+  /// When the Hub last confirmed [value].
+  final DateTime fetchedAt;
+
+  /// Parsed JSON body, or content length for HEAD requests.
+  final Object? value;
+
+  const _CachedMetadata({
+    required this.etag,
+    required this.fetchedAt,
+    required this.value,
+  });
+
+  factory _CachedMetadata.fromJson(Map<String, dynamic> json) {
+    return _CachedMetadata(
+      etag: json['etag'] as String?,
+      fetchedAt: DateTime.parse(json['fetchedAt'] as String),
+      value: json['value'],
+    );
+  }
+
+  Map<String, Object?> toJson() => {
+        'etag': etag,
+        'fetchedAt': fetchedAt.toIso8601String(),
+        'value': value,
+      };
+}
@@ -103,6 +103,37 @@ class InferenceContext {
     _tokens.removeRange(0, removeCount);
   }
 
+  /// Drops every token after the first [length].
+  ///
+  /// Unlike [truncate], which keeps the most recent tokens, this keeps the
+  /// start of the context, the way a KV cache is rewound.
+  ///
+  /// Throws [StateError] if the context has been disposed.
+  /// Throws [ArgumentError] if length is negative.
+  void rewind(int length) {
+    _checkDisposed();
+
+    if (length < 0) {
+      throw ArgumentError('length must be non-negative');
+    }
+
+    if (length >= tokenCount) {
+      return;
+    }
+
+    _tokens.removeRange(length, tokenCount);
+  }
+
+  /// Returns how many leading tokens this context shares with [tokens].
+  int commonPrefixLength(List<int> tokens) {
+    final limit = tokens.length < tokenCount ? tokens.length : tokenCount;
+    var length = 0;
+    while (length < limit && _tokens[length] == tokens[length]) {
+      length++;
+    }
+    return length;
+  }
+
   /// Estimates the memory usage of this context in bytes.
   ///
   /// This includes the KV cache memory based on the model dimensions
@@ -103,9 +103,18 @@ class InferenceEngine {
   /// The chat template for the loaded model.
   ChatTemplate? _chatTemplate;
 
+  /// Whether prompts are rendered by the model's own embedded template.
+  bool _useModelTemplate = false;
+
   /// The current inference context.
+  ///
+  /// With a [_session], mirrors the tokens resident in it.
   InferenceContext? _context;
 
+  /// Native session holding the conversation's KV state, or null if the
+  /// platform has none; chat then evaluates the whole prompt every turn.
+  SessionHandle? _session;
+
   /// Whether the engine has been disposed.
   bool _isDisposed = false;
 
@@ -191,6 +200,16 @@ class InferenceEngine {
     _chatTemplate =
         ChatTemplateFactory.forArchitecture(_modelInfo!.architecture);
 
+    // Prefer the template embedded in the model when the platform can
+    // render it; the Dart template still supplies stop sequences.
+    final probe = await _binding.applyChatTemplate(
+      ChatTemplateRequest(
+        modelHandle: _handle!,
+        messages: const [ChatMessage.user('')],
+      ),
+    );
+    _useModelTemplate = probe != null;
+
     // Create context
     final contextSize = effectiveConfig.contextSize ?? _modelInfo!.contextSize;
     _context = InferenceContext(
@@ -198,11 +217,14 @@ class InferenceEngine {
       contextSize: contextSize,
       kvCacheType: effectiveConfig.kvCacheType,
     );
+    _session = await _binding.createSession(_handle!);
 
     _logger.info('Model loaded: ${_modelInfo!.name}');
     _logger.info('Architecture: ${_modelInfo!.architecture}');
     _logger.info('Context size: $contextSize');
-    _logger.info('Chat template: ${_chatTemplate!.name}');
+    _logger.info(
+      'Chat template: ${_useModelTemplate ? 'model' : _chatTemplate!.name}',
+    );
 
     return _modelInfo!;
   }
@@ -215,6 +237,10 @@ class InferenceEngine {
 
     _logger.info('Unloading model: ${_modelInfo?.name}');
 
+    if (_session != null) {
+      await _binding.freeSession(_session!);
+      _session = null;
+    }
     await _binding.unloadModel(_handle!);
 
     _context?.dispose();
@@ -223,6 +249,7 @@ class InferenceEngine {
     _modelInfo = null;
     _tokenizer = null;
     _chatTemplate = null;
+    _useModelTemplate = false;
 
     _logger.info('Model unloaded');
   }
@@ -307,21 +334,25 @@ class InferenceEngine {
     _logger.debug('Chat generation, messages: ${messages.length}');
 
     // Format messages using chat template
-    final prompt = _chatTemplate!.apply(messages, addGenerationPrompt: true);
-
-    // Tokenize (without adding special tokens since template handles them)
-    final promptTokens =
-        await _tokenizer!.encode(prompt, addSpecialTokens: false);
+    final prompt = await _renderChat(messages);
+    final promptTokens = await _encodeChat(prompt);
 
     // Add stop sequences from template to config
     final effectiveConfig =
         _mergeStopSequences(config, _chatTemplate!.stopSequences);
 
     // Create generation request
-    final request = _createGenerateRequest(promptTokens, effectiveConfig);
+    final request = _createChatRequest(promptTokens, effectiveConfig);
 
     // Generate
-    final result = await _binding.generate(request);
+    final GenerateResult result;
+    try {
+      result = await _binding.generate(request);
+    } catch (_) {
+      _recordSessionTokens(const [], FinishReason.error);
+      rethrow;
+    }
+    _recordSessionTokens(result.tokens, result.finishReason);
 
     // Detokenize and extract response
     final rawText = await _tokenizer!.decode(result.tokens);
@@ -330,7 +361,7 @@ class InferenceEngine {
     return GenerationResult(
       text: cleanedText,
       tokens: result.tokens,
-      promptTokenCount: result.promptTokenCount,
+      promptTokenCount: promptTokens.length,
       completionTokenCount: result.completionTokenCount,
       finishReason: result.finishReason,
       generationTimeMs: result.generationTimeMs,
@@ -353,41 +384,54 @@ class InferenceEngine {
     _logger.debug('Streaming chat, messages: ${messages.length}');
 
     // Format messages using chat template
-    final prompt = _chatTemplate!.apply(messages, addGenerationPrompt: true);
-
-    // Tokenize
-    final promptTokens =
-        await _tokenizer!.encode(prompt, addSpecialTokens: false);
+    final prompt = await _renderChat(messages);
+    final promptTokens = await _encodeChat(prompt);
 
     // Add stop sequences from template
     final effectiveConfig =
         _mergeStopSequences(config, _chatTemplate!.stopSequences);
 
     // Create generation request
-    final request = _createGenerateRequest(promptTokens, effectiveConfig);
+    final request = _createChatRequest(promptTokens, effectiveConfig);
 
-    // Stream generation
+    // Stream generation; only non-final chunks carry resident tokens
     final buffer = StringBuffer();
-    await for (final chunk in _binding.generateStream(request)) {
-      final text = await _tokenizer!.decode([chunk.token]);
-      buffer.write(text);
-
-      // Check for stop sequences in accumulated text
-      bool shouldStop = false;
-      for (final stop in _chatTemplate!.stopSequences) {
-        if (buffer.toString().contains(stop)) {
-          shouldStop = true;
-          break;
+    final generated = <int>[];
+    var completed = false;
+    var failed = false;
+    try {
+      await for (final chunk in _binding.generateStream(request)) {
+        final text = await _tokenizer!.decode([chunk.token]);
+        buffer.write(text);
+        if (chunk.finishReason == null) {
+          generated.add(chunk.token);
+        } else {
+          failed = chunk.finishReason == FinishReason.error;
         }
-      }
 
-      yield GenerationChunk(
-        text: text,
-        token: chunk.token,
-        finishReason: shouldStop ? FinishReason.stop : chunk.finishReason,
-      );
+        // Check for stop sequences in accumulated text
+        bool shouldStop = false;
+        for (final stop in _chatTemplate!.stopSequences) {
+          if (buffer.toString().contains(stop)) {
+            shouldStop = true;
+            break;
+          }
+        }
 
-      if (shouldStop) break;
+        yield GenerationChunk(
+          text: text,
+          token: chunk.token,
+          finishReason: shouldStop ? FinishReason.stop : chunk.finishReason,
+        );
+
+        if (shouldStop) break;
+      }
+      completed = true;
+    } finally {
+      _recordSessionTokens(
+        generated,
+        completed && !failed ? null : FinishReason.error,
+      );
     }
   }
 
@@ -413,7 +457,9 @@ class InferenceEngine {
 
     final result = await _binding.embed(request);
 
-    return result.embedding.toList();
+    // The Float32List is already a List<double>; copying it would touch
+    // every element.
+    return result.embedding;
   }
 
   /// Sets a custom chat template.
@@ -421,9 +467,77 @@ class InferenceEngine {
   /// [template] is the template to use for subsequent chat operations.
   void setChatTemplate(ChatTemplate template) {
     _chatTemplate = template;
+    _useModelTemplate = false;
     _logger.info('Chat template set to: ${template.name}');
   }
 
+  /// Renders [messages] into a prompt ending with the assistant prefix.
+  ///
+  /// Uses the model's embedded template when available and falls back to
+  /// the Dart [ChatTemplate] otherwise.
+  Future<String> _renderChat(List<ChatMessage> messages) async {
+    if (_useModelTemplate) {
+      final result = await _binding.applyChatTemplate(
+        ChatTemplateRequest(modelHandle: _handle!, messages: messages),
+      );
+      if (result != null) return result.text;
+    }
+    return _chatTemplate!.apply(messages, addGenerationPrompt: true);
+  }
+
+  /// Tokenizes a prompt from [_renderChat].
+  ///
+  /// The Dart templates write BOS themselves, but the model's template
+  /// leaves it to the tokenizer, as llama.cpp does: adding special tokens
+  /// prepends BOS only when the vocabulary's add_bos flag asks for it.
+  Future<List<int>> _encodeChat(String prompt) {
+    return _tokenizer!.encode(prompt, addSpecialTokens: _useModelTemplate);
+  }
+
+  /// Creates the request for a chat turn.
+  ///
+  /// With a session, only the tokens after the longest prefix of
+  /// [promptTokens] the session already holds are sent, so earlier turns
+  /// are not evaluated again. The context is updated to mirror the session.
+  GenerateRequest _createChatRequest(
+    List<int> promptTokens,
+    GenerationConfig config,
+  ) {
+    final session = _session;
+    final context = _context!;
+    if (session == null || promptTokens.length > context.contextSize) {
+      return _createGenerateRequest(promptTokens, config);
+    }
+
+    final keep = context.commonPrefixLength(promptTokens);
+    final newTokens = promptTokens.sublist(keep);
+    context.rewind(keep);
+    context.addTokens(newTokens);
+
+    return _createGenerateRequest(
+      newTokens,
+      config,
+      session: session,
+      sessionKeepTokens: keep,
+    );
+  }
+
+  /// Records the tokens a chat turn left in the session.
+  ///
+  /// After a failure the session's contents are unknown, so the context is
+  /// cleared and the next turn sends its whole prompt.
+  void _recordSessionTokens(List<int> tokens, FinishReason? finishReason) {
+    final context = _context;
+    if (_session == null || context == null) return;
+
+    if (finishReason == FinishReason.error ||
+        tokens.length > context.remainingCapacity) {
+      context.clear();
+      return;
+    }
+    context.addTokens(tokens);
+  }
+
   /// Resets the inference context.
   ///
   /// Clears all tokens from the context, resetting it to its initial state.
@@ -454,8 +568,10 @@ class InferenceEngine {
   /// - String matching in extractResponse handles partial matches correctly
   GenerateRequest _createGenerateRequest(
     List<int> promptTokens,
-    GenerationConfig config,
-  ) {
+    GenerationConfig config, {
+    SessionHandle? session,
+    int sessionKeepTokens = 0,
+  }) {
     return GenerateRequest(
       modelHandle: _handle!,
       promptTokens: promptTokens,
@@ -470,6 +586,8 @@ class InferenceEngine {
       repeatLastN: config.repeatLastN,
       stopTokens: const [],
       seed: config.seed,
+      session: session,
+      sessionKeepTokens: sessionKeepTokens,
     );
   }
 
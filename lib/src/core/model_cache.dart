@@ -1,9 +1,12 @@
+import 'dart:convert';
 import 'dart:io';
 
 import 'package:dartllm/src/models/model_info.dart';
+import 'package:dartllm/src/utils/hash_utils.dart';
 import 'package:dartllm/src/utils/logger.dart';
 import 'package:dartllm/src/utils/path_utils.dart';
 import 'package:dartllm/src/utils/platform_utils.dart';
+import 'package:path/path.dart' as p;
 
 /// Manages cached model files on disk.
 ///
@@ -13,6 +16,13 @@ import 'package:dartllm/src/utils/platform_utils.dart';
 /// - Removing models from cache
 /// - Managing cache directory per platform
 ///
+/// Model files are stored by content under `blobs/<sha256>`, so the same
+/// file cached under several ids takes its space once. Entries live in a
+/// manifest that [initialize] loads into memory: each change is appended
+/// to `.manifest/log.jsonl`, and the log is folded into
+/// `.manifest/snapshot.json` once it grows, so listing and lookups do no
+/// I/O. A cache directory should be used by one process at a time.
+///
 /// Example usage:
 /// ```dart
 /// final cache = ModelCache();
@@ -31,6 +41,9 @@ class ModelCache {
   static const String _loggerName = 'dartllm.core.cache';
   final DartLLMLogger _logger = DartLLMLogger(_loggerName);
 
+  /// Log records after which the log is folded into the snapshot.
+  static const int _compactThreshold = 64;
+
   /// The base directory for the cache.
   final String? _customCacheDir;
 
@@ -40,6 +53,15 @@ class ModelCache {
   /// Whether the cache has been initialized.
   bool _initialized = false;
 
+  /// Manifest entries by model ID.
+  final Map<String, _ManifestEntry> _entries = {};
+
+  /// Records in the log since the last snapshot.
+  int _logRecords = 0;
+
+  /// Tail of the chain that serializes manifest writes.
+  Future<void> _writes = Future.value();
+
   /// Creates a ModelCache with an optional custom cache directory.
   ///
   /// If [cacheDirectory] is null, uses the platform-specific default.
@@ -56,7 +78,8 @@ class ModelCache {
     return _cacheDir!.path;
   }
 
-  /// Initializes the cache, creating the directory if needed.
+  /// Initializes the cache, creating the directory if needed, and loads
+  /// the manifest.
   ///
   /// This must be called before using other cache methods.
   Future<void> initialize() async {
@@ -71,8 +94,11 @@ class ModelCache {
       await _cacheDir!.create(recursive: true);
     }
 
+    await _loadManifest();
+    await _importLegacyMetadata();
+
     _initialized = true;
-    _logger.info('Cache initialized at: $dirPath');
+    _logger.info('Cache initialized at: $dirPath (${_entries.length} models)');
   }
 
   /// Lists all cached models.
@@ -81,27 +107,7 @@ class ModelCache {
   Future<List<CachedModelInfo>> listModels() async {
     _checkInitialized();
 
-    final models = <CachedModelInfo>[];
-    final metadataDir = Directory('${_cacheDir!.path}/.metadata');
-
-    if (!await metadataDir.exists()) {
-      return models;
-    }
-
-    await for (final entity in metadataDir.list()) {
-      if (entity is File && entity.path.endsWith('.json')) {
-        try {
-          final info = await _readModelMetadata(entity);
-          if (info != null) {
-            models.add(info);
-          }
-        } catch (e) {
-          _logger.warning('Failed to read metadata: ${entity.path}', e);
-        }
-      }
-    }
-
-    return models;
+    return [for (final entry in _entries.values) _toInfo(entry)];
   }
 
   /// Gets information about a specific cached model.
@@ -110,20 +116,15 @@ class ModelCache {
   Future<CachedModelInfo?> getModel(String modelId) async {
     _checkInitialized();
 
-    final metadataFile = _getMetadataFile(modelId);
-    if (!await metadataFile.exists()) {
-      return null;
-    }
-
-    return _readModelMetadata(metadataFile);
+    final entry = _entries[modelId];
+    return entry != null ? _toInfo(entry) : null;
   }
 
   /// Checks if a model is cached.
   Future<bool> hasModel(String modelId) async {
     _checkInitialized();
 
-    final metadataFile = _getMetadataFile(modelId);
-    return metadataFile.exists();
+    return _entries.containsKey(modelId);
   }
 
   /// Gets the file path for a cached model.
@@ -140,6 +141,11 @@ class ModelCache {
   /// [sourcePath] is the path to the model file to cache.
   /// [sourceUrl] is the optional URL the model was downloaded from.
   /// [move] if true, moves the file instead of copying (default: false).
+  /// [sha256] is the file's SHA-256, if known. Otherwise the file is hashed
+  /// before it is stored.
+  ///
+  /// If the cache already holds a file with the same content, the entry
+  /// shares it and the source is not stored again.
   ///
   /// Returns the cached model info.
   Future<CachedModelInfo> addModel(
@@ -147,6 +153,7 @@ class ModelCache {
     String sourcePath, {
     String? sourceUrl,
     bool move = false,
+    String? sha256,
   }) async {
     _checkInitialized();
 
@@ -158,35 +165,48 @@ class ModelCache {
     // Validate the path
     PathUtils.validatePath(sourcePath);
 
-    // Create target path
-    final sanitizedId = _sanitizeModelId(modelId);
-    final targetPath = '${_cacheDir!.path}/$sanitizedId';
-    final targetFile = File(targetPath);
+    final digest = sha256?.toLowerCase() ??
+        await HashUtils.sha256File(sourcePath);
+    final blobPath = 'blobs/$digest';
+    final blobFile = File(_resolvePath(blobPath));
 
-    // Copy or move the file
-    if (move) {
-      _logger.info('Moving model to cache: $modelId');
-      await sourceFile.rename(targetPath);
+    if (await blobFile.exists()) {
+      _logger.info('Model content already cached, sharing it: $modelId');
+      if (move) {
+        await sourceFile.delete();
+      }
     } else {
-      _logger.info('Copying model to cache: $modelId');
-      await sourceFile.copy(targetPath);
+      await blobFile.parent.create(recursive: true);
+      if (move) {
+        _logger.info('Moving model to cache: $modelId');
+        await sourceFile.rename(blobFile.path);
+      } else {
+        // Copy under a temporary name so a partial copy is never taken
+        // for the blob.
+        _logger.info('Copying model to cache: $modelId');
+        final temp = await sourceFile.copy('${blobFile.path}.tmp');
+        await temp.rename(blobFile.path);
+      }
     }
 
-    // Get file stats
-    final stat = await targetFile.stat();
-
-    // Create metadata
-    final info = CachedModelInfo(
+    final stat = await blobFile.stat();
+    final entry = _ManifestEntry(
       modelId: modelId,
-      filePath: targetPath,
+      path: blobPath,
       sizeBytes: stat.size,
       downloadedAt: DateTime.now(),
       sourceUrl: sourceUrl ?? 'local://$sourcePath',
+      sha256: digest,
     );
 
-    // Save metadata
-    await _writeModelMetadata(modelId, info);
+    final previous = _entries[modelId];
+    _entries[modelId] = entry;
+    await _record({'op': 'put', ...entry.toJson()});
+    if (previous != null) {
+      await _deleteIfUnreferenced(previous);
+    }
 
+    final info = _toInfo(entry);
     _logger.info('Model cached: $modelId (${info.sizeFormatted})');
 
     return info;
@@ -194,31 +214,20 @@ class ModelCache {
 
   /// Removes a model from the cache.
   ///
-  /// Returns the size in bytes of the removed file, or 0 if not found.
+  /// The file is deleted once no other cached model shares it.
+  ///
+  /// Returns the size in bytes of the removed file, or 0 if not found or
+  /// still shared.
   Future<int> removeModel(String modelId) async {
     _checkInitialized();
 
-    final info = await getModel(modelId);
-    if (info == null) {
+    final entry = _entries.remove(modelId);
+    if (entry == null) {
       return 0;
     }
 
-    final modelFile = File(info.filePath);
-    final metadataFile = _getMetadataFile(modelId);
-
-    int freedBytes = 0;
-
-    // Delete model file
-    if (await modelFile.exists()) {
-      freedBytes = info.sizeBytes;
-      await modelFile.delete();
-      _logger.info('Deleted model file: ${info.filePath}');
-    }
-
-    // Delete metadata
-    if (await metadataFile.exists()) {
-      await metadataFile.delete();
-    }
+    await _record({'op': 'remove', 'modelId': modelId});
+    final freedBytes = await _deleteIfUnreferenced(entry);
 
     _logger.info('Removed model from cache: $modelId');
 
@@ -232,10 +241,8 @@ class ModelCache {
     _checkInitialized();
 
     int totalFreed = 0;
-    final models = await listModels();
-
-    for (final model in models) {
-      totalFreed += await removeModel(model.modelId);
+    for (final modelId in _entries.keys.toList()) {
+      totalFreed += await removeModel(modelId);
     }
 
     _logger.info(
@@ -245,63 +252,231 @@ class ModelCache {
   }
 
   /// Gets the total size of the cache in bytes.
+  ///
+  /// Files shared by several models are counted once.
   Future<int> totalSize() async {
     _checkInitialized();
 
-    int total = 0;
-    final models = await listModels();
-
-    for (final model in models) {
-      total += model.sizeBytes;
-    }
-
-    return total;
+    final sizes = {
+      for (final entry in _entries.values) entry.path: entry.sizeBytes,
+    };
+    return sizes.values.fold<int>(0, (sum, size) => sum + size);
   }
 
   /// Gets the number of models in the cache.
   Future<int> modelCount() async {
-    final models = await listModels();
-    return models.length;
+    _checkInitialized();
+
+    return _entries.length;
   }
 
   /// Verifies a cached model file exists and matches expected size.
+  ///
+  /// When a SHA-256 is recorded, the file is also hashed, reading it in
+  /// fixed-size blocks so memory use stays bounded.
   Future<bool> verifyModel(String modelId) async {
-    final info = await getModel(modelId);
-    if (info == null) {
+    _checkInitialized();
+
+    final entry = _entries[modelId];
+    if (entry == null) {
       return false;
     }
 
-    final file = File(info.filePath);
+    final file = File(_resolvePath(entry.path));
     if (!await file.exists()) {
       return false;
     }
 
     final stat = await file.stat();
-    return stat.size == info.sizeBytes;
+    if (stat.size != entry.sizeBytes) {
+      return false;
+    }
+
+    if (entry.sha256 == null) {
+      return true;
+    }
+
+    _logger.debug('Hashing cached model: $modelId');
+    return await HashUtils.sha256File(file.path) == entry.sha256;
+  }
+
+  /// Deletes the file of [entry] unless another entry shares it.
+  ///
+  /// Returns the bytes freed.
+  Future<int> _deleteIfUnreferenced(_ManifestEntry entry) async {
+    if (_entries.values.any((other) => other.path == entry.path)) {
+      return 0;
+    }
+
+    final file = File(_resolvePath(entry.path));
+    if (!await file.exists()) {
+      return 0;
+    }
+
+    await file.delete();
+    _logger.info('Deleted model file: ${file.path}');
+    return entry.sizeBytes;
   }
 
-  /// Sanitizes a model ID for use as a filename.
-  String _sanitizeModelId(String modelId) {
-    return modelId
-        .replaceAll('/', '_')
-        .replaceAll('\\', '_')
-        .replaceAll(':', '_')
-        .replaceAll('?', '_')
-        .replaceAll('*', '_')
-        .replaceAll('"', '_')
-        .replaceAll('<', '_')
-        .replaceAll('>', '_')
-        .replaceAll('|', '_');
+  /// Converts a manifest entry to the public model info.
+  CachedModelInfo _toInfo(_ManifestEntry entry) {
+    return CachedModelInfo(
+      modelId: entry.modelId,
+      filePath: _resolvePath(entry.path),
+      sizeBytes: entry.sizeBytes,
+      downloadedAt: entry.downloadedAt,
+      sourceUrl: entry.sourceUrl,
+    );
   }
 
-  /// Gets the metadata file for a model.
-  File _getMetadataFile(String modelId) {
-    final sanitizedId = _sanitizeModelId(modelId);
-    return File('${_cacheDir!.path}/.metadata/$sanitizedId.json');
+  /// Resolves a manifest path, which is relative to the cache directory
+  /// unless the file lies outside it.
+  String _resolvePath(String path) {
+    return p.isAbsolute(path) ? path : p.join(_cacheDir!.path, path);
   }
 
-  /// Reads model metadata from a file.
-  Future<CachedModelInfo?> _readModelMetadata(File file) async {
+  /// The manifest directory.
+  String get _manifestDir => '${_cacheDir!.path}/.manifest';
+
+  /// The snapshot of all entries as of the last compaction.
+  File get _snapshotFile => File('$_manifestDir/snapshot.json');
+
+  /// The changes since the snapshot, one JSON record per line.
+  File get _logFile => File('$_manifestDir/log.jsonl');
+
+  /// Loads the snapshot and replays the log over it.
+  Future<void> _loadManifest() async {
+    final snapshot = _snapshotFile;
+    if (await snapshot.exists()) {
+      try {
+        final json =
+            jsonDecode(await snapshot.readAsString()) as Map<String, dynamic>;
+        for (final item in json['entries'] as List<dynamic>) {
+          final entry = _ManifestEntry.fromJson(item as Map<String, dynamic>);
+          _entries[entry.modelId] = entry;
+        }
+      } catch (e) {
+        _logger.warning('Failed to read manifest snapshot', e);
+      }
+    }
+
+    final log = _logFile;
+    if (await log.exists()) {
+      for (final line in await log.readAsLines()) {
+        if (line.isEmpty) continue;
+        try {
+          _apply(jsonDecode(line) as Map<String, dynamic>);
+          _logRecords++;
+        } catch (e) {
+          // A record cut short by a crash; nothing after it was written.
+          _logger.warning('Ignoring unreadable manifest record', e);
+          break;
+        }
+      }
+    }
+
+    if (_logRecords >= _compactThreshold) {
+      await _compact();
+    }
+  }
+
+  /// Applies one log record to the in-memory entries.
+  void _apply(Map<String, dynamic> record) {
+    switch (record['op']) {
+      case 'put':
+        final entry = _ManifestEntry.fromJson(record);
+        _entries[entry.modelId] = entry;
+      case 'remove':
+        _entries.remove(record['modelId']);
+    }
+  }
+
+  /// Appends [record] to the log, compacting it when it has grown.
+  ///
+  /// Writes run one at a time so compaction never drops a record.
+  Future<void> _record(Map<String, Object?> record) {
+    final write = _writes.then((_) async {
+      final log = _logFile;
+      await log.parent.create(recursive: true);
+      await log.writeAsString(
+        '${jsonEncode(record)}\n',
+        mode: FileMode.append,
+        flush: true,
+      );
+      if (++_logRecords >= _compactThreshold) {
+        await _compact();
+      }
+    });
+    _writes = write.catchError((Object _) {});
+    return write;
+  }
+
+  /// Writes all entries to a new snapshot and empties the log.
+  ///
+  /// Records are idempotent, so a crash between the two steps only
+  /// replays records the snapshot already holds.
+  Future<void> _compact() async {
+    await Directory(_manifestDir).create(recursive: true);
+
+    final snapshot = _snapshotFile;
+    final temp = File('${snapshot.path}.tmp');
+    await temp.writeAsString(
+      jsonEncode({
+        'version': 1,
+        'entries': [for (final entry in _entries.values) entry.toJson()],
+      }),
+      flush: true,
+    );
+    await temp.rename(snapshot.path);
+    await _logFile.writeAsString('', flush: true);
+    _logRecords = 0;
+  }
+
+  /// Moves the per-model metadata files of older versions into the
+  /// manifest. Their model files stay where they are.
+  ///
+  /// A file is deleted only once the manifest holds its model. Files that
+  /// cannot be parsed are kept, with the `.metadata` directory, so their
+  /// models are not silently dropped from the cache.
+  Future<void> _importLegacyMetadata() async {
+    final metadataDir = Directory('${_cacheDir!.path}/.metadata');
+    if (!await metadataDir.exists()) {
+      return;
+    }
+
+    var imported = 0;
+    final parsed = <File>[];
+    await for (final entity in metadataDir.list()) {
+      if (entity is File && entity.path.endsWith('.json')) {
+        final entry = await _readLegacyMetadata(entity);
+        if (entry == null) {
+          continue;
+        }
+        parsed.add(entity);
+        if (!_entries.containsKey(entry.modelId)) {
+          _entries[entry.modelId] = entry;
+          imported++;
+        }
+      }
+    }
+
+    await _compact();
+    for (final file in parsed) {
+      await file.delete();
+    }
+    if (await metadataDir.list().isEmpty) {
+      await metadataDir.delete();
+    } else {
+      _logger.warning(
+        'Kept metadata files that could not be imported in: '
+        '${metadataDir.path}',
+      );
+    }
+    _logger.info('Imported $imported models into the cache manifest');
+  }
+
+  /// Reads a metadata file written by older versions.
+  Future<_ManifestEntry?> _readLegacyMetadata(File file) async {
     try {
       final content = await file.readAsString();
       final lines = content.split('\n');
@@ -311,6 +486,7 @@ class ModelCache {
       int? sizeBytes;
       DateTime? downloadedAt;
       String? sourceUrl;
+      String? sha256;
 
       for (final line in lines) {
         final parts = line.split('=');
@@ -330,6 +506,8 @@ class ModelCache {
             downloadedAt = DateTime.tryParse(value);
           case 'sourceUrl':
             sourceUrl = value.isEmpty ? null : value;
+          case 'sha256':
+            sha256 = value.isEmpty ? null : value;
         }
       }
 
@@ -338,12 +516,16 @@ class ModelCache {
           sizeBytes != null &&
           downloadedAt != null &&
           sourceUrl != null) {
-        return CachedModelInfo(
+        final cacheDir = _cacheDir!.path;
+        return _ManifestEntry(
           modelId: modelId,
-          filePath: filePath,
+          path: p.isWithin(cacheDir, filePath)
+              ? p.relative(filePath, from: cacheDir)
+              : filePath,
           sizeBytes: sizeBytes,
           downloadedAt: downloadedAt,
           sourceUrl: sourceUrl,
+          sha256: sha256,
         );
       }
 
@@ -354,26 +536,6 @@ class ModelCache {
     }
   }
 
-  /// Writes model metadata to a file.
-  Future<void> _writeModelMetadata(String modelId, CachedModelInfo info) async {
-    final metadataFile = _getMetadataFile(modelId);
-    final metadataDir = metadataFile.parent;
-
-    if (!await metadataDir.exists()) {
-      await metadataDir.create(recursive: true);
-    }
-
-    final content = '''
-modelId=${info.modelId}
-filePath=${info.filePath}
-sizeBytes=${info.sizeBytes}
-downloadedAt=${info.downloadedAt.toIso8601String()}
-sourceUrl=${info.sourceUrl}
-''';
-
-    await metadataFile.writeAsString(content);
-  }
-
   /// Checks that the cache has been initialized.
   void _checkInitialized() {
     if (!_initialized) {
@@ -381,3 +543,48 @@ sourceUrl=${info.sourceUrl}
     }
   }
 }
+
+/// A cached model as recorded in the manifest.
+class _ManifestEntry {
+  final String modelId;
+
+  /// Path of the model file, relative to the cache directory unless the
+  /// file lies outside it.
+  final String path;
+
+  final int sizeBytes;
+  final DateTime downloadedAt;
+  final String sourceUrl;
+
+  /// SHA-256 of the file as lowercase hex, or null if never computed.
+  final String? sha256;
+
+  const _ManifestEntry({
+    required this.modelId,
+    required this.path,
+    required this.sizeBytes,
+    required this.downloadedAt,
+    required this.sourceUrl,
+    this.sha256,
+  });
+
+  factory _ManifestEntry.fromJson(Map<String, dynamic> json) {
+    return _ManifestEntry(
+      modelId: json['modelId'] as String,
+      path: json['path'] as String,
+      sizeBytes: json['sizeBytes'] as int,
+      downloadedAt: DateTime.parse(json['downloadedAt'] as String),
+      sourceUrl: json['sourceUrl'] as String,
+      sha256: json['sha256'] as String?,
+    );
+  }
+
+  Map<String, Object?> toJson() => {
+        'modelId': modelId,
+        'path': path,
+        'sizeBytes': sizeBytes,
+        'downloadedAt': downloadedAt.toIso8601String(),
+        'sourceUrl': sourceUrl,
+        if (sha256 != null) 'sha256': sha256,
+      };
+}
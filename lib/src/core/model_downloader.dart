@@ -1,8 +1,11 @@
 import 'dart:async';
+import 'dart:collection';
+import 'dart:convert';
 import 'dart:io';
+import 'dart:math' as math;
 
-import 'package:crypto/crypto.dart';
 import 'package:dartllm/src/core/exceptions/network_exception.dart';
+import 'package:dartllm/src/utils/hash_utils.dart';
 import 'package:dartllm/src/utils/logger.dart';
 
 /// Progress information for a download.
@@ -55,11 +58,15 @@ class DownloadResult {
   /// Duration of the download.
   final Duration duration;
 
+  /// SHA-256 of the file as lowercase hex, computed while downloading.
+  final String? sha256;
+
   /// Creates a download result.
   const DownloadResult({
     required this.filePath,
     required this.sizeBytes,
     required this.duration,
+    this.sha256,
   });
 
   /// Average download speed in bytes per second.
@@ -74,7 +81,8 @@ class DownloadResult {
 /// The ModelDownloader provides:
 /// - Progress callbacks during download
 /// - Resume capability for interrupted downloads
-/// - Checksum validation
+/// - Parallel segmented downloads over several connections
+/// - Checksum validation, hashed as the data arrives
 /// - Timeout handling
 ///
 /// Example usage:
@@ -176,6 +184,21 @@ class ModelDownloader {
         );
       }
 
+      // A server that ignores the range sends the whole file again.
+      if (startByte > 0 && response.statusCode == 200) {
+        _logger.info('Server ignored the range request, restarting');
+        startByte = 0;
+        downloadedBytes = 0;
+        lastProgressBytes = 0;
+      }
+
+      // The hash covers the whole file, so a resumed download first hashes
+      // the part already on disk.
+      final hasher = Sha256Hasher();
+      if (startByte > 0) {
+        await hasher.addFile(tempFile, length: startByte);
+      }
+
       // Get total size
       final contentLength = response.contentLength;
       final totalBytes = contentLength > 0
@@ -194,6 +217,7 @@ class ModelDownloader {
       try {
         await for (final chunk in response) {
           sink.add(chunk);
+          hasher.add(chunk);
           downloadedBytes += chunk.length;
 
           // Calculate progress
@@ -236,8 +260,8 @@ class ModelDownloader {
       }
 
       // Validate checksum if provided
+      final actualHash = hasher.close();
       if (expectedSha256 != null) {
-        final actualHash = await _computeSha256(tempFile);
         if (actualHash != expectedSha256.toLowerCase()) {
           await tempFile.delete();
           throw DownloadException(
@@ -256,6 +280,217 @@ class ModelDownloader {
         filePath: destinationPath,
         sizeBytes: downloadedBytes,
         duration: stopwatch.elapsed,
+        sha256: actualHash,
+      );
+
+      _logger.info(
+        'Download complete: ${result.sizeBytes ~/ (1024 * 1024)} MB in '
+        '${result.duration.inSeconds}s '
+        '(${(result.averageBytesPerSecond / (1024 * 1024)).toStringAsFixed(1)} MB/s)',
+      );
+
+      return result;
+    } on SocketException catch (e) {
+      throw ConnectionException(
+        'Connection failed: ${e.message}',
+        host: e.address?.host,
+        cause: e,
+      );
+    } on HttpException catch (e) {
+      throw DownloadException(
+        url,
+        message: 'HTTP error: ${e.message}',
+        cause: e,
+      );
+    }
+  }
+
+  /// Smallest segment [downloadSegmented] splits a file into by default.
+  static const int defaultMinSegmentSize = 16 * 1024 * 1024;
+
+  /// Downloads a file from a URL over several connections at once.
+  ///
+  /// The file is split into at most [segments] byte ranges of at least
+  /// [minSegmentSize] bytes, which up to [connections] concurrent requests
+  /// write at their offsets in a preallocated partial file. The progress
+  /// of each segment is recorded next to the partial file, so with
+  /// [resume] an interrupted download continues every segment where it
+  /// stopped. [onProgress] reports the bytes of all segments together.
+  ///
+  /// Falls back to [download] when the server does not report the size or
+  /// does not serve byte ranges. The SHA-256 is computed while the segments
+  /// arrive: bytes that extend the hashed prefix are hashed from memory, and
+  /// only bytes that arrived ahead of it are read back from the partial
+  /// file, once the segments before them are complete.
+  ///
+  /// Returns a [DownloadResult] on success.
+  ///
+  /// Throws [ArgumentError] if [segments] or [connections] is below 1.
+  /// Throws [DownloadException] if the download fails.
+  /// Throws [ConnectionException] if the connection fails.
+  Future<DownloadResult> downloadSegmented(
+    String url,
+    String destinationPath, {
+    void Function(DownloadProgress progress)? onProgress,
+    bool resume = true,
+    int segments = 8,
+    int connections = 4,
+    int minSegmentSize = defaultMinSegmentSize,
+    int? expectedSize,
+    String? expectedSha256,
+  }) async {
+    if (segments < 1) {
+      throw ArgumentError.value(segments, 'segments', 'must be at least 1');
+    }
+    if (connections < 1) {
+      throw ArgumentError.value(
+          connections, 'connections', 'must be at least 1');
+    }
+
+    _logger.info('Starting segmented download: $url');
+
+    final tempFile = File('$destinationPath.part');
+    final stateFile = File('$destinationPath.part.segments');
+
+    try {
+      final totalBytes = await _probeRangeSupport(url);
+      if (totalBytes == null) {
+        _logger.info('Server does not serve ranges, using one connection');
+        // A preallocated file would look like a finished prefix.
+        if (await stateFile.exists()) {
+          await stateFile.delete();
+          if (await tempFile.exists()) {
+            await tempFile.delete();
+          }
+        }
+        return download(
+          url,
+          destinationPath,
+          onProgress: onProgress,
+          resume: resume,
+          expectedSize: expectedSize,
+          expectedSha256: expectedSha256,
+        );
+      }
+
+      if (expectedSize != null && totalBytes != expectedSize) {
+        throw DownloadException(
+          url,
+          message: 'Size mismatch: expected $expectedSize, got $totalBytes',
+          totalBytes: expectedSize,
+        );
+      }
+
+      final previous = resume && await tempFile.exists()
+          ? await _readSegments(stateFile, url, totalBytes)
+          : null;
+      final List<_Segment> plan;
+      if (previous != null) {
+        plan = previous;
+        _logger.info('Resuming ${plan.where((s) => !s.isComplete).length} '
+            'of ${plan.length} segments');
+      } else {
+        plan = _planSegments(totalBytes, segments, minSegmentSize);
+        final raf = await tempFile.open(mode: FileMode.write);
+        try {
+          await raf.truncate(totalBytes);
+        } finally {
+          await raf.close();
+        }
+        await _writeSegments(stateFile, url, totalBytes, plan);
+      }
+
+      _logger.info('Total size: ${totalBytes ~/ (1024 * 1024)} MB in '
+          '${plan.length} segments over $connections connections');
+
+      final stopwatch = Stopwatch()..start();
+      final pending = Queue<_Segment>.of(plan.where((s) => !s.isComplete));
+      var downloadedBytes = plan.fold<int>(0, (sum, s) => sum + s.done);
+      var lastProgressBytes = downloadedBytes;
+      var lastProgressTime = DateTime.now();
+      var failed = false;
+      final hasher = _PrefixHasher(tempFile, plan);
+
+      bool onChunk(int offset, List<int> chunk) {
+        hasher.add(offset, chunk);
+        downloadedBytes += chunk.length;
+
+        final now = DateTime.now();
+        final elapsed = now.difference(lastProgressTime).inMilliseconds;
+        if (elapsed >= 100) {
+          final bytesDelta = downloadedBytes - lastProgressBytes;
+          onProgress?.call(DownloadProgress(
+            downloadedBytes: downloadedBytes,
+            totalBytes: totalBytes,
+            bytesPerSecond: bytesDelta / (elapsed / 1000),
+          ));
+          lastProgressBytes = downloadedBytes;
+          lastProgressTime = now;
+        }
+        return !failed;
+      }
+
+      Future<void> worker() async {
+        final raf = await tempFile.open(mode: FileMode.append);
+        try {
+          while (!failed && pending.isNotEmpty) {
+            await _fetchSegment(url, pending.removeFirst(), raf, onChunk);
+          }
+        } catch (_) {
+          failed = true;
+          rethrow;
+        } finally {
+          await raf.close();
+        }
+      }
+
+      // Record segment progress now and then so a crash loses little.
+      Future<void>? saving;
+      final saveTimer = Timer.periodic(const Duration(seconds: 1), (_) {
+        saving ??= _writeSegments(stateFile, url, totalBytes, plan)
+            .catchError((Object e) {
+          _logger.warning('Failed to record segment progress', e);
+        }).whenComplete(() => saving = null);
+      });
+
+      try {
+        await Future.wait([
+          for (var i = 0; i < math.min(connections, pending.length); i++)
+            worker(),
+        ]);
+      } catch (_) {
+        saveTimer.cancel();
+        await saving;
+        await _writeSegments(stateFile, url, totalBytes, plan);
+        rethrow;
+      }
+      saveTimer.cancel();
+      await saving;
+
+      stopwatch.stop();
+
+      final actualHash = await hasher.close();
+      if (expectedSha256 != null) {
+        if (actualHash != expectedSha256.toLowerCase()) {
+          await tempFile.delete();
+          await stateFile.delete();
+          throw DownloadException(
+            url,
+            message:
+                'Checksum mismatch: expected $expectedSha256, got $actualHash',
+          );
+        }
+        _logger.info('Checksum verified');
+      }
+
+      await tempFile.rename(destinationPath);
+      await stateFile.delete();
+
+      final result = DownloadResult(
+        filePath: destinationPath,
+        sizeBytes: totalBytes,
+        duration: stopwatch.elapsed,
+        sha256: actualHash,
       );
 
       _logger.info(
@@ -280,6 +515,141 @@ class ModelDownloader {
     }
   }
 
+  /// Returns the size of the file at [url] if the server serves byte
+  /// ranges of it, or null otherwise.
+  Future<int?> _probeRangeSupport(String url) async {
+    final request = await _client.getUrl(Uri.parse(url));
+    request.headers.set('Range', 'bytes=0-0');
+    final response = await request.close();
+
+    if (response.statusCode != 206) {
+      // Cancelling closes the connection instead of reading a whole body.
+      await response.listen(null).cancel();
+      return null;
+    }
+    await response.drain<void>();
+
+    // Content-Range: bytes 0-0/<size>
+    final contentRange = response.headers.value('content-range');
+    if (contentRange == null) {
+      return null;
+    }
+    final size = int.tryParse(
+      contentRange.substring(contentRange.lastIndexOf('/') + 1),
+    );
+    return size != null && size > 0 ? size : null;
+  }
+
+  /// Fetches the rest of [segment] into [raf] at its offset.
+  ///
+  /// [onChunk] is called with each chunk written and its file offset, and
+  /// stops the fetch early by returning false.
+  Future<void> _fetchSegment(
+    String url,
+    _Segment segment,
+    RandomAccessFile raf,
+    bool Function(int offset, List<int> chunk) onChunk,
+  ) async {
+    final request = await _client.getUrl(Uri.parse(url));
+    request.headers.set(
+        'Range', 'bytes=${segment.position}-${segment.end - 1}');
+    final response = await request.close();
+
+    // A full response would overwrite other segments.
+    if (response.statusCode != 206) {
+      await response.listen(null).cancel();
+      throw DownloadException(
+        url,
+        message: 'HTTP ${response.statusCode}: expected a partial response '
+            'for bytes ${segment.position}-${segment.end - 1}',
+        statusCode: response.statusCode,
+      );
+    }
+
+    await raf.setPosition(segment.position);
+    await for (final chunk in response) {
+      final offset = segment.position;
+      final length = math.min(chunk.length, segment.end - offset);
+      await raf.writeFrom(chunk, 0, length);
+      segment.done += length;
+      final written =
+          length < chunk.length ? chunk.sublist(0, length) : chunk;
+      if (!onChunk(offset, written) || segment.isComplete) {
+        break;
+      }
+    }
+
+    if (!segment.isComplete) {
+      throw DownloadException(
+        url,
+        message: 'Connection closed at byte ${segment.position} of segment '
+            '${segment.start}-${segment.end - 1}',
+        bytesDownloaded: segment.position,
+        totalBytes: segment.end,
+      );
+    }
+  }
+
+  /// Splits [totalBytes] into at most [segments] near-equal ranges of at
+  /// least [minSegmentSize] bytes.
+  static List<_Segment> _planSegments(
+    int totalBytes,
+    int segments,
+    int minSegmentSize,
+  ) {
+    final count = math.max(
+      1,
+      math.min(segments, totalBytes ~/ math.max(1, minSegmentSize)),
+    );
+    return [
+      for (var i = 0; i < count; i++)
+        _Segment(totalBytes * i ~/ count, totalBytes * (i + 1) ~/ count),
+    ];
+  }
+
+  /// Reads the segment record of a previous attempt, or null if there is
+  /// none or it belongs to a different file.
+  Future<List<_Segment>?> _readSegments(
+    File stateFile,
+    String url,
+    int totalBytes,
+  ) async {
+    if (!await stateFile.exists()) {
+      return null;
+    }
+    try {
+      final state =
+          jsonDecode(await stateFile.readAsString()) as Map<String, dynamic>;
+      if (state['url'] != url || state['size'] != totalBytes) {
+        return null;
+      }
+      return [
+        for (final entry in state['segments'] as List<dynamic>)
+          _Segment.fromJson(entry as List<dynamic>),
+      ];
+    } on FormatException catch (e) {
+      _logger.warning('Ignoring unreadable segment record', e);
+      return null;
+    }
+  }
+
+  /// Records the progress of [segments], replacing the previous record in
+  /// one rename so it is never seen half written.
+  Future<void> _writeSegments(
+    File stateFile,
+    String url,
+    int totalBytes,
+    List<_Segment> segments,
+  ) async {
+    final temp = File('${stateFile.path}.tmp');
+    await temp.writeAsString(jsonEncode({
+      'url': url,
+      'size': totalBytes,
+      'segments': [for (final segment in segments) segment.toJson()],
+    }));
+    await temp.rename(stateFile.path);
+  }
+
   /// Checks if a URL is reachable and gets the content length.
   ///
   /// Returns the content length in bytes, or null if unknown.
@@ -304,14 +674,109 @@ class ModelDownloader {
   void close() {
     _client.close(force: true);
   }
+}
+
+/// Hashes a segmented download in file order while its segments arrive.
+///
+/// A chunk written right at the end of the hashed prefix is hashed as it
+/// is. Bytes written further on are read back from the partial file once
+/// every byte before them is written, so each byte is hashed exactly once.
+class _PrefixHasher {
+  final File _file;
+  final List<_Segment> _segments;
+  final Sha256Hasher _hasher = Sha256Hasher();
+
+  /// Length of the prefix hashed so far.
+  int _hashed = 0;
+
+  /// Read-back of the written prefix, while one is running.
+  Future<void>? _reading;
+
+  /// Why a read-back failed.
+  AsyncError? _failure;
+
+  _PrefixHasher(this._file, this._segments);
+
+  /// End of the bytes written contiguously from the start of the file.
+  int get _writtenEnd {
+    for (final segment in _segments) {
+      if (!segment.isComplete) {
+        return segment.position;
+      }
+    }
+    return _segments.last.end;
+  }
+
+  /// Hashes [chunk], just written at [offset], or the written bytes it
+  /// completes the prefix up to.
+  void add(int offset, List<int> chunk) {
+    // While a read-back runs it will reach these bytes on disk.
+    if (_reading == null && offset == _hashed) {
+      _hasher.add(chunk);
+      _hashed += chunk.length;
+    }
+    _catchUp();
+  }
+
+  /// Starts reading back written bytes past the hashed prefix.
+  void _catchUp() {
+    if (_reading != null || _failure != null || _hashed >= _writtenEnd) {
+      return;
+    }
+    _reading = _readWritten().then((_) {
+      _reading = null;
+      _catchUp();
+    }, onError: (Object error, StackTrace stackTrace) {
+      _reading = null;
+      _failure = AsyncError(error, stackTrace);
+    });
+  }
+
+  Future<void> _readWritten() async {
+    while (_hashed < _writtenEnd) {
+      final end = _writtenEnd;
+      await _hasher.addFile(_file, offset: _hashed, length: end - _hashed);
+      _hashed = end;
+    }
+  }
 
-  /// Computes SHA-256 hash of a file.
-  Future<String> _computeSha256(File file) async {
-    _logger.debug('Computing SHA-256 hash');
+  /// Hashes the rest of the written file and returns the hash as
+  /// lowercase hex.
+  Future<String> close() async {
+    _catchUp();
+    while (_reading != null) {
+      await _reading;
+    }
+    final failure = _failure;
+    if (failure != null) {
+      Error.throwWithStackTrace(failure.error, failure.stackTrace);
+    }
+    return _hasher.close();
+  }
+}
+
+/// A byte range of a segmented download and how much of it is written.
+class _Segment {
+  /// First byte of the range.
+  final int start;
 
-    final bytes = await file.readAsBytes();
-    final digest = sha256.convert(bytes);
+  /// End of the range, exclusive.
+  final int end;
 
-    return digest.toString();
+  /// Bytes written from [start].
+  int done;
+
+  _Segment(this.start, this.end, [this.done = 0]);
+
+  factory _Segment.fromJson(List<dynamic> json) {
+    return _Segment(json[0] as int, json[1] as int, json[2] as int);
   }
+
+  /// Next byte to fetch.
+  int get position => start + done;
+
+  /// Whether the whole range is written.
+  bool get isComplete => position >= end;
+
+  List<int> toJson() => [start, end, done];
 }
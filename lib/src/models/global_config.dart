@@ -48,6 +48,17 @@ sealed class GlobalConfig with _$GlobalConfig {
     /// Default: 0 (automatic)
     @Default(0) int defaultThreadCount,
 
+    /// Number of worker isolates models run on.
+    ///
+    /// - `0`: Run inference on the calling isolate
+    /// - `n > 0`: Load each model on one of n worker isolates, so models
+    ///   run in parallel and the calling isolate stays responsive
+    ///
+    /// Read when the first model is loaded; takes effect again after
+    /// `DartLLM.dispose()`.
+    /// Default: 0 (calling isolate)
+    @Default(0) int isolateWorkers,
+
     /// Whether to enable internal debug logging.
     ///
     /// When enabled, DartLLM outputs diagnostic information through
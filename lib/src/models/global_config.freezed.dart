@@ -42,6 +42,17 @@ mixin _$GlobalConfig {
   /// Default: 0 (automatic)
   int get defaultThreadCount;
 
+  /// Number of worker isolates models run on.
+  ///
+  /// - `0`: Run inference on the calling isolate
+  /// - `n > 0`: Load each model on one of n worker isolates, so models
+  ///   run in parallel and the calling isolate stays responsive
+  ///
+  /// Read when the first model is loaded; takes effect again after
+  /// `DartLLM.dispose()`.
+  /// Default: 0 (calling isolate)
+  int get isolateWorkers;
+
   /// Whether to enable internal debug logging.
   ///
   /// When enabled, DartLLM outputs diagnostic information through
@@ -80,6 +91,8 @@ mixin _$GlobalConfig {
                 other.defaultGpuLayers == defaultGpuLayers) &&
             (identical(other.defaultThreadCount, defaultThreadCount) ||
                 other.defaultThreadCount == defaultThreadCount) &&
+            (identical(other.isolateWorkers, isolateWorkers) ||
+                other.isolateWorkers == isolateWorkers) &&
             (identical(other.enableLogging, enableLogging) ||
                 other.enableLogging == enableLogging) &&
             (identical(other.logLevel, logLevel) ||
@@ -94,13 +107,14 @@ mixin _$GlobalConfig {
       defaultCacheDirectory,
       defaultGpuLayers,
       defaultThreadCount,
+      isolateWorkers,
       enableLogging,
       logLevel,
       huggingFaceToken);
 
   @override
   String toString() {
-    return 'GlobalConfig(defaultCacheDirectory: $defaultCacheDirectory, defaultGpuLayers: $defaultGpuLayers, defaultThreadCount: $defaultThreadCount, enableLogging: $enableLogging, logLevel: $logLevel, huggingFaceToken: $huggingFaceToken)';
+    return 'GlobalConfig(defaultCacheDirectory: $defaultCacheDirectory, defaultGpuLayers: $defaultGpuLayers, defaultThreadCount: $defaultThreadCount, isolateWorkers: $isolateWorkers, enableLogging: $enableLogging, logLevel: $logLevel, huggingFaceToken: $huggingFaceToken)';
   }
 }
 
@@ -114,6 +128,7 @@ abstract mixin class $GlobalConfigCopyWith<$Res> {
       {String? defaultCacheDirectory,
       int defaultGpuLayers,
       int defaultThreadCount,
+      int isolateWorkers,
       bool enableLogging,
       LogLevel logLevel,
       String? huggingFaceToken});
@@ -134,6 +149,7 @@ class _$GlobalConfigCopyWithImpl<$Res> implements $GlobalConfigCopyWith<$Res> {
     Object? defaultCacheDirectory = freezed,
     Object? defaultGpuLayers = null,
     Object? defaultThreadCount = null,
+    Object? isolateWorkers = null,
     Object? enableLogging = null,
     Object? logLevel = null,
     Object? huggingFaceToken = freezed,
@@ -151,6 +167,10 @@ class _$GlobalConfigCopyWithImpl<$Res> implements $GlobalConfigCopyWith<$Res> {
           ? _self.defaultThreadCount
           : defaultThreadCount // ignore: cast_nullable_to_non_nullable
               as int,
+      isolateWorkers: null == isolateWorkers
+          ? _self.isolateWorkers
+          : isolateWorkers // ignore: cast_nullable_to_non_nullable
+              as int,
       enableLogging: null == enableLogging
           ? _self.enableLogging
           : enableLogging // ignore: cast_nullable_to_non_nullable
@@ -262,6 +282,7 @@ extension GlobalConfigPatterns on GlobalConfig {
             String? defaultCacheDirectory,
             int defaultGpuLayers,
             int defaultThreadCount,
+            int isolateWorkers,
             bool enableLogging,
             LogLevel logLevel,
             String? huggingFaceToken)?
@@ -275,6 +296,7 @@ extension GlobalConfigPatterns on GlobalConfig {
             _that.defaultCacheDirectory,
             _that.defaultGpuLayers,
             _that.defaultThreadCount,
+            _that.isolateWorkers,
             _that.enableLogging,
             _that.logLevel,
             _that.huggingFaceToken);
@@ -302,6 +324,7 @@ extension GlobalConfigPatterns on GlobalConfig {
             String? defaultCacheDirectory,
             int defaultGpuLayers,
             int defaultThreadCount,
+            int isolateWorkers,
             bool enableLogging,
             LogLevel logLevel,
             String? huggingFaceToken)
@@ -314,6 +337,7 @@ extension GlobalConfigPatterns on GlobalConfig {
             _that.defaultCacheDirectory,
             _that.defaultGpuLayers,
             _that.defaultThreadCount,
+            _that.isolateWorkers,
             _that.enableLogging,
             _that.logLevel,
             _that.huggingFaceToken);
@@ -338,6 +362,7 @@ extension GlobalConfigPatterns on GlobalConfig {
             String? defaultCacheDirectory,
             int defaultGpuLayers,
             int defaultThreadCount,
+            int isolateWorkers,
             bool enableLogging,
             LogLevel logLevel,
             String? huggingFaceToken)?
@@ -350,6 +375,7 @@ extension GlobalConfigPatterns on GlobalConfig {
             _that.defaultCacheDirectory,
             _that.defaultGpuLayers,
             _that.defaultThreadCount,
+            _that.isolateWorkers,
             _that.enableLogging,
             _that.logLevel,
             _that.huggingFaceToken);
@@ -366,6 +392,7 @@ class _GlobalConfig extends GlobalConfig {
       {this.defaultCacheDirectory,
       this.defaultGpuLayers = -1,
       this.defaultThreadCount = 0,
+      this.isolateWorkers = 0,
       this.enableLogging = false,
       this.logLevel = LogLevel.warning,
       this.huggingFaceToken})
@@ -404,6 +431,19 @@ class _GlobalConfig extends GlobalConfig {
   @JsonKey()
   final int defaultThreadCount;
 
+  /// Number of worker isolates models run on.
+  ///
+  /// - `0`: Run inference on the calling isolate
+  /// - `n > 0`: Load each model on one of n worker isolates, so models
+  ///   run in parallel and the calling isolate stays responsive
+  ///
+  /// Read when the first model is loaded; takes effect again after
+  /// `DartLLM.dispose()`.
+  /// Default: 0 (calling isolate)
+  @override
+  @JsonKey()
+  final int isolateWorkers;
+
   /// Whether to enable internal debug logging.
   ///
   /// When enabled, DartLLM outputs diagnostic information through
@@ -447,6 +487,8 @@ class _GlobalConfig extends GlobalConfig {
                 other.defaultGpuLayers == defaultGpuLayers) &&
             (identical(other.defaultThreadCount, defaultThreadCount) ||
                 other.defaultThreadCount == defaultThreadCount) &&
+            (identical(other.isolateWorkers, isolateWorkers) ||
+                other.isolateWorkers == isolateWorkers) &&
             (identical(other.enableLogging, enableLogging) ||
                 other.enableLogging == enableLogging) &&
             (identical(other.logLevel, logLevel) ||
@@ -461,13 +503,14 @@ class _GlobalConfig extends GlobalConfig {
       defaultCacheDirectory,
       defaultGpuLayers,
       defaultThreadCount,
+      isolateWorkers,
       enableLogging,
       logLevel,
       huggingFaceToken);
 
   @override
   String toString() {
-    return 'GlobalConfig(defaultCacheDirectory: $defaultCacheDirectory, defaultGpuLayers: $defaultGpuLayers, defaultThreadCount: $defaultThreadCount, enableLogging: $enableLogging, logLevel: $logLevel, huggingFaceToken: $huggingFaceToken)';
+    return 'GlobalConfig(defaultCacheDirectory: $defaultCacheDirectory, defaultGpuLayers: $defaultGpuLayers, defaultThreadCount: $defaultThreadCount, isolateWorkers: $isolateWorkers, enableLogging: $enableLogging, logLevel: $logLevel, huggingFaceToken: $huggingFaceToken)';
   }
 }
 
@@ -483,6 +526,7 @@ abstract mixin class _$GlobalConfigCopyWith<$Res>
       {String? defaultCacheDirectory,
       int defaultGpuLayers,
       int defaultThreadCount,
+      int isolateWorkers,
       bool enableLogging,
       LogLevel logLevel,
       String? huggingFaceToken});
@@ -504,6 +548,7 @@ class __$GlobalConfigCopyWithImpl<$Res>
     Object? defaultCacheDirectory = freezed,
     Object? defaultGpuLayers = null,
     Object? defaultThreadCount = null,
+    Object? isolateWorkers = null,
     Object? enableLogging = null,
     Object? logLevel = null,
     Object? huggingFaceToken = freezed,
@@ -521,6 +566,10 @@ class __$GlobalConfigCopyWithImpl<$Res>
           ? _self.defaultThreadCount
           : defaultThreadCount // ignore: cast_nullable_to_non_nullable
               as int,
+      isolateWorkers: null == isolateWorkers
+          ? _self.isolateWorkers
+          : isolateWorkers // ignore: cast_nullable_to_non_nullable
+              as int,
       enableLogging: null == enableLogging
           ? _self.enableLogging
           : enableLogging // ignore: cast_nullable_to_non_nullable
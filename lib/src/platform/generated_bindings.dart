@@ -120,6 +120,142 @@ class DartLLMBindings {
         int,
       )>();
 
+  /// Get the thread configuration for a model, or the recommendation for this host.
+  ///
+  /// When threads is 0, dartllm_load_model() picks separate decode and prefill
+  /// thread counts from the CPU topology: one decode thread per performance
+  /// core (SMT siblings excluded) and one prefill thread per physical core,
+  /// both clamped to the cgroup CPU quota.
+  ///
+  /// @param model Model handle, or NULL for the host recommendation
+  /// @param out   Output: thread configuration
+  ///
+  /// @return 0 on success, negative error code on failure
+  int dartllm_get_thread_config(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<DartLLMThreadConfig> out,
+  ) {
+    return _dartllm_get_thread_config(model, out);
+  }
+
+  late final _dartllm_get_thread_configPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<DartLLMThreadConfig>,
+          )>>('dartllm_get_thread_config');
+  late final _dartllm_get_thread_config = _dartllm_get_thread_configPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<DartLLMThreadConfig>,
+      )>();
+
+  /// Measure decode and prefill speed at a few candidate thread counts and
+  /// apply the fastest to the model's context.
+  ///
+  /// Takes a few hundred milliseconds to a few seconds depending on the model.
+  /// Results are cached per model file (path, size, mtime) and host CPU
+  /// configuration: in memory for the lifetime of the process, and on disk
+  /// when cache_dir is given. Models loaded later with threads = 0 reuse an
+  /// in-memory result. Clears the model's KV cache.
+  ///
+  /// @param model     Model handle
+  /// @param cache_dir Directory for the persistent cache, or NULL for none
+  /// @param out       Output: applied thread configuration (may be NULL)
+  ///
+  /// @return 0 on success, negative error code on failure
+  int dartllm_calibrate_threads(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Char> cache_dir,
+    ffi.Pointer<DartLLMThreadConfig> out,
+  ) {
+    return _dartllm_calibrate_threads(model, cache_dir, out);
+  }
+
+  late final _dartllm_calibrate_threadsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Char>,
+            ffi.Pointer<DartLLMThreadConfig>,
+          )>>('dartllm_calibrate_threads');
+  late final _dartllm_calibrate_threads = _dartllm_calibrate_threadsPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Char>,
+        ffi.Pointer<DartLLMThreadConfig>,
+      )>();
+
+  /// Start warming up a model in a background thread.
+  ///
+  /// With use_mmap the first request after loading pays page faults across
+  /// the whole weight file. Warm-up moves that cost off the request path:
+  /// DARTLLM_WARMUP_READ reads the file sequentially into the page cache
+  /// (reporting progress), DARTLLM_WARMUP_ADVISE only asks the kernel to
+  /// read ahead, and DARTLLM_WARMUP_DECODE then runs one dummy decode so
+  /// backend kernels and compute buffers are ready. Prefetching is skipped
+  /// for models loaded without use_mmap.
+  ///
+  /// Requests may run while warm-up is in progress; the dummy decode waits
+  /// for them. Freeing the model cancels the warm-up.
+  ///
+  /// @param model Model handle from dartllm_load_model()
+  /// @param mode  Bitwise OR of DARTLLM_WARMUP_* mode flags
+  ///
+  /// @return 0 if started, -1 on invalid arguments, -2 if already running
+  int dartllm_warmup(
+    ffi.Pointer<ffi.Void> model,
+    int mode,
+  ) {
+    return _dartllm_warmup(model, mode);
+  }
+
+  late final _dartllm_warmupPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+              ffi.Pointer<ffi.Void>, ffi.Int32)>>('dartllm_warmup');
+  late final _dartllm_warmup = _dartllm_warmupPtr
+      .asFunction<int Function(ffi.Pointer<ffi.Void>, int)>();
+
+  /// Get the progress of the current or last warm-up.
+  ///
+  /// @param model Model handle from dartllm_load_model()
+  /// @param out   Output: warm-up status
+  ///
+  /// @return 0 on success, negative on invalid arguments
+  int dartllm_warmup_status(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<DartLLMWarmupStatus> out,
+  ) {
+    return _dartllm_warmup_status(model, out);
+  }
+
+  late final _dartllm_warmup_statusPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<ffi.Void>,
+              ffi.Pointer<DartLLMWarmupStatus>)>>('dartllm_warmup_status');
+  late final _dartllm_warmup_status = _dartllm_warmup_statusPtr.asFunction<
+      int Function(ffi.Pointer<ffi.Void>, ffi.Pointer<DartLLMWarmupStatus>)>();
+
+  /// Block until the current warm-up finishes.
+  ///
+  /// @param model Model handle from dartllm_load_model()
+  ///
+  /// @return 0 if the warm-up completed (or none was started), -1 if it
+  /// failed or was cancelled; see dartllm_get_last_error()
+  int dartllm_warmup_wait(
+    ffi.Pointer<ffi.Void> model,
+  ) {
+    return _dartllm_warmup_wait(model);
+  }
+
+  late final _dartllm_warmup_waitPtr =
+      _lookup<ffi.NativeFunction<ffi.Int32 Function(ffi.Pointer<ffi.Void>)>>(
+    'dartllm_warmup_wait',
+  );
+  late final _dartllm_warmup_wait = _dartllm_warmup_waitPtr
+      .asFunction<int Function(ffi.Pointer<ffi.Void>)>();
+
   /// Unload a model and free all associated resources.
   ///
   /// @param model Model handle from dartllm_load_model()
@@ -134,6 +270,25 @@ class DartLLMBindings {
   late final _dartllm_free_model =
       _dartllm_free_modelPtr.asFunction<void Function(ffi.Pointer<ffi.Void>)>();
 
+  /// Unload a model and free all associated resources.
+  ///
+  /// @param model Model handle from dartllm_load_model()
+  void dartllm_free_model(
+    ffi.Pointer<ffi.Void> model,
+  ) {
+    return _dartllm_free_model(model);
+  }
+
+  late final _dartllm_free_modelPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_free_model');
+  late final _dartllm_free_model = _dartllm_free_modelPtr.asFunction<
+      void Function(
+        ffi.Pointer<ffi.Void>,
+      )>();
+
   /// Get information about a loaded model.
   ///
   /// @param model Model handle from dartllm_load_model()
@@ -153,221 +308,1789 @@ class DartLLMBindings {
   late final _dartllm_get_model_info = _dartllm_get_model_infoPtr.asFunction<
       ffi.Pointer<DartLLMModelInfo> Function(ffi.Pointer<ffi.Void>)>();
 
-  /// Tokenize text to token IDs.
+  /// Estimate the memory a model would need, without loading it.
   ///
-  /// @param model         Model handle
-  /// @param text          Input text (UTF-8, null-terminated)
-  /// @param add_special   Non-zero to add BOS/EOS tokens
-  /// @param out_length    Output: number of tokens produced
+  /// Reads only the GGUF header and tensor table; the weights are neither read
+  /// nor mapped, so this takes milliseconds. The context size is clamped to
+  /// the model's training context exactly as dartllm_load_model() does.
   ///
-  /// @return Array of token IDs, or NULL on failure.
+  /// @param path          Path to the GGUF model file (UTF-8)
+  /// @param context_size  Context size in tokens (0 for model default)
+  /// @param batch_size    Batch size for prompt processing (0 for default)
+  /// @param type_k        ggml type of the K cache (-1 for F16)
+  /// @param type_v        ggml type of the V cache (-1 for F16)
+  ///
+  /// @return Pointer to DartLLMMemoryEstimate, or NULL on failure.
   /// Must be freed with dartllm_free().
-  ffi.Pointer<ffi.Int32> dartllm_tokenize(
-    ffi.Pointer<ffi.Void> model,
-    ffi.Pointer<ffi.Char> text,
-    int add_special,
-    ffi.Pointer<ffi.Int32> out_length,
+  ffi.Pointer<DartLLMMemoryEstimate> dartllm_estimate_memory(
+    ffi.Pointer<ffi.Char> path,
+    int context_size,
+    int batch_size,
+    int type_k,
+    int type_v,
   ) {
-    return _dartllm_tokenize(model, text, add_special, out_length);
+    return _dartllm_estimate_memory(
+      path,
+      context_size,
+      batch_size,
+      type_k,
+      type_v,
+    );
   }
 
-  late final _dartllm_tokenizePtr = _lookup<
+  late final _dartllm_estimate_memoryPtr = _lookup<
       ffi.NativeFunction<
-          ffi.Pointer<ffi.Int32> Function(
-            ffi.Pointer<ffi.Void>,
+          ffi.Pointer<DartLLMMemoryEstimate> Function(
             ffi.Pointer<ffi.Char>,
-            ffi.Int8,
-            ffi.Pointer<ffi.Int32>,
-          )>>('dartllm_tokenize');
-  late final _dartllm_tokenize = _dartllm_tokenizePtr.asFunction<
-      ffi.Pointer<ffi.Int32> Function(
-        ffi.Pointer<ffi.Void>,
+            ffi.Int32,
+            ffi.Int32,
+            ffi.Int32,
+            ffi.Int32,
+          )>>('dartllm_estimate_memory');
+  late final _dartllm_estimate_memory = _dartllm_estimate_memoryPtr.asFunction<
+      ffi.Pointer<DartLLMMemoryEstimate> Function(
         ffi.Pointer<ffi.Char>,
         int,
-        ffi.Pointer<ffi.Int32>,
+        int,
+        int,
+        int,
       )>();
 
-  /// Convert token IDs back to text.
+  /// Read model information from a GGUF file without loading it.
   ///
-  /// @param model         Model handle
-  /// @param tokens        Array of token IDs
-  /// @param token_count   Number of tokens
+  /// Parses only the GGUF key/value section and tensor table, so listing a
+  /// catalog of models takes milliseconds per file. Fields are as for
+  /// dartllm_get_model_info() except that context_size is the training
+  /// context and file_size_bytes is the size of the file on disk.
   ///
-  /// @return UTF-8 string, or NULL on failure.
+  /// Results are cached in memory keyed by path, size and modification
+  /// time. If cache_dir is given they are also stored there and reused
+  /// across processes.
+  ///
+  /// @param path      Path to the GGUF model file (UTF-8)
+  /// @param cache_dir Directory for the probe cache, or NULL for memory only
+  ///
+  /// @return Pointer to DartLLMModelInfo, or NULL on failure.
   /// Must be freed with dartllm_free().
-  ffi.Pointer<ffi.Char> dartllm_detokenize(
-    ffi.Pointer<ffi.Void> model,
-    ffi.Pointer<ffi.Int32> tokens,
-    int token_count,
+  ffi.Pointer<DartLLMModelInfo> dartllm_probe_model(
+    ffi.Pointer<ffi.Char> path,
+    ffi.Pointer<ffi.Char> cache_dir,
   ) {
-    return _dartllm_detokenize(model, tokens, token_count);
+    return _dartllm_probe_model(path, cache_dir);
   }
 
-  late final _dartllm_detokenizePtr = _lookup<
+  late final _dartllm_probe_modelPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<DartLLMModelInfo> Function(ffi.Pointer<ffi.Char>,
+              ffi.Pointer<ffi.Char>)>>('dartllm_probe_model');
+  late final _dartllm_probe_model = _dartllm_probe_modelPtr.asFunction<
+      ffi.Pointer<DartLLMModelInfo> Function(
+          ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Char>)>();
+
+  /// Get the full chat template of a GGUF file without loading it.
+  ///
+  /// DartLLMModelInfo.chat_template is truncated to 4095 bytes; this returns
+  /// the whole template. Shares the cache used by dartllm_probe_model().
+  ///
+  /// @param path      Path to the GGUF model file (UTF-8)
+  /// @param cache_dir Directory for the probe cache, or NULL for memory only
+  ///
+  /// @return Template string (empty if the model has none), or NULL on failure.
+  /// Must be freed with dartllm_free().
+  ffi.Pointer<ffi.Char> dartllm_probe_chat_template(
+    ffi.Pointer<ffi.Char> path,
+    ffi.Pointer<ffi.Char> cache_dir,
+  ) {
+    return _dartllm_probe_chat_template(path, cache_dir);
+  }
+
+  late final _dartllm_probe_chat_templatePtr = _lookup<
       ffi.NativeFunction<
+          ffi.Pointer<ffi.Char> Function(ffi.Pointer<ffi.Char>,
+              ffi.Pointer<ffi.Char>)>>('dartllm_probe_chat_template');
+  late final _dartllm_probe_chat_template =
+      _dartllm_probe_chat_templatePtr.asFunction<
           ffi.Pointer<ffi.Char> Function(
+              ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Char>)>();
+
+  /// Fill threadpool parameters with defaults.
+  ///
+  /// @param params Output: parameters to initialize
+  void dartllm_threadpool_default_params(
+    ffi.Pointer<DartLLMThreadpoolParams> params,
+  ) {
+    return _dartllm_threadpool_default_params(params);
+  }
+
+  late final _dartllm_threadpool_default_paramsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(
+            ffi.Pointer<DartLLMThreadpoolParams>,
+          )>>('dartllm_threadpool_default_params');
+  late final _dartllm_threadpool_default_params = _dartllm_threadpool_default_paramsPtr.asFunction<
+      void Function(
+        ffi.Pointer<DartLLMThreadpoolParams>,
+      )>();
+
+  /// Create a pinned CPU threadpool that can be shared by several models.
+  ///
+  /// Without a threadpool every model context runs its own compute threads.
+  /// Models attached to the same pool instead take turns on one set of pinned
+  /// workers, one decode call at a time, so several loaded models no longer
+  /// oversubscribe the cores.
+  ///
+  /// @param params Pool configuration, or NULL for defaults
+  ///
+  /// @return Opaque threadpool handle, or NULL on failure.
+  /// Must be freed with dartllm_threadpool_free().
+  ffi.Pointer<ffi.Void> dartllm_threadpool_create(
+    ffi.Pointer<DartLLMThreadpoolParams> params,
+  ) {
+    return _dartllm_threadpool_create(params);
+  }
+
+  late final _dartllm_threadpool_createPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Void> Function(
+            ffi.Pointer<DartLLMThreadpoolParams>,
+          )>>('dartllm_threadpool_create');
+  late final _dartllm_threadpool_create = _dartllm_threadpool_createPtr.asFunction<
+      ffi.Pointer<ffi.Void> Function(
+        ffi.Pointer<DartLLMThreadpoolParams>,
+      )>();
+
+  /// Release a threadpool handle.
+  ///
+  /// Models still attached keep the pool alive until they are detached or freed.
+  ///
+  /// @param pool Threadpool handle from dartllm_threadpool_create()
+  void dartllm_threadpool_free(
+    ffi.Pointer<ffi.Void> pool,
+  ) {
+    return _dartllm_threadpool_free(pool);
+  }
+
+  late final _dartllm_threadpool_freePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(
             ffi.Pointer<ffi.Void>,
-            ffi.Pointer<ffi.Int32>,
-            ffi.Int32,
-          )>>('dartllm_detokenize');
-  late final _dartllm_detokenize = _dartllm_detokenizePtr.asFunction<
-      ffi.Pointer<ffi.Char> Function(
+          )>>('dartllm_threadpool_free');
+  late final _dartllm_threadpool_free = _dartllm_threadpool_freePtr.asFunction<
+      void Function(
         ffi.Pointer<ffi.Void>,
-        ffi.Pointer<ffi.Int32>,
-        int,
       )>();
 
-  /// Generate tokens from a prompt.
+  /// Get the number of worker threads in a threadpool.
   ///
-  /// @param model             Model handle
-  /// @param prompt_tokens     Input token IDs
-  /// @param prompt_length     Number of prompt tokens
-  /// @param max_tokens        Maximum tokens to generate
-  /// @param temperature       Sampling temperature (0.0-2.0)
-  /// @param top_p             Nucleus sampling threshold (0.0-1.0)
-  /// @param top_k             Top-K sampling limit
-  /// @param min_p             Minimum probability threshold
-  /// @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
-  /// @param seed              Random seed (-1 for random)
+  /// @param pool Threadpool handle
   ///
-  /// @return Generation result, or NULL on failure.
-  /// Must be freed with dartllm_free().
-  ffi.Pointer<DartLLMGenerateResult> dartllm_generate(
+  /// @return Thread count, or negative error code on failure
+  int dartllm_threadpool_n_threads(
+    ffi.Pointer<ffi.Void> pool,
+  ) {
+    return _dartllm_threadpool_n_threads(pool);
+  }
+
+  late final _dartllm_threadpool_n_threadsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_threadpool_n_threads');
+  late final _dartllm_threadpool_n_threads = _dartllm_threadpool_n_threadsPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Run a model's computation on shared threadpools.
+  ///
+  /// The context's thread counts are set to the pools' thread counts while
+  /// attached. Replaces any previously attached pools.
+  ///
+  /// @param model      Model handle
+  /// @param pool       Threadpool for single-token decode
+  /// @param pool_batch Threadpool for batched prompt processing (NULL to use pool)
+  ///
+  /// @return 0 on success, negative error code on failure
+  int dartllm_attach_threadpool(
     ffi.Pointer<ffi.Void> model,
-    ffi.Pointer<ffi.Int32> prompt_tokens,
-    int prompt_length,
-    int max_tokens,
-    double temperature,
-    double top_p,
-    int top_k,
-    double min_p,
-    double repetition_penalty,
-    int seed,
+    ffi.Pointer<ffi.Void> pool,
+    ffi.Pointer<ffi.Void> pool_batch,
   ) {
-    return _dartllm_generate(
-      model,
-      prompt_tokens,
-      prompt_length,
-      max_tokens,
-      temperature,
-      top_p,
-      top_k,
-      min_p,
-      repetition_penalty,
-      seed,
-    );
+    return _dartllm_attach_threadpool(model, pool, pool_batch);
+  }
+
+  late final _dartllm_attach_threadpoolPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_attach_threadpool');
+  late final _dartllm_attach_threadpool = _dartllm_attach_threadpoolPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Return a model to its own compute threads and thread counts.
+  ///
+  /// @param model Model handle
+  ///
+  /// @return 0 on success, negative error code on failure
+  int dartllm_detach_threadpool(
+    ffi.Pointer<ffi.Void> model,
+  ) {
+    return _dartllm_detach_threadpool(model);
+  }
+
+  late final _dartllm_detach_threadpoolPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_detach_threadpool');
+  late final _dartllm_detach_threadpool = _dartllm_detach_threadpoolPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Create a model registry with a memory budget.
+  ///
+  /// A registry loads models on demand by id, reference-counts the handles it
+  /// hands out, and when a load would exceed the budget evicts the least
+  /// recently used models that have no active handles. Each model's cost is
+  /// estimated from its GGUF header (see dartllm_estimate_memory()).
+  ///
+  /// Evicted CPU models loaded with mmap can be kept "warm": the context, KV
+  /// cache and compute buffers are freed but the weights stay mapped. Their
+  /// pages are file-backed and reclaimable, so warm models do not count
+  /// against the budget, and reacquiring one only recreates the context.
+  ///
+  /// @param budget_bytes    Memory budget in bytes (0 for unlimited)
+  /// @param max_warm_models Maximum evicted models to keep warm (0 to disable)
+  ///
+  /// @return Registry handle, or NULL on failure.
+  /// Must be freed with dartllm_registry_free().
+  ffi.Pointer<ffi.Void> dartllm_registry_create(
+    int budget_bytes,
+    int max_warm_models,
+  ) {
+    return _dartllm_registry_create(budget_bytes, max_warm_models);
+  }
+
+  late final _dartllm_registry_createPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Void> Function(
+            ffi.Int64,
+            ffi.Int32,
+          )>>('dartllm_registry_create');
+  late final _dartllm_registry_create = _dartllm_registry_createPtr.asFunction<
+      ffi.Pointer<ffi.Void> Function(
+        int,
+        int,
+      )>();
+
+  /// Free a registry and every model it holds.
+  ///
+  /// All handles from dartllm_registry_acquire() become invalid.
+  ///
+  /// @param registry Registry handle from dartllm_registry_create()
+  void dartllm_registry_free(
+    ffi.Pointer<ffi.Void> registry,
+  ) {
+    return _dartllm_registry_free(registry);
+  }
+
+  late final _dartllm_registry_freePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_registry_free');
+  late final _dartllm_registry_free = _dartllm_registry_freePtr.asFunction<
+      void Function(
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Register a model under an id. The model is not loaded until acquired.
+  ///
+  /// Parameters match dartllm_load_model().
+  ///
+  /// @param registry Registry handle
+  /// @param id       Model id (UTF-8, null-terminated)
+  /// @param path     Path to the GGUF model file (UTF-8)
+  ///
+  /// @return 0 on success, -1 on invalid arguments or an unreadable model
+  /// file, -2 if the id is already registered
+  int dartllm_registry_register(
+    ffi.Pointer<ffi.Void> registry,
+    ffi.Pointer<ffi.Char> id,
+    ffi.Pointer<ffi.Char> path,
+    int context_size,
+    int gpu_layers,
+    int threads,
+    int batch_size,
+    int use_mmap,
+  ) {
+    return _dartllm_registry_register(
+      registry,
+      id,
+      path,
+      context_size,
+      gpu_layers,
+      threads,
+      batch_size,
+      use_mmap,
+    );
+  }
+
+  late final _dartllm_registry_registerPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Char>,
+            ffi.Pointer<ffi.Char>,
+            ffi.Int32,
+            ffi.Int32,
+            ffi.Int32,
+            ffi.Int32,
+            ffi.Int8,
+          )>>('dartllm_registry_register');
+  late final _dartllm_registry_register = _dartllm_registry_registerPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Char>,
+        ffi.Pointer<ffi.Char>,
+        int,
+        int,
+        int,
+        int,
+        int,
+      )>();
+
+  /// Remove a model from the registry, freeing it if loaded.
+  ///
+  /// @param registry Registry handle
+  /// @param id       Model id
+  ///
+  /// @return 0 on success, -1 if the id is unknown, -2 if handles are active
+  int dartllm_registry_unregister(
+    ffi.Pointer<ffi.Void> registry,
+    ffi.Pointer<ffi.Char> id,
+  ) {
+    return _dartllm_registry_unregister(registry, id);
+  }
+
+  late final _dartllm_registry_unregisterPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Char>,
+          )>>('dartllm_registry_unregister');
+  late final _dartllm_registry_unregister = _dartllm_registry_unregisterPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Char>,
+      )>();
+
+  /// Get a handle to a registered model, loading it if needed.
+  ///
+  /// The handle works with every function that takes a model handle, except
+  /// dartllm_free_model(); return it with dartllm_registry_release(). Blocks
+  /// while the model loads. Concurrent acquires of the same id share one load.
+  ///
+  /// @param registry Registry handle
+  /// @param id       Model id
+  ///
+  /// @return Model handle, or NULL if the id is unknown, the load failed, or
+  /// the model does not fit in the budget with all idle models evicted
+  ffi.Pointer<ffi.Void> dartllm_registry_acquire(
+    ffi.Pointer<ffi.Void> registry,
+    ffi.Pointer<ffi.Char> id,
+  ) {
+    return _dartllm_registry_acquire(registry, id);
+  }
+
+  late final _dartllm_registry_acquirePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Void> Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Char>,
+          )>>('dartllm_registry_acquire');
+  late final _dartllm_registry_acquire = _dartllm_registry_acquirePtr.asFunction<
+      ffi.Pointer<ffi.Void> Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Char>,
+      )>();
+
+  /// Release a handle from dartllm_registry_acquire().
+  ///
+  /// The model stays resident until the budget needs its memory.
+  ///
+  /// @param registry Registry handle
+  /// @param model    Model handle
+  ///
+  /// @return 0 on success, -1 if the handle was not acquired from this registry
+  int dartllm_registry_release(
+    ffi.Pointer<ffi.Void> registry,
+    ffi.Pointer<ffi.Void> model,
+  ) {
+    return _dartllm_registry_release(registry, model);
+  }
+
+  late final _dartllm_registry_releasePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_registry_release');
+  late final _dartllm_registry_release = _dartllm_registry_releasePtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Get registry statistics.
+  ///
+  /// @param registry Registry handle
+  /// @param out      Output: statistics
+  ///
+  /// @return 0 on success, negative on invalid arguments
+  int dartllm_registry_stats(
+    ffi.Pointer<ffi.Void> registry,
+    ffi.Pointer<DartLLMRegistryStats> out,
+  ) {
+    return _dartllm_registry_stats(registry, out);
+  }
+
+  late final _dartllm_registry_statsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<DartLLMRegistryStats>,
+          )>>('dartllm_registry_stats');
+  late final _dartllm_registry_stats = _dartllm_registry_statsPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<DartLLMRegistryStats>,
+      )>();
+
+  /// Load a LoRA adapter for a loaded base model.
+  ///
+  /// The adapter shares the base weights; only its low-rank tensors are
+  /// loaded. Any number of adapters can be loaded per model. They are freed
+  /// with the model or by dartllm_lora_free(). Stateless requests name their
+  /// adapter per call and sessions pin one with dartllm_session_set_lora(),
+  /// so concurrent callers never see each other's choice. Switching adapters
+  /// only rebinds tensors; nothing is reloaded. Embeddings always use the
+  /// base model.
+  ///
+  /// @param model Model handle from dartllm_load_model()
+  /// @param path  Path to the GGUF LoRA adapter file (UTF-8)
+  ///
+  /// @return Adapter handle, or NULL on failure
+  ffi.Pointer<ffi.Void> dartllm_lora_load(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Char> path,
+  ) {
+    return _dartllm_lora_load(model, path);
+  }
+
+  late final _dartllm_lora_loadPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Void> Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Char>,
+          )>>('dartllm_lora_load');
+  late final _dartllm_lora_load = _dartllm_lora_loadPtr.asFunction<
+      ffi.Pointer<ffi.Void> Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Char>,
+      )>();
+
+  /// Free a LoRA adapter.
+  ///
+  /// @param model   Model handle the adapter was loaded for
+  /// @param adapter Adapter handle from dartllm_lora_load()
+  ///
+  /// @return 0 on success, -1 if the adapter does not belong to the model,
+  /// -2 if a session still uses it
+  int dartllm_lora_free(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Void> adapter,
+  ) {
+    return _dartllm_lora_free(model, adapter);
+  }
+
+  late final _dartllm_lora_freePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_lora_free');
+  late final _dartllm_lora_free = _dartllm_lora_freePtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Tokenize text to token IDs.
+  ///
+  /// @param model         Model handle
+  /// @param text          Input text (UTF-8, null-terminated)
+  /// @param add_special   Non-zero to add BOS/EOS tokens
+  /// @param out_length    Output: number of tokens produced
+  ///
+  /// @return Array of token IDs, or NULL on failure.
+  /// Must be freed with dartllm_free().
+  ffi.Pointer<ffi.Int32> dartllm_tokenize(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Char> text,
+    int add_special,
+    ffi.Pointer<ffi.Int32> out_length,
+  ) {
+    return _dartllm_tokenize(model, text, add_special, out_length);
+  }
+
+  late final _dartllm_tokenizePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Int32> Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Char>,
+            ffi.Int8,
+            ffi.Pointer<ffi.Int32>,
+          )>>('dartllm_tokenize');
+  late final _dartllm_tokenize = _dartllm_tokenizePtr.asFunction<
+      ffi.Pointer<ffi.Int32> Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Char>,
+        int,
+        ffi.Pointer<ffi.Int32>,
+      )>();
+
+  /// Tokenize text into a caller-provided buffer.
+  ///
+  /// Avoids the allocation of dartllm_tokenize(). If the tokens do not fit,
+  /// the return value exceeds capacity and the call should be repeated with
+  /// a buffer of that size.
+  ///
+  /// @param model       Model handle
+  /// @param text        Input text (UTF-8, null-terminated)
+  /// @param add_special Non-zero to add BOS/EOS tokens
+  /// @param out_tokens  Output buffer for token IDs
+  /// @param capacity    Number of tokens out_tokens can hold
+  ///
+  /// @return Number of tokens in the text, or -1 on invalid parameters
+  int dartllm_tokenize_into(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Char> text,
+    int add_special,
+    ffi.Pointer<ffi.Int32> out_tokens,
+    int capacity,
+  ) {
+    return _dartllm_tokenize_into(
+      model,
+      text,
+      add_special,
+      out_tokens,
+      capacity,
+    );
+  }
+
+  late final _dartllm_tokenize_intoPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Char>,
+            ffi.Int8,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Int32,
+          )>>('dartllm_tokenize_into');
+  late final _dartllm_tokenize_into = _dartllm_tokenize_intoPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Char>,
+        int,
+        ffi.Pointer<ffi.Int32>,
+        int,
+      )>();
+
+
+  /// Convert token IDs back to text.
+  ///
+  /// @param model         Model handle
+  /// @param tokens        Array of token IDs
+  /// @param token_count   Number of tokens
+  ///
+  /// @return UTF-8 string, or NULL on failure.
+  /// Must be freed with dartllm_free().
+  ffi.Pointer<ffi.Char> dartllm_detokenize(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Int32> tokens,
+    int token_count,
+  ) {
+    return _dartllm_detokenize(model, tokens, token_count);
+  }
+
+  late final _dartllm_detokenizePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Char> Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Int32,
+          )>>('dartllm_detokenize');
+  late final _dartllm_detokenize = _dartllm_detokenizePtr.asFunction<
+      ffi.Pointer<ffi.Char> Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Int32>,
+        int,
+      )>();
+
+  /// Get a model's full chat template.
+  ///
+  /// Unlike DartLLMModelInfo.chat_template, the result is not truncated.
+  ///
+  /// @param model Model handle
+  ///
+  /// @return Template text, or NULL if the model has none.
+  /// Must be freed with dartllm_free().
+  ffi.Pointer<ffi.Char> dartllm_get_chat_template(
+    ffi.Pointer<ffi.Void> model,
+  ) {
+    return _dartllm_get_chat_template(model);
+  }
+
+  late final _dartllm_get_chat_templatePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Char> Function(
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_get_chat_template');
+  late final _dartllm_get_chat_template = _dartllm_get_chat_templatePtr.asFunction<
+      ffi.Pointer<ffi.Char> Function(
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Render chat messages with the model's embedded chat template.
+  ///
+  /// Only templates llama.cpp recognizes can be rendered; arbitrary Jinja is
+  /// not evaluated. In incremental mode (previous_count > 0) the first
+  /// previous_count messages are assumed to be rendered already, and only
+  /// the text that follows them is returned, so a caller extending a
+  /// conversation only tokenizes the new turn. If the template renders the
+  /// earlier messages differently once more are appended, the full text is
+  /// returned instead and out_prefix_length is 0.
+  ///
+  /// @param model                 Model handle
+  /// @param roles                 Message roles ("system", "user", "assistant")
+  /// @param contents              Message contents (UTF-8)
+  /// @param message_count         Number of messages
+  /// @param previous_count        Messages already rendered (0 for all)
+  /// @param add_generation_prompt Non-zero to append the assistant turn prefix
+  /// @param out_prefix_length     Output: bytes of the full rendering omitted
+  /// from the result (may be NULL)
+  ///
+  /// @return Rendered text, or NULL if the model has no template or it is not
+  /// supported. Must be freed with dartllm_free().
+  ffi.Pointer<ffi.Char> dartllm_apply_chat_template(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Pointer<ffi.Char>> roles,
+    ffi.Pointer<ffi.Pointer<ffi.Char>> contents,
+    int message_count,
+    int previous_count,
+    int add_generation_prompt,
+    ffi.Pointer<ffi.Int32> out_prefix_length,
+  ) {
+    return _dartllm_apply_chat_template(
+      model,
+      roles,
+      contents,
+      message_count,
+      previous_count,
+      add_generation_prompt,
+      out_prefix_length,
+    );
+  }
+
+  late final _dartllm_apply_chat_templatePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Char> Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Pointer<ffi.Char>>,
+            ffi.Pointer<ffi.Pointer<ffi.Char>>,
+            ffi.Int32,
+            ffi.Int32,
+            ffi.Int8,
+            ffi.Pointer<ffi.Int32>,
+          )>>('dartllm_apply_chat_template');
+  late final _dartllm_apply_chat_template = _dartllm_apply_chat_templatePtr.asFunction<
+      ffi.Pointer<ffi.Char> Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Pointer<ffi.Char>>,
+        ffi.Pointer<ffi.Pointer<ffi.Char>>,
+        int,
+        int,
+        int,
+        ffi.Pointer<ffi.Int32>,
+      )>();
+
+
+  /// Generate tokens from a prompt.
+  ///
+  /// @param model             Model handle
+  /// @param prompt_tokens     Input token IDs
+  /// @param prompt_length     Number of prompt tokens
+  /// @param max_tokens        Maximum tokens to generate
+  /// @param temperature       Sampling temperature (0.0-2.0)
+  /// @param top_p             Nucleus sampling threshold (0.0-1.0)
+  /// @param top_k             Top-K sampling limit
+  /// @param min_p             Minimum probability threshold
+  /// @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
+  /// @param seed              Random seed (-1 for random)
+  /// @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+  /// the base model
+  /// @param lora_scale        Adapter strength (1.0 for the trained strength)
+  /// @param constraints       Grammar and logit biases, or NULL for none
+  ///
+  /// @return Generation result, or NULL on failure.
+  /// Must be freed with dartllm_free().
+  ffi.Pointer<DartLLMGenerateResult> dartllm_generate(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Int32> prompt_tokens,
+    int prompt_length,
+    int max_tokens,
+    double temperature,
+    double top_p,
+    int top_k,
+    double min_p,
+    double repetition_penalty,
+    int seed,
+    ffi.Pointer<ffi.Void> lora,
+    double lora_scale,
+    ffi.Pointer<DartLLMConstraints> constraints,
+  ) {
+    return _dartllm_generate(
+      model,
+      prompt_tokens,
+      prompt_length,
+      max_tokens,
+      temperature,
+      top_p,
+      top_k,
+      min_p,
+      repetition_penalty,
+      seed,
+      lora,
+      lora_scale,
+      constraints,
+    );
+  }
+
+  late final _dartllm_generatePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<DartLLMGenerateResult> Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Int32,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Pointer<ffi.Void>,
+            ffi.Float,
+            ffi.Pointer<DartLLMConstraints>,
+          )>>('dartllm_generate');
+  late final _dartllm_generate = _dartllm_generatePtr.asFunction<
+      ffi.Pointer<DartLLMGenerateResult> Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Int32>,
+        int,
+        int,
+        double,
+        double,
+        int,
+        double,
+        double,
+        int,
+        ffi.Pointer<ffi.Void>,
+        double,
+        ffi.Pointer<DartLLMConstraints>,
+      )>();
+
+  /// Generate tokens from a prompt and report log-probabilities.
+  ///
+  /// Same as dartllm_generate(), but also returns, for every generated token,
+  /// its log-probability and the top_n most likely alternatives. Probabilities
+  /// come from the raw logits, before temperature, truncation, grammar or
+  /// logit bias. The alternatives are found by partial selection, so the cost
+  /// is one pass over the vocabulary per token.
+  ///
+  /// @param model             Model handle
+  /// @param prompt_tokens     Input token IDs
+  /// @param prompt_length     Number of prompt tokens
+  /// @param max_tokens        Maximum tokens to generate
+  /// @param temperature       Sampling temperature (0.0-2.0)
+  /// @param top_p             Nucleus sampling threshold (0.0-1.0)
+  /// @param top_k             Top-K sampling limit
+  /// @param min_p             Minimum probability threshold
+  /// @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
+  /// @param seed              Random seed (-1 for random)
+  /// @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+  /// the base model
+  /// @param lora_scale        Adapter strength (1.0 for the trained strength)
+  /// @param constraints       Grammar and logit biases, or NULL for none
+  /// @param top_n             Alternatives per token (0-DARTLLM_MAX_TOP_LOGPROBS)
+  /// @param out_logprobs      Output: token_count * (1 + top_n) packed entries,
+  /// or NULL if no tokens were generated.
+  /// Must be freed with dartllm_free().
+  ///
+  /// @return Generation result, or NULL on failure.
+  /// Must be freed with dartllm_free().
+  ffi.Pointer<DartLLMGenerateResult> dartllm_generate_logprobs(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Int32> prompt_tokens,
+    int prompt_length,
+    int max_tokens,
+    double temperature,
+    double top_p,
+    int top_k,
+    double min_p,
+    double repetition_penalty,
+    int seed,
+    ffi.Pointer<ffi.Void> lora,
+    double lora_scale,
+    ffi.Pointer<DartLLMConstraints> constraints,
+    int top_n,
+    ffi.Pointer<ffi.Pointer<DartLLMTokenLogprob>> out_logprobs,
+  ) {
+    return _dartllm_generate_logprobs(
+      model,
+      prompt_tokens,
+      prompt_length,
+      max_tokens,
+      temperature,
+      top_p,
+      top_k,
+      min_p,
+      repetition_penalty,
+      seed,
+      lora,
+      lora_scale,
+      constraints,
+      top_n,
+      out_logprobs,
+    );
+  }
+
+  late final _dartllm_generate_logprobsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<DartLLMGenerateResult> Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Int32,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Pointer<ffi.Void>,
+            ffi.Float,
+            ffi.Pointer<DartLLMConstraints>,
+            ffi.Int32,
+            ffi.Pointer<ffi.Pointer<DartLLMTokenLogprob>>,
+          )>>('dartllm_generate_logprobs');
+  late final _dartllm_generate_logprobs = _dartllm_generate_logprobsPtr.asFunction<
+      ffi.Pointer<DartLLMGenerateResult> Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Int32>,
+        int,
+        int,
+        double,
+        double,
+        int,
+        double,
+        double,
+        int,
+        ffi.Pointer<ffi.Void>,
+        double,
+        ffi.Pointer<DartLLMConstraints>,
+        int,
+        ffi.Pointer<ffi.Pointer<DartLLMTokenLogprob>>,
+      )>();
+
+
+  /// Generate n independent completions of one prompt.
+  ///
+  /// The prompt is decoded once and shared by all branches through the KV
+  /// cache. Branches are then decoded together, one token each per batch,
+  /// with their own sampler seeded from seed + branch index, wrapping past
+  /// INT32_MAX to 0 (or randomly when seed is -1). A branch that reaches an
+  /// end-of-generation token drops out while the others continue. Each branch
+  /// needs a KV sequence not held by a session (see dartllm_session_create()).
+  ///
+  /// @param model             Model handle
+  /// @param prompt_tokens     Input token IDs
+  /// @param prompt_length     Number of prompt tokens
+  /// @param max_tokens        Maximum tokens to generate per branch (>= 0)
+  /// @param temperature       Sampling temperature (0.0-2.0)
+  /// @param top_p             Nucleus sampling threshold (0.0-1.0)
+  /// @param top_k             Top-K sampling limit
+  /// @param min_p             Minimum probability threshold
+  /// @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
+  /// @param seed              Random seed (-1 for random)
+  /// @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+  /// the base model
+  /// @param lora_scale        Adapter strength (1.0 for the trained strength)
+  /// @param constraints       Grammar and logit biases, or NULL for none
+  /// @param n                 Number of branches (1-DARTLLM_MAX_PARALLEL)
+  /// @param out_results       Output: n results (caller-allocated array).
+  /// Each must be freed with dartllm_free().
+  ///
+  /// @return 0 on success, -1 on invalid parameters, -2 on failure
+  int dartllm_generate_n(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Int32> prompt_tokens,
+    int prompt_length,
+    int max_tokens,
+    double temperature,
+    double top_p,
+    int top_k,
+    double min_p,
+    double repetition_penalty,
+    int seed,
+    ffi.Pointer<ffi.Void> lora,
+    double lora_scale,
+    ffi.Pointer<DartLLMConstraints> constraints,
+    int n,
+    ffi.Pointer<ffi.Pointer<DartLLMGenerateResult>> out_results,
+  ) {
+    return _dartllm_generate_n(
+      model,
+      prompt_tokens,
+      prompt_length,
+      max_tokens,
+      temperature,
+      top_p,
+      top_k,
+      min_p,
+      repetition_penalty,
+      seed,
+      lora,
+      lora_scale,
+      constraints,
+      n,
+      out_results,
+    );
+  }
+
+  late final _dartllm_generate_nPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Int32,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Pointer<ffi.Void>,
+            ffi.Float,
+            ffi.Pointer<DartLLMConstraints>,
+            ffi.Int32,
+            ffi.Pointer<ffi.Pointer<DartLLMGenerateResult>>,
+          )>>('dartllm_generate_n');
+  late final _dartllm_generate_n = _dartllm_generate_nPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Int32>,
+        int,
+        int,
+        double,
+        double,
+        int,
+        double,
+        double,
+        int,
+        ffi.Pointer<ffi.Void>,
+        double,
+        ffi.Pointer<DartLLMConstraints>,
+        int,
+        ffi.Pointer<ffi.Pointer<DartLLMGenerateResult>>,
+      )>();
+
+
+  /// Generate tokens from a prompt into a caller-provided buffer.
+  ///
+  /// Same as dartllm_generate(), without allocating a result.
+  ///
+  /// @param model             Model handle
+  /// @param prompt_tokens     Input token IDs
+  /// @param prompt_length     Number of prompt tokens
+  /// @param max_tokens        Maximum tokens to generate
+  /// @param temperature       Sampling temperature (0.0-2.0)
+  /// @param top_p             Nucleus sampling threshold (0.0-1.0)
+  /// @param top_k             Top-K sampling limit
+  /// @param min_p             Minimum probability threshold
+  /// @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
+  /// @param seed              Random seed (-1 for random)
+  /// @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+  /// the base model
+  /// @param lora_scale        Adapter strength (1.0 for the trained strength)
+  /// @param constraints       Grammar and logit biases, or NULL for none
+  /// @param out_tokens        Output buffer with room for max_tokens token IDs
+  /// @param out_finish_reason Output: 0=stop, 1=length, 2=error
+  ///
+  /// @return Number of tokens generated, or -1 on failure
+  int dartllm_generate_into(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Int32> prompt_tokens,
+    int prompt_length,
+    int max_tokens,
+    double temperature,
+    double top_p,
+    int top_k,
+    double min_p,
+    double repetition_penalty,
+    int seed,
+    ffi.Pointer<ffi.Void> lora,
+    double lora_scale,
+    ffi.Pointer<DartLLMConstraints> constraints,
+    ffi.Pointer<ffi.Int32> out_tokens,
+    ffi.Pointer<ffi.Int32> out_finish_reason,
+  ) {
+    return _dartllm_generate_into(
+      model,
+      prompt_tokens,
+      prompt_length,
+      max_tokens,
+      temperature,
+      top_p,
+      top_k,
+      min_p,
+      repetition_penalty,
+      seed,
+      lora,
+      lora_scale,
+      constraints,
+      out_tokens,
+      out_finish_reason,
+    );
+  }
+
+  late final _dartllm_generate_intoPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Int32,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Pointer<ffi.Void>,
+            ffi.Float,
+            ffi.Pointer<DartLLMConstraints>,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Pointer<ffi.Int32>,
+          )>>('dartllm_generate_into');
+  late final _dartllm_generate_into = _dartllm_generate_intoPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Int32>,
+        int,
+        int,
+        double,
+        double,
+        int,
+        double,
+        double,
+        int,
+        ffi.Pointer<ffi.Void>,
+        double,
+        ffi.Pointer<DartLLMConstraints>,
+        ffi.Pointer<ffi.Int32>,
+        ffi.Pointer<ffi.Int32>,
+      )>();
+
+
+  /// Generate tokens with streaming callback.
+  ///
+  /// Calls the callback for each generated token. Generation continues
+  /// until max_tokens is reached, a stop token is hit, or the callback
+  /// returns zero.
+  ///
+  /// @param model             Model handle
+  /// @param prompt_tokens     Input token IDs
+  /// @param prompt_length     Number of prompt tokens
+  /// @param max_tokens        Maximum tokens to generate
+  /// @param temperature       Sampling temperature (0.0-2.0)
+  /// @param top_p             Nucleus sampling threshold (0.0-1.0)
+  /// @param top_k             Top-K sampling limit
+  /// @param min_p             Minimum probability threshold
+  /// @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
+  /// @param seed              Random seed (-1 for random)
+  /// @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+  /// the base model
+  /// @param lora_scale        Adapter strength (1.0 for the trained strength)
+  /// @param constraints       Grammar and logit biases, or NULL for none
+  /// @param callback          Streaming callback function
+  /// @param user_data         User context passed to callback
+  ///
+  /// @return 0 on success, non-zero error code on failure
+  int dartllm_generate_stream(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Int32> prompt_tokens,
+    int prompt_length,
+    int max_tokens,
+    double temperature,
+    double top_p,
+    int top_k,
+    double min_p,
+    double repetition_penalty,
+    int seed,
+    ffi.Pointer<ffi.Void> lora,
+    double lora_scale,
+    ffi.Pointer<DartLLMConstraints> constraints,
+    DartLLMStreamCallback callback,
+    ffi.Pointer<ffi.Void> user_data,
+  ) {
+    return _dartllm_generate_stream(
+      model,
+      prompt_tokens,
+      prompt_length,
+      max_tokens,
+      temperature,
+      top_p,
+      top_k,
+      min_p,
+      repetition_penalty,
+      seed,
+      lora,
+      lora_scale,
+      constraints,
+      callback,
+      user_data,
+    );
+  }
+
+  late final _dartllm_generate_streamPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Int32,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Pointer<ffi.Void>,
+            ffi.Float,
+            ffi.Pointer<DartLLMConstraints>,
+            DartLLMStreamCallback,
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_generate_stream');
+  late final _dartllm_generate_stream = _dartllm_generate_streamPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Int32>,
+        int,
+        int,
+        double,
+        double,
+        int,
+        double,
+        double,
+        int,
+        ffi.Pointer<ffi.Void>,
+        double,
+        ffi.Pointer<DartLLMConstraints>,
+        DartLLMStreamCallback,
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Create a conversation session on a loaded model.
+  ///
+  /// A session owns one KV sequence of the model's context and keeps the
+  /// tokens it has decoded resident between calls, so each turn only decodes
+  /// its new tokens. Sessions share the context's cache cells with each other
+  /// and with stateless requests, which leave session state untouched.
+  ///
+  /// Sessions are freed together with their model, but should be freed with
+  /// dartllm_session_free() first when the model is released to a registry.
+  /// Encoder models are not supported.
+  ///
+  /// @param model Model handle
+  ///
+  /// @return Session handle, or NULL if DARTLLM_MAX_SESSIONS are already live
+  ffi.Pointer<ffi.Void> dartllm_session_create(
+    ffi.Pointer<ffi.Void> model,
+  ) {
+    return _dartllm_session_create(model);
+  }
+
+  late final _dartllm_session_createPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Void> Function(
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_session_create');
+  late final _dartllm_session_create = _dartllm_session_createPtr.asFunction<
+      ffi.Pointer<ffi.Void> Function(
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Free a session and drop its KV state.
+  ///
+  /// @param session Session handle (can be NULL)
+  void dartllm_session_free(
+    ffi.Pointer<ffi.Void> session,
+  ) {
+    return _dartllm_session_free(session);
+  }
+
+  late final _dartllm_session_freePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_session_free');
+  late final _dartllm_session_free = _dartllm_session_freePtr.asFunction<
+      void Function(
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Get the number of tokens resident in a session.
+  ///
+  /// @param session Session handle
+  ///
+  /// @return Token count, or -1 on failure
+  int dartllm_session_length(
+    ffi.Pointer<ffi.Void> session,
+  ) {
+    return _dartllm_session_length(session);
+  }
+
+  late final _dartllm_session_lengthPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_session_length');
+  late final _dartllm_session_length = _dartllm_session_lengthPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Drop the resident tokens after the first `length`.
+  ///
+  /// Use this to rewind to the part of the conversation that is unchanged
+  /// before appending the rest.
+  ///
+  /// @param session Session handle
+  /// @param length  Number of tokens to keep (0 to session length)
+  ///
+  /// @return 0 on success, -1 on failure
+  int dartllm_session_truncate(
+    ffi.Pointer<ffi.Void> session,
+    int length,
+  ) {
+    return _dartllm_session_truncate(session, length);
+  }
+
+  late final _dartllm_session_truncatePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Int32,
+          )>>('dartllm_session_truncate');
+  late final _dartllm_session_truncate = _dartllm_session_truncatePtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        int,
+      )>();
+
+  /// Set the LoRA adapter a session decodes and samples with.
+  ///
+  /// The KV cache holds activations computed under the session's adapter, so
+  /// the adapter can only change while the session is empty; truncate it to
+  /// 0 first to switch.
+  ///
+  /// @param session Session handle
+  /// @param adapter Adapter handle from dartllm_lora_load(), or NULL for the base model
+  /// @param scale   Adapter strength (1.0 for the trained strength)
+  ///
+  /// @return 0 on success, -1 on invalid parameters or an adapter from another
+  /// model, -2 if the session holds tokens
+  int dartllm_session_set_lora(
+    ffi.Pointer<ffi.Void> session,
+    ffi.Pointer<ffi.Void> adapter,
+    double scale,
+  ) {
+    return _dartllm_session_set_lora(session, adapter, scale);
+  }
+
+  late final _dartllm_session_set_loraPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Void>,
+            ffi.Float,
+          )>>('dartllm_session_set_lora');
+  late final _dartllm_session_set_lora = _dartllm_session_set_loraPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Void>,
+        double,
+      )>();
+
+  /// Decode tokens after the session's resident ones.
+  ///
+  /// The tokens stay resident; the cost is proportional to `count`, not to the
+  /// length of the conversation.
+  ///
+  /// @param session Session handle
+  /// @param tokens  Token IDs to append
+  /// @param count   Number of tokens
+  ///
+  /// @return New session length, or -1 on failure
+  int dartllm_session_append(
+    ffi.Pointer<ffi.Void> session,
+    ffi.Pointer<ffi.Int32> tokens,
+    int count,
+  ) {
+    return _dartllm_session_append(session, tokens, count);
+  }
+
+  late final _dartllm_session_appendPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Int32,
+          )>>('dartllm_session_append');
+  late final _dartllm_session_append = _dartllm_session_appendPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Int32>,
+        int,
+      )>();
+
+  /// Generate tokens continuing the session.
+  ///
+  /// Sampling uses the session's LoRA adapter. Generated tokens stay
+  /// resident, except a final end-of-generation token, which is not returned
+  /// either.
+  ///
+  /// @param session           Session handle (must hold at least one token)
+  /// @param max_tokens        Maximum tokens to generate
+  /// @param temperature       Sampling temperature (0.0-2.0)
+  /// @param top_p             Nucleus sampling threshold (0.0-1.0)
+  /// @param top_k             Top-K sampling limit
+  /// @param min_p             Minimum probability threshold
+  /// @param seed              Random seed (-1 for random)
+  /// @param constraints       Grammar and logit biases, or NULL for none
+  /// @param out_tokens        Output buffer with room for max_tokens token IDs
+  /// @param out_finish_reason Output: 0=stop, 1=length, 2=error
+  ///
+  /// @return Number of tokens generated, or -1 on failure
+  int dartllm_session_generate(
+    ffi.Pointer<ffi.Void> session,
+    int max_tokens,
+    double temperature,
+    double top_p,
+    int top_k,
+    double min_p,
+    int seed,
+    ffi.Pointer<DartLLMConstraints> constraints,
+    ffi.Pointer<ffi.Int32> out_tokens,
+    ffi.Pointer<ffi.Int32> out_finish_reason,
+  ) {
+    return _dartllm_session_generate(
+      session,
+      max_tokens,
+      temperature,
+      top_p,
+      top_k,
+      min_p,
+      seed,
+      constraints,
+      out_tokens,
+      out_finish_reason,
+    );
+  }
+
+  late final _dartllm_session_generatePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Pointer<DartLLMConstraints>,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Pointer<ffi.Int32>,
+          )>>('dartllm_session_generate');
+  late final _dartllm_session_generate = _dartllm_session_generatePtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        int,
+        double,
+        double,
+        int,
+        double,
+        int,
+        ffi.Pointer<DartLLMConstraints>,
+        ffi.Pointer<ffi.Int32>,
+        ffi.Pointer<ffi.Int32>,
+      )>();
+
+  /// Generate tokens continuing the session, with a streaming callback.
+  ///
+  /// Same as dartllm_session_generate(), reporting tokens as
+  /// dartllm_generate_stream() does.
+  ///
+  /// @param session     Session handle (must hold at least one token)
+  /// @param max_tokens  Maximum tokens to generate
+  /// @param temperature Sampling temperature (0.0-2.0)
+  /// @param top_p       Nucleus sampling threshold (0.0-1.0)
+  /// @param top_k       Top-K sampling limit
+  /// @param min_p       Minimum probability threshold
+  /// @param seed        Random seed (-1 for random)
+  /// @param constraints Grammar and logit biases, or NULL for none
+  /// @param callback    Streaming callback function
+  /// @param user_data   User context passed to callback
+  ///
+  /// @return 0 on success, non-zero error code on failure
+  int dartllm_session_generate_stream(
+    ffi.Pointer<ffi.Void> session,
+    int max_tokens,
+    double temperature,
+    double top_p,
+    int top_k,
+    double min_p,
+    int seed,
+    ffi.Pointer<DartLLMConstraints> constraints,
+    DartLLMStreamCallback callback,
+    ffi.Pointer<ffi.Void> user_data,
+  ) {
+    return _dartllm_session_generate_stream(
+      session,
+      max_tokens,
+      temperature,
+      top_p,
+      top_k,
+      min_p,
+      seed,
+      constraints,
+      callback,
+      user_data,
+    );
+  }
+
+  late final _dartllm_session_generate_streamPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Pointer<DartLLMConstraints>,
+            DartLLMStreamCallback,
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_session_generate_stream');
+  late final _dartllm_session_generate_stream = _dartllm_session_generate_streamPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        int,
+        double,
+        double,
+        int,
+        double,
+        int,
+        ffi.Pointer<DartLLMConstraints>,
+        DartLLMStreamCallback,
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Start a polled generation continuing the session.
+  ///
+  /// The pull-based counterpart of dartllm_session_generate_stream() for hosts
+  /// that cannot block in a callback, such as a browser's main thread: each
+  /// dartllm_stream_next() call produces one token, so the caller can yield
+  /// between tokens. Decode state lives in the session, so other requests may
+  /// run between calls. The sampler, with its grammar and logit biases, is
+  /// built here.
+  ///
+  /// @param session     Session handle (must hold at least one token)
+  /// @param max_tokens  Maximum tokens to generate
+  /// @param temperature Sampling temperature (0.0-2.0)
+  /// @param top_p       Nucleus sampling threshold (0.0-1.0)
+  /// @param top_k       Top-K sampling limit
+  /// @param min_p       Minimum probability threshold
+  /// @param seed        Random seed (-1 for random)
+  /// @param constraints Grammar and logit biases, or NULL for none
+  ///
+  /// @return Stream handle, or NULL on failure.
+  /// Must be freed with dartllm_stream_free() before the session.
+  ffi.Pointer<ffi.Void> dartllm_stream_begin(
+    ffi.Pointer<ffi.Void> session,
+    int max_tokens,
+    double temperature,
+    double top_p,
+    int top_k,
+    double min_p,
+    int seed,
+    ffi.Pointer<DartLLMConstraints> constraints,
+  ) {
+    return _dartllm_stream_begin(
+      session,
+      max_tokens,
+      temperature,
+      top_p,
+      top_k,
+      min_p,
+      seed,
+      constraints,
+    );
+  }
+
+  late final _dartllm_stream_beginPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Void> Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Float,
+            ffi.Int32,
+            ffi.Pointer<DartLLMConstraints>,
+          )>>('dartllm_stream_begin');
+  late final _dartllm_stream_begin = _dartllm_stream_beginPtr.asFunction<
+      ffi.Pointer<ffi.Void> Function(
+        ffi.Pointer<ffi.Void>,
+        int,
+        double,
+        double,
+        int,
+        double,
+        int,
+        ffi.Pointer<DartLLMConstraints>,
+      )>();
+
+  /// Produce the next token of a polled stream.
+  ///
+  /// Reports match the callback of dartllm_session_generate_stream(): the
+  /// last one has is_final set, after which the stream is exhausted.
+  ///
+  /// @param stream Stream handle
+  /// @param out    Output: the report
+  ///
+  /// @return 0 on success, -1 on failure or once the stream is exhausted
+  int dartllm_stream_next(
+    ffi.Pointer<ffi.Void> stream,
+    ffi.Pointer<DartLLMStreamToken> out,
+  ) {
+    return _dartllm_stream_next(stream, out);
+  }
+
+  late final _dartllm_stream_nextPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<DartLLMStreamToken>,
+          )>>('dartllm_stream_next');
+  late final _dartllm_stream_next = _dartllm_stream_nextPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<DartLLMStreamToken>,
+      )>();
+
+  /// Free a polled stream. Tokens it generated stay resident in the session.
+  ///
+  /// @param stream Stream handle (can be NULL)
+  void dartllm_stream_free(
+    ffi.Pointer<ffi.Void> stream,
+  ) {
+    return _dartllm_stream_free(stream);
+  }
+
+  late final _dartllm_stream_freePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_stream_free');
+  late final _dartllm_stream_free = _dartllm_stream_freePtr.asFunction<
+      void Function(
+        ffi.Pointer<ffi.Void>,
+      )>();
+
+  /// Persist the KV state of frequently used prompt prefixes, such as system
+  /// prompts, so later requests and later processes restore it instead of
+  /// decoding it again.
+  ///
+  /// Stateless requests (generate, generate_n, generate_stream, score) count
+  /// how often each prefix of a multiple of DARTLLM_PREFIX_BLOCK tokens is
+  /// seen. Once one has been seen `min_uses` times, the KV state after it is
+  /// written to `cache_dir`, keyed by the model file, the context size and
+  /// the prefix tokens. A request starting with a stored prefix maps the file
+  /// and restores the state, then decodes only the rest of its prompt. The
+  /// last prompt token is always decoded.
+  ///
+  /// Models using the same directory share its entries and budget. Requests
+  /// made with a LoRA adapter selected bypass the cache.
+  ///
+  /// @param model        Model handle
+  /// @param cache_dir    Existing directory for the cache files, or NULL to
+  /// stop using the cache for this model
+  /// @param budget_bytes Disk budget of the directory; least recently used
+  /// prefixes are deleted beyond it (must be > 0)
+  /// @param min_uses     Requests that must share a prefix before it is
+  /// stored (0 for the default of 2)
+  ///
+  /// @return 0 on success, negative error code on failure
+  int dartllm_set_prefix_cache(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Char> cache_dir,
+    int budget_bytes,
+    int min_uses,
+  ) {
+    return _dartllm_set_prefix_cache(
+      model,
+      cache_dir,
+      budget_bytes,
+      min_uses,
+    );
+  }
+
+  late final _dartllm_set_prefix_cachePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Char>,
+            ffi.Int64,
+            ffi.Int32,
+          )>>('dartllm_set_prefix_cache');
+  late final _dartllm_set_prefix_cache = _dartllm_set_prefix_cachePtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Char>,
+        int,
+        int,
+      )>();
+
+  /// Get the statistics of a model's prefix cache.
+  ///
+  /// @param model Model handle
+  /// @param out   Output: statistics (zeroed if the model has no prefix cache)
+  ///
+  /// @return 0 on success, negative error code on failure
+  int dartllm_prefix_cache_stats(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<DartLLMPrefixCacheStats> out,
+  ) {
+    return _dartllm_prefix_cache_stats(model, out);
   }
 
-  late final _dartllm_generatePtr = _lookup<
+  late final _dartllm_prefix_cache_statsPtr = _lookup<
       ffi.NativeFunction<
-          ffi.Pointer<DartLLMGenerateResult> Function(
+          ffi.Int32 Function(
             ffi.Pointer<ffi.Void>,
-            ffi.Pointer<ffi.Int32>,
-            ffi.Int32,
-            ffi.Int32,
-            ffi.Float,
-            ffi.Float,
-            ffi.Int32,
-            ffi.Float,
-            ffi.Float,
-            ffi.Int32,
-          )>>('dartllm_generate');
-  late final _dartllm_generate = _dartllm_generatePtr.asFunction<
-      ffi.Pointer<DartLLMGenerateResult> Function(
+            ffi.Pointer<DartLLMPrefixCacheStats>,
+          )>>('dartllm_prefix_cache_stats');
+  late final _dartllm_prefix_cache_stats = _dartllm_prefix_cache_statsPtr.asFunction<
+      int Function(
         ffi.Pointer<ffi.Void>,
-        ffi.Pointer<ffi.Int32>,
-        int,
-        int,
-        double,
-        double,
-        int,
-        double,
-        double,
-        int,
+        ffi.Pointer<DartLLMPrefixCacheStats>,
       )>();
 
-  /// Generate tokens with streaming callback.
+  /// Score candidate continuations of a prompt by log-likelihood.
   ///
-  /// Calls the callback for each generated token. Generation continues
-  /// until max_tokens is reached, a stop token is hit, or the callback
-  /// returns zero.
+  /// The prompt is decoded once and its KV cache is shared by every candidate,
+  /// which are then evaluated together in batches rather than one run each.
+  /// Useful for classification and reranking by comparing candidates.
   ///
   /// @param model             Model handle
-  /// @param prompt_tokens     Input token IDs
+  /// @param prompt_tokens     Shared prompt token IDs
   /// @param prompt_length     Number of prompt tokens
-  /// @param max_tokens        Maximum tokens to generate
-  /// @param temperature       Sampling temperature (0.0-2.0)
-  /// @param top_p             Nucleus sampling threshold (0.0-1.0)
-  /// @param top_k             Top-K sampling limit
-  /// @param min_p             Minimum probability threshold
-  /// @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
-  /// @param seed              Random seed (-1 for random)
-  /// @param callback          Streaming callback function
-  /// @param user_data         User context passed to callback
+  /// @param candidate_tokens  All candidates' token IDs, concatenated
+  /// @param candidate_lengths Number of tokens in each candidate (each > 0)
+  /// @param candidate_count   Number of candidates
+  /// @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+  /// the base model
+  /// @param lora_scale        Adapter strength (1.0 for the trained strength)
+  /// @param out_totals        Output: summed log-probability of each candidate
+  /// (caller-allocated, candidate_count elements)
   ///
-  /// @return 0 on success, non-zero error code on failure
-  int dartllm_generate_stream(
+  /// @return Log-probability of every candidate token, in the same layout as
+  /// candidate_tokens, or NULL on failure.
+  /// Must be freed with dartllm_free().
+  ffi.Pointer<ffi.Float> dartllm_score(
     ffi.Pointer<ffi.Void> model,
     ffi.Pointer<ffi.Int32> prompt_tokens,
     int prompt_length,
-    int max_tokens,
-    double temperature,
-    double top_p,
-    int top_k,
-    double min_p,
-    double repetition_penalty,
-    int seed,
-    DartLLMStreamCallback callback,
-    ffi.Pointer<ffi.Void> user_data,
+    ffi.Pointer<ffi.Int32> candidate_tokens,
+    ffi.Pointer<ffi.Int32> candidate_lengths,
+    int candidate_count,
+    ffi.Pointer<ffi.Void> lora,
+    double lora_scale,
+    ffi.Pointer<ffi.Float> out_totals,
   ) {
-    return _dartllm_generate_stream(
+    return _dartllm_score(
       model,
       prompt_tokens,
       prompt_length,
-      max_tokens,
-      temperature,
-      top_p,
-      top_k,
-      min_p,
-      repetition_penalty,
-      seed,
-      callback,
-      user_data,
+      candidate_tokens,
+      candidate_lengths,
+      candidate_count,
+      lora,
+      lora_scale,
+      out_totals,
     );
   }
 
-  late final _dartllm_generate_streamPtr = _lookup<
+  late final _dartllm_scorePtr = _lookup<
       ffi.NativeFunction<
-          ffi.Int32 Function(
+          ffi.Pointer<ffi.Float> Function(
             ffi.Pointer<ffi.Void>,
             ffi.Pointer<ffi.Int32>,
             ffi.Int32,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Pointer<ffi.Int32>,
             ffi.Int32,
-            ffi.Float,
-            ffi.Float,
-            ffi.Int32,
-            ffi.Float,
-            ffi.Float,
-            ffi.Int32,
-            DartLLMStreamCallback,
             ffi.Pointer<ffi.Void>,
-          )>>('dartllm_generate_stream');
-  late final _dartllm_generate_stream = _dartllm_generate_streamPtr.asFunction<
-      int Function(
+            ffi.Float,
+            ffi.Pointer<ffi.Float>,
+          )>>('dartllm_score');
+  late final _dartllm_score = _dartllm_scorePtr.asFunction<
+      ffi.Pointer<ffi.Float> Function(
         ffi.Pointer<ffi.Void>,
         ffi.Pointer<ffi.Int32>,
         int,
+        ffi.Pointer<ffi.Int32>,
+        ffi.Pointer<ffi.Int32>,
         int,
-        double,
-        double,
-        int,
-        double,
-        double,
-        int,
-        DartLLMStreamCallback,
         ffi.Pointer<ffi.Void>,
+        double,
+        ffi.Pointer<ffi.Float>,
       )>();
 
+
   /// Generate embeddings for tokens.
   ///
   /// @param model         Model handle
@@ -406,6 +2129,59 @@ class DartLLMBindings {
         ffi.Pointer<ffi.Int32>,
       )>();
 
+  /// Generate an embedding into a caller-provided buffer.
+  ///
+  /// Avoids the allocation of dartllm_embed(). If capacity is smaller than
+  /// the model's embedding dimension, nothing is computed and the dimension
+  /// is returned so the caller can size the buffer.
+  ///
+  /// @param model         Model handle
+  /// @param tokens        Input token IDs
+  /// @param token_count   Number of tokens
+  /// @param normalize     Non-zero to L2-normalize the embedding
+  /// @param out_embedding Output buffer for the embedding
+  /// @param capacity      Number of floats out_embedding can hold
+  ///
+  /// @return Embedding dimension, or -1 on failure
+  int dartllm_embed_into(
+    ffi.Pointer<ffi.Void> model,
+    ffi.Pointer<ffi.Int32> tokens,
+    int token_count,
+    int normalize,
+    ffi.Pointer<ffi.Float> out_embedding,
+    int capacity,
+  ) {
+    return _dartllm_embed_into(
+      model,
+      tokens,
+      token_count,
+      normalize,
+      out_embedding,
+      capacity,
+    );
+  }
+
+  late final _dartllm_embed_intoPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+            ffi.Pointer<ffi.Void>,
+            ffi.Pointer<ffi.Int32>,
+            ffi.Int32,
+            ffi.Int8,
+            ffi.Pointer<ffi.Float>,
+            ffi.Int32,
+          )>>('dartllm_embed_into');
+  late final _dartllm_embed_into = _dartllm_embed_intoPtr.asFunction<
+      int Function(
+        ffi.Pointer<ffi.Void>,
+        ffi.Pointer<ffi.Int32>,
+        int,
+        int,
+        ffi.Pointer<ffi.Float>,
+        int,
+      )>();
+
+
   /// Check if GPU acceleration is available.
   ///
   /// @return Non-zero if GPU is available
@@ -462,6 +2238,25 @@ class DartLLMBindings {
   late final _dartllm_free =
       _dartllm_freePtr.asFunction<void Function(ffi.Pointer<ffi.Void>)>();
 
+  /// Free memory allocated by DartLLM functions.
+  ///
+  /// @param ptr Pointer returned by dartllm_* functions
+  void dartllm_free(
+    ffi.Pointer<ffi.Void> ptr,
+  ) {
+    return _dartllm_free(ptr);
+  }
+
+  late final _dartllm_freePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(
+            ffi.Pointer<ffi.Void>,
+          )>>('dartllm_free');
+  late final _dartllm_free = _dartllm_freePtr.asFunction<
+      void Function(
+        ffi.Pointer<ffi.Void>,
+      )>();
+
   /// Get the last error message.
   ///
   /// @return Error message string, or NULL if no error. Do not free.
@@ -500,7 +2295,8 @@ final class __mbstate_t extends ffi.Union {
 
 /// Model information structure.
 ///
-/// Returned by dartllm_get_model_info(). All strings are null-terminated.
+/// Returned by dartllm_get_model_info() and dartllm_probe_model().
+/// All strings are null-terminated.
 /// The structure uses fixed-size arrays for ABI stability.
 final class DartLLMModelInfo extends ffi.Struct {
   /// Model name from GGUF metadata (max 255 chars + null)
@@ -556,12 +2352,276 @@ final class DartLLMModelInfo extends ffi.Struct {
   external ffi.Array<ffi.Char> chat_template;
 }
 
+/// Memory estimate structure.
+///
+/// Returned by dartllm_estimate_memory(). All sizes are in bytes.
+final class DartLLMMemoryEstimate extends ffi.Struct {
+  /// Tensor data as stored in the file (mapped or loaded)
+  @ffi.Int64()
+  external int weights_bytes;
+
+  /// KV cache for the full context at the requested cache types
+  @ffi.Int64()
+  external int kv_cache_bytes;
+
+  /// Worst-case compute buffer for one prompt-processing ubatch (heuristic)
+  @ffi.Int64()
+  external int compute_bytes;
+
+  /// Host output buffer for logits and embeddings
+  @ffi.Int64()
+  external int output_bytes;
+
+  /// Sum of the above
+  @ffi.Int64()
+  external int total_bytes;
+
+  /// Context size the estimate was computed for, after clamping
+  @ffi.Int32()
+  external int context_size;
+
+  /// Number of transformer layers
+  @ffi.Int32()
+  external int layer_count;
+}
+
+/// Thread configuration structure.
+///
+/// Filled by dartllm_get_thread_config() and dartllm_calibrate_threads().
+final class DartLLMThreadConfig extends ffi.Struct {
+  /// Threads used for single-token decode
+  @ffi.Int32()
+  external int n_threads;
+
+  /// Threads used for batched prompt processing
+  @ffi.Int32()
+  external int n_threads_batch;
+
+  /// Logical CPUs in the process affinity mask
+  @ffi.Int32()
+  external int logical_cpus;
+
+  /// Physical cores in the process affinity mask
+  @ffi.Int32()
+  external int physical_cores;
+
+  /// Physical cores in the fastest capacity/frequency class
+  @ffi.Int32()
+  external int performance_cores;
+
+  /// cgroup CPU quota in CPUs (e.g. 2.5), or 0 if unlimited
+  @ffi.Float()
+  external double cpu_quota;
+
+  /// Non-zero if the thread counts come from a calibration run
+  @ffi.Int8()
+  external int calibrated;
+}
+
+/// Threadpool configuration structure.
+///
+/// Initialize with dartllm_threadpool_default_params() before setting fields.
+final class DartLLMThreadpoolParams extends ffi.Struct {
+  /// Number of worker threads (0 for one per physical core, or one per CPU in cpu_list)
+  @ffi.Int32()
+  external int n_threads;
+
+  /// CPUs to pin workers to, as a list such as "0-7,16" (UTF-8, null-terminated).
+  /// NULL pins one worker to each physical core, fastest cores first.
+  external ffi.Pointer<ffi.Char> cpu_list;
+
+  /// Scheduling priority: -1 low, 0 normal, 1 medium, 2 high, 3 realtime
+  @ffi.Int32()
+  external int priority;
+
+  /// Polling level 0-100: 0 sleeps between graphs, higher spins longer before sleeping
+  @ffi.Uint32()
+  external int poll;
+
+  /// Non-zero to pin each worker to a single CPU instead of the whole mask
+  @ffi.Int8()
+  external int strict_cpu;
+}
+
+/// Model registry statistics structure.
+///
+/// Filled by dartllm_registry_stats().
+final class DartLLMRegistryStats extends ffi.Struct {
+  /// Memory budget in bytes (0 for unlimited)
+  @ffi.Int64()
+  external int budget_bytes;
+
+  /// Estimated bytes held by resident models
+  @ffi.Int64()
+  external int resident_bytes;
+
+  /// Registered model ids
+  @ffi.Int32()
+  external int registered_models;
+
+  /// Models with weights and context loaded
+  @ffi.Int32()
+  external int resident_models;
+
+  /// Evicted models whose mmap'd weights are kept loaded
+  @ffi.Int32()
+  external int warm_models;
+
+  /// Handles currently acquired and not yet released
+  @ffi.Int32()
+  external int active_handles;
+
+  /// Acquires served by an already resident model
+  @ffi.Int64()
+  external int hits;
+
+  /// Acquires served by recreating the context of a warm model
+  @ffi.Int64()
+  external int warm_hits;
+
+  /// Acquires that loaded the model from disk
+  @ffi.Int64()
+  external int loads;
+
+  /// Models evicted to stay within the budget
+  @ffi.Int64()
+  external int evictions;
+}
+
+/// Prefix cache statistics structure.
+///
+/// Filled by dartllm_prefix_cache_stats(). Counts cover every model using
+/// the same cache directory.
+final class DartLLMPrefixCacheStats extends ffi.Struct {
+  /// Disk budget in bytes
+  @ffi.Int64()
+  external int budget_bytes;
+
+  /// Bytes of stored prefix states
+  @ffi.Int64()
+  external int stored_bytes;
+
+  /// Stored prefixes
+  @ffi.Int32()
+  external int entries;
+
+  /// Prompts that started from a stored prefix
+  @ffi.Int64()
+  external int hits;
+
+  /// Prompts with a cacheable prefix that had none stored
+  @ffi.Int64()
+  external int misses;
+
+  /// Prompt tokens restored instead of decoded
+  @ffi.Int64()
+  external int tokens_restored;
+
+  /// Prefixes written to disk
+  @ffi.Int64()
+  external int stores;
+
+  /// Prefixes deleted to stay within the budget
+  @ffi.Int64()
+  external int evictions;
+}
+
+/// Warm-up progress structure.
+///
+/// Filled by dartllm_warmup_status().
+final class DartLLMWarmupStatus extends ffi.Struct {
+  /// One of the DARTLLM_WARMUP_IDLE ... DARTLLM_WARMUP_CANCELLED values
+  @ffi.Int32()
+  external int state;
+
+  /// Mode flags the warm-up was started with
+  @ffi.Int32()
+  external int mode;
+
+  /// Bytes of the model file prefetched so far
+  @ffi.Int64()
+  external int bytes_done;
+
+  /// Bytes to prefetch, or 0 when progress is not metered: the model is
+  /// not memory-mapped or the mode has DARTLLM_WARMUP_ADVISE without
+  /// DARTLLM_WARMUP_READ
+  @ffi.Int64()
+  external int bytes_total;
+
+  /// Non-zero once the dummy decode has completed
+  @ffi.Int8()
+  external int decoded;
+}
+
+/// One step of a polled stream.
+///
+/// Filled by dartllm_stream_next(). Mirrors the arguments of
+/// DartLLMStreamCallback.
+final class DartLLMStreamToken extends ffi.Struct {
+  /// Generated token ID (0 in a closing report without a token)
+  @ffi.Int32()
+  external int token;
+
+  /// Non-zero if this is the last report of the stream
+  @ffi.Int8()
+  external int is_final;
+
+  /// 0=stop, 1=length, 2=error (only valid when is_final)
+  @ffi.Int32()
+  external int finish_reason;
+
+  /// Token text (UTF-8, null-terminated)
+  @ffi.Array.multi([256])
+  external ffi.Array<ffi.Char> text;
+}
+
+/// Grammar and logit biases constraining one generate or stream call.
+///
+/// Constraints are checked and the grammar parsed before anything is
+/// decoded. Parsed grammars are cached per model by their source text, so
+/// repeating a recent grammar does not parse it again. Biases are added to
+/// the logits before any other sampler runs; a bias of -INFINITY bans the
+/// token outright.
+final class DartLLMConstraints extends ffi.Struct {
+  /// GBNF grammar or JSON Schema (UTF-8), or NULL/"" for none
+  external ffi.Pointer<ffi.Char> grammar;
+
+  /// DARTLLM_GRAMMAR_GBNF or DARTLLM_GRAMMAR_JSON_SCHEMA
+  @ffi.Int32()
+  external int grammar_kind;
+
+  /// Token IDs to bias (may be NULL when bias_count is 0)
+  external ffi.Pointer<ffi.Int32> bias_tokens;
+
+  /// Bias for each token
+  external ffi.Pointer<ffi.Float> biases;
+
+  /// Number of biased tokens
+  @ffi.Int32()
+  external int bias_count;
+}
+
 /// Generation result structure.
 ///
 /// Returned by dartllm_generate(). Contains generated tokens and metadata.
 /// Variable-length tokens array follows the fixed fields.
 final class DartLLMGenerateResult extends ffi.Opaque {}
 
+/// Log-probability of one token.
+///
+/// dartllm_generate_logprobs() returns these packed as token_count groups
+/// of (1 + top_n) entries: the sampled token, then the top_n most likely
+/// tokens in descending order.
+final class DartLLMTokenLogprob extends ffi.Struct {
+  /// Token ID
+  @ffi.Int32()
+  external int token;
+
+  /// Natural-log probability under the model's unmodified distribution
+  @ffi.Float()
+  external double logprob;
+}
+
 /// Callback function type for streaming token generation.
 ///
 /// @param token     Generated token ID
@@ -1,10 +1,19 @@
 import 'dart:async';
 import 'dart:isolate';
+import 'dart:typed_data';
 
 import 'package:dartllm/src/core/exceptions/exceptions.dart';
+import 'package:dartllm/src/platform/binding_factory.dart';
+import 'package:dartllm/src/platform/platform_binding.dart';
 import 'package:dartllm/src/utils/logger.dart';
 import 'package:dartllm/src/utils/platform_utils.dart';
 
+/// Creates the binding a bridge isolate runs requests on.
+///
+/// Called inside the bridge isolate, so it must be a top-level or static
+/// function.
+typedef BridgeBindingFactory = Future<PlatformBinding> Function();
+
 /// Types of requests that can be sent to the bridge isolate.
 enum IsolateRequestType {
   /// Load a model from a file path.
@@ -31,8 +40,24 @@ enum IsolateRequestType {
   /// Get model information.
   getModelInfo,
 
+  /// Render chat messages with the model's template.
+  applyChatTemplate,
+
+  /// Create a session on a model.
+  createSession,
+
+  /// Free a session.
+  freeSession,
+
   /// Shutdown the isolate.
-  shutdown,
+  shutdown;
+
+  /// Whether the request only reads immutable model data and returns
+  /// quickly, so it may run beside a long request on the same model.
+  bool get isLightweight => switch (this) {
+        tokenize || detokenize || getModelInfo => true,
+        _ => false,
+      };
 }
 
 /// A request sent to the bridge isolate.
@@ -43,17 +68,77 @@ class IsolateRequest {
   /// Type of operation to perform.
   final IsolateRequestType type;
 
-  /// Request payload data.
+  /// Request payload: the [PlatformBinding] request for [type], the
+  /// [ModelHandle] for [IsolateRequestType.unloadModel],
+  /// [IsolateRequestType.getModelInfo] and
+  /// [IsolateRequestType.createSession], the [SessionHandle] for
+  /// [IsolateRequestType.freeSession], or null for
+  /// [IsolateRequestType.shutdown].
+  ///
+  /// Token lists are moved in a [TypedPayload] on the way to the bridge
+  /// isolate, as are the tokens and embeddings it returns.
   final Object? payload;
 
+  /// Native address of a model loaded by another isolate, from
+  /// [LoadedModel.address].
+  ///
+  /// When set, the bridge runs the request on that model, attaching it
+  /// on first use, instead of the model handle in [payload]; unloading
+  /// detaches it. Only lightweight requests may be sent this way.
+  final int? modelAddress;
+
   /// Creates an isolate request.
   const IsolateRequest({
     required this.requestId,
     required this.type,
     this.payload,
+    this.modelAddress,
   });
 }
 
+/// Result of an [IsolateRequestType.loadModel] request.
+class LoadedModel {
+  /// The model as loaded by the bridge isolate's binding.
+  final LoadModelResult result;
+
+  /// Native address of the model, or null if the binding cannot share
+  /// models with other isolates (see [SharedModelBinding]).
+  final int? address;
+
+  /// Creates a loaded model result.
+  const LoadedModel({required this.result, this.address});
+}
+
+/// [payload] of a model request with its model handle replaced by
+/// [handle].
+///
+/// Payloads that name no model are returned as they are.
+Object? payloadForModel(Object? payload, ModelHandle handle) {
+  return switch (payload) {
+    int() => handle,
+    final GenerateRequest request => request.copyWith(modelHandle: handle),
+    final EmbedRequest request => EmbedRequest(
+        modelHandle: handle,
+        tokens: request.tokens,
+        normalize: request.normalize,
+      ),
+    final TokenizeRequest request => TokenizeRequest(
+        modelHandle: handle,
+        text: request.text,
+        addSpecialTokens: request.addSpecialTokens,
+      ),
+    final DetokenizeRequest request =>
+      DetokenizeRequest(modelHandle: handle, tokens: request.tokens),
+    final ChatTemplateRequest request => ChatTemplateRequest(
+        modelHandle: handle,
+        messages: request.messages,
+        addGenerationPrompt: request.addGenerationPrompt,
+        previousMessageCount: request.previousMessageCount,
+      ),
+    _ => payload,
+  };
+}
+
 /// A response from the bridge isolate.
 class IsolateResponse {
   /// ID of the request this response corresponds to.
@@ -107,11 +192,143 @@ class IsolateStreamChunk {
   });
 }
 
+/// Token IDs or a float vector sent between isolates as one block.
+///
+/// [SendPort.send] copies a message's lists into the receiving isolate,
+/// and a plain `List<int>` is copied slot by slot. A payload holds its
+/// values in a [TransferableTypedData] instead: they are packed once when
+/// the payload is created, and the receiver adopts that buffer without
+/// copying it again.
+///
+/// [IsolateManager] wraps the tokens and vectors of requests and results
+/// itself; see [IsolateRequest.payload].
+///
+/// A payload can be read once, by the isolate that receives it.
+class TypedPayload {
+  final TransferableTypedData _data;
+
+  /// Whether the elements are float32 rather than int32.
+  final bool isFloat32;
+
+  ByteBuffer? _buffer;
+
+  TypedPayload._(this._data, {required this.isFloat32});
+
+  /// Wraps token IDs.
+  factory TypedPayload.int32(List<int> values) {
+    final list = values is Int32List ? values : Int32List.fromList(values);
+    return TypedPayload._(
+      TransferableTypedData.fromList([list]),
+      isFloat32: false,
+    );
+  }
+
+  /// Wraps a float vector, such as an embedding.
+  factory TypedPayload.float32(Float32List values) {
+    return TypedPayload._(
+      TransferableTypedData.fromList([values]),
+      isFloat32: true,
+    );
+  }
+
+  ByteBuffer get _bytes => _buffer ??= _data.materialize();
+
+  /// The token IDs of a payload created with [TypedPayload.int32].
+  Int32List asInt32List() {
+    if (isFloat32) throw StateError('Payload holds float32 data');
+    return _bytes.asInt32List();
+  }
+
+  /// The floats of a payload created with [TypedPayload.float32].
+  Float32List asFloat32List() {
+    if (!isFloat32) throw StateError('Payload holds int32 data');
+    return _bytes.asFloat32List();
+  }
+}
+
+/// A request or result whose tokens or vector travel in [data], with the
+/// list in [message] left empty.
+final class _Packed<T> {
+  final T message;
+  final TypedPayload data;
+
+  const _Packed(this.message, this.data);
+}
+
+/// Moves the tokens or vector of a message into a [TypedPayload].
+Object? _pack(Object? value) {
+  return switch (value) {
+    final GenerateRequest request => _Packed(
+        request.copyWith(promptTokens: const []),
+        TypedPayload.int32(request.promptTokens),
+      ),
+    final EmbedRequest request => _Packed(
+        EmbedRequest(
+          modelHandle: request.modelHandle,
+          tokens: const [],
+          normalize: request.normalize,
+        ),
+        TypedPayload.int32(request.tokens),
+      ),
+    final DetokenizeRequest request => _Packed(
+        DetokenizeRequest(modelHandle: request.modelHandle, tokens: const []),
+        TypedPayload.int32(request.tokens),
+      ),
+    final GenerateResult result => _Packed(
+        GenerateResult(
+          tokens: const [],
+          promptTokenCount: result.promptTokenCount,
+          completionTokenCount: result.completionTokenCount,
+          finishReason: result.finishReason,
+          generationTimeMs: result.generationTimeMs,
+          logprobs: result.logprobs,
+        ),
+        TypedPayload.int32(result.tokens),
+      ),
+    final EmbedResult result => TypedPayload.float32(result.embedding),
+    // Tokenization results.
+    final List<int> tokens => TypedPayload.int32(tokens),
+    _ => value,
+  };
+}
+
+/// Reverses [_pack] in the receiving isolate.
+Object? _unpack(Object? value) {
+  return switch (value) {
+    _Packed(message: final GenerateRequest request, :final data) =>
+      request.copyWith(promptTokens: data.asInt32List()),
+    _Packed(message: final EmbedRequest request, :final data) => EmbedRequest(
+        modelHandle: request.modelHandle,
+        tokens: data.asInt32List(),
+        normalize: request.normalize,
+      ),
+    _Packed(message: final DetokenizeRequest request, :final data) =>
+      DetokenizeRequest(
+        modelHandle: request.modelHandle,
+        tokens: data.asInt32List(),
+      ),
+    _Packed(message: final GenerateResult result, :final data) =>
+      GenerateResult(
+        tokens: data.asInt32List(),
+        promptTokenCount: result.promptTokenCount,
+        completionTokenCount: result.completionTokenCount,
+        finishReason: result.finishReason,
+        generationTimeMs: result.generationTimeMs,
+        logprobs: result.logprobs,
+      ),
+    final TypedPayload payload when payload.isFloat32 =>
+      EmbedResult(embedding: payload.asFloat32List()),
+    final TypedPayload payload => payload.asInt32List(),
+    _ => value,
+  };
+}
+
 /// Manages communication between the main isolate and the bridge isolate.
 ///
 /// The bridge isolate performs all inference operations to keep the
 /// main/UI isolate responsive. Communication uses Dart's [SendPort]
-/// and [ReceivePort] mechanism.
+/// and [ReceivePort] mechanism; token and vector data travel in a
+/// [TypedPayload] so the receiver does not copy them again.
 ///
 /// Threading model:
 /// ```
@@ -168,12 +385,23 @@ class IsolateManager {
   /// Stream controllers for streaming requests.
   final Map<int, StreamController<IsolateStreamChunk>> _streamControllers = {};
 
+  /// Creates the binding inside the bridge isolate.
+  final BridgeBindingFactory _bindingFactory;
+
   /// Creates a new isolate manager.
-  IsolateManager();
+  ///
+  /// The bridge isolate runs requests on the binding from
+  /// [bindingFactory], [BindingFactory.create] by default, created when
+  /// the first request needs it.
+  IsolateManager({BridgeBindingFactory? bindingFactory})
+      : _bindingFactory = bindingFactory ?? BindingFactory.create;
 
   /// Whether the bridge isolate is running.
   bool get isRunning => _isRunning;
 
+  /// Requests and streams sent but not yet finished.
+  int get inFlightCount => _pendingRequests.length + _streamControllers.length;
+
   /// Starts the bridge isolate.
   ///
   /// This must be called before sending any requests.
@@ -204,7 +432,7 @@ class IsolateManager {
 
     _isolate = await Isolate.spawn(
       _bridgeIsolateEntryPoint,
-      _receivePort!.sendPort,
+      (_receivePort!.sendPort, _bindingFactory),
     );
 
     _sendPort = await sendPortCompleter.future;
@@ -228,12 +456,26 @@ class IsolateManager {
   void _handleResponse(IsolateResponse response) {
     final completer = _pendingRequests.remove(response.requestId);
     if (completer == null) {
+      // A stream that failed before its last chunk.
+      final controller = _streamControllers.remove(response.requestId);
+      if (controller != null && !response.success) {
+        controller.addError(_reconstructException(response));
+        controller.close();
+        return;
+      }
       _logger.warning(
           'Received response for unknown request: ${response.requestId}');
       return;
     }
 
-    completer.complete(response);
+    completer.complete(
+      response.success
+          ? IsolateResponse.success(
+              requestId: response.requestId,
+              data: _unpack(response.data),
+            )
+          : response,
+    );
   }
 
   /// Handles a stream chunk message.
@@ -261,7 +503,7 @@ class IsolateManager {
     final completer = Completer<IsolateResponse>();
     _pendingRequests[request.requestId] = completer;
 
-    _sendPort!.send(request);
+    _sendPort!.send(_packRequest(request));
 
     final response = await completer.future;
 
@@ -281,7 +523,7 @@ class IsolateManager {
     final controller = StreamController<IsolateStreamChunk>();
     _streamControllers[request.requestId] = controller;
 
-    _sendPort!.send(request);
+    _sendPort!.send(_packRequest(request));
 
     return controller.stream;
   }
@@ -289,6 +531,15 @@ class IsolateManager {
   /// Generates a unique request ID.
   int generateRequestId() => _nextRequestId++;
 
+  IsolateRequest _packRequest(IsolateRequest request) {
+    return IsolateRequest(
+      requestId: request.requestId,
+      type: request.type,
+      payload: _pack(request.payload),
+      modelAddress: request.modelAddress,
+    );
+  }
+
   /// Checks that the isolate is running.
   void _checkRunning() {
     if (!_isRunning) {
@@ -385,8 +636,11 @@ class IsolateManager {
 /// Entry point for the bridge isolate.
 ///
 /// This function runs in the bridge isolate and handles incoming
-/// requests from the main isolate.
-Future<void> _bridgeIsolateEntryPoint(SendPort mainSendPort) async {
+/// requests from the main isolate, one at a time.
+Future<void> _bridgeIsolateEntryPoint(
+  (SendPort, BridgeBindingFactory) args,
+) async {
+  final (mainSendPort, bindingFactory) = args;
   final logger = DartLLMLogger('dartllm.platform.bridge');
   logger.info('Bridge isolate starting');
 
@@ -396,10 +650,12 @@ Future<void> _bridgeIsolateEntryPoint(SendPort mainSendPort) async {
   // Send our send port back to the main isolate
   mainSendPort.send(receivePort.sendPort);
 
+  final bridge = _Bridge(mainSendPort, bindingFactory, logger);
+
   // Process incoming requests
   await for (final message in receivePort) {
     if (message is IsolateRequest) {
-      await _handleRequest(message, mainSendPort, logger);
+      await bridge.handle(message);
 
       if (message.type == IsolateRequestType.shutdown) {
         logger.info('Bridge isolate received shutdown request');
@@ -408,159 +664,160 @@ Future<void> _bridgeIsolateEntryPoint(SendPort mainSendPort) async {
     }
   }
 
+  bridge.dispose();
   receivePort.close();
   logger.info('Bridge isolate terminated');
 }
 
-/// Handles a request in the bridge isolate.
-Future<void> _handleRequest(
-  IsolateRequest request,
-  SendPort sendPort,
-  DartLLMLogger logger,
-) async {
-  logger.debug('Processing request ${request.requestId}: ${request.type}');
+/// Runs requests on the bridge isolate's binding.
+class _Bridge {
+  final SendPort _sendPort;
+  final BridgeBindingFactory _bindingFactory;
+  final DartLLMLogger _logger;
 
-  try {
-    switch (request.type) {
+  /// Created by the first request that needs it.
+  PlatformBinding? _binding;
+
+  /// Models loaded or attached by this isolate.
+  final Set<ModelHandle> _models = {};
+
+  /// Handles of attached models by native address.
+  final Map<int, ModelHandle> _attached = {};
+
+  _Bridge(this._sendPort, this._bindingFactory, this._logger);
+
+  Future<PlatformBinding> get _ready async =>
+      _binding ??= await _bindingFactory();
+
+  /// Handles a request and sends its response or stream chunks.
+  Future<void> handle(IsolateRequest request) async {
+    _logger.debug('Processing request ${request.requestId}: ${request.type}');
+
+    try {
+      var payload = _unpack(request.payload);
+      final address = request.modelAddress;
+      if (address != null) {
+        payload = request.type == IsolateRequestType.unloadModel
+            ? _attached.remove(address)
+            : payloadForModel(payload, await _attach(address));
+      }
+
+      if (request.type == IsolateRequestType.generateStream) {
+        await _stream(request.requestId, payload! as GenerateRequest);
+        return;
+      }
+
+      final data = await _run(request.type, payload);
+      _sendPort.send(IsolateResponse.success(
+        requestId: request.requestId,
+        data: _pack(data),
+      ));
+    } on DartLLMException catch (error) {
+      _sendPort.send(IsolateResponse.failure(
+        requestId: request.requestId,
+        errorMessage: error.message,
+        errorType: error.runtimeType.toString(),
+      ));
+    } on Object catch (error) {
+      // Includes StateError for unknown handles; the caller must not hang.
+      _sendPort.send(IsolateResponse.failure(
+        requestId: request.requestId,
+        errorMessage: error.toString(),
+      ));
+    }
+  }
+
+  Future<Object?> _run(IsolateRequestType type, Object? payload) async {
+    switch (type) {
       case IsolateRequestType.loadModel:
-        await _handleLoadModel(request, sendPort, logger);
+        final binding = await _ready;
+        final result = await binding.loadModel(payload! as LoadModelRequest);
+        _models.add(result.handle);
+        return LoadedModel(
+          result: result,
+          address: binding is SharedModelBinding
+              ? binding.modelAddress(result.handle)
+              : null,
+        );
 
       case IsolateRequestType.unloadModel:
-        await _handleUnloadModel(request, sendPort, logger);
+        // Nothing to free for a model this isolate never loaded.
+        if (_models.remove(payload)) {
+          await _binding!.unloadModel(payload! as ModelHandle);
+        }
+        return null;
 
       case IsolateRequestType.generate:
-        await _handleGenerate(request, sendPort, logger);
-
-      case IsolateRequestType.generateStream:
-        await _handleGenerateStream(request, sendPort, logger);
+        return (await _ready).generate(payload! as GenerateRequest);
 
       case IsolateRequestType.embed:
-        await _handleEmbed(request, sendPort, logger);
+        return (await _ready).embed(payload! as EmbedRequest);
 
       case IsolateRequestType.tokenize:
-        await _handleTokenize(request, sendPort, logger);
+        return (await _ready).tokenize(payload! as TokenizeRequest);
 
       case IsolateRequestType.detokenize:
-        await _handleDetokenize(request, sendPort, logger);
+        return (await _ready).detokenize(payload! as DetokenizeRequest);
 
       case IsolateRequestType.getModelInfo:
-        await _handleGetModelInfo(request, sendPort, logger);
+        return (await _ready).getModelInfo(payload! as ModelHandle);
 
-      case IsolateRequestType.shutdown:
-        sendPort.send(IsolateResponse.success(requestId: request.requestId));
-    }
-  } on DartLLMException catch (error) {
-    sendPort.send(IsolateResponse.failure(
-      requestId: request.requestId,
-      errorMessage: error.message,
-      errorType: error.runtimeType.toString(),
-    ));
-  } on Exception catch (error) {
-    sendPort.send(IsolateResponse.failure(
-      requestId: request.requestId,
-      errorMessage: error.toString(),
-    ));
-  }
-}
-
-// Request handlers - these will be implemented when integrating with the binding
-Future<void> _handleLoadModel(
-  IsolateRequest request,
-  SendPort sendPort,
-  DartLLMLogger logger,
-) async {
-  // Integration point: call binding.loadModel(request.payload)
-  logger.debug('Load model request received');
-  sendPort.send(IsolateResponse.failure(
-    requestId: request.requestId,
-    errorMessage: 'Native library not available',
-    errorType: 'LLMPlatformException',
-  ));
-}
+      case IsolateRequestType.applyChatTemplate:
+        return (await _ready).applyChatTemplate(
+          payload! as ChatTemplateRequest,
+        );
 
-Future<void> _handleUnloadModel(
-  IsolateRequest request,
-  SendPort sendPort,
-  DartLLMLogger logger,
-) async {
-  logger.debug('Unload model request received');
-  sendPort.send(IsolateResponse.success(requestId: request.requestId));
-}
+      case IsolateRequestType.createSession:
+        return (await _ready).createSession(payload! as ModelHandle);
 
-Future<void> _handleGenerate(
-  IsolateRequest request,
-  SendPort sendPort,
-  DartLLMLogger logger,
-) async {
-  logger.debug('Generate request received');
-  sendPort.send(IsolateResponse.failure(
-    requestId: request.requestId,
-    errorMessage: 'Native library not available',
-    errorType: 'LLMPlatformException',
-  ));
-}
+      case IsolateRequestType.freeSession:
+        await (await _ready).freeSession(payload! as SessionHandle);
+        return null;
 
-Future<void> _handleGenerateStream(
-  IsolateRequest request,
-  SendPort sendPort,
-  DartLLMLogger logger,
-) async {
-  logger.debug('Generate stream request received');
-  sendPort.send(IsolateStreamChunk(
-    requestId: request.requestId,
-    data: null,
-    isLast: true,
-  ));
-}
+      case IsolateRequestType.generateStream:
+      case IsolateRequestType.shutdown:
+        return null;
+    }
+  }
 
-Future<void> _handleEmbed(
-  IsolateRequest request,
-  SendPort sendPort,
-  DartLLMLogger logger,
-) async {
-  logger.debug('Embed request received');
-  sendPort.send(IsolateResponse.failure(
-    requestId: request.requestId,
-    errorMessage: 'Native library not available',
-    errorType: 'LLMPlatformException',
-  ));
-}
+  /// The local handle of the model at [address], attaching it first.
+  Future<ModelHandle> _attach(int address) async {
+    final existing = _attached[address];
+    if (existing != null) return existing;
 
-Future<void> _handleTokenize(
-  IsolateRequest request,
-  SendPort sendPort,
-  DartLLMLogger logger,
-) async {
-  logger.debug('Tokenize request received');
-  sendPort.send(IsolateResponse.failure(
-    requestId: request.requestId,
-    errorMessage: 'Native library not available',
-    errorType: 'LLMPlatformException',
-  ));
-}
+    final binding = await _ready;
+    if (binding is! SharedModelBinding) {
+      throw LLMPlatformException(
+        'This binding cannot use models loaded by other isolates',
+      );
+    }
+    final handle = binding.attachModel(address);
+    _attached[address] = handle;
+    _models.add(handle);
+    return handle;
+  }
 
-Future<void> _handleDetokenize(
-  IsolateRequest request,
-  SendPort sendPort,
-  DartLLMLogger logger,
-) async {
-  logger.debug('Detokenize request received');
-  sendPort.send(IsolateResponse.failure(
-    requestId: request.requestId,
-    errorMessage: 'Native library not available',
-    errorType: 'LLMPlatformException',
-  ));
-}
+  /// Sends each chunk of a generation, then a last chunk without data.
+  Future<void> _stream(int requestId, GenerateRequest request) async {
+    final binding = await _ready;
+    await for (final chunk in binding.generateStream(request)) {
+      _sendPort.send(IsolateStreamChunk(
+        requestId: requestId,
+        data: chunk,
+        isLast: false,
+      ));
+    }
+    _sendPort.send(IsolateStreamChunk(
+      requestId: requestId,
+      data: null,
+      isLast: true,
+    ));
+  }
 
-Future<void> _handleGetModelInfo(
-  IsolateRequest request,
-  SendPort sendPort,
-  DartLLMLogger logger,
-) async {
-  logger.debug('Get model info request received');
-  sendPort.send(IsolateResponse.failure(
-    requestId: request.requestId,
-    errorMessage: 'Native library not available',
-    errorType: 'LLMPlatformException',
-  ));
+  void dispose() {
+    _binding?.dispose();
+    _binding = null;
+    _models.clear();
+    _attached.clear();
+  }
 }
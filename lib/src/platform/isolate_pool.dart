@@ -0,0 +1,417 @@
+import 'dart:async';
+import 'dart:math' as math;
+
+import 'package:dartllm/src/models/model_info.dart';
+import 'package:dartllm/src/platform/isolate_manager.dart';
+import 'package:dartllm/src/platform/platform_binding.dart';
+import 'package:dartllm/src/utils/logger.dart';
+import 'package:dartllm/src/utils/platform_utils.dart';
+
+/// A model loaded by one of the pool's workers.
+class _PooledModel {
+  /// Index of the worker that loaded the model.
+  final int worker;
+
+  /// The model's handle in that worker's binding.
+  final ModelHandle localHandle;
+
+  /// Native address for the express isolate, or null if the worker's
+  /// binding cannot share models.
+  final int? address;
+
+  /// Express requests on the model that have not finished.
+  final Set<Future<void>> expressRequests = {};
+
+  /// Whether the express isolate has attached the model.
+  bool attached = false;
+
+  _PooledModel(this.worker, this.localHandle, this.address);
+}
+
+/// A pool of bridge isolates with each model pinned to one of them.
+///
+/// A single bridge isolate handles requests one at a time, so a long
+/// generation on one model would hold up every other model. The pool runs
+/// [size] workers and loads each model on the worker with the fewest
+/// models, so requests for different models run in parallel while all
+/// requests for one model stay on the isolate that owns its state.
+///
+/// The pool hands out its own model and session handles and maps them to
+/// the worker's, as every worker's binding numbers its handles from 1.
+///
+/// Lightweight requests (see [IsolateRequestType.isLightweight]) only read
+/// immutable model data. When a model's worker is busy they go to a
+/// separate express isolate, which attaches the model by its native
+/// address instead of loading it again (see [SharedModelBinding]).
+///
+/// The pool is itself a [PlatformBinding], so an `InferenceEngine` runs on
+/// it like on a [PlatformBinding] of the calling isolate:
+/// ```dart
+/// final pool = IsolatePool(size: 2);
+/// final engine = InferenceEngine(binding: pool);
+/// await engine.loadModel('/path/to/model.gguf');
+///
+/// await pool.shutdown();
+/// ```
+class IsolatePool implements PlatformBinding {
+  static const String _loggerName = 'dartllm.platform.pool';
+
+  final DartLLMLogger _logger = DartLLMLogger(_loggerName);
+
+  /// Number of workers models are loaded on.
+  final int size;
+
+  /// Workers models are loaded on.
+  final List<IsolateManager> _workers;
+
+  /// Worker for lightweight requests whose model's worker is busy.
+  final IsolateManager _express;
+
+  /// Loaded models by pool handle.
+  final Map<ModelHandle, _PooledModel> _models = {};
+
+  /// Loads in progress per worker.
+  final List<int> _pendingLoads;
+
+  /// Sessions by pool handle, with their model's pool handle.
+  final Map<SessionHandle, (ModelHandle, SessionHandle)> _sessions = {};
+
+  /// Counter for request IDs, unique across all workers.
+  int _nextRequestId = 1;
+
+  /// Counter for model and session handles.
+  int _nextHandle = 1;
+
+  Future<void>? _starting;
+
+  /// Creates a pool of [size] workers.
+  ///
+  /// Defaults to one worker per four processors, between 1 and 4: each
+  /// model's inference already spreads over several native threads.
+  /// Every worker runs requests on a binding from [bindingFactory]
+  /// (see [IsolateManager.new]).
+  IsolatePool({int? size, BridgeBindingFactory? bindingFactory})
+      : this._(_checkSize(size ?? _defaultSize()), bindingFactory);
+
+  IsolatePool._(this.size, BridgeBindingFactory? bindingFactory)
+      : _workers = List.generate(
+          size,
+          (_) => IsolateManager(bindingFactory: bindingFactory),
+        ),
+        _express = IsolateManager(bindingFactory: bindingFactory),
+        _pendingLoads = List.filled(size, 0);
+
+  static int _defaultSize() {
+    return math.max(1, math.min(4, PlatformUtils.processorCount ~/ 4));
+  }
+
+  static int _checkSize(int size) {
+    if (size < 1) {
+      throw ArgumentError.value(size, 'size', 'must be at least 1');
+    }
+    return size;
+  }
+
+  /// Whether the workers are running.
+  bool get isRunning => _express.isRunning;
+
+  /// Starts every worker.
+  ///
+  /// The [PlatformBinding] methods start the pool on first use.
+  Future<void> start() {
+    if (isRunning) {
+      return Future.value();
+    }
+
+    return _starting ??= () async {
+      _logger.info('Starting isolate pool with $size workers');
+      try {
+        await Future.wait([
+          for (final worker in _workers) worker.start(),
+          _express.start(),
+        ]);
+      } finally {
+        _starting = null;
+      }
+    }();
+  }
+
+  /// The index of the worker the model [handle] is loaded on, or null.
+  int? workerFor(ModelHandle handle) => _models[handle]?.worker;
+
+  /// The worker with the fewest models, counting loads in progress and
+  /// breaking ties by requests in flight.
+  int _leastLoadedWorker() {
+    final counts = List<int>.of(_pendingLoads);
+    for (final model in _models.values) {
+      counts[model.worker]++;
+    }
+
+    var best = 0;
+    for (var i = 1; i < size; i++) {
+      if (counts[i] < counts[best] ||
+          (counts[i] == counts[best] &&
+              _workers[i].inFlightCount < _workers[best].inFlightCount)) {
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  _PooledModel _model(ModelHandle handle) {
+    final model = _models[handle];
+    if (model == null) {
+      throw StateError('Invalid model handle: $handle');
+    }
+    return model;
+  }
+
+  IsolateRequest _request(IsolateRequestType type, Object? payload) {
+    return IsolateRequest(
+      requestId: _nextRequestId++,
+      type: type,
+      payload: payload,
+    );
+  }
+
+  /// Sends a request on the model [handle] to its worker, or for a
+  /// lightweight request to the express isolate when the worker is busy.
+  Future<Object?> _send(
+    IsolateRequestType type,
+    ModelHandle handle,
+    Object? payload,
+  ) async {
+    await start();
+    final model = _model(handle);
+    final worker = _workers[model.worker];
+
+    if (type.isLightweight &&
+        model.address != null &&
+        worker.inFlightCount > 0) {
+      return _sendExpress(type, model, payload);
+    }
+
+    final response = await worker.sendRequest(
+      _request(type, payloadForModel(payload, model.localHandle)),
+    );
+    return response.data;
+  }
+
+  Future<Object?> _sendExpress(
+    IsolateRequestType type,
+    _PooledModel model,
+    Object? payload,
+  ) {
+    model.attached = true;
+    final response = _express.sendRequest(
+      IsolateRequest(
+        requestId: _nextRequestId++,
+        type: type,
+        payload: payload,
+        modelAddress: model.address,
+      ),
+    );
+
+    final done = response.then<void>((_) {}, onError: (Object _) {});
+    model.expressRequests.add(done);
+    unawaited(done.whenComplete(() => model.expressRequests.remove(done)));
+
+    return response.then((response) => response.data);
+  }
+
+  @override
+  Future<LoadModelResult> loadModel(LoadModelRequest request) async {
+    await start();
+
+    // Count the load before it completes, so concurrent loads spread out.
+    final worker = _leastLoadedWorker();
+    _pendingLoads[worker]++;
+    final LoadedModel loaded;
+    try {
+      final response = await _workers[worker].sendRequest(
+        _request(IsolateRequestType.loadModel, request),
+      );
+      loaded = response.data! as LoadedModel;
+    } finally {
+      _pendingLoads[worker]--;
+    }
+
+    final handle = _nextHandle++;
+    _models[handle] = _PooledModel(
+      worker,
+      loaded.result.handle,
+      loaded.address,
+    );
+    _logger.debug('Loaded model $handle on worker $worker');
+
+    return LoadModelResult(handle: handle, modelInfo: loaded.result.modelInfo);
+  }
+
+  @override
+  Future<void> unloadModel(ModelHandle handle) async {
+    final model = _models.remove(handle);
+    if (model == null) {
+      _logger.warning('Attempted to unload unknown model handle: $handle');
+      return;
+    }
+    _sessions.removeWhere((_, session) => session.$1 == handle);
+
+    // The express isolate must be done with the model before it is freed.
+    await Future.wait(model.expressRequests.toList());
+    if (model.attached) {
+      await _express.sendRequest(
+        IsolateRequest(
+          requestId: _nextRequestId++,
+          type: IsolateRequestType.unloadModel,
+          modelAddress: model.address,
+        ),
+      );
+    }
+
+    await _workers[model.worker].sendRequest(
+      _request(IsolateRequestType.unloadModel, model.localHandle),
+    );
+  }
+
+  /// Maps the pool's session in [request] to the worker's.
+  GenerateRequest _localRequest(GenerateRequest request) {
+    final session = request.session;
+    if (session == null) {
+      return request;
+    }
+
+    final local = _sessions[session];
+    if (local == null || local.$1 != request.modelHandle) {
+      throw StateError('Invalid session handle: $session');
+    }
+    return request.copyWith(session: local.$2);
+  }
+
+  @override
+  Future<GenerateResult> generate(GenerateRequest request) async {
+    final data = await _send(
+      IsolateRequestType.generate,
+      request.modelHandle,
+      _localRequest(request),
+    );
+    return data! as GenerateResult;
+  }
+
+  @override
+  Stream<GenerateStreamChunk> generateStream(GenerateRequest request) async* {
+    await start();
+    final model = _model(request.modelHandle);
+    final local = payloadForModel(_localRequest(request), model.localHandle);
+
+    final chunks = _workers[model.worker].sendStreamingRequest(
+      _request(IsolateRequestType.generateStream, local),
+    );
+    await for (final chunk in chunks) {
+      if (chunk.data case final GenerateStreamChunk data) {
+        yield data;
+      }
+    }
+  }
+
+  @override
+  Future<EmbedResult> embed(EmbedRequest request) async {
+    final data = await _send(
+      IsolateRequestType.embed,
+      request.modelHandle,
+      request,
+    );
+    return data! as EmbedResult;
+  }
+
+  @override
+  Future<List<int>> tokenize(TokenizeRequest request) async {
+    final data = await _send(
+      IsolateRequestType.tokenize,
+      request.modelHandle,
+      request,
+    );
+    return data! as List<int>;
+  }
+
+  @override
+  Future<String> detokenize(DetokenizeRequest request) async {
+    final data = await _send(
+      IsolateRequestType.detokenize,
+      request.modelHandle,
+      request,
+    );
+    return data! as String;
+  }
+
+  @override
+  Future<ModelInfo> getModelInfo(ModelHandle handle) async {
+    final data = await _send(IsolateRequestType.getModelInfo, handle, handle);
+    return data! as ModelInfo;
+  }
+
+  @override
+  Future<ChatTemplateResult?> applyChatTemplate(
+    ChatTemplateRequest request,
+  ) async {
+    final data = await _send(
+      IsolateRequestType.applyChatTemplate,
+      request.modelHandle,
+      request,
+    );
+    return data as ChatTemplateResult?;
+  }
+
+  @override
+  Future<SessionHandle?> createSession(ModelHandle handle) async {
+    final local = await _send(
+      IsolateRequestType.createSession,
+      handle,
+      handle,
+    );
+    if (local == null) {
+      return null;
+    }
+
+    final session = _nextHandle++;
+    _sessions[session] = (handle, local as SessionHandle);
+    return session;
+  }
+
+  @override
+  Future<void> freeSession(SessionHandle session) async {
+    final local = _sessions.remove(session);
+    if (local == null) {
+      return;
+    }
+
+    final model = _model(local.$1);
+    await _workers[model.worker].sendRequest(
+      _request(IsolateRequestType.freeSession, local.$2),
+    );
+  }
+
+  @override
+  bool get supportsGpu => PlatformUtils.supportsGpuAcceleration;
+
+  @override
+  bool get supportsMultiThreading => true;
+
+  /// Shuts down every worker; their bindings free the models they hold.
+  Future<void> shutdown() async {
+    if (!isRunning) {
+      return;
+    }
+
+    _logger.info('Shutting down isolate pool');
+    // The express isolate first: the workers free the models it uses.
+    await _express.shutdown();
+    await Future.wait([for (final worker in _workers) worker.shutdown()]);
+    _models.clear();
+    _sessions.clear();
+  }
+
+  @override
+  void dispose() {
+    unawaited(shutdown());
+  }
+}
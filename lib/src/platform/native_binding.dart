@@ -4,6 +4,7 @@ import 'dart:typed_data';
 
 import 'package:dartllm/src/core/exceptions/exceptions.dart';
 import 'package:dartllm/src/models/enums.dart';
+import 'package:dartllm/src/models/model_config.dart';
 import 'package:dartllm/src/models/model_info.dart';
 import 'package:dartllm/src/platform/generated_bindings.dart';
 import 'package:dartllm/src/platform/library_loader.dart';
@@ -31,7 +32,7 @@ typedef StreamCallbackNative = Int32 Function(
 /// - iOS/macOS: `llamacpp.framework`
 /// - Windows: `llamacpp.dll`
 /// - Linux: `libllamacpp.so`
-class NativeBinding implements PlatformBinding {
+class NativeBinding implements SharedModelBinding {
   static const String _loggerName = 'dartllm.platform.native';
 
   final DartLLMLogger _logger = DartLLMLogger(_loggerName);
@@ -42,6 +43,9 @@ class NativeBinding implements PlatformBinding {
   /// The auto-generated bindings wrapper.
   DartLLMBindings? _bindings;
 
+  /// Address of `dartllm_free`, looked up on first use by [_nativeFree].
+  Pointer<NativeFinalizerFunction>? _dartllmFree;
+
   /// Whether the native library was successfully loaded.
   bool _isInitialized = false;
 
@@ -54,6 +58,36 @@ class NativeBinding implements PlatformBinding {
   /// Counter for generating unique model handles.
   int _nextHandle = 1;
 
+  /// Native model registry, created by [configureRegistry].
+  Pointer<Void>? _registry;
+
+  /// Handles acquired from the registry; released instead of freed.
+  final Set<ModelHandle> _registryHandles = {};
+
+  /// Handles adopted from another isolate by [attachModel]; never freed.
+  final Set<ModelHandle> _attachedHandles = {};
+
+  /// LoRA adapters by handle, with the model each was loaded for.
+  final Map<LoraAdapterHandle, (ModelHandle, Pointer<Void>)> _loraAdapters =
+      {};
+
+  /// Counter for generating unique LoRA adapter handles.
+  int _nextLoraHandle = 1;
+
+  /// Sessions by handle, with the model each was created on.
+  final Map<SessionHandle, (ModelHandle, Pointer<Void>)> _sessions = {};
+
+  /// Counter for generating unique session handles.
+  int _nextSessionHandle = 1;
+
+  /// Reused native buffers for token inputs and outputs, so the common
+  /// calls do not allocate per request.
+  final _ScratchBuffer _inputScratch = _ScratchBuffer();
+  final _ScratchBuffer _outputScratch = _ScratchBuffer();
+
+  /// Embedding dimension per model, learned on the first embed call.
+  final Map<ModelHandle, int> _embeddingDimensions = {};
+
   /// Creates a new native binding.
   ///
   /// Call [initialize] to load the native library before using
@@ -212,6 +246,62 @@ class NativeBinding implements PlatformBinding {
     }
   }
 
+  /// Estimates the memory [modelPath] would need if loaded with [config].
+  ///
+  /// Reads only the GGUF header and tensor table, so it is cheap enough to
+  /// run over a whole model catalog before choosing what to load.
+  ///
+  /// Throws [InvalidModelException] if the file is not a readable GGUF model.
+  Future<MemoryEstimate> estimateMemory(
+    String modelPath, {
+    ModelConfig config = const ModelConfig(),
+  }) async {
+    _checkReady();
+
+    final pathPointer = modelPath.toNativeUtf8();
+    final cacheType = _ggmlCacheType(config.kvCacheType);
+
+    try {
+      final estimatePointer = _bindings!.dartllm_estimate_memory(
+        pathPointer.cast(),
+        config.contextSize ?? 0,
+        config.batchSize,
+        cacheType,
+        cacheType,
+      );
+
+      if (estimatePointer == nullptr) {
+        throw InvalidModelException(
+          modelPath,
+          details: lastError ?? 'Failed to read GGUF header',
+        );
+      }
+
+      try {
+        final estimate = estimatePointer.ref;
+        return MemoryEstimate(
+          weightsBytes: estimate.weights_bytes,
+          kvCacheBytes: estimate.kv_cache_bytes,
+          computeBytes: estimate.compute_bytes,
+          outputBytes: estimate.output_bytes,
+          contextSize: estimate.context_size,
+          layerCount: estimate.layer_count,
+        );
+      } finally {
+        _bindings!.dartllm_free(estimatePointer.cast());
+      }
+    } finally {
+      calloc.free(pathPointer);
+    }
+  }
+
+  /// Maps a [KVCacheType] to its ggml type id.
+  static int _ggmlCacheType(KVCacheType type) => switch (type) {
+        KVCacheType.f16 => 1,
+        KVCacheType.q8_0 => 8,
+        KVCacheType.q4_0 => 2,
+      };
+
   @override
   Future<void> unloadModel(ModelHandle handle) async {
     _checkReady();
@@ -222,10 +312,424 @@ class NativeBinding implements PlatformBinding {
       return;
     }
 
+    // Native code frees a model's adapters together with the model.
+    _loraAdapters.removeWhere((_, adapter) => adapter.$1 == handle);
+
+    // Sessions are freed explicitly: a registry may keep the model.
+    _sessions.removeWhere((_, session) {
+      if (session.$1 != handle) return false;
+      _bindings!.dartllm_session_free(session.$2);
+      return true;
+    });
+    _embeddingDimensions.remove(handle);
+
+    if (_attachedHandles.remove(handle)) {
+      _logger.debug('Model detached: handle $handle');
+      return;
+    }
+
+    if (_registryHandles.remove(handle)) {
+      _bindings!.dartllm_registry_release(_registry!, pointer);
+      _logger.info('Model released to registry: handle $handle');
+      return;
+    }
+
     _bindings!.dartllm_free_model(pointer);
     _logger.info('Model unloaded: handle $handle');
   }
 
+  @override
+  int modelAddress(ModelHandle handle) {
+    _checkReady();
+
+    final pointer = _modelPointers[handle];
+    if (pointer == null) {
+      throw StateError('Invalid model handle: $handle');
+    }
+    return pointer.address;
+  }
+
+  @override
+  ModelHandle attachModel(int address) {
+    _checkReady();
+
+    if (address == 0) {
+      throw ArgumentError.value(address, 'address', 'must be a model address');
+    }
+
+    // Tokenization and model info only read the vocabulary and metadata,
+    // which native code never mutates, so no lock is shared with the
+    // owning isolate. The owner must not free the model while it is
+    // attached.
+    final handle = _nextHandle++;
+    _modelPointers[handle] = Pointer<Void>.fromAddress(address);
+    _attachedHandles.add(handle);
+    return handle;
+  }
+
+  /// Loads the LoRA adapter at [adapterPath] for the model [handle].
+  ///
+  /// The adapter shares the model's weights. Select it per request with
+  /// [GenerateRequest.loraAdapter]; switching does not reload anything.
+  Future<LoraAdapterHandle> loadLoraAdapter(
+    ModelHandle handle,
+    String adapterPath,
+  ) async {
+    _checkReady();
+
+    final pointer = _modelPointers[handle];
+    if (pointer == null) {
+      throw StateError('Invalid model handle: $handle');
+    }
+
+    final pathPointer = adapterPath.toNativeUtf8();
+    try {
+      final adapterPointer =
+          _bindings!.dartllm_lora_load(pointer, pathPointer.cast());
+      if (adapterPointer == nullptr) {
+        throw InvalidModelException(adapterPath, details: lastError);
+      }
+
+      final adapterHandle = _nextLoraHandle++;
+      _loraAdapters[adapterHandle] = (handle, adapterPointer);
+      return adapterHandle;
+    } finally {
+      calloc.free(pathPointer);
+    }
+  }
+
+  /// Frees a LoRA adapter loaded with [loadLoraAdapter].
+  ///
+  /// Throws a [StateError] while a session still uses the adapter; reset
+  /// or free the session first.
+  Future<void> unloadLoraAdapter(LoraAdapterHandle adapter) async {
+    _checkReady();
+
+    final entry = _loraAdapters[adapter];
+    if (entry == null) {
+      _logger.warning('Attempted to unload unknown LoRA adapter: $adapter');
+      return;
+    }
+
+    final pointer = _modelPointers[entry.$1];
+    if (pointer != null && _bindings!.dartllm_lora_free(pointer, entry.$2) != 0) {
+      throw StateError(
+        'Failed to unload LoRA adapter $adapter: ${lastError ?? 'unknown error'}',
+      );
+    }
+    _loraAdapters.remove(adapter);
+  }
+
+  @override
+  Future<SessionHandle?> createSession(ModelHandle handle) async {
+    _checkReady();
+
+    final pointer = _modelPointers[handle];
+    if (pointer == null) {
+      throw StateError('Invalid model handle: $handle');
+    }
+
+    final sessionPointer = _bindings!.dartllm_session_create(pointer);
+    if (sessionPointer == nullptr) {
+      _logger.debug('No session for model $handle: $lastError');
+      return null;
+    }
+
+    final session = _nextSessionHandle++;
+    _sessions[session] = (handle, sessionPointer);
+    return session;
+  }
+
+  @override
+  Future<void> freeSession(SessionHandle session) async {
+    _checkReady();
+
+    final entry = _sessions.remove(session);
+    if (entry == null) {
+      _logger.warning('Attempted to free unknown session: $session');
+      return;
+    }
+    _bindings!.dartllm_session_free(entry.$2);
+  }
+
+  /// Resolves the request's session to its native pointer, or null for a
+  /// stateless request.
+  Pointer<Void>? _sessionPointer(GenerateRequest request) {
+    final session = request.session;
+    if (session == null) return null;
+
+    final entry = _sessions[session];
+    if (entry == null || entry.$1 != request.modelHandle) {
+      throw StateError('Invalid session for this model: $session');
+    }
+    if (request.topLogprobs != null) {
+      throw ArgumentError('topLogprobs is not supported with a session');
+    }
+    return entry.$2;
+  }
+
+  /// Rewinds [session] to [GenerateRequest.sessionKeepTokens], pins the
+  /// request's LoRA adapter to it and decodes the request's prompt tokens
+  /// after the kept ones.
+  ///
+  /// A session's cached tokens were computed with its adapter, so the
+  /// adapter can only change on a request that keeps no tokens.
+  void _prepareSession(
+    Pointer<Void> session,
+    Pointer<Void> lora,
+    GenerateRequest request,
+  ) {
+    final truncated = _bindings!.dartllm_session_truncate(
+      session,
+      request.sessionKeepTokens,
+    );
+    if (truncated != 0) {
+      throw GenerationException(
+        'Failed to rewind session: ${lastError ?? 'unknown error'}',
+      );
+    }
+    final pinned =
+        _bindings!.dartllm_session_set_lora(session, lora, request.loraScale);
+    if (pinned != 0) {
+      throw GenerationException(
+        'Failed to set session LoRA adapter: ${lastError ?? 'unknown error'}',
+      );
+    }
+    if (request.promptTokens.isEmpty) return;
+
+    final appended = _bindings!.dartllm_session_append(
+      session,
+      _inputScratch.copyInts(request.promptTokens),
+      request.promptTokens.length,
+    );
+    if (appended < 0) {
+      throw GenerationException(
+        'Failed to extend session: ${lastError ?? 'unknown error'}',
+      );
+    }
+  }
+
+  /// Resolves the request's LoRA adapter to its native pointer, or
+  /// [nullptr] for the base model.
+  Pointer<Void> _loraPointer(GenerateRequest request) =>
+      _adapterPointer(request.modelHandle, request.loraAdapter);
+
+  /// Resolves [adapter] of the model [handle] to its native pointer, or
+  /// [nullptr] for the base model.
+  Pointer<Void> _adapterPointer(
+    ModelHandle handle,
+    LoraAdapterHandle? adapter,
+  ) {
+    if (adapter == null) return nullptr;
+
+    final entry = _loraAdapters[adapter];
+    if (entry == null || entry.$1 != handle) {
+      throw StateError('Invalid LoRA adapter for this model: $adapter');
+    }
+    return entry.$2;
+  }
+
+  void _checkConstraints(GenerateRequest request) {
+    if (request.grammar != null && request.jsonSchema != null) {
+      throw ArgumentError('Specify either grammar or jsonSchema, not both');
+    }
+  }
+
+  /// Runs [call] with the request's grammar and logit biases in native
+  /// memory, freeing them once it returns.
+  ///
+  /// Constraints go with each native call rather than being set on the
+  /// model, so concurrent requests on one model never see each other's.
+  /// Native code caches parsed grammars per model, so repeating a grammar
+  /// across requests does not parse it again.
+  T _withConstraints<T>(
+    GenerateRequest request,
+    T Function(Pointer<DartLLMConstraints> constraints) call,
+  ) {
+    final grammar = request.jsonSchema ?? request.grammar;
+    final bias = <int, double>{
+      ...request.logitBias,
+      for (final token in request.bannedTokens) token: double.negativeInfinity,
+    };
+    if (grammar == null && bias.isEmpty) return call(nullptr);
+
+    final constraints = calloc<DartLLMConstraints>();
+    final ref = constraints.ref;
+    try {
+      ref.grammar_kind =
+          request.jsonSchema != null ? _grammarJsonSchema : _grammarGbnf;
+      if (grammar != null) {
+        ref.grammar = grammar.toNativeUtf8(allocator: calloc).cast();
+      }
+      if (bias.isNotEmpty) {
+        ref.bias_tokens = calloc<Int32>(bias.length)
+          ..asTypedList(bias.length).setAll(0, bias.keys);
+        ref.biases = calloc<Float>(bias.length)
+          ..asTypedList(bias.length).setAll(0, bias.values);
+        ref.bias_count = bias.length;
+      }
+      return call(constraints);
+    } finally {
+      if (ref.grammar != nullptr) calloc.free(ref.grammar);
+      if (ref.bias_tokens != nullptr) calloc.free(ref.bias_tokens);
+      if (ref.biases != nullptr) calloc.free(ref.biases);
+      calloc.free(constraints);
+    }
+  }
+
+  static const int _grammarGbnf = 0;
+  static const int _grammarJsonSchema = 1;
+
+  /// Creates the native model registry used by [registerModel] and
+  /// [acquireModel].
+  ///
+  /// The registry keeps models loaded after [unloadModel] while they fit in
+  /// [budgetBytes] (0 for unlimited), evicting the least recently used idle
+  /// models when a new one needs room. Up to [maxWarmModels] evicted CPU
+  /// models keep their memory-mapped weights so reacquiring them only
+  /// recreates the context.
+  void configureRegistry({required int budgetBytes, int maxWarmModels = 2}) {
+    _checkReady();
+
+    if (_registry != null) {
+      throw StateError('Model registry already configured');
+    }
+
+    final registry =
+        _bindings!.dartllm_registry_create(budgetBytes, maxWarmModels);
+    if (registry == nullptr) {
+      throw ArgumentError(lastError ?? 'Invalid registry configuration');
+    }
+    _registry = registry;
+  }
+
+  /// Registers [modelPath] with the registry under [id] without loading it.
+  ///
+  /// Throws [InvalidModelException] if the file is not a readable GGUF model.
+  Future<void> registerModel(
+    String id,
+    String modelPath, {
+    ModelConfig config = const ModelConfig(),
+  }) async {
+    final registry = _checkRegistry();
+
+    final idPointer = id.toNativeUtf8();
+    final pathPointer = modelPath.toNativeUtf8();
+
+    try {
+      final result = _bindings!.dartllm_registry_register(
+        registry,
+        idPointer.cast(),
+        pathPointer.cast(),
+        config.contextSize ?? 0,
+        config.gpuLayers,
+        config.threads,
+        config.batchSize,
+        config.useMemoryMap ? 1 : 0,
+      );
+
+      if (result == -2) {
+        throw StateError('Model id already registered: $id');
+      }
+      if (result != 0) {
+        throw InvalidModelException(modelPath, details: lastError);
+      }
+    } finally {
+      calloc.free(idPointer);
+      calloc.free(pathPointer);
+    }
+  }
+
+  /// Removes [id] from the registry, freeing its model.
+  ///
+  /// Throws [StateError] if handles to the model have not been unloaded.
+  Future<void> unregisterModel(String id) async {
+    final registry = _checkRegistry();
+
+    final idPointer = id.toNativeUtf8();
+    try {
+      final result =
+          _bindings!.dartllm_registry_unregister(registry, idPointer.cast());
+      if (result != 0) {
+        throw StateError(lastError ?? 'Failed to unregister model: $id');
+      }
+    } finally {
+      calloc.free(idPointer);
+    }
+  }
+
+  /// Returns a handle to the registered model [id], loading it if it is not
+  /// resident.
+  ///
+  /// Pass the handle to [unloadModel] when done; the model then stays loaded
+  /// until the registry needs its memory.
+  Future<LoadModelResult> acquireModel(String id) async {
+    final registry = _checkRegistry();
+
+    final idPointer = id.toNativeUtf8();
+    try {
+      final modelPointer =
+          _bindings!.dartllm_registry_acquire(registry, idPointer.cast());
+      if (modelPointer == nullptr) {
+        throw ModelException(
+          'Failed to acquire model $id: ${lastError ?? 'unknown error'}',
+        );
+      }
+
+      final handle = _nextHandle++;
+      _modelPointers[handle] = modelPointer;
+      _registryHandles.add(handle);
+
+      try {
+        final modelInfo = await getModelInfo(handle);
+        return LoadModelResult(handle: handle, modelInfo: modelInfo);
+      } catch (_) {
+        _modelPointers.remove(handle);
+        _registryHandles.remove(handle);
+        _bindings!.dartllm_registry_release(registry, modelPointer);
+        rethrow;
+      }
+    } finally {
+      calloc.free(idPointer);
+    }
+  }
+
+  /// Returns the registry's residency and hit counters.
+  RegistryStats registryStats() {
+    final registry = _checkRegistry();
+
+    final stats = calloc<DartLLMRegistryStats>();
+    try {
+      if (_bindings!.dartllm_registry_stats(registry, stats) != 0) {
+        throw StateError(lastError ?? 'Failed to read registry statistics');
+      }
+      final ref = stats.ref;
+      return RegistryStats(
+        budgetBytes: ref.budget_bytes,
+        residentBytes: ref.resident_bytes,
+        registeredModels: ref.registered_models,
+        residentModels: ref.resident_models,
+        warmModels: ref.warm_models,
+        activeHandles: ref.active_handles,
+        hits: ref.hits,
+        warmHits: ref.warm_hits,
+        loads: ref.loads,
+        evictions: ref.evictions,
+      );
+    } finally {
+      calloc.free(stats);
+    }
+  }
+
+  Pointer<Void> _checkRegistry() {
+    _checkReady();
+    final registry = _registry;
+    if (registry == null) {
+      throw StateError('Model registry not configured');
+    }
+    return registry;
+  }
+
   @override
   Future<GenerateResult> generate(GenerateRequest request) async {
     _checkReady();
@@ -234,30 +738,112 @@ class NativeBinding implements PlatformBinding {
     if (pointer == null) {
       throw StateError('Invalid model handle: ${request.modelHandle}');
     }
+    final loraPointer = _loraPointer(request);
+    final sessionPointer = _sessionPointer(request);
+    _checkConstraints(request);
+
+    final topLogprobs = request.topLogprobs;
+    if (topLogprobs != null &&
+        (topLogprobs < 0 || topLogprobs > _maxTopLogprobs)) {
+      throw ArgumentError.value(
+        topLogprobs,
+        'topLogprobs',
+        'must be between 0 and $_maxTopLogprobs',
+      );
+    }
 
     final startTime = DateTime.now();
 
-    final promptPointer = calloc<Int32>(request.promptTokens.length);
-    try {
-      for (var i = 0; i < request.promptTokens.length; i++) {
-        promptPointer[i] = request.promptTokens[i];
+    if (topLogprobs == null) {
+      // Tokens are written straight into a reused buffer; nothing is
+      // allocated natively.
+      final tokensPointer = _outputScratch.ints(request.maxTokens);
+      final finishPointer = _outputScratch.finishReason;
+      final int count;
+      if (sessionPointer != null) {
+        _prepareSession(sessionPointer, loraPointer, request);
+        count = _withConstraints(
+          request,
+          (constraints) => _bindings!.dartllm_session_generate(
+            sessionPointer,
+            request.maxTokens,
+            request.temperature,
+            request.topP,
+            request.topK,
+            request.minP,
+            request.seed ?? -1,
+            constraints,
+            tokensPointer,
+            finishPointer,
+          ),
+        );
+      } else {
+        count = _withConstraints(
+          request,
+          (constraints) => _bindings!.dartllm_generate_into(
+            pointer,
+            _inputScratch.copyInts(request.promptTokens),
+            request.promptTokens.length,
+            request.maxTokens,
+            request.temperature,
+            request.topP,
+            request.topK,
+            request.minP,
+            request.repetitionPenalty,
+            request.seed ?? -1,
+            loraPointer,
+            request.loraScale,
+            constraints,
+            tokensPointer,
+            finishPointer,
+          ),
+        );
       }
 
-      final resultPointer = _bindings!.dartllm_generate(
-        pointer,
-        promptPointer,
-        request.promptTokens.length,
-        request.maxTokens,
-        request.temperature,
-        request.topP,
-        request.topK,
-        request.minP,
-        request.repetitionPenalty,
-        request.seed ?? -1,
+      if (count < 0) {
+        throw GenerationException(
+          'Generation failed: ${lastError ?? 'unknown error'}',
+        );
+      }
+
+      final tokens = Int32List.fromList(tokensPointer.asTypedList(count));
+      return GenerateResult(
+        tokens: tokens,
+        promptTokenCount: request.promptTokens.length,
+        completionTokenCount: count,
+        finishReason: _finishReason(finishPointer.value),
+        generationTimeMs: DateTime.now().difference(startTime).inMilliseconds,
+      );
+    }
+
+    final promptPointer = _inputScratch.copyInts(request.promptTokens);
+    final logprobsOut = calloc<Pointer<DartLLMTokenLogprob>>();
+    try {
+      final resultPointer = _withConstraints(
+        request,
+        (constraints) => _bindings!.dartllm_generate_logprobs(
+          pointer,
+          promptPointer,
+          request.promptTokens.length,
+          request.maxTokens,
+          request.temperature,
+          request.topP,
+          request.topK,
+          request.minP,
+          request.repetitionPenalty,
+          request.seed ?? -1,
+          loraPointer,
+          request.loraScale,
+          constraints,
+          topLogprobs,
+          logprobsOut,
+        ),
       );
 
       if (resultPointer == nullptr) {
-        throw GenerationException('Generation failed in native code');
+        throw GenerationException(
+          'Generation failed: ${lastError ?? 'unknown error'}',
+        );
       }
 
       try {
@@ -271,15 +857,133 @@ class NativeBinding implements PlatformBinding {
           completionTokenCount: result.tokens.length,
           finishReason: result.finishReason,
           generationTimeMs: generationTimeMs,
+          logprobs: _parseLogprobs(
+            logprobsOut.value,
+            result.tokens.length,
+            topLogprobs,
+          ),
         );
       } finally {
         _bindings!.dartllm_free(resultPointer.cast());
+        if (logprobsOut.value != nullptr) {
+          _bindings!.dartllm_free(logprobsOut.value.cast());
+        }
       }
     } finally {
-      calloc.free(promptPointer);
+      calloc.free(logprobsOut);
     }
   }
 
+  /// Generates [n] independent completions of the same prompt.
+  ///
+  /// The prompt is evaluated once and the completions are decoded together
+  /// in shared batches, each with its own seed (`seed + i` when
+  /// [GenerateRequest.seed] is set). Completions that finish early drop
+  /// out while the rest continue. [GenerateRequest.topLogprobs] is not
+  /// supported here.
+  Future<List<GenerateResult>> generateN(GenerateRequest request, int n) async {
+    _checkReady();
+
+    final pointer = _modelPointers[request.modelHandle];
+    if (pointer == null) {
+      throw StateError('Invalid model handle: ${request.modelHandle}');
+    }
+    if (n < 1 || n > _maxParallel) {
+      throw ArgumentError.value(n, 'n', 'must be between 1 and $_maxParallel');
+    }
+    if (request.session != null) {
+      throw ArgumentError('generateN does not support sessions');
+    }
+    final loraPointer = _loraPointer(request);
+    _checkConstraints(request);
+
+    final startTime = DateTime.now();
+
+    final promptPointer = _inputScratch.copyInts(request.promptTokens);
+    final resultsPointer = calloc<Pointer<DartLLMGenerateResult>>(n);
+    try {
+      final status = _withConstraints(
+        request,
+        (constraints) => _bindings!.dartllm_generate_n(
+          pointer,
+          promptPointer,
+          request.promptTokens.length,
+          request.maxTokens,
+          request.temperature,
+          request.topP,
+          request.topK,
+          request.minP,
+          request.repetitionPenalty,
+          request.seed ?? -1,
+          loraPointer,
+          request.loraScale,
+          constraints,
+          n,
+          resultsPointer,
+        ),
+      );
+
+      if (status != 0) {
+        throw GenerationException(
+          'Generation failed: ${lastError ?? 'unknown error'}',
+        );
+      }
+
+      final generationTimeMs =
+          DateTime.now().difference(startTime).inMilliseconds;
+      final results = <GenerateResult>[];
+      for (var i = 0; i < n; i++) {
+        final resultPointer = resultsPointer[i];
+        try {
+          final result = _parseGenerateResult(resultPointer.cast());
+          results.add(
+            GenerateResult(
+              tokens: result.tokens,
+              promptTokenCount: request.promptTokens.length,
+              completionTokenCount: result.tokens.length,
+              finishReason: result.finishReason,
+              generationTimeMs: generationTimeMs,
+            ),
+          );
+        } finally {
+          _bindings!.dartllm_free(resultPointer.cast());
+        }
+      }
+      return results;
+    } finally {
+      calloc.free(resultsPointer);
+    }
+  }
+
+  static const int _maxParallel = 16;
+
+  /// Unpacks `tokenCount` groups of (1 + [topN]) native entries.
+  List<TokenLogprobs> _parseLogprobs(
+    Pointer<DartLLMTokenLogprob> packed,
+    int tokenCount,
+    int topN,
+  ) {
+    if (packed == nullptr) return const [];
+
+    TokenLogprob entry(int index) {
+      final ref = packed[index];
+      return TokenLogprob(token: ref.token, logprob: ref.logprob);
+    }
+
+    final stride = 1 + topN;
+    return [
+      for (var i = 0; i < tokenCount; i++)
+        TokenLogprobs(
+          sampled: entry(i * stride),
+          topAlternatives: [
+            for (var j = 1; j < stride; j++) entry(i * stride + j),
+          ],
+        ),
+    ];
+  }
+
+  static const int _maxTopLogprobs = 20;
+
   /// Parses the native generation result structure.
   ({List<int> tokens, FinishReason finishReason}) _parseGenerateResult(
     Pointer<Void> resultPointer,
@@ -292,18 +996,19 @@ class NativeBinding implements PlatformBinding {
     final tokenCount = intPtr[0];
     final finishReasonCode = intPtr[1];
 
-    final tokens = <int>[];
-    for (var i = 0; i < tokenCount; i++) {
-      tokens.add(intPtr[2 + i]);
-    }
+    // One block copy: the native result is freed right after parsing.
+    final tokens = Int32List.fromList((intPtr + 2).asTypedList(tokenCount));
+
+    return (tokens: tokens, finishReason: _finishReason(finishReasonCode));
+  }
 
-    final finishReason = switch (finishReasonCode) {
+  /// Maps a native finish reason code (0=stop, 1=length, 2=error).
+  FinishReason _finishReason(int code) {
+    return switch (code) {
       0 => FinishReason.stop,
       1 => FinishReason.length,
       _ => FinishReason.error,
     };
-
-    return (tokens: tokens, finishReason: finishReason);
   }
 
   @override
@@ -314,13 +1019,17 @@ class NativeBinding implements PlatformBinding {
     if (pointer == null) {
       throw StateError('Invalid model handle: ${request.modelHandle}');
     }
+    final loraPointer = _loraPointer(request);
+    final sessionPointer = _sessionPointer(request);
+    _checkConstraints(request);
 
     final controller = StreamController<GenerateStreamChunk>();
+    // Not the input scratch buffer: generation starts in a microtask, after
+    // other calls may have reused it.
     final tokensPointer = calloc<Int32>(request.promptTokens.length);
-
-    for (var i = 0; i < request.promptTokens.length; i++) {
-      tokensPointer[i] = request.promptTokens[i];
-    }
+    tokensPointer
+        .asTypedList(request.promptTokens.length)
+        .setAll(0, request.promptTokens);
 
     var shouldContinue = true;
 
@@ -356,24 +1065,54 @@ class NativeBinding implements PlatformBinding {
 
     Future<void>.microtask(() async {
       try {
-        final result = _bindings!.dartllm_generate_stream(
-          pointer,
-          tokensPointer,
-          request.promptTokens.length,
-          request.maxTokens,
-          request.temperature,
-          request.topP,
-          request.topK,
-          request.minP,
-          request.repetitionPenalty,
-          request.seed ?? -1,
-          nativeCallback.nativeFunction.cast(),
-          nullptr,
+        if (sessionPointer != null) {
+          try {
+            _prepareSession(sessionPointer, loraPointer, request);
+          } on GenerationException catch (e) {
+            controller.addError(e);
+            controller.close();
+            return;
+          }
+        }
+        final result = _withConstraints(
+          request,
+          (constraints) => sessionPointer != null
+              ? _bindings!.dartllm_session_generate_stream(
+                  sessionPointer,
+                  request.maxTokens,
+                  request.temperature,
+                  request.topP,
+                  request.topK,
+                  request.minP,
+                  request.seed ?? -1,
+                  constraints,
+                  nativeCallback.nativeFunction.cast(),
+                  nullptr,
+                )
+              : _bindings!.dartllm_generate_stream(
+                  pointer,
+                  tokensPointer,
+                  request.promptTokens.length,
+                  request.maxTokens,
+                  request.temperature,
+                  request.topP,
+                  request.topK,
+                  request.minP,
+                  request.repetitionPenalty,
+                  request.seed ?? -1,
+                  loraPointer,
+                  request.loraScale,
+                  constraints,
+                  nativeCallback.nativeFunction.cast(),
+                  nullptr,
+                ),
         );
 
         if (result < 0 && !controller.isClosed) {
           controller.addError(
-            GenerationException('Streaming generation failed: code $result'),
+            GenerationException(
+              'Streaming generation failed: ${lastError ?? 'code $result'}',
+            ),
           );
           controller.close();
         }
@@ -386,51 +1125,151 @@ class NativeBinding implements PlatformBinding {
     return controller.stream;
   }
 
-  @override
-  Future<EmbedResult> embed(EmbedRequest request) async {
+  /// Scores each of [candidates] as a continuation of [promptTokens].
+  ///
+  /// The prompt is evaluated once and shared by all candidates, which are
+  /// then evaluated together, so scoring K candidates costs far less than K
+  /// generations. Returns one score per candidate, in order. Candidates
+  /// are scored with [loraAdapter] at [loraScale], or the base model.
+  Future<List<CandidateScore>> score(
+    ModelHandle handle,
+    List<int> promptTokens,
+    List<List<int>> candidates, {
+    LoraAdapterHandle? loraAdapter,
+    double loraScale = 1.0,
+  }) async {
     _checkReady();
 
-    final pointer = _modelPointers[request.modelHandle];
+    final pointer = _modelPointers[handle];
     if (pointer == null) {
-      throw StateError('Invalid model handle: ${request.modelHandle}');
+      throw StateError('Invalid model handle: $handle');
+    }
+    final loraPointer = _adapterPointer(handle, loraAdapter);
+    if (promptTokens.isEmpty) {
+      throw ArgumentError.value(promptTokens, 'promptTokens', 'is empty');
+    }
+    if (candidates.isEmpty || candidates.any((c) => c.isEmpty)) {
+      throw ArgumentError.value(
+        candidates,
+        'candidates',
+        'must be non-empty token lists',
+      );
     }
 
-    final tokensPointer = calloc<Int32>(request.tokens.length);
-    final dimensionPointer = calloc<Int32>(1);
+    final totalTokens = candidates.fold<int>(0, (n, c) => n + c.length);
+    final promptPointer = calloc<Int32>(promptTokens.length);
+    final tokensPointer = calloc<Int32>(totalTokens);
+    final lengthsPointer = calloc<Int32>(candidates.length);
+    final totalsPointer = calloc<Float>(candidates.length);
 
     try {
-      for (var i = 0; i < request.tokens.length; i++) {
-        tokensPointer[i] = request.tokens[i];
+      promptPointer.asTypedList(promptTokens.length).setAll(0, promptTokens);
+      final tokens = tokensPointer.asTypedList(totalTokens);
+      final lengths = lengthsPointer.asTypedList(candidates.length);
+      var offset = 0;
+      for (var i = 0; i < candidates.length; i++) {
+        lengths[i] = candidates[i].length;
+        tokens.setAll(offset, candidates[i]);
+        offset += candidates[i].length;
       }
 
-      final embeddingPointer = _bindings!.dartllm_embed(
+      final logprobsPointer = _bindings!.dartllm_score(
         pointer,
+        promptPointer,
+        promptTokens.length,
         tokensPointer,
-        request.tokens.length,
-        request.normalize ? 1 : 0,
-        dimensionPointer,
+        lengthsPointer,
+        candidates.length,
+        loraPointer,
+        loraScale,
+        totalsPointer,
       );
-
-      if (embeddingPointer == nullptr) {
-        throw GenerationException('Embedding generation failed in native code');
+      if (logprobsPointer == nullptr) {
+        throw GenerationException(
+          'Scoring failed: ${lastError ?? 'unknown error'}',
+        );
       }
 
-      try {
-        final dimension = dimensionPointer[0];
-        final embedding = Float32List(dimension);
-
-        for (var i = 0; i < dimension; i++) {
-          embedding[i] = embeddingPointer[i];
-        }
-
-        return EmbedResult(embedding: embedding);
-      } finally {
-        _bindings!.dartllm_free(embeddingPointer.cast());
+      // Each candidate's log-probabilities are a view of the native array,
+      // which is freed once no view is reachable.
+      final logprobs = logprobsPointer.asTypedList(
+        totalTokens,
+        finalizer: _nativeFree,
+      );
+      final scores = <CandidateScore>[];
+      var start = 0;
+      for (var i = 0; i < candidates.length; i++) {
+        final end = start + candidates[i].length;
+        scores.add(
+          CandidateScore(
+            logprob: totalsPointer[i],
+            tokenLogprobs: Float32List.sublistView(logprobs, start, end),
+          ),
+        );
+        start = end;
       }
+      return scores;
     } finally {
+      calloc.free(promptPointer);
       calloc.free(tokensPointer);
-      calloc.free(dimensionPointer);
+      calloc.free(lengthsPointer);
+      calloc.free(totalsPointer);
+    }
+  }
+
+  /// `dartllm_free`, as a finalizer for typed views of native results.
+  Pointer<NativeFinalizerFunction> get _nativeFree => _dartllmFree ??=
+      _library!.lookup<NativeFinalizerFunction>('dartllm_free');
+
+  @override
+  Future<EmbedResult> embed(EmbedRequest request) async {
+    _checkReady();
+
+    final pointer = _modelPointers[request.modelHandle];
+    if (pointer == null) {
+      throw StateError('Invalid model handle: ${request.modelHandle}');
+    }
+
+    final tokensPointer = _inputScratch.copyInts(request.tokens);
+    final normalize = request.normalize ? 1 : 0;
+
+    // A zero-capacity call only reports the dimension.
+    final dimension = _embeddingDimensions[request.modelHandle] ??=
+        _bindings!.dartllm_embed_into(
+      pointer,
+      tokensPointer,
+      request.tokens.length,
+      normalize,
+      nullptr,
+      0,
+    );
+    if (dimension <= 0) {
+      _embeddingDimensions.remove(request.modelHandle);
+      throw GenerationException('Embedding generation failed in native code');
     }
+
+    // Native code writes into memory owned by the returned list, so the
+    // vector is never copied.
+    final embeddingPointer = malloc<Float>(dimension);
+    final written = _bindings!.dartllm_embed_into(
+      pointer,
+      tokensPointer,
+      request.tokens.length,
+      normalize,
+      embeddingPointer,
+      dimension,
+    );
+    if (written != dimension) {
+      malloc.free(embeddingPointer);
+      throw GenerationException('Embedding generation failed in native code');
+    }
+
+    return EmbedResult(
+      embedding: embeddingPointer.asTypedList(
+        dimension,
+        finalizer: malloc.nativeFree,
+      ),
+    );
   }
 
   @override
@@ -443,38 +1282,34 @@ class NativeBinding implements PlatformBinding {
     }
 
     final textPointer = request.text.toNativeUtf8();
-    final lengthPointer = calloc<Int32>(1);
 
     try {
-      final tokensPointer = _bindings!.dartllm_tokenize(
-        pointer,
-        textPointer.cast(),
-        request.addSpecialTokens ? 1 : 0,
-        lengthPointer,
-      );
+      // Tokenize into the reused buffer, growing it once if the text needs
+      // more room.
+      var capacity = _outputScratch.capacity;
+      var count = -1;
+      while (true) {
+        count = _bindings!.dartllm_tokenize_into(
+          pointer,
+          textPointer.cast(),
+          request.addSpecialTokens ? 1 : 0,
+          _outputScratch.ints(capacity),
+          capacity,
+        );
+        if (count <= capacity) break;
+        capacity = count;
+      }
 
-      if (tokensPointer == nullptr) {
+      if (count < 0) {
         throw TokenizationException(
           'Tokenization failed',
           inputText: request.text,
         );
       }
 
-      try {
-        final length = lengthPointer[0];
-        final tokens = <int>[];
-
-        for (var i = 0; i < length; i++) {
-          tokens.add(tokensPointer[i]);
-        }
-
-        return tokens;
-      } finally {
-        _bindings!.dartllm_free(tokensPointer.cast());
-      }
+      return Int32List.fromList(_outputScratch.ints(count).asTypedList(count));
     } finally {
       calloc.free(textPointer);
-      calloc.free(lengthPointer);
     }
   }
 
@@ -487,33 +1322,100 @@ class NativeBinding implements PlatformBinding {
       throw StateError('Invalid model handle: ${request.modelHandle}');
     }
 
-    final tokensPointer = calloc<Int32>(request.tokens.length);
+    final textPointer = _bindings!.dartllm_detokenize(
+      pointer,
+      _inputScratch.copyInts(request.tokens),
+      request.tokens.length,
+    );
+
+    if (textPointer == nullptr) {
+      throw TokenizationException(
+        'Detokenization failed',
+        inputText: request.tokens.toString(),
+      );
+    }
 
     try {
-      for (var i = 0; i < request.tokens.length; i++) {
-        tokensPointer[i] = request.tokens[i];
+      return textPointer.cast<Utf8>().toDartString();
+    } finally {
+      _bindings!.dartllm_free(textPointer.cast());
+    }
+  }
+
+  @override
+  Future<ChatTemplateResult?> applyChatTemplate(
+    ChatTemplateRequest request,
+  ) async {
+    _checkReady();
+
+    final pointer = _modelPointers[request.modelHandle];
+    if (pointer == null) {
+      throw StateError('Invalid model handle: ${request.modelHandle}');
+    }
+
+    final messages = request.messages;
+    final roles = calloc<Pointer<Char>>(messages.length);
+    final contents = calloc<Pointer<Char>>(messages.length);
+    final prefixPointer = calloc<Int32>();
+
+    try {
+      for (var i = 0; i < messages.length; i++) {
+        roles[i] = messages[i].role.name.toNativeUtf8().cast();
+        contents[i] = messages[i].content.toNativeUtf8().cast();
       }
 
-      final textPointer = _bindings!.dartllm_detokenize(
+      final textPointer = _bindings!.dartllm_apply_chat_template(
         pointer,
-        tokensPointer,
-        request.tokens.length,
+        roles,
+        contents,
+        messages.length,
+        request.previousMessageCount,
+        request.addGenerationPrompt ? 1 : 0,
+        prefixPointer,
       );
 
+      // No embedded template, or one llama.cpp does not recognize.
       if (textPointer == nullptr) {
-        throw TokenizationException(
-          'Detokenization failed',
-          inputText: request.tokens.toString(),
-        );
+        _logger.debug('Model chat template unavailable: $lastError');
+        return null;
       }
 
       try {
-        return textPointer.cast<Utf8>().toDartString();
+        return ChatTemplateResult(
+          text: textPointer.cast<Utf8>().toDartString(),
+          incremental: prefixPointer.value > 0,
+        );
       } finally {
         _bindings!.dartllm_free(textPointer.cast());
       }
     } finally {
-      calloc.free(tokensPointer);
+      for (var i = 0; i < messages.length; i++) {
+        if (roles[i] != nullptr) calloc.free(roles[i]);
+        if (contents[i] != nullptr) calloc.free(contents[i]);
+      }
+      calloc.free(roles);
+      calloc.free(contents);
+      calloc.free(prefixPointer);
+    }
+  }
+
+  /// Gets the model's full chat template, or null if it has none.
+  ///
+  /// [ModelInfo.chatTemplate] is truncated to 4095 bytes; this is not.
+  String? chatTemplate(ModelHandle handle) {
+    _checkReady();
+
+    final pointer = _modelPointers[handle];
+    if (pointer == null) {
+      throw StateError('Invalid model handle: $handle');
+    }
+
+    final textPointer = _bindings!.dartllm_get_chat_template(pointer);
+    if (textPointer == nullptr) return null;
+    try {
+      return textPointer.cast<Utf8>().toDartString();
+    } finally {
+      _bindings!.dartllm_free(textPointer.cast());
     }
   }
 
@@ -541,6 +1443,207 @@ class NativeBinding implements PlatformBinding {
     }
   }
 
+  /// Warms up a loaded model so the first request runs at steady-state
+  /// latency.
+  ///
+  /// With memory-mapped weights, [readWeights] reads the model file into the
+  /// page cache in a background native thread; otherwise the kernel is only
+  /// asked to read ahead. [decode] then runs one dummy decode so backend
+  /// kernels and compute buffers are ready. [onProgress] is called with the
+  /// bytes prefetched so far and the total while the warm-up runs; both are
+  /// 0 when [readWeights] is false, as the kernel's read-ahead is not
+  /// metered.
+  ///
+  /// Requests may be issued while the warm-up is in progress.
+  Future<void> warmup(
+    ModelHandle handle, {
+    bool readWeights = true,
+    bool decode = true,
+    void Function(int bytesDone, int bytesTotal)? onProgress,
+  }) async {
+    _checkReady();
+
+    final pointer = _modelPointers[handle];
+    if (pointer == null) {
+      throw StateError('Invalid model handle: $handle');
+    }
+
+    var mode = readWeights ? _warmupRead : _warmupAdvise;
+    if (decode) mode |= _warmupDecode;
+
+    final started = _bindings!.dartllm_warmup(pointer, mode);
+    if (started != 0) {
+      throw ModelException(
+        'Failed to start warm-up: ${lastError ?? 'error $started'}',
+      );
+    }
+
+    final status = calloc<DartLLMWarmupStatus>();
+    try {
+      while (true) {
+        _bindings!.dartllm_warmup_status(pointer, status);
+        onProgress?.call(status.ref.bytes_done, status.ref.bytes_total);
+
+        if (status.ref.state != _warmupStateRunning) break;
+        await Future<void>.delayed(const Duration(milliseconds: 50));
+      }
+
+      // The worker has finished, so this only joins it and reports errors.
+      if (_bindings!.dartllm_warmup_wait(pointer) != 0) {
+        throw ModelException('Warm-up failed: ${lastError ?? 'unknown error'}');
+      }
+    } finally {
+      calloc.free(status);
+    }
+  }
+
+  // Mirrors of the DARTLLM_WARMUP_* macros in dartllm.h.
+  static const int _warmupAdvise = 1;
+  static const int _warmupRead = 2;
+  static const int _warmupDecode = 4;
+  static const int _warmupStateRunning = 1;
+
+  /// Persists the KV state of frequently used prompt prefixes of the model
+  /// [handle] in [directory], such as shared system prompts.
+  ///
+  /// Once [minUses] requests have started with the same prefix, its state
+  /// is written to disk; later requests, including those of later
+  /// processes, restore it instead of decoding it. Models using the same
+  /// directory share its [budgetBytes], beyond which the least recently
+  /// used prefixes are deleted. Pass a null [directory] to stop using the
+  /// cache.
+  void setPrefixCache(
+    ModelHandle handle, {
+    required String? directory,
+    int budgetBytes = 1024 * 1024 * 1024,
+    int minUses = 2,
+  }) {
+    _checkReady();
+
+    final pointer = _modelPointers[handle];
+    if (pointer == null) {
+      throw StateError('Invalid model handle: $handle');
+    }
+
+    final directoryPointer = directory?.toNativeUtf8() ?? nullptr;
+    try {
+      final result = _bindings!.dartllm_set_prefix_cache(
+        pointer,
+        directoryPointer.cast(),
+        budgetBytes,
+        minUses,
+      );
+      if (result == -1) {
+        throw ArgumentError(lastError ?? 'Invalid prefix cache settings');
+      }
+      if (result != 0) {
+        throw ModelException(
+          'Failed to set prefix cache: ${lastError ?? 'error $result'}',
+        );
+      }
+    } finally {
+      if (directoryPointer != nullptr) calloc.free(directoryPointer);
+    }
+  }
+
+  /// Returns the prefix cache counters of the model [handle], all zero if
+  /// it has no prefix cache (see [setPrefixCache]).
+  PrefixCacheStats prefixCacheStats(ModelHandle handle) {
+    _checkReady();
+
+    final pointer = _modelPointers[handle];
+    if (pointer == null) {
+      throw StateError('Invalid model handle: $handle');
+    }
+
+    final stats = calloc<DartLLMPrefixCacheStats>();
+    try {
+      if (_bindings!.dartllm_prefix_cache_stats(pointer, stats) != 0) {
+        throw StateError(lastError ?? 'Failed to read prefix cache statistics');
+      }
+      final ref = stats.ref;
+      return PrefixCacheStats(
+        budgetBytes: ref.budget_bytes,
+        storedBytes: ref.stored_bytes,
+        entries: ref.entries,
+        hits: ref.hits,
+        misses: ref.misses,
+        tokensRestored: ref.tokens_restored,
+        stores: ref.stores,
+        evictions: ref.evictions,
+      );
+    } finally {
+      calloc.free(stats);
+    }
+  }
+
+  /// Reads [ModelInfo] from the GGUF header at [modelPath] without loading
+  /// the model.
+  ///
+  /// Only the metadata section is parsed, so this is cheap enough to run
+  /// over a whole catalog. [ModelInfo.contextSize] is the training context
+  /// and [ModelInfo.fileSizeBytes] the size of the file on disk. When
+  /// [cacheDirectory] is given, results are also cached there keyed by
+  /// path, size and modification time.
+  ///
+  /// Throws [InvalidModelException] if the file is not a readable GGUF model.
+  Future<ModelInfo> probeModel(
+    String modelPath, {
+    String? cacheDirectory,
+  }) async {
+    _checkReady();
+
+    final pathPointer = modelPath.toNativeUtf8();
+    final cachePointer = cacheDirectory?.toNativeUtf8() ?? nullptr;
+
+    try {
+      final infoPointer = _bindings!.dartllm_probe_model(
+        pathPointer.cast(),
+        cachePointer.cast(),
+      );
+
+      if (infoPointer == nullptr) {
+        throw InvalidModelException(
+          modelPath,
+          details: lastError ?? 'Failed to read GGUF header',
+        );
+      }
+
+      final ModelInfo info;
+      try {
+        info = _parseModelInfo(infoPointer);
+      } finally {
+        _bindings!.dartllm_free(infoPointer.cast());
+      }
+
+      // The struct holds at most 4095 bytes of template; fetch the rest.
+      if (info.chatTemplate == null || info.chatTemplate!.length < 4095) {
+        return info;
+      }
+
+      final templatePointer = _bindings!.dartllm_probe_chat_template(
+        pathPointer.cast(),
+        cachePointer.cast(),
+      );
+      if (templatePointer == nullptr) {
+        return info;
+      }
+
+      try {
+        return info.copyWith(
+          chatTemplate: templatePointer.cast<Utf8>().toDartString(),
+        );
+      } finally {
+        _bindings!.dartllm_free(templatePointer.cast());
+      }
+    } finally {
+      calloc.free(pathPointer);
+      if (cachePointer != nullptr) {
+        calloc.free(cachePointer);
+      }
+    }
+  }
+
   /// Parses the native model info structure using generated bindings.
   ModelInfo _parseModelInfo(Pointer<DartLLMModelInfo> infoPointer) {
     final info = infoPointer.ref;
@@ -578,16 +1681,87 @@ class NativeBinding implements PlatformBinding {
     if (_isDisposed) return;
     _isDisposed = true;
 
-    // Unload all models
-    for (final pointer in _modelPointers.values) {
-      _bindings?.dartllm_free_model(pointer);
+    // Sessions first: models kept by the registry would hold them.
+    for (final session in _sessions.values) {
+      _bindings?.dartllm_session_free(session.$2);
+    }
+    _sessions.clear();
+
+    // Unload all models; the registry frees the ones it owns.
+    for (final entry in _modelPointers.entries) {
+      if (!_registryHandles.contains(entry.key) &&
+          !_attachedHandles.contains(entry.key)) {
+        _bindings?.dartllm_free_model(entry.value);
+      }
     }
     _modelPointers.clear();
+    _registryHandles.clear();
+    _attachedHandles.clear();
+    _loraAdapters.clear();
+    _embeddingDimensions.clear();
+    _inputScratch.free();
+    _outputScratch.free();
+
+    if (_registry != null) {
+      _bindings?.dartllm_registry_free(_registry!);
+      _registry = null;
+    }
 
     _bindings = null;
+    _dartllmFree = null;
     _library = null;
     _isInitialized = false;
 
     _logger.info('Native binding disposed');
   }
 }
+
+/// A growable native buffer reused across calls.
+///
+/// Only valid until the next call that uses the same buffer, so it must not
+/// be held across an `await`.
+class _ScratchBuffer {
+  static const int _minCapacity = 256;
+
+  Pointer<Int32> _ints = nullptr;
+  int _capacity = 0;
+  Pointer<Int32> _finishReason = nullptr;
+
+  /// Number of ints the buffer holds without growing.
+  int get capacity => _capacity < _minCapacity ? _minCapacity : _capacity;
+
+  /// A buffer with room for at least [length] ints.
+  Pointer<Int32> ints(int length) {
+    if (length > _capacity || _ints == nullptr) {
+      if (_ints != nullptr) malloc.free(_ints);
+      var capacity = _capacity < _minCapacity ? _minCapacity : _capacity;
+      while (capacity < length) {
+        capacity *= 2;
+      }
+      _ints = malloc<Int32>(capacity);
+      _capacity = capacity;
+    }
+    return _ints;
+  }
+
+  /// Copies [values] into the buffer in one block.
+  Pointer<Int32> copyInts(List<int> values) {
+    final pointer = ints(values.length);
+    pointer.asTypedList(values.length).setAll(0, values);
+    return pointer;
+  }
+
+  /// A single int output slot.
+  Pointer<Int32> get finishReason {
+    if (_finishReason == nullptr) _finishReason = malloc<Int32>();
+    return _finishReason;
+  }
+
+  void free() {
+    if (_ints != nullptr) malloc.free(_ints);
+    if (_finishReason != nullptr) malloc.free(_finishReason);
+    _ints = nullptr;
+    _finishReason = nullptr;
+    _capacity = 0;
+  }
+}
@@ -8,6 +8,7 @@
 /// - [PlatformBinding]: Abstract interface for LLM operations
 /// - [BindingFactory]: Creates platform-appropriate bindings
 /// - [IsolateManager]: Manages bridge isolate communication
+/// - [IsolatePool]: Runs several bridge isolates with per-model affinity
 ///
 /// Platform implementations:
 /// - Native platforms use [NativeBinding] with Dart FFI
@@ -16,4 +17,5 @@ library;
 
 export 'binding_factory.dart';
 export 'isolate_manager.dart';
+export 'isolate_pool.dart';
 export 'platform_binding.dart';
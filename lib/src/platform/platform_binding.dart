@@ -1,6 +1,7 @@
 import 'dart:async';
 import 'dart:typed_data';
 
+import 'package:dartllm/src/models/chat_message.dart';
 import 'package:dartllm/src/models/enums.dart';
 import 'package:dartllm/src/models/model_config.dart';
 import 'package:dartllm/src/models/model_info.dart';
@@ -12,6 +13,13 @@ import 'package:dartllm/src/models/model_info.dart';
 /// varies by platform.
 typedef ModelHandle = int;
 
+/// Handle to a LoRA adapter loaded for a model.
+typedef LoraAdapterHandle = int;
+
+/// Handle to a conversation session that keeps its KV state between
+/// requests.
+typedef SessionHandle = int;
+
 /// Request to load a model from a file path.
 class LoadModelRequest {
   /// Path to the GGUF model file.
@@ -42,6 +50,150 @@ class LoadModelResult {
   });
 }
 
+/// Memory a model would need once loaded, estimated from its GGUF header.
+///
+/// All sizes are in bytes.
+class MemoryEstimate {
+  /// Tensor data as stored in the file.
+  final int weightsBytes;
+
+  /// KV cache for the full context at the requested cache type.
+  final int kvCacheBytes;
+
+  /// Worst-case compute buffer for prompt processing (heuristic).
+  final int computeBytes;
+
+  /// Host output buffer for logits and embeddings.
+  final int outputBytes;
+
+  /// Context size the estimate was computed for, after clamping to the
+  /// model's training context.
+  final int contextSize;
+
+  /// Number of transformer layers.
+  final int layerCount;
+
+  /// Creates a memory estimate.
+  const MemoryEstimate({
+    required this.weightsBytes,
+    required this.kvCacheBytes,
+    required this.computeBytes,
+    required this.outputBytes,
+    required this.contextSize,
+    required this.layerCount,
+  });
+
+  /// Total estimated bytes.
+  int get totalBytes => weightsBytes + kvCacheBytes + computeBytes + outputBytes;
+}
+
+/// Counters of the native model registry, from
+/// `NativeBinding.registryStats`.
+class RegistryStats {
+  /// Memory budget in bytes, or 0 for unlimited.
+  final int budgetBytes;
+
+  /// Estimated bytes held by resident models.
+  final int residentBytes;
+
+  /// Registered model ids.
+  final int registeredModels;
+
+  /// Models with weights and context loaded.
+  final int residentModels;
+
+  /// Evicted models whose memory-mapped weights are kept loaded.
+  final int warmModels;
+
+  /// Handles acquired and not yet unloaded.
+  final int activeHandles;
+
+  /// Acquires served by an already resident model.
+  final int hits;
+
+  /// Acquires served by recreating the context of a warm model.
+  final int warmHits;
+
+  /// Acquires that loaded the model from disk.
+  final int loads;
+
+  /// Models evicted to stay within the budget.
+  final int evictions;
+
+  /// Creates registry statistics.
+  const RegistryStats({
+    required this.budgetBytes,
+    required this.residentBytes,
+    required this.registeredModels,
+    required this.residentModels,
+    required this.warmModels,
+    required this.activeHandles,
+    required this.hits,
+    required this.warmHits,
+    required this.loads,
+    required this.evictions,
+  });
+}
+
+/// Counters of a model's prompt prefix cache, from
+/// `NativeBinding.prefixCacheStats`.
+///
+/// Counts cover every model using the same cache directory.
+class PrefixCacheStats {
+  /// Disk budget in bytes.
+  final int budgetBytes;
+
+  /// Bytes of stored prefix states.
+  final int storedBytes;
+
+  /// Stored prefixes.
+  final int entries;
+
+  /// Prompts that started from a stored prefix.
+  final int hits;
+
+  /// Prompts with a cacheable prefix that had none stored.
+  final int misses;
+
+  /// Prompt tokens restored instead of decoded.
+  final int tokensRestored;
+
+  /// Prefixes written to disk.
+  final int stores;
+
+  /// Prefixes deleted to stay within the budget.
+  final int evictions;
+
+  /// Creates prefix cache statistics.
+  const PrefixCacheStats({
+    required this.budgetBytes,
+    required this.storedBytes,
+    required this.entries,
+    required this.hits,
+    required this.misses,
+    required this.tokensRestored,
+    required this.stores,
+    required this.evictions,
+  });
+}
+
+/// Log-likelihood of one candidate continuation, from
+/// `NativeBinding.score`.
+class CandidateScore {
+  /// Summed log-probability of the candidate's tokens.
+  final double logprob;
+
+  /// Log-probability of each candidate token given everything before it.
+  final List<double> tokenLogprobs;
+
+  /// Creates a candidate score.
+  const CandidateScore({required this.logprob, required this.tokenLogprobs});
+
+  /// Mean log-probability per token, for comparing candidates of
+  /// different lengths.
+  double get meanLogprob => logprob / tokenLogprobs.length;
+}
+
 /// Request to generate text from a prompt.
 class GenerateRequest {
   /// Handle to the model to use.
@@ -83,6 +235,39 @@ class GenerateRequest {
   /// Random seed for reproducibility (null for random).
   final int? seed;
 
+  /// LoRA adapter to apply for this request (null for the base model).
+  final LoraAdapterHandle? loraAdapter;
+
+  /// Strength of [loraAdapter] (1.0 for the trained strength).
+  final double loraScale;
+
+  /// GBNF grammar the output must match (root rule `root`).
+  final String? grammar;
+
+  /// JSON Schema the output must match. Mutually exclusive with [grammar].
+  final String? jsonSchema;
+
+  /// Bias added to the logit of each token ID before sampling.
+  final Map<int, double> logitBias;
+
+  /// Token IDs that are never sampled.
+  final List<int> bannedTokens;
+
+  /// Number of most likely alternatives to report per generated token, or
+  /// null to skip log-probabilities. 0 reports only the sampled token.
+  final int? topLogprobs;
+
+  /// Session to continue, or null for a stateless request.
+  ///
+  /// The session first drops its resident tokens after the first
+  /// [sessionKeepTokens], then decodes [promptTokens] after them, so only
+  /// the new tokens are evaluated. Generated tokens stay in the session.
+  final SessionHandle? session;
+
+  /// Number of the session's resident tokens to keep before appending
+  /// [promptTokens]. Ignored without a [session].
+  final int sessionKeepTokens;
+
   /// Creates a generation request.
   const GenerateRequest({
     required this.modelHandle,
@@ -98,7 +283,48 @@ class GenerateRequest {
     required this.repeatLastN,
     required this.stopTokens,
     this.seed,
+    this.loraAdapter,
+    this.loraScale = 1.0,
+    this.grammar,
+    this.jsonSchema,
+    this.logitBias = const {},
+    this.bannedTokens = const [],
+    this.topLogprobs,
+    this.session,
+    this.sessionKeepTokens = 0,
   });
+
+  /// A copy with the given fields replaced.
+  GenerateRequest copyWith({
+    ModelHandle? modelHandle,
+    List<int>? promptTokens,
+    SessionHandle? session,
+  }) {
+    return GenerateRequest(
+      modelHandle: modelHandle ?? this.modelHandle,
+      promptTokens: promptTokens ?? this.promptTokens,
+      maxTokens: maxTokens,
+      temperature: temperature,
+      topP: topP,
+      topK: topK,
+      minP: minP,
+      repetitionPenalty: repetitionPenalty,
+      frequencyPenalty: frequencyPenalty,
+      presencePenalty: presencePenalty,
+      repeatLastN: repeatLastN,
+      stopTokens: stopTokens,
+      seed: seed,
+      loraAdapter: loraAdapter,
+      loraScale: loraScale,
+      grammar: grammar,
+      jsonSchema: jsonSchema,
+      logitBias: logitBias,
+      bannedTokens: bannedTokens,
+      topLogprobs: topLogprobs,
+      session: session ?? this.session,
+      sessionKeepTokens: sessionKeepTokens,
+    );
+  }
 }
 
 /// Result of a text generation operation.
@@ -118,6 +344,10 @@ class GenerateResult {
   /// Time spent generating in milliseconds.
   final int generationTimeMs;
 
+  /// Log-probabilities for each of [tokens], when
+  /// [GenerateRequest.topLogprobs] was set.
+  final List<TokenLogprobs>? logprobs;
+
   /// Creates a generation result.
   const GenerateResult({
     required this.tokens,
@@ -125,9 +355,34 @@ class GenerateResult {
     required this.completionTokenCount,
     required this.finishReason,
     required this.generationTimeMs,
+    this.logprobs,
   });
 }
 
+/// A token and its natural-log probability.
+class TokenLogprob {
+  /// Token ID.
+  final int token;
+
+  /// Log-probability under the model's unmodified distribution.
+  final double logprob;
+
+  /// Creates a token log-probability.
+  const TokenLogprob({required this.token, required this.logprob});
+}
+
+/// Log-probabilities for one generated token.
+class TokenLogprobs {
+  /// The sampled token.
+  final TokenLogprob sampled;
+
+  /// The most likely tokens at this step, most likely first.
+  final List<TokenLogprob> topAlternatives;
+
+  /// Creates the log-probabilities for one step.
+  const TokenLogprobs({required this.sampled, required this.topAlternatives});
+}
+
 /// A single token generated during streaming.
 class GenerateStreamChunk {
   /// The generated token ID.
@@ -214,6 +469,44 @@ class DetokenizeRequest {
   });
 }
 
+/// Request to render chat messages with a model's own chat template.
+class ChatTemplateRequest {
+  /// Handle to the model whose template is used.
+  final ModelHandle modelHandle;
+
+  /// The conversation so far.
+  final List<ChatMessage> messages;
+
+  /// Whether to append the assistant turn prefix.
+  final bool addGenerationPrompt;
+
+  /// Number of leading [messages] already rendered by an earlier request.
+  /// When non-zero, only the text after them is returned if possible.
+  final int previousMessageCount;
+
+  /// Creates a chat template request.
+  const ChatTemplateRequest({
+    required this.modelHandle,
+    required this.messages,
+    this.addGenerationPrompt = true,
+    this.previousMessageCount = 0,
+  });
+}
+
+/// Result of rendering a chat template.
+class ChatTemplateResult {
+  /// The rendered text; only the new suffix when [incremental] is true.
+  final String text;
+
+  /// Whether [text] continues the rendering of the first
+  /// [ChatTemplateRequest.previousMessageCount] messages rather than
+  /// replacing it.
+  final bool incremental;
+
+  /// Creates a chat template result.
+  const ChatTemplateResult({required this.text, required this.incremental});
+}
+
 /// Abstract interface for platform-specific LLM operations.
 ///
 /// This interface defines the contract between the Dart API layer
@@ -264,6 +557,22 @@ abstract interface class PlatformBinding {
   /// Gets information about a loaded model.
   Future<ModelInfo> getModelInfo(ModelHandle handle);
 
+  /// Renders chat messages with the chat template embedded in the model.
+  ///
+  /// Returns null if the model has no template or the platform cannot
+  /// render it; callers then fall back to a built-in template.
+  Future<ChatTemplateResult?> applyChatTemplate(ChatTemplateRequest request);
+
+  /// Creates a session on the model [handle] whose KV state persists
+  /// between requests that name it in [GenerateRequest.session].
+  ///
+  /// Returns null if the platform does not support sessions or the model
+  /// has no session slot left; callers then send stateless requests.
+  Future<SessionHandle?> createSession(ModelHandle handle);
+
+  /// Frees a session created by [createSession].
+  Future<void> freeSession(SessionHandle session);
+
   /// Checks if the platform supports GPU acceleration.
   bool get supportsGpu;
 
@@ -275,3 +584,21 @@ abstract interface class PlatformBinding {
   /// After calling dispose, the binding becomes unusable.
   void dispose();
 }
+
+/// A [PlatformBinding] whose loaded models can be used from other isolates
+/// of the same process.
+///
+/// `IsolatePool` uses this to run tokenization on an express isolate while
+/// the model's own isolate is busy generating.
+abstract interface class SharedModelBinding implements PlatformBinding {
+  /// The native address of the loaded model [handle].
+  int modelAddress(ModelHandle handle);
+
+  /// Adopts a model loaded by another isolate at [address].
+  ///
+  /// The returned handle supports the read-only requests (tokenize,
+  /// detokenize and model info). [PlatformBinding.unloadModel] releases it
+  /// without freeing the model, which stays owned by the isolate that
+  /// loaded it.
+  ModelHandle attachModel(int address);
+}
@@ -1,5 +1,6 @@
 import 'dart:async';
 import 'dart:js_interop';
+import 'dart:js_interop_unsafe';
 import 'dart:typed_data';
 
 import 'package:dartllm/src/core/exceptions/exceptions.dart';
@@ -19,9 +20,19 @@ extension type DartLLMWasmModule._(JSObject _) implements JSObject {
   /// Initializes the WASM module.
   external JSPromise<JSBoolean> init();
 
-  /// Loads a model from a URL or ArrayBuffer.
+  /// Fetches a model into the module's file system, one response chunk
+  /// at a time, calling [onProgress] with `(bytesDone, bytesTotal)`.
+  external JSPromise<ModelFileJS> dartllmFetchModel(
+    JSString url,
+    JSString name,
+    JSFunction? onProgress,
+  );
+
+  /// Loads a model from a file made by [dartllmFetchModel].
+  ///
+  /// Resolves to the model handle, or 0 on failure.
   external JSPromise<JSNumber> loadModel(
-    JSAny modelData,
+    JSString path,
     JSNumber contextSize,
     JSNumber gpuLayers,
     JSNumber batchSize,
@@ -50,6 +61,18 @@ extension type DartLLMWasmModule._(JSObject _) implements JSObject {
     GenerateConfigJS config,
   );
 
+  /// Generates text from a prompt, calling [onToken] with
+  /// `(token, text, isFinal, finishReason)` as each token is sampled.
+  ///
+  /// [onToken] returns false to stop early. Optional: modules built
+  /// without polled streaming do not define it.
+  external JSPromise<JSNumber> generateStream(
+    JSNumber handle,
+    JSInt32Array promptTokens,
+    GenerateConfigJS config,
+    JSFunction onToken,
+  );
+
   /// Generates embeddings from tokens.
   external JSPromise<JSFloat32Array> embed(
     JSNumber handle,
@@ -61,6 +84,16 @@ extension type DartLLMWasmModule._(JSObject _) implements JSObject {
   external JSBoolean hasWebGPU();
 }
 
+/// A model file in the module's heap, from `dartllmFetchModel`.
+@JS()
+@anonymous
+extension type ModelFileJS._(JSObject _) implements JSObject {
+  external String get path;
+
+  /// Releases the file; call once its model is unloaded.
+  external void free();
+}
+
 /// JavaScript representation of model info.
 @JS()
 @anonymous
@@ -131,9 +164,11 @@ external DartLLMWasmModule? get _dartLLMWasm;
 /// This binding communicates with the llama.cpp WASM module running
 /// in the browser. It handles type conversion between Dart and JavaScript.
 ///
-/// The WASM module must be loaded before creating this binding:
+/// The WASM module must be instantiated and published before creating
+/// this binding:
 /// ```html
-/// <script src="dartllm_wasm.js"></script>
+/// <script src="dartllm.js"></script>
+/// <script>DartLLMWasm().then((m) => { window.DartLLMWasm = m; });</script>
 /// ```
 ///
 /// Performance expectations for web:
@@ -157,6 +192,9 @@ class WasmBinding implements PlatformBinding {
   /// Set of active model handles.
   final Set<ModelHandle> _activeHandles = {};
 
+  /// Heap-backed model files, freed after their model is unloaded.
+  final Map<ModelHandle, ModelFileJS> _modelFiles = {};
+
   /// Creates a new WASM binding.
   ///
   /// Call [initialize] to load the WASM module before using
@@ -182,7 +220,7 @@ class WasmBinding implements PlatformBinding {
       if (_module == null) {
         _logger.warning(
           'WASM module not found. '
-          'Ensure dartllm_wasm.js is loaded before initializing.',
+          'Publish the instantiated module as window.DartLLMWasm first.',
         );
         return false;
       }
@@ -234,10 +272,24 @@ class WasmBinding implements PlatformBinding {
     _logger.info('Loading model from: ${request.modelPath}');
 
     try {
-      // For web, modelPath is typically a URL to fetch
+      // For web, modelPath is a URL; the module streams it into its heap.
+      final ModelFileJS file;
+      try {
+        file = await _module!
+            .dartllmFetchModel(
+              request.modelPath.toJS,
+              Uri.parse(request.modelPath).pathSegments.last.toJS,
+              null,
+            )
+            .toDart;
+      } on Object catch (error) {
+        _logger.error('Failed to fetch model', error);
+        throw ModelNotFoundException(request.modelPath);
+      }
+
       final handleJs = await _module!
           .loadModel(
-            request.modelPath.toJS,
+            file.path.toJS,
             (request.config.contextSize ?? 0).toJS,
             request.config.gpuLayers.toJS,
             request.config.batchSize.toJS,
@@ -247,10 +299,12 @@ class WasmBinding implements PlatformBinding {
       final handle = handleJs.toDartInt;
 
       if (handle <= 0) {
+        file.free();
         throw ModelNotFoundException(request.modelPath);
       }
 
       _activeHandles.add(handle);
+      _modelFiles[handle] = file;
 
       final modelInfo = await getModelInfo(handle);
 
@@ -274,6 +328,7 @@ class WasmBinding implements PlatformBinding {
 
     await _module!.unloadModel(handle.toJS).toDart;
     _activeHandles.remove(handle);
+    _modelFiles.remove(handle)?.free();
 
     _logger.info('Model unloaded: handle $handle');
   }
@@ -290,22 +345,12 @@ class WasmBinding implements PlatformBinding {
 
     final promptTokensJs = Int32List.fromList(request.promptTokens).toJS;
 
-    final configJs = GenerateConfigJS(
-      maxTokens: request.maxTokens,
-      temperature: request.temperature,
-      topP: request.topP,
-      topK: request.topK,
-      minP: request.minP,
-      repetitionPenalty: request.repetitionPenalty,
-      frequencyPenalty: request.frequencyPenalty,
-      presencePenalty: request.presencePenalty,
-      repeatLastN: request.repeatLastN,
-      stopTokens: request.stopTokens.map((t) => t.toJS).toList().toJS,
-      seed: request.seed,
-    );
-
     final resultJs = await _module!
-        .generate(request.modelHandle.toJS, promptTokensJs, configJs)
+        .generate(
+          request.modelHandle.toJS,
+          promptTokensJs,
+          _generateConfig(request),
+        )
         .toDart;
 
     final endTime = DateTime.now();
@@ -323,6 +368,23 @@ class WasmBinding implements PlatformBinding {
     );
   }
 
+  /// Converts a request's sampling parameters for the WASM module.
+  GenerateConfigJS _generateConfig(GenerateRequest request) {
+    return GenerateConfigJS(
+      maxTokens: request.maxTokens,
+      temperature: request.temperature,
+      topP: request.topP,
+      topK: request.topK,
+      minP: request.minP,
+      repetitionPenalty: request.repetitionPenalty,
+      frequencyPenalty: request.frequencyPenalty,
+      presencePenalty: request.presencePenalty,
+      repeatLastN: request.repeatLastN,
+      stopTokens: request.stopTokens.map((t) => t.toJS).toList().toJS,
+      seed: request.seed,
+    );
+  }
+
   /// Converts a JavaScript finish reason code to a Dart enum.
   FinishReason _parseFinishReason(int code) {
     return switch (code) {
@@ -336,6 +398,12 @@ class WasmBinding implements PlatformBinding {
   Stream<GenerateStreamChunk> generateStream(GenerateRequest request) async* {
     _checkReady();
 
+    if (_module!.has('generateStream')) {
+      yield* _pollStream(request);
+      return;
+    }
+
+    // Older modules only return whole completions; replay them per token.
     final result = await generate(request);
 
     for (var i = 0; i < result.tokens.length; i++) {
@@ -354,6 +422,60 @@ class WasmBinding implements PlatformBinding {
     }
   }
 
+  /// Streams tokens as the module samples them; it yields to the event
+  /// loop between tokens, so the first one arrives right after prefill.
+  Stream<GenerateStreamChunk> _pollStream(GenerateRequest request) async* {
+    if (!_activeHandles.contains(request.modelHandle)) {
+      throw StateError('Invalid model handle: ${request.modelHandle}');
+    }
+
+    final controller = StreamController<GenerateStreamChunk>();
+    var cancelled = false;
+
+    JSBoolean onToken(
+      JSNumber token,
+      JSString text,
+      JSBoolean isFinal,
+      JSNumber finishReason,
+    ) {
+      controller.add(
+        GenerateStreamChunk(
+          token: token.toDartInt,
+          text: text.toDart,
+          finishReason: isFinal.toDart
+              ? _parseFinishReason(finishReason.toDartInt)
+              : null,
+        ),
+      );
+      return (!cancelled).toJS;
+    }
+
+    final done = _module!
+        .generateStream(
+          request.modelHandle.toJS,
+          Int32List.fromList(request.promptTokens).toJS,
+          _generateConfig(request),
+          onToken.toJS,
+        )
+        .toDart
+        .then(
+          (_) => controller.close(),
+          onError: (Object error) {
+            controller.addError(
+              LLMPlatformException('Streaming generation failed: $error'),
+            );
+            controller.close();
+          },
+        );
+
+    try {
+      yield* controller.stream;
+    } finally {
+      cancelled = true;
+      await done;
+    }
+  }
+
   @override
   Future<EmbedResult> embed(EmbedRequest request) async {
     _checkReady();
@@ -406,6 +528,35 @@ class WasmBinding implements PlatformBinding {
     return textJs.toDart;
   }
 
+  @override
+  Future<ChatTemplateResult?> applyChatTemplate(
+    ChatTemplateRequest request,
+  ) async {
+    _checkReady();
+
+    if (!_activeHandles.contains(request.modelHandle)) {
+      throw StateError('Invalid model handle: ${request.modelHandle}');
+    }
+
+    // The WASM module does not export template rendering.
+    return null;
+  }
+
+  @override
+  Future<SessionHandle?> createSession(ModelHandle handle) async {
+    _checkReady();
+
+    if (!_activeHandles.contains(handle)) {
+      throw StateError('Invalid model handle: $handle');
+    }
+
+    // The WASM module does not export sessions; requests stay stateless.
+    return null;
+  }
+
+  @override
+  Future<void> freeSession(SessionHandle session) async {}
+
   @override
   Future<ModelInfo> getModelInfo(ModelHandle handle) async {
     _checkReady();
@@ -440,9 +591,14 @@ class WasmBinding implements PlatformBinding {
 
     // Unload all models
     for (final handle in _activeHandles.toList()) {
-      _module?.unloadModel(handle.toJS);
+      final unloaded = _module?.unloadModel(handle.toJS).toDart;
+      final file = _modelFiles[handle];
+      if (unloaded != null && file != null) {
+        unawaited(unloaded.then((_) => file.free()));
+      }
     }
     _activeHandles.clear();
+    _modelFiles.clear();
 
     _module = null;
     _isInitialized = false;
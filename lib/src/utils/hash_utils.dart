@@ -0,0 +1,80 @@
+import 'dart:convert';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:crypto/crypto.dart';
+
+/// SHA-256 computed incrementally over data fed in chunks.
+///
+/// Memory use is constant no matter how much data is hashed, so a model
+/// can be hashed while it downloads instead of being read back whole.
+class Sha256Hasher {
+  final _DigestSink _digest = _DigestSink();
+  late final ByteConversionSink _input = sha256.startChunkedConversion(
+    _digest,
+  );
+
+  /// Feeds [chunk] into the hash.
+  void add(List<int> chunk) => _input.add(chunk);
+
+  /// Feeds [length] bytes of [file] from [offset] (the rest of it if
+  /// null), read in fixed-size blocks.
+  Future<void> addFile(File file, {int offset = 0, int? length}) async {
+    final raf = await file.open();
+    try {
+      await raf.setPosition(offset);
+      final buffer = Uint8List(HashUtils.blockSize);
+      var remaining = length ?? await raf.length() - offset;
+      while (remaining > 0) {
+        final wanted = remaining < buffer.length ? remaining : buffer.length;
+        final read = await raf.readInto(buffer, 0, wanted);
+        if (read == 0) {
+          throw FileSystemException('Unexpected end of file', file.path);
+        }
+        // The hash copies what it has not consumed, so the block can be
+        // reused.
+        _input.add(Uint8List.sublistView(buffer, 0, read));
+        remaining -= read;
+      }
+    } finally {
+      await raf.close();
+    }
+  }
+
+  /// Finishes the hash and returns it as lowercase hex.
+  ///
+  /// The hasher cannot be used afterwards.
+  String close() {
+    _input.close();
+    return _digest.value.toString();
+  }
+}
+
+/// Hashing helpers for model files.
+abstract final class HashUtils {
+  /// Bytes read per block when hashing files.
+  static const int blockSize = 1024 * 1024;
+
+  /// Computes the SHA-256 of the file at [path] as lowercase hex.
+  ///
+  /// The file is read in [blockSize] blocks, so multi-gigabyte models are
+  /// hashed without being loaded into memory.
+  static Future<String> sha256File(String path) async {
+    final hasher = Sha256Hasher();
+    await hasher.addFile(File(path));
+    return hasher.close();
+  }
+}
+
+/// Receives the single digest a chunked conversion produces.
+class _DigestSink implements Sink<Digest> {
+  Digest? _value;
+
+  Digest get value => _value!;
+
+  @override
+  void add(Digest data) => _value = data;
+
+  @override
+  void close() {}
+}
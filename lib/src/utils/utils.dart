@@ -1,9 +1,10 @@
 /// Utility classes for DartLLM internal use.
 ///
 /// This library exports utility functions for logging, platform detection,
-/// memory calculations, and path handling.
+/// memory calculations, path handling, and file hashing.
 library;
 
+export 'hash_utils.dart';
 export 'logger.dart';
 export 'memory_utils.dart';
 export 'path_utils.dart';
@@ -0,0 +1,319 @@
+/**
+ * @file bench_dartllm.cpp
+ * @brief Micro-benchmarks for tokenization, embedding and FFI buffer handling
+ *
+ * Model-backed benchmarks read their model paths from the environment and
+ * are skipped when unset:
+ *   DARTLLM_BENCH_MODEL        GGUF used for tokenize/detokenize
+ *   DARTLLM_BENCH_EMBED_MODEL  GGUF used for embed (defaults to DARTLLM_BENCH_MODEL)
+ *
+ * The L2 normalisation benchmark needs no model.
+ */
+
+#include "../src/dartllm.h"
+#include "../src/dartllm_internal.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum Corpus { ASCII = 0, CJK = 1, CODE = 2 };
+
+const char* corpus_name(int64_t corpus) {
+    switch (corpus) {
+        case ASCII: return "ascii";
+        case CJK: return "cjk";
+        default: return "code";
+    }
+}
+
+const char* corpus_seed(int64_t corpus) {
+    switch (corpus) {
+        case ASCII:
+            return "Large language models map text to tokens before any inference "
+                   "happens, so tokenizer throughput bounds how fast we can index. ";
+        case CJK:
+            return "大規模言語モデルは推論の前にテキストをトークンに変換します。"
+                   "语言模型在推理之前会把文本切分成词元。토큰화 속도가 중요합니다。";
+        default:
+            return "for (int32_t i = 0; i < n_embd; i++) {\n"
+                   "    norm += result[i] * result[i];\n"
+                   "}\nreturn std::sqrt(norm); // {\"key\": [1, 2, 3]}\n";
+    }
+}
+
+/** Repeat the corpus seed until the text is at least `bytes` long. */
+std::string make_corpus(int64_t corpus, int64_t bytes) {
+    const char* seed = corpus_seed(corpus);
+    std::string text;
+    text.reserve(bytes + std::strlen(seed));
+    while (static_cast<int64_t>(text.size()) < bytes) {
+        text += seed;
+    }
+    return text;
+}
+
+void* load_model_from_env(const char* var, const char* fallback_var) {
+    const char* path = std::getenv(var);
+    if ((!path || !*path) && fallback_var) {
+        path = std::getenv(fallback_var);
+    }
+    if (!path || !*path) {
+        return nullptr;
+    }
+
+    dartllm_init();
+    return dartllm_load_model(path, 2048, 0, 0, 512, 1);
+}
+
+void* text_model() {
+    static void* model = load_model_from_env("DARTLLM_BENCH_MODEL", nullptr);
+    return model;
+}
+
+void* embed_model() {
+    static void* model = load_model_from_env("DARTLLM_BENCH_EMBED_MODEL", "DARTLLM_BENCH_MODEL");
+    return model;
+}
+
+/* ============================================================================
+ * Tokenization
+ * ============================================================================ */
+
+void BM_Tokenize(benchmark::State& state) {
+    void* model = text_model();
+    if (!model) {
+        state.SkipWithError("DARTLLM_BENCH_MODEL not set or failed to load");
+        return;
+    }
+
+    std::string text = make_corpus(state.range(0), state.range(1));
+    int64_t tokens_total = 0;
+
+    for (auto _ : state) {
+        int32_t length = 0;
+        int32_t* tokens = dartllm_tokenize(model, text.c_str(), 1, &length);
+        benchmark::DoNotOptimize(tokens);
+        tokens_total += length;
+        dartllm_free(tokens);
+    }
+
+    state.SetLabel(corpus_name(state.range(0)));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+    state.counters["tokens/s"] = benchmark::Counter(
+        static_cast<double>(tokens_total), benchmark::Counter::kIsRate);
+}
+
+void BM_Detokenize(benchmark::State& state) {
+    void* model = text_model();
+    if (!model) {
+        state.SkipWithError("DARTLLM_BENCH_MODEL not set or failed to load");
+        return;
+    }
+
+    std::string text = make_corpus(state.range(0), state.range(1));
+    int32_t length = 0;
+    int32_t* tokens = dartllm_tokenize(model, text.c_str(), 0, &length);
+    if (!tokens) {
+        state.SkipWithError("Tokenization failed");
+        return;
+    }
+    std::vector<int32_t> token_vec(tokens, tokens + length);
+    dartllm_free(tokens);
+
+    for (auto _ : state) {
+        char* out = dartllm_detokenize(model, token_vec.data(), length);
+        benchmark::DoNotOptimize(out);
+        dartllm_free(out);
+    }
+
+    state.SetLabel(corpus_name(state.range(0)));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+    state.SetItemsProcessed(state.iterations() * length);
+}
+
+void CorpusArgs(benchmark::internal::Benchmark* b) {
+    for (int64_t corpus : {ASCII, CJK, CODE}) {
+        for (int64_t bytes : {1 << 10, 16 << 10, 128 << 10}) {
+            b->Args({corpus, bytes});
+        }
+    }
+    b->ArgNames({"corpus", "bytes"});
+}
+
+BENCHMARK(BM_Tokenize)->Apply(CorpusArgs)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Detokenize)->Apply(CorpusArgs)->Unit(benchmark::kMicrosecond);
+
+/* ============================================================================
+ * Embeddings
+ * ============================================================================ */
+
+void BM_Embed(benchmark::State& state) {
+    void* model = embed_model();
+    if (!model) {
+        state.SkipWithError("DARTLLM_BENCH_EMBED_MODEL not set or failed to load");
+        return;
+    }
+
+    int32_t seq_len = static_cast<int32_t>(state.range(0));
+    int32_t batch = static_cast<int32_t>(state.range(1));
+
+    std::string text = make_corpus(ASCII, seq_len * 8);
+    int32_t length = 0;
+    int32_t* tokens = dartllm_tokenize(model, text.c_str(), 1, &length);
+    if (!tokens || length < seq_len) {
+        dartllm_free(tokens);
+        state.SkipWithError("Could not build input sequence");
+        return;
+    }
+    std::vector<int32_t> sequence(tokens, tokens + seq_len);
+    dartllm_free(tokens);
+
+    for (auto _ : state) {
+        for (int32_t b = 0; b < batch; b++) {
+            int32_t dim = 0;
+            float* embedding = dartllm_embed(model, sequence.data(), seq_len, 1, &dim);
+            if (!embedding) {
+                state.SkipWithError("dartllm_embed failed");
+                return;
+            }
+            benchmark::DoNotOptimize(embedding);
+            dartllm_free(embedding);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * batch * seq_len);
+    state.counters["seqs/s"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * batch), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_Embed)
+    ->ArgsProduct({{16, 64, 256, 512}, {1, 8, 32}})
+    ->ArgNames({"seq_len", "batch"})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_L2Normalize(benchmark::State& state) {
+    int32_t dim = static_cast<int32_t>(state.range(0));
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+
+    // Each iteration normalises a whole batch in place. Renormalising costs
+    // the same as the first pass, so the batch is never refilled and no
+    // timer pause lands inside the loop.
+    constexpr int32_t kBatch = 256;
+    std::vector<float> work(static_cast<size_t>(dim) * kBatch);
+    for (float& v : work) v = dist(rng);
+
+    for (auto _ : state) {
+        for (int32_t b = 0; b < kBatch; b++) {
+            dartllm::l2_normalize(work.data() + static_cast<size_t>(b) * dim, dim);
+        }
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * kBatch * dim);
+    state.SetBytesProcessed(
+        state.iterations() * kBatch * dim * static_cast<int64_t>(sizeof(float)));
+}
+
+BENCHMARK(BM_L2Normalize)->Arg(384)->Arg(768)->Arg(1024)->Arg(4096);
+
+/* ============================================================================
+ * FFI buffer handling
+ *
+ * The allocating entry points against their caller-buffer *_into
+ * counterparts on the same input, so the difference is the cost of the
+ * native allocation and dartllm_free() on each call.
+ * ============================================================================ */
+
+void BM_FfiTokenize(benchmark::State& state) {
+    void* model = text_model();
+    if (!model) {
+        state.SkipWithError("DARTLLM_BENCH_MODEL not set or failed to load");
+        return;
+    }
+
+    bool into = state.range(0) != 0;
+    std::string text = make_corpus(ASCII, state.range(1));
+    std::vector<int32_t> buffer(dartllm_tokenize_into(model, text.c_str(), 1, nullptr, 0));
+    int64_t tokens_total = 0;
+
+    for (auto _ : state) {
+        int32_t length = 0;
+        if (into) {
+            length = dartllm_tokenize_into(
+                model, text.c_str(), 1, buffer.data(), static_cast<int32_t>(buffer.size()));
+            benchmark::DoNotOptimize(buffer.data());
+        } else {
+            int32_t* tokens = dartllm_tokenize(model, text.c_str(), 1, &length);
+            benchmark::DoNotOptimize(tokens);
+            dartllm_free(tokens);
+        }
+        tokens_total += length;
+    }
+
+    state.SetLabel(into ? "into" : "alloc");
+    state.SetItemsProcessed(tokens_total);
+}
+
+void BM_FfiEmbed(benchmark::State& state) {
+    void* model = embed_model();
+    if (!model) {
+        state.SkipWithError("DARTLLM_BENCH_EMBED_MODEL not set or failed to load");
+        return;
+    }
+
+    bool into = state.range(0) != 0;
+    int32_t seq_len = static_cast<int32_t>(state.range(1));
+    std::string text = make_corpus(ASCII, seq_len * 8);
+    int32_t length = 0;
+    int32_t* tokens = dartllm_tokenize(model, text.c_str(), 1, &length);
+    if (!tokens || length < seq_len) {
+        dartllm_free(tokens);
+        state.SkipWithError("Could not build input sequence");
+        return;
+    }
+    std::vector<int32_t> sequence(tokens, tokens + seq_len);
+    dartllm_free(tokens);
+
+    int32_t dim = dartllm_embed_into(model, sequence.data(), seq_len, 1, nullptr, 0);
+    if (dim <= 0) {
+        state.SkipWithError("dartllm_embed_into failed");
+        return;
+    }
+    std::vector<float> buffer(dim);
+
+    for (auto _ : state) {
+        if (into) {
+            dartllm_embed_into(model, sequence.data(), seq_len, 1, buffer.data(), dim);
+            benchmark::DoNotOptimize(buffer.data());
+        } else {
+            int32_t out_dim = 0;
+            float* embedding = dartllm_embed(model, sequence.data(), seq_len, 1, &out_dim);
+            benchmark::DoNotOptimize(embedding);
+            dartllm_free(embedding);
+        }
+    }
+
+    state.SetLabel(into ? "into" : "alloc");
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_FfiTokenize)
+    ->ArgsProduct({{0, 1}, {1 << 10, 16 << 10, 128 << 10}})
+    ->ArgNames({"into", "bytes"})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FfiEmbed)
+    ->ArgsProduct({{0, 1}, {16, 256}})
+    ->ArgNames({"into", "seq_len"})
+    ->Unit(benchmark::kMillisecond);
+
+} // anonymous namespace
+
+BENCHMARK_MAIN();
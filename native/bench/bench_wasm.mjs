@@ -0,0 +1,244 @@
+#!/usr/bin/env node
+/**
+ * @file bench_wasm.mjs
+ * @brief Prefill and decode throughput of the WebAssembly builds under Node
+ *
+ * Runs the same model through each variant that scripts/build_wasm.sh
+ * ships (scalar, SIMD128 and the SIMD128 pthread build) and reports tokens
+ * per second plus the speed-up over the scalar build:
+ *
+ *   node bench/bench_wasm.mjs model.gguf [--dir ../web/lib] [--threads 8]
+ *       [--prompt 128] [--generate 32] [--runs 3] [--variants scalar,simd,threads]
+ *
+ * The model is a local path, streamed into the heap through
+ * Module.dartllmCreateModelFile(), or an http(s) URL fetched with
+ * Module.dartllmFetchModel(). Node 20+ provides fetch, SharedArrayBuffer and
+ * worker threads, so no flags are needed. Threaded runs leave their worker
+ * pool alive, so the script exits explicitly when done.
+ */
+
+import fs from 'node:fs';
+import os from 'node:os';
+import path from 'node:path';
+import { createRequire } from 'node:module';
+import { fileURLToPath } from 'node:url';
+
+const require = createRequire(import.meta.url);
+const here = path.dirname(fileURLToPath(import.meta.url));
+
+const VARIANTS = {
+    scalar: { glue: 'dartllm.js', wasm: 'dartllm.wasm' },
+    simd: { glue: 'dartllm.js', wasm: 'dartllm-simd.wasm' },
+    threads: { glue: 'dartllm-mt.js', wasm: 'dartllm-mt.wasm' },
+};
+
+function parseArgs(argv) {
+    const options = {
+        model: null,
+        dir: path.resolve(here, '../../web/lib'),
+        threads: os.availableParallelism ? os.availableParallelism() : os.cpus().length,
+        prompt: 128,
+        generate: 32,
+        runs: 3,
+        variants: Object.keys(VARIANTS),
+    };
+    for (let i = 0; i < argv.length; i++) {
+        const arg = argv[i];
+        const value = () => {
+            if (i + 1 >= argv.length) throw new Error('Missing value for ' + arg);
+            return argv[++i];
+        };
+        switch (arg) {
+            case '--dir': options.dir = path.resolve(value()); break;
+            case '--threads': options.threads = Number(value()); break;
+            case '--prompt': options.prompt = Number(value()); break;
+            case '--generate': options.generate = Number(value()); break;
+            case '--runs': options.runs = Number(value()); break;
+            case '--variants': options.variants = value().split(','); break;
+            default:
+                if (arg.startsWith('--') || options.model) throw new Error('Unknown argument: ' + arg);
+                options.model = arg;
+        }
+    }
+    if (!options.model) {
+        throw new Error('Usage: node bench/bench_wasm.mjs <model.gguf|url> [options]');
+    }
+    for (const name of options.variants) {
+        if (!VARIANTS[name]) throw new Error('Unknown variant: ' + name);
+    }
+    return options;
+}
+
+/** Copy a local file into a heap-backed model file chunk by chunk. */
+async function createFromPath(Module, file) {
+    const size = fs.statSync(file).size;
+    const model = Module.dartllmCreateModelFile(path.basename(file), size);
+    try {
+        let offset = 0;
+        for await (const chunk of fs.createReadStream(file, { highWaterMark: 16 << 20 })) {
+            model.write(chunk, offset);
+            offset += chunk.length;
+        }
+    } catch (e) {
+        model.free();
+        throw e;
+    }
+    return model;
+}
+
+function lastError(Module) {
+    return Module.UTF8ToString(Module._dartllm_get_last_error());
+}
+
+function withString(Module, text, fn) {
+    const length = Module.lengthBytesUTF8(text) + 1;
+    const ptr = Module._malloc(length);
+    Module.stringToUTF8(text, ptr, length);
+    try {
+        return fn(ptr);
+    } finally {
+        Module._free(ptr);
+    }
+}
+
+/** Exactly `count` prompt tokens from a repeated paragraph. */
+function promptTokens(Module, model, count) {
+    const paragraph = 'WebAssembly runs the same llama.cpp kernels as native builds, ' +
+        'but every matrix multiply goes through the browser sandbox. ';
+    const text = paragraph.repeat(Math.ceil(count / 16) + 1);
+    const lengthPtr = Module._malloc(4);
+    try {
+        const tokensPtr = withString(Module, text, (ptr) =>
+            Module._dartllm_tokenize(model, ptr, 1, lengthPtr));
+        if (!tokensPtr) throw new Error('Tokenize failed: ' + lastError(Module));
+        const length = Module.HEAP32[lengthPtr >> 2];
+        const tokens = Module.HEAP32.slice(tokensPtr >> 2, (tokensPtr >> 2) + length);
+        Module._dartllm_free(tokensPtr);
+        if (tokens.length < count) throw new Error('Prompt is shorter than ' + count + ' tokens');
+        return tokens.subarray(0, count);
+    } finally {
+        Module._free(lengthPtr);
+    }
+}
+
+/** One prefill and one greedy decode through a fresh session. */
+function measure(Module, model, tokens, generate) {
+    const session = Module._dartllm_session_create(model);
+    if (!session) throw new Error('Session failed: ' + lastError(Module));
+    const prompt = Module._malloc(tokens.length * 4);
+    // DartLLMStreamToken: token, is_final, finish_reason, text[256].
+    const report = Module._malloc(268);
+    let stream = 0;
+    try {
+        Module.HEAP32.set(tokens, prompt >> 2);
+        let start = performance.now();
+        if (Module._dartllm_session_append(session, prompt, tokens.length) < 0) {
+            throw new Error('Prefill failed: ' + lastError(Module));
+        }
+        const prefillMs = performance.now() - start;
+
+        stream = Module._dartllm_stream_begin(session, generate, 0.0, 1.0, 1, 0.0, 42, 0);
+        if (!stream) throw new Error('Stream failed: ' + lastError(Module));
+        let generated = 0;
+        start = performance.now();
+        for (;;) {
+            if (Module._dartllm_stream_next(stream, report) !== 0) {
+                throw new Error('Decode failed: ' + lastError(Module));
+            }
+            if (Module.HEAP8[report + 4] !== 0) break;
+            generated++;
+        }
+        const decodeMs = performance.now() - start;
+
+        return {
+            prefill: tokens.length / (prefillMs / 1000),
+            decode: generated > 0 ? generated / (decodeMs / 1000) : 0,
+        };
+    } finally {
+        if (stream) Module._dartllm_stream_free(stream);
+        Module._free(report);
+        Module._free(prompt);
+        Module._dartllm_session_free(session);
+    }
+}
+
+function median(values) {
+    const sorted = [...values].sort((a, b) => a - b);
+    return sorted[Math.floor(sorted.length / 2)];
+}
+
+async function runVariant(name, options) {
+    const variant = VARIANTS[name];
+    const glue = path.join(options.dir, variant.glue);
+    const wasm = path.join(options.dir, variant.wasm);
+    if (!fs.existsSync(glue) || !fs.existsSync(wasm)) {
+        console.log(`${name}: skipped (${variant.wasm} not found in ${options.dir})`);
+        return null;
+    }
+
+    const factory = require(glue);
+    const Module = await factory({
+        wasmBinaryFile: wasm,
+        // The calling thread computes too, so the pool holds one fewer.
+        dartllmThreadPoolSize: Math.max(1, options.threads - 1),
+        onLog: () => {},
+        onError: () => {},
+    });
+    Module._dartllm_init();
+
+    const remote = /^https?:\/\//.test(options.model);
+    const file = remote
+        ? await Module.dartllmFetchModel(options.model, path.basename(new URL(options.model).pathname))
+        : await createFromPath(Module, options.model);
+
+    let model = 0;
+    try {
+        // threads = 0 lets dartllm_load_model() plan within the worker pool.
+        model = withString(Module, file.path, (ptr) =>
+            Module._dartllm_load_model(ptr, options.prompt + options.generate + 16, 0, 0, 512, 1));
+        if (!model) throw new Error('Load failed: ' + lastError(Module));
+
+        const tokens = promptTokens(Module, model, options.prompt);
+        measure(Module, model, tokens.subarray(0, Math.min(8, tokens.length)), 2);  // warm-up
+        const runs = [];
+        for (let i = 0; i < options.runs; i++) {
+            runs.push(measure(Module, model, tokens, options.generate));
+        }
+        return {
+            prefill: median(runs.map((r) => r.prefill)),
+            decode: median(runs.map((r) => r.decode)),
+        };
+    } finally {
+        if (model) Module._dartllm_free_model(model);
+        file.free();
+    }
+}
+
+async function main() {
+    const options = parseArgs(process.argv.slice(2));
+    console.log(`Model: ${options.model}`);
+    console.log(`Prompt ${options.prompt} tokens, generate ${options.generate}, ` +
+        `${options.runs} runs, up to ${options.threads} threads\n`);
+
+    const results = {};
+    for (const name of options.variants) {
+        results[name] = await runVariant(name, options);
+    }
+
+    const base = results.scalar;
+    const speedup = (value, key) => (base && base[key] > 0 ? ` (${(value / base[key]).toFixed(2)}x)` : '');
+    console.log('variant   prefill tok/s        decode tok/s');
+    for (const name of options.variants) {
+        const r = results[name];
+        if (!r) continue;
+        const prefill = (r.prefill.toFixed(1) + speedup(r.prefill, 'prefill')).padEnd(20);
+        const decode = r.decode.toFixed(1) + speedup(r.decode, 'decode');
+        console.log(`${name.padEnd(9)} ${prefill} ${decode}`);
+    }
+    process.exit(0);
+}
+
+main().catch((e) => {
+    console.error(e.message);
+    process.exit(1);
+});
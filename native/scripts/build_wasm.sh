@@ -24,26 +24,56 @@ if [ ! -d "$NATIVE_DIR/llama.cpp" ]; then
     exit 1
 fi
 
-mkdir -p "$BUILD_DIR"
-cd "$BUILD_DIR"
+# Build one variant into its own directory: <name> <cmake options...>
+build_variant() {
+    local name="$1"
+    shift
+    local dir="$BUILD_DIR/$name"
 
-emcmake cmake "$NATIVE_DIR" \
-    -DCMAKE_BUILD_TYPE=Release \
-    -DDARTLLM_BUILD_WASM=ON \
-    -DLLAMA_NATIVE=OFF \
-    -DLLAMA_LTO=OFF
+    echo "Building $name variant..."
+    mkdir -p "$dir"
+    (
+        cd "$dir"
+        emcmake cmake "$NATIVE_DIR" \
+            -DCMAKE_BUILD_TYPE=Release \
+            -DDARTLLM_BUILD_WASM=ON \
+            -DLLAMA_NATIVE=OFF \
+            -DLLAMA_LTO=OFF \
+            "$@"
+        emmake make -j$(nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 4)
+    )
+}
 
-emmake make -j$(nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 4)
+build_variant scalar
+build_variant simd -DDARTLLM_WASM_SIMD=ON
+build_variant threads -DDARTLLM_WASM_THREADS=ON
+
+# dartllm.js loads dartllm-simd.wasm when SIMD is available, which is only
+# safe while both single-threaded builds produce the same glue.
+if ! cmp -s "$BUILD_DIR/scalar/dartllm.js" "$BUILD_DIR/simd/dartllm.js"; then
+    echo "Error: scalar and SIMD builds produced different JS glue"
+    exit 1
+fi
 
 mkdir -p "$OUTPUT_DIR"
 
-if [ -f "$BUILD_DIR/dartllm.js" ]; then
-    cp "$BUILD_DIR/dartllm.js" "$OUTPUT_DIR/"
-    cp "$BUILD_DIR/dartllm.wasm" "$OUTPUT_DIR/"
-    echo "WASM files copied to: $OUTPUT_DIR/"
-else
-    echo "Error: WASM build files not found"
-    exit 1
+for file in \
+    "$BUILD_DIR/scalar/dartllm.js" \
+    "$BUILD_DIR/scalar/dartllm.wasm" \
+    "$BUILD_DIR/threads/dartllm-mt.js" \
+    "$BUILD_DIR/threads/dartllm-mt.wasm"; do
+    if [ ! -f "$file" ]; then
+        echo "Error: WASM build file not found: $file"
+        exit 1
+    fi
+    cp "$file" "$OUTPUT_DIR/"
+done
+cp "$BUILD_DIR/simd/dartllm.wasm" "$OUTPUT_DIR/dartllm-simd.wasm"
+
+# Emscripten releases before 3.1.58 emit a separate pthread worker script.
+if [ -f "$BUILD_DIR/threads/dartllm-mt.worker.js" ]; then
+    cp "$BUILD_DIR/threads/dartllm-mt.worker.js" "$OUTPUT_DIR/"
 fi
 
+echo "WASM files copied to: $OUTPUT_DIR/"
 echo "WASM build complete!"
@@ -0,0 +1,284 @@
+/**
+ * @file cpu_topology.cpp
+ * @brief CPU topology discovery and thread count selection
+ */
+
+#include "cpu_topology.h"
+#include "dartllm_internal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace dartllm {
+
+namespace {
+
+#if defined(__linux__)
+
+bool read_line(const std::string& path, std::string* out) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::getline(file, *out);
+    return true;
+}
+
+int64_t read_int(const std::string& path, int64_t fallback) {
+    std::string line;
+    if (!read_line(path, &line) || line.empty()) return fallback;
+    char* end = nullptr;
+    long long value = std::strtoll(line.c_str(), &end, 10);
+    return end == line.c_str() ? fallback : static_cast<int64_t>(value);
+}
+
+/** Parse a sysfs cpulist such as "0-3,8,10-11". */
+std::vector<int32_t> parse_cpu_list(const std::string& list) {
+    std::vector<int32_t> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) continue;
+        size_t dash = range.find('-');
+        int32_t first = std::atoi(range.substr(0, dash).c_str());
+        int32_t last = (dash == std::string::npos) ? first : std::atoi(range.substr(dash + 1).c_str());
+        for (int32_t cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<int32_t> allowed_cpus() {
+    std::vector<int32_t> cpus;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+
+    if (cpus.empty()) {
+        std::string online;
+        if (read_line("/sys/devices/system/cpu/online", &online)) {
+            cpus = parse_cpu_list(online);
+        }
+    }
+
+    return cpus;
+}
+
+/** Parse a cgroup v2 cpu.max value ("max 100000" or "250000 100000"). */
+double parse_cpu_max(const std::string& value) {
+    std::stringstream ss(value);
+    std::string quota;
+    int64_t period = 0;
+    ss >> quota >> period;
+    if (quota.empty() || quota == "max" || period <= 0) return 0.0;
+    return static_cast<double>(std::atoll(quota.c_str())) / period;
+}
+
+double read_cgroup_quota() {
+    std::ifstream cgroup("/proc/self/cgroup");
+    std::string line;
+    std::string v2_path;
+    std::string v1_path;
+
+    while (std::getline(cgroup, line)) {
+        // Format: hierarchy-ID:controller-list:cgroup-path
+        size_t first = line.find(':');
+        size_t second = line.find(':', first + 1);
+        if (first == std::string::npos || second == std::string::npos) continue;
+
+        std::string controllers = line.substr(first + 1, second - first - 1);
+        std::string path = line.substr(second + 1);
+
+        if (controllers.empty()) {
+            v2_path = path;
+        } else if (("," + controllers + ",").find(",cpu,") != std::string::npos) {
+            v1_path = path;
+        }
+    }
+
+    std::string value;
+    if (!v2_path.empty() && read_line("/sys/fs/cgroup" + v2_path + "/cpu.max", &value)) {
+        return parse_cpu_max(value);
+    }
+    if (read_line("/sys/fs/cgroup/cpu.max", &value)) {
+        return parse_cpu_max(value);
+    }
+
+    for (const std::string& root : {std::string("/sys/fs/cgroup/cpu,cpuacct"), std::string("/sys/fs/cgroup/cpu")}) {
+        for (const std::string& path : {root + v1_path, root}) {
+            int64_t quota = read_int(path + "/cpu.cfs_quota_us", -2);
+            int64_t period = read_int(path + "/cpu.cfs_period_us", 0);
+            if (quota == -2) continue;
+            if (quota <= 0 || period <= 0) return 0.0;
+            return static_cast<double>(quota) / period;
+        }
+    }
+
+    return 0.0;
+}
+
+#endif // __linux__
+
+} // anonymous namespace
+
+CpuTopology detect_cpu_topology() {
+    CpuTopology topology;
+
+#if defined(__linux__)
+    const std::string base = "/sys/devices/system/cpu/cpu";
+
+    for (int32_t id : allowed_cpus()) {
+        LogicalCpu cpu;
+        cpu.id = id;
+        std::string dir = base + std::to_string(id);
+        cpu.package_id = static_cast<int32_t>(read_int(dir + "/topology/physical_package_id", 0));
+        cpu.core_id = static_cast<int32_t>(read_int(dir + "/topology/core_id", id));
+        cpu.capacity = static_cast<int32_t>(read_int(dir + "/cpu_capacity", 0));
+        cpu.max_freq_khz = read_int(dir + "/cpufreq/cpuinfo_max_freq", 0);
+        topology.cpus.push_back(cpu);
+    }
+
+    topology.cpu_quota = read_cgroup_quota();
+#endif
+
+    if (topology.cpus.empty()) {
+        topology.known = false;
+        int32_t n = static_cast<int32_t>(std::thread::hardware_concurrency());
+        for (int32_t id = 0; id < std::max(n, 1); id++) {
+            LogicalCpu cpu;
+            cpu.id = id;
+            cpu.core_id = id;
+            topology.cpus.push_back(cpu);
+        }
+    }
+
+    int32_t max_capacity = 0;
+    int64_t max_freq = 0;
+    for (const LogicalCpu& cpu : topology.cpus) {
+        max_capacity = std::max(max_capacity, cpu.capacity);
+        max_freq = std::max(max_freq, cpu.max_freq_khz);
+    }
+
+    auto is_performance = [&](const LogicalCpu& cpu) {
+        if (max_capacity > 0) return cpu.capacity * 10 >= max_capacity * 9;
+        if (max_freq > 0) return cpu.max_freq_khz * 10 >= max_freq * 9;
+        return true;
+    };
+
+    // Order fastest first so callers that take a prefix get the big cores.
+    std::vector<LogicalCpu> ordered = topology.cpus;
+    std::stable_sort(ordered.begin(), ordered.end(), [](const LogicalCpu& a, const LogicalCpu& b) {
+        if (a.capacity != b.capacity) return a.capacity > b.capacity;
+        return a.max_freq_khz > b.max_freq_khz;
+    });
+
+    std::set<std::pair<int32_t, int32_t>> seen_cores;
+    for (const LogicalCpu& cpu : ordered) {
+        if (!seen_cores.insert({cpu.package_id, cpu.core_id}).second) continue;
+        topology.core_cpu_ids.push_back(cpu.id);
+        if (is_performance(cpu)) {
+            topology.performance_cpu_ids.push_back(cpu.id);
+        }
+    }
+
+    topology.physical_cores = static_cast<int32_t>(topology.core_cpu_ids.size());
+    topology.performance_cores = static_cast<int32_t>(topology.performance_cpu_ids.size());
+
+    return topology;
+}
+
+ThreadPlan plan_threads(const CpuTopology& topology, int32_t max_threads) {
+    ThreadPlan plan;
+
+    int32_t quota_cap = topology.physical_cores;
+    if (topology.cpu_quota > 0.0) {
+        quota_cap = std::max(1, static_cast<int32_t>(std::floor(topology.cpu_quota)));
+    }
+
+    int32_t decode_cores = topology.performance_cores;
+    int32_t prefill_cores = topology.physical_cores;
+    if (!topology.known) {
+        const int32_t n = static_cast<int32_t>(topology.cpus.size());
+        decode_cores = n <= 2 ? 1 : (n <= 4 ? n - 1 : n - 2);
+        prefill_cores = decode_cores;
+    }
+
+    plan.decode_threads = std::max(1, std::min(decode_cores, quota_cap));
+    plan.prefill_threads = std::max(1, std::min(prefill_cores, quota_cap));
+    plan.prefill_threads = std::max(plan.prefill_threads, plan.decode_threads);
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    // Single-threaded WebAssembly builds cannot start worker threads.
+    plan.decode_threads = 1;
+    plan.prefill_threads = 1;
+#endif
+
+    if (max_threads > 0) {
+        plan.decode_threads = std::min(plan.decode_threads, max_threads);
+        plan.prefill_threads = std::min(plan.prefill_threads, max_threads);
+    }
+
+    return plan;
+}
+
+uint64_t host_signature(const CpuTopology& topology) {
+    uint64_t hash = kFnv1aOffsetBasis;
+    auto mix = [&hash](int64_t value) {
+        hash = fnv1a_int(static_cast<uint64_t>(value), 8, hash);
+    };
+
+    for (const LogicalCpu& cpu : topology.cpus) {
+        mix(cpu.id);
+        mix(cpu.package_id);
+        mix(cpu.core_id);
+        mix(cpu.capacity);
+        mix(cpu.max_freq_khz);
+    }
+    mix(static_cast<int64_t>(topology.cpu_quota * 1000.0));
+
+    return hash;
+}
+
+int32_t parse_cpu_mask(const char* list, bool* mask, int32_t mask_size) {
+    int32_t count = 0;
+    const char* p = list;
+    while (*p) {
+        char* end = nullptr;
+        long first = std::strtol(p, &end, 10);
+        if (end == p || first < 0) return -1;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = std::strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first) return -1;
+            p = end;
+        }
+        for (long cpu = first; cpu <= last && cpu < mask_size; cpu++) {
+            if (!mask[cpu]) count++;
+            mask[cpu] = true;
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p) {
+            return -1;
+        }
+    }
+    return count;
+}
+
+} // namespace dartllm
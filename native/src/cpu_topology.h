@@ -0,0 +1,103 @@
+/**
+ * @file cpu_topology.h
+ * @brief CPU topology discovery and thread count selection (internal)
+ *
+ * On Linux the topology is read from sysfs and the cgroup CPU quota; other
+ * platforms only know std::thread::hardware_concurrency().
+ */
+
+#ifndef DARTLLM_CPU_TOPOLOGY_H
+#define DARTLLM_CPU_TOPOLOGY_H
+
+#include <cstdint>
+#include <vector>
+
+namespace dartllm {
+
+/** One logical CPU the process is allowed to run on. */
+struct LogicalCpu {
+    int32_t id = 0;
+    int32_t package_id = 0;
+    int32_t core_id = 0;
+    /** Relative capacity from sysfs cpu_capacity (1024 = biggest core), 0 if unknown. */
+    int32_t capacity = 0;
+    /** Maximum frequency in kHz from cpufreq, 0 if unknown. */
+    int64_t max_freq_khz = 0;
+};
+
+struct CpuTopology {
+    /** Logical CPUs in the process affinity mask. */
+    std::vector<LogicalCpu> cpus;
+
+    /** Distinct (package, core) pairs among `cpus`. */
+    int32_t physical_cores = 0;
+
+    /** Physical cores in the fastest capacity/frequency class. */
+    int32_t performance_cores = 0;
+
+    /** CPU quota from cgroups in CPUs (e.g. 2.5), or 0 if unlimited. */
+    double cpu_quota = 0.0;
+
+    /** Logical CPU ids of one SMT thread per performance core, fastest first. */
+    std::vector<int32_t> performance_cpu_ids;
+
+    /** Logical CPU ids of one SMT thread per physical core, fastest first. */
+    std::vector<int32_t> core_cpu_ids;
+
+    /**
+     * False when the CPUs could not be read and `cpus` only numbers the
+     * std::thread::hardware_concurrency() logical CPUs; their cores and
+     * speeds are then unknown and every one counts as a performance core.
+     */
+    bool known = true;
+};
+
+/**
+ * Read the topology of the CPUs this process may run on.
+ *
+ * Never fails: missing sysfs entries degrade to one core per logical CPU.
+ */
+CpuTopology detect_cpu_topology();
+
+/** Thread counts chosen for a context. */
+struct ThreadPlan {
+    /** Threads for single-token decode (memory-bandwidth bound). */
+    int32_t decode_threads = 1;
+
+    /** Threads for batched prompt processing (compute bound). */
+    int32_t prefill_threads = 1;
+};
+
+/**
+ * Pick decode and prefill thread counts for a topology.
+ *
+ * Decode uses one thread per performance core: SMT siblings share the load
+ * and store ports that decode saturates, and efficiency cores stall the
+ * barrier at the end of each layer. Prefill uses one thread per physical
+ * core. When the topology is not known, both use n - 2 of n logical CPUs
+ * (n - 1 up to four, one up to two), leaving room for SMT siblings and
+ * efficiency cores. Both are clamped to the cgroup quota and to
+ * `max_threads`, the most threads the platform can run at once (0 for no
+ * limit; WebAssembly builds pass the size of their pre-started worker pool
+ * plus one).
+ */
+ThreadPlan plan_threads(const CpuTopology& topology, int32_t max_threads = 0);
+
+/**
+ * Stable identifier for the host CPU configuration, used to key
+ * calibration results.
+ */
+uint64_t host_signature(const CpuTopology& topology);
+
+/**
+ * Parse a CPU list such as "0-3,8" into a ggml-style cpumask of
+ * `mask_size` entries, setting the listed CPUs. CPUs at or beyond
+ * `mask_size` are ignored.
+ *
+ * @return Number of CPUs newly set, or -1 on a malformed list
+ */
+int32_t parse_cpu_mask(const char* list, bool* mask, int32_t mask_size);
+
+} // namespace dartllm
+
+#endif /* DARTLLM_CPU_TOPOLOGY_H */
@@ -4,15 +4,46 @@
  */
 
 #include "dartllm.h"
+#include "dartllm_internal.h"
+#include "cpu_topology.h"
+#include "gguf_metadata.h"
+#include "json_schema_grammar.h"
+#include "prefix_store.h"
+#include "registry_policy.h"
 #include "llama.h"
 #include "ggml.h"
+#include "ggml-cpu.h"
 
+#include <sys/stat.h>
+
+#if defined(__EMSCRIPTEN_PTHREADS__)
+#include <emscripten.h>
+#endif
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <condition_variable>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <map>
 #include <string>
 #include <vector>
 #include <mutex>
 #include <memory>
+#include <system_error>
 #include <thread>
 
 namespace {
@@ -22,6 +53,104 @@ bool g_initialized = false;
 std::mutex g_init_mutex;
 const char* VERSION = "0.1.0";
 
+/**
+ * A ggml CPU threadpool that can be shared by several model contexts.
+ *
+ * A ggml threadpool runs one graph at a time, so contexts attached to the
+ * same pool take compute_mutex around each decode/encode call. Contexts
+ * then interleave token by token instead of oversubscribing the cores.
+ */
+struct ThreadPool {
+    ggml_threadpool* pool = nullptr;
+    int32_t n_threads = 0;
+    std::mutex compute_mutex;
+
+    ~ThreadPool() {
+        if (pool) {
+            ggml_threadpool_free(pool);
+        }
+    }
+};
+
+/** Opaque handle returned by dartllm_threadpool_create(). */
+struct ThreadPoolHandle {
+    std::shared_ptr<ThreadPool> pool;
+};
+
+/**
+ * A parsed grammar sampler kept as a prototype. Requests use a clone, so
+ * the grammar text is parsed once no matter how often it is used.
+ */
+struct CompiledGrammar {
+    uint64_t hash = 0;
+    int32_t kind = 0;
+    std::string source;
+    llama_sampler* sampler = nullptr;
+
+    ~CompiledGrammar() {
+        if (sampler) {
+            llama_sampler_free(sampler);
+        }
+    }
+};
+
+/**
+ * The grammar and logit biases of one request, resolved from its
+ * DartLLMConstraints by resolve_constraints().
+ */
+struct RequestConstraints {
+    std::shared_ptr<CompiledGrammar> grammar;
+    std::vector<llama_logit_bias> logit_bias;
+};
+
+using dartllm::PrefixStore;
+
+/** Sequences per context; dartllm_score() and dartllm_generate_n() fork the prompt into these. */
+constexpr int32_t kMaxSequences = DARTLLM_MAX_PARALLEL;
+
+/** Parsed grammars kept per model for DartLLMConstraints. */
+constexpr size_t kGrammarCacheSize = 16;
+
+struct ModelContext;
+
+/**
+ * A conversation bound to one KV sequence of its model's context, created
+ * by dartllm_session_create(). `tokens` are resident in that sequence while
+ * context_generation matches the model's; the last token's logits are still
+ * in the context's output buffer while logits_epoch matches decode_epoch.
+ */
+struct SessionContext {
+    ModelContext* owner = nullptr;
+    llama_seq_id seq = 0;
+    std::vector<llama_token> tokens;
+
+    /** Adapter the session's tokens are decoded with (null for the base model). */
+    llama_adapter_lora* lora = nullptr;
+    float lora_scale = 1.0f;
+
+    uint64_t context_generation = 0;
+    uint64_t logits_epoch = 0;
+};
+
+/**
+ * A polled generation from dartllm_stream_begin(). `pending` is the last
+ * reported token; the next call decodes it into the session, so each call
+ * returns as soon as its own token is sampled.
+ */
+struct StreamContext {
+    SessionContext* session = nullptr;
+    llama_sampler* sampler = nullptr;
+    int32_t remaining = 0;
+    llama_token pending = LLAMA_TOKEN_NULL;
+    bool finished = false;
+
+    ~StreamContext() {
+        if (sampler) {
+            llama_sampler_free(sampler);
+        }
+    }
+};
+
 struct ModelContext {
     llama_model* model = nullptr;
     llama_context* ctx = nullptr;
@@ -30,14 +159,93 @@ struct ModelContext {
     std::string model_path;
     int32_t context_size = 0;
     int32_t n_threads = 0;
+    int32_t n_threads_batch = 0;
+    bool threads_calibrated = false;
+
+    /** Serializes operations that touch the llama_context and sampler. */
+    std::mutex mutex;
+
+    /** Attached shared threadpools; released after the context is freed. */
+    std::shared_ptr<ThreadPool> threadpool;
+    std::shared_ptr<ThreadPool> threadpool_batch;
+
+    int32_t batch_size = 0;
+    bool use_mmap = false;
+
+    /**
+     * LoRA adapters from dartllm_lora_load(), guarded by lora_mutex so
+     * loading one does not wait for a running request. Each request names
+     * its own adapter. Lock order: mutex, then lora_mutex.
+     */
+    std::mutex lora_mutex;
+    std::vector<llama_adapter_lora*> lora_adapters;
+
+    /** Adapter currently set on ctx (guarded by mutex). */
+    llama_adapter_lora* lora_applied = nullptr;
+    float lora_applied_scale = 0.0f;
+
+    /**
+     * Recently parsed request grammars, most recently used first (guarded
+     * by grammar_mutex).
+     */
+    std::mutex grammar_mutex;
+    std::list<std::shared_ptr<CompiledGrammar>> grammar_cache;
+
+    /**
+     * Live sessions by KV sequence (guarded by mutex). Sequence 0 is never
+     * given to a session; stateless requests clear every sequence except
+     * the ones held here.
+     */
+    std::array<std::unique_ptr<SessionContext>, kMaxSequences> sessions;
+    int32_t session_count = 0;
+
+    /**
+     * Counters sessions use to detect lost state: decode_epoch is bumped by
+     * every decode and encode, context_generation by every new llama_context.
+     */
+    uint64_t decode_epoch = 0;
+    uint64_t context_generation = 0;
+
+    /**
+     * Prefix cache from dartllm_set_prefix_cache(). prefix_store is written
+     * with both mutex and prefix_mutex held, so requests read it under
+     * mutex and dartllm_prefix_cache_stats() under prefix_mutex alone; the
+     * other fields are guarded by mutex. prefix_uses counts requests per
+     * prefix key. Lock order: mutex, then prefix_mutex.
+     */
+    std::mutex prefix_mutex;
+    std::shared_ptr<PrefixStore> prefix_store;
+    uint64_t prefix_model_key = 0;
+    int32_t prefix_min_uses = 0;
+    std::map<std::string, int32_t> prefix_uses;
+
+    /** Background warm-up started by dartllm_warmup(). */
+    std::thread warmup_thread;
+    std::mutex warmup_mutex;
+    std::string warmup_error;
+    std::atomic<bool> warmup_cancel{false};
+    std::atomic<int32_t> warmup_state{DARTLLM_WARMUP_IDLE};
+    std::atomic<int32_t> warmup_mode{0};
+    std::atomic<int64_t> warmup_bytes_done{0};
+    std::atomic<int64_t> warmup_bytes_total{0};
+    std::atomic<bool> warmup_decoded{false};
 
     ~ModelContext() {
+        // The warm-up thread decodes on ctx, so stop it before freeing.
+        warmup_cancel = true;
+        if (warmup_thread.joinable()) {
+            warmup_thread.join();
+        }
         if (sampler) {
             llama_sampler_free(sampler);
         }
         if (ctx) {
             llama_free(ctx);
         }
+        grammar_cache.clear();
+        for (llama_adapter_lora* adapter : lora_adapters) {
+            llama_adapter_lora_free(adapter);
+        }
         if (model) {
             llama_model_free(model);
         }
@@ -58,376 +266,3242 @@ void copy_string(char* dest, size_t dest_size, const std::string& src) {
     dest[len] = '\0';
 }
 
-int32_t get_optimal_threads() {
-    int32_t n = std::thread::hardware_concurrency();
-    if (n <= 2) return 1;
-    if (n <= 4) return n - 1;
-    return n - 2;
+const dartllm::CpuTopology& host_topology() {
+    static const dartllm::CpuTopology topology = dartllm::detect_cpu_topology();
+    return topology;
 }
 
-} // anonymous namespace
-
-extern "C" {
-
-DARTLLM_API int32_t dartllm_init(void) {
-    std::lock_guard<std::mutex> lock(g_init_mutex);
-
-    if (g_initialized) {
-        return 0;
-    }
-
-    ggml_backend_load_all();
-    g_initialized = true;
-    clear_error();
+#if defined(__EMSCRIPTEN_PTHREADS__)
+// Workers cannot start while the calling thread blocks in a decode, so
+// only the pool wasm_pre.js sized before startup is available.
+EM_JS(int32_t, js_thread_pool_size, (), {
+    return Module['dartllmThreadPoolSize'] | 0;
+});
+#endif
 
+/** Most compute threads this process can run at once, or 0 for no limit. */
+int32_t host_thread_limit() {
+#if defined(__EMSCRIPTEN_PTHREADS__)
+    // The calling thread computes alongside the pooled workers.
+    return js_thread_pool_size() + 1;
+#else
     return 0;
+#endif
 }
 
-DARTLLM_API const char* dartllm_version(void) {
-    return VERSION;
+/** plan_threads() for this host. */
+dartllm::ThreadPlan host_thread_plan() {
+    return dartllm::plan_threads(host_topology(), host_thread_limit());
 }
 
-DARTLLM_API const char* dartllm_llama_version(void) {
-    return "unknown";
+/** Fold the path, size and modification time of a file into `hash`. */
+uint64_t file_identity_hash(const std::string& path, const struct stat& st, uint64_t hash) {
+    hash = dartllm::fnv1a(path, hash);
+    hash = dartllm::fnv1a(std::to_string(static_cast<long long>(st.st_size)), hash);
+    return dartllm::fnv1a(std::to_string(static_cast<long long>(st.st_mtime)), hash);
 }
 
-DARTLLM_API void* dartllm_load_model(
-    const char* path,
-    int32_t context_size,
-    int32_t gpu_layers,
-    int32_t threads,
-    int32_t batch_size,
-    int8_t use_mmap
-) {
-    if (!g_initialized) {
-        set_error("Library not initialized. Call dartllm_init() first.");
-        return nullptr;
-    }
+/** Calibrated thread plans keyed by calibration_key(). */
+std::map<std::string, dartllm::ThreadPlan> g_calibrations;
+std::mutex g_calibrations_mutex;
 
-    if (!path) {
-        set_error("Model path is null");
-        return nullptr;
+/**
+ * Key for a calibration result: model file identity plus host CPU layout.
+ * Returns an empty string if the model file cannot be stat'ed.
+ */
+std::string calibration_key(const std::string& model_path) {
+    struct stat st;
+    if (stat(model_path.c_str(), &st) != 0) {
+        return "";
     }
 
-    clear_error();
-
-    auto model_ctx = std::make_unique<ModelContext>();
-    model_ctx->model_path = path;
+    uint64_t hash = file_identity_hash(model_path, st, dartllm::host_signature(host_topology()));
 
-    llama_model_params model_params = llama_model_default_params();
-    model_params.n_gpu_layers = (gpu_layers < 0) ? 999 : gpu_layers;
-    model_params.use_mmap = use_mmap != 0;
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+    return key;
+}
 
-    model_ctx->model = llama_model_load_from_file(path, model_params);
-    if (!model_ctx->model) {
-        set_error("Failed to load model from: " + std::string(path));
-        return nullptr;
-    }
+std::string calibration_cache_file(const std::string& cache_dir) {
+    return cache_dir + "/dartllm_threads.cache";
+}
 
-    model_ctx->vocab = llama_model_get_vocab(model_ctx->model);
+/** Look up a cached calibration, in memory first and then on disk. */
+bool find_calibration(
+    const std::string& key,
+    const char* cache_dir,
+    dartllm::ThreadPlan* plan
+) {
+    if (key.empty()) return false;
 
-    int32_t model_ctx_size = llama_model_n_ctx_train(model_ctx->model);
-    if (context_size <= 0) {
-        context_size = model_ctx_size;
+    std::lock_guard<std::mutex> lock(g_calibrations_mutex);
+    auto it = g_calibrations.find(key);
+    if (it != g_calibrations.end()) {
+        *plan = it->second;
+        return true;
     }
-    model_ctx->context_size = std::min(context_size, model_ctx_size);
-    model_ctx->n_threads = (threads <= 0) ? get_optimal_threads() : threads;
 
-    llama_context_params ctx_params = llama_context_default_params();
-    ctx_params.n_ctx = model_ctx->context_size;
-    ctx_params.n_batch = (batch_size <= 0) ? 512 : batch_size;
-    ctx_params.n_threads = model_ctx->n_threads;
-    ctx_params.n_threads_batch = model_ctx->n_threads;
+    if (!cache_dir) return false;
 
-    model_ctx->ctx = llama_init_from_model(model_ctx->model, ctx_params);
-    if (!model_ctx->ctx) {
-        set_error("Failed to create context");
-        return nullptr;
+    std::ifstream file(calibration_cache_file(cache_dir));
+    std::string entry_key;
+    dartllm::ThreadPlan entry;
+    while (file >> entry_key >> entry.decode_threads >> entry.prefill_threads) {
+        if (entry_key == key && entry.decode_threads > 0 && entry.prefill_threads > 0) {
+            g_calibrations[key] = entry;
+            *plan = entry;
+            return true;
+        }
     }
+    return false;
+}
 
-    llama_sampler_chain_params sampler_params = llama_sampler_chain_default_params();
-    model_ctx->sampler = llama_sampler_chain_init(sampler_params);
+/** Entries kept in a calibration cache file, most recently stored last. */
+constexpr size_t kMaxCalibrationEntries = 64;
 
-    return model_ctx.release();
-}
+void store_calibration(
+    const std::string& key,
+    const char* cache_dir,
+    const dartllm::ThreadPlan& plan
+) {
+    if (key.empty()) return;
+
+    std::lock_guard<std::mutex> lock(g_calibrations_mutex);
+    g_calibrations[key] = plan;
+
+    if (!cache_dir) return;
+
+    // Rewrite the file with one line per key so recalibrating a model
+    // replaces its entry, dropping the oldest beyond the cap.
+    const std::string path = calibration_cache_file(cache_dir);
+    std::vector<std::pair<std::string, dartllm::ThreadPlan>> entries;
+    {
+        std::ifstream file(path);
+        std::string entry_key;
+        dartllm::ThreadPlan entry;
+        while (file >> entry_key >> entry.decode_threads >> entry.prefill_threads) {
+            if (entry_key != key) entries.emplace_back(entry_key, entry);
+        }
+    }
+    entries.emplace_back(key, plan);
+    if (entries.size() > kMaxCalibrationEntries) {
+        entries.erase(entries.begin(), entries.end() - kMaxCalibrationEntries);
+    }
 
-DARTLLM_API void dartllm_free_model(void* model) {
-    if (model) {
-        delete static_cast<ModelContext*>(model);
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+        if (!file) return;
+        for (const auto& entry : entries) {
+            file << entry.first << ' ' << entry.second.decode_threads << ' '
+                 << entry.second.prefill_threads << '\n';
+        }
+        if (!file) {
+            file.close();
+            std::remove(temp_path.c_str());
+            return;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
     }
 }
 
-DARTLLM_API DartLLMModelInfo* dartllm_get_model_info(void* model) {
-    if (!model) {
-        set_error("Model handle is null");
-        return nullptr;
+/** Thread plan for a model loaded with threads = 0. */
+dartllm::ThreadPlan default_thread_plan(const std::string& model_path) {
+    dartllm::ThreadPlan plan;
+    if (find_calibration(calibration_key(model_path), nullptr, &plan)) {
+        return plan;
     }
+    return host_thread_plan();
+}
 
-    clear_error();
+void fill_thread_config(
+    DartLLMThreadConfig* out,
+    int32_t n_threads,
+    int32_t n_threads_batch,
+    bool calibrated
+) {
+    const dartllm::CpuTopology& topology = host_topology();
+    std::memset(out, 0, sizeof(DartLLMThreadConfig));
+    out->n_threads = n_threads;
+    out->n_threads_batch = n_threads_batch;
+    out->logical_cpus = static_cast<int32_t>(topology.cpus.size());
+    out->physical_cores = topology.physical_cores;
+    out->performance_cores = topology.performance_cores;
+    out->cpu_quota = static_cast<float>(topology.cpu_quota);
+    out->calibrated = calibrated ? 1 : 0;
+}
 
-    auto* ctx = static_cast<ModelContext*>(model);
-    auto* info = static_cast<DartLLMModelInfo*>(std::malloc(sizeof(DartLLMModelInfo)));
-    if (!info) {
-        set_error("Failed to allocate model info");
-        return nullptr;
-    }
+/** Model information read from a GGUF header by dartllm_probe_model(). */
+struct ProbedModel {
+    DartLLMModelInfo info;
+    std::string chat_template;
+};
 
-    std::memset(info, 0, sizeof(DartLLMModelInfo));
+/** Probe results keyed by probe_key(). */
+std::map<std::string, std::shared_ptr<const ProbedModel>> g_probes;
+std::mutex g_probes_mutex;
 
-    char meta_buf[256];
-    int32_t meta_len = llama_model_meta_val_str(ctx->model, "general.name", meta_buf, sizeof(meta_buf));
-    if (meta_len > 0) {
-        copy_string(info->name, sizeof(info->name), meta_buf);
-    } else {
-        std::string path = ctx->model_path;
-        size_t last_sep = path.find_last_of("/\\");
-        std::string filename = (last_sep != std::string::npos) ? path.substr(last_sep + 1) : path;
-        copy_string(info->name, sizeof(info->name), filename);
-    }
+/** Bumped whenever the layout of a probe cache file changes. */
+const uint32_t PROBE_CACHE_VERSION = 1;
 
-    meta_len = llama_model_meta_val_str(ctx->model, "general.architecture", meta_buf, sizeof(meta_buf));
-    if (meta_len > 0) {
-        copy_string(info->architecture, sizeof(info->architecture), meta_buf);
-    } else {
-        copy_string(info->architecture, sizeof(info->architecture), "unknown");
-    }
+std::string file_basename(const std::string& path) {
+    size_t last_sep = path.find_last_of("/\\");
+    return (last_sep != std::string::npos) ? path.substr(last_sep + 1) : path;
+}
 
-    meta_len = llama_model_meta_val_str(ctx->model, "general.quantization_version", meta_buf, sizeof(meta_buf));
-    if (meta_len > 0) {
-        copy_string(info->quantization, sizeof(info->quantization), meta_buf);
-    } else {
-        copy_string(info->quantization, sizeof(info->quantization), "unknown");
+/**
+ * Key for a probe result: path, size and mtime of the model file.
+ * Returns an empty string if the file cannot be stat'ed.
+ */
+std::string probe_key(const std::string& model_path, int64_t* file_size) {
+    struct stat st;
+    if (stat(model_path.c_str(), &st) != 0) {
+        return "";
     }
+    *file_size = static_cast<int64_t>(st.st_size);
 
-    info->parameter_count = llama_model_n_params(ctx->model);
-    info->context_size = ctx->context_size;
-    info->vocabulary_size = llama_vocab_n_tokens(ctx->vocab);
-    info->embedding_size = llama_model_n_embd(ctx->model);
-    info->layer_count = llama_model_n_layer(ctx->model);
-    info->head_count = llama_model_n_head(ctx->model);
-    info->file_size_bytes = llama_model_size(ctx->model);
-    info->supports_embedding = llama_model_has_encoder(ctx->model) ? 1 : 0;
-    info->supports_vision = 0;
+    uint64_t hash = file_identity_hash(model_path, st, dartllm::kFnv1aOffsetBasis);
 
-    std::vector<char> template_buf(4096);
-    int32_t template_len = llama_model_meta_val_str(
-        ctx->model,
-        "tokenizer.chat_template",
-        template_buf.data(),
-        template_buf.size()
-    );
-    if (template_len > 0) {
-        copy_string(info->chat_template, sizeof(info->chat_template), template_buf.data());
-    } else {
-        info->chat_template[0] = '\0';
-    }
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+    return key;
+}
 
-    return info;
+std::string probe_cache_file(const std::string& cache_dir, const std::string& key) {
+    return cache_dir + "/dartllm_probe_" + key + ".bin";
 }
 
-DARTLLM_API int32_t* dartllm_tokenize(
-    void* model,
-    const char* text,
-    int8_t add_special,
-    int32_t* out_length
-) {
-    if (!model || !text || !out_length) {
-        set_error("Invalid parameters");
-        return nullptr;
+/**
+ * Probe cache file layout: version, sizeof(DartLLMModelInfo), path length
+ * and bytes, the info struct, then template length and bytes. The path is
+ * stored so a hash collision reads as a miss.
+ */
+bool read_probe_cache(const std::string& file_path, const std::string& model_path, ProbedModel* out) {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file) return false;
+
+    uint32_t version = 0;
+    uint32_t info_size = 0;
+    uint64_t path_length = 0;
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&info_size), sizeof(info_size));
+    file.read(reinterpret_cast<char*>(&path_length), sizeof(path_length));
+    if (!file || version != PROBE_CACHE_VERSION || info_size != sizeof(DartLLMModelInfo)
+            || path_length != model_path.size()) {
+        return false;
     }
 
-    clear_error();
+    std::string stored_path(path_length, '\0');
+    file.read(&stored_path[0], static_cast<std::streamsize>(path_length));
+    if (!file || stored_path != model_path) return false;
 
-    auto* ctx = static_cast<ModelContext*>(model);
-    size_t text_len = std::strlen(text);
+    file.read(reinterpret_cast<char*>(&out->info), sizeof(DartLLMModelInfo));
 
-    int32_t n_tokens = -llama_tokenize(ctx->vocab, text, text_len, nullptr, 0, add_special != 0, true);
+    uint64_t template_length = 0;
+    file.read(reinterpret_cast<char*>(&template_length), sizeof(template_length));
+    if (!file || template_length > (1u << 24)) return false;
 
-    if (n_tokens <= 0) {
-        set_error("Tokenization failed");
-        return nullptr;
+    out->chat_template.assign(template_length, '\0');
+    file.read(&out->chat_template[0], static_cast<std::streamsize>(template_length));
+    return static_cast<bool>(file);
+}
+
+void write_probe_cache(const std::string& file_path, const std::string& model_path, const ProbedModel& probe) {
+    // Write beside the final name and rename so readers never see a partial file.
+    std::string temp_path = file_path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file) return;
+
+        uint32_t version = PROBE_CACHE_VERSION;
+        uint32_t info_size = sizeof(DartLLMModelInfo);
+        uint64_t path_length = model_path.size();
+        uint64_t template_length = probe.chat_template.size();
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file.write(reinterpret_cast<const char*>(&info_size), sizeof(info_size));
+        file.write(reinterpret_cast<const char*>(&path_length), sizeof(path_length));
+        file.write(model_path.data(), static_cast<std::streamsize>(path_length));
+        file.write(reinterpret_cast<const char*>(&probe.info), sizeof(DartLLMModelInfo));
+        file.write(reinterpret_cast<const char*>(&template_length), sizeof(template_length));
+        file.write(probe.chat_template.data(), static_cast<std::streamsize>(template_length));
+        if (!file) {
+            file.close();
+            std::remove(temp_path.c_str());
+            return;
+        }
     }
+    if (std::rename(temp_path.c_str(), file_path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+    }
+}
 
-    std::vector<llama_token> tokens(n_tokens);
-    int32_t actual = llama_tokenize(ctx->vocab, text, text_len, tokens.data(), tokens.size(), add_special != 0, true);
+bool is_encoder_architecture(const std::string& arch) {
+    return arch == "bert" || arch == "nomic-bert" || arch == "nomic-bert-moe"
+        || arch == "jina-bert-v2" || arch == "t5" || arch == "t5encoder";
+}
 
-    if (actual < 0) {
-        set_error("Tokenization failed");
-        return nullptr;
-    }
+/** Fill a probe result from a GGUF header. */
+void read_probe(const dartllm::GgufFile& file, const std::string& model_path, int64_t file_size, ProbedModel* out) {
+    DartLLMModelInfo& info = out->info;
+    std::memset(&info, 0, sizeof(DartLLMModelInfo));
 
-    auto* result = static_cast<int32_t*>(std::malloc(actual * sizeof(int32_t)));
-    if (!result) {
-        set_error("Failed to allocate token array");
-        return nullptr;
-    }
+    copy_string(info.name, sizeof(info.name), file.get_string("general.name", file_basename(model_path)));
+    copy_string(info.architecture, sizeof(info.architecture), file.architecture());
+    copy_string(info.quantization, sizeof(info.quantization),
+        dartllm::file_type_name(file.get_int("general.file_type", -1)));
 
-    for (int32_t i = 0; i < actual; i++) {
-        result[i] = tokens[i];
+    int64_t n_vocab = file.get_int(file.arch_key("vocab_size"), 0);
+    if (n_vocab <= 0) {
+        n_vocab = file.get_array_length("tokenizer.ggml.tokens");
     }
 
-    *out_length = actual;
-    return result;
+    info.parameter_count = file.parameter_count();
+    info.context_size = static_cast<int32_t>(file.get_int(file.arch_key("context_length"), 0));
+    info.vocabulary_size = static_cast<int32_t>(n_vocab);
+    info.embedding_size = static_cast<int32_t>(file.get_int(file.arch_key("embedding_length"), 0));
+    info.layer_count = static_cast<int32_t>(file.get_int(file.arch_key("block_count"), 0));
+    info.head_count = static_cast<int32_t>(file.get_int(file.arch_key("attention.head_count"), 0));
+    info.file_size_bytes = file_size;
+    info.supports_embedding = (is_encoder_architecture(file.architecture())
+        || file.has(file.arch_key("pooling_type"))) ? 1 : 0;
+    info.supports_vision = file.get_int("clip.has_vision_encoder", 0) != 0 ? 1 : 0;
+
+    out->chat_template = file.get_string("tokenizer.chat_template", "");
+    copy_string(info.chat_template, sizeof(info.chat_template), out->chat_template);
 }
 
-DARTLLM_API char* dartllm_detokenize(
-    void* model,
-    const int32_t* tokens,
-    int32_t token_count
-) {
-    if (!model || !tokens || token_count <= 0) {
-        set_error("Invalid parameters");
+/**
+ * Probe a model file, consulting the in-memory cache and then `cache_dir`.
+ * Returns nullptr and sets `error` on failure.
+ */
+std::shared_ptr<const ProbedModel> probe_model(const std::string& model_path, const char* cache_dir, std::string* error) {
+    int64_t file_size = 0;
+    std::string key = probe_key(model_path, &file_size);
+    if (key.empty()) {
+        *error = "Model file not found: " + model_path;
         return nullptr;
     }
 
-    clear_error();
-
-    auto* ctx = static_cast<ModelContext*>(model);
+    {
+        std::lock_guard<std::mutex> lock(g_probes_mutex);
+        auto it = g_probes.find(key);
+        if (it != g_probes.end()) {
+            return it->second;
+        }
+    }
 
-    std::string result;
-    result.reserve(token_count * 8);
+    auto probe = std::make_shared<ProbedModel>();
+    bool cached = cache_dir && read_probe_cache(probe_cache_file(cache_dir, key), model_path, probe.get());
 
-    for (int32_t i = 0; i < token_count; i++) {
-        char buf[256];
-        int32_t n = llama_token_to_piece(ctx->vocab, tokens[i], buf, sizeof(buf), 0, true);
-        if (n > 0) {
-            result.append(buf, n);
+    if (!cached) {
+        std::unique_ptr<dartllm::GgufFile> file = dartllm::GgufFile::open(model_path, error);
+        if (!file) {
+            return nullptr;
         }
-    }
+        read_probe(*file, model_path, file_size, probe.get());
 
-    char* output = static_cast<char*>(std::malloc(result.length() + 1));
-    if (!output) {
-        set_error("Failed to allocate output string");
-        return nullptr;
+        if (cache_dir) {
+            write_probe_cache(probe_cache_file(cache_dir, key), model_path, *probe);
+        }
     }
 
-    std::memcpy(output, result.c_str(), result.length() + 1);
-    return output;
+    std::lock_guard<std::mutex> lock(g_probes_mutex);
+    g_probes[key] = probe;
+    return probe;
 }
 
-DARTLLM_API DartLLMGenerateResult* dartllm_generate(
-    void* model,
-    const int32_t* prompt_tokens,
-    int32_t prompt_length,
-    int32_t max_tokens,
+/**
+ * Build a sampler chain for one request or branch.
+ *
+ * The grammar is cloned from its parsed prototype, which starts the clone
+ * at the grammar's initial state.
+ */
+llama_sampler* build_sampler(
+    ModelContext* ctx,
+    const RequestConstraints& constraints,
     float temperature,
     float top_p,
     int32_t top_k,
     float min_p,
-    float repetition_penalty,
     int32_t seed
 ) {
-    (void)repetition_penalty;
-
-    if (!model || !prompt_tokens || prompt_length <= 0) {
-        set_error("Invalid parameters");
-        return nullptr;
+    llama_sampler* chain = llama_sampler_chain_init(llama_sampler_chain_default_params());
+
+    // Biases and the grammar run first so truncation samplers only see
+    // tokens that are still allowed.
+    if (!constraints.logit_bias.empty()) {
+        llama_sampler_chain_add(chain, llama_sampler_init_logit_bias(
+            llama_vocab_n_tokens(ctx->vocab),
+            static_cast<int32_t>(constraints.logit_bias.size()),
+            constraints.logit_bias.data()));
+    }
+    if (constraints.grammar) {
+        llama_sampler_chain_add(chain, llama_sampler_clone(constraints.grammar->sampler));
+    }
+
+    llama_sampler_chain_add(chain, llama_sampler_init_top_k(top_k));
+    llama_sampler_chain_add(chain, llama_sampler_init_top_p(top_p, 1));
+    llama_sampler_chain_add(chain, llama_sampler_init_min_p(min_p, 1));
+    llama_sampler_chain_add(chain, llama_sampler_init_temp(temperature));
+    llama_sampler_chain_add(chain, llama_sampler_init_dist(seed >= 0 ? seed : LLAMA_DEFAULT_SEED));
+    return chain;
+}
+
+/**
+ * Rebuild the sampler chain for a new request.
+ *
+ * llama_sampler_reset() only resets sampler state, so adding to an existing
+ * chain would grow it on every call.
+ */
+void configure_sampler(
+    ModelContext* ctx,
+    const RequestConstraints& constraints,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    int32_t seed
+) {
+    if (ctx->sampler) {
+        llama_sampler_free(ctx->sampler);
+    }
+    ctx->sampler = build_sampler(ctx, constraints, temperature, top_p, top_k, min_p, seed);
+}
+
+/**
+ * Holds the compute lock of every threadpool attached to a context for the
+ * duration of one decode/encode call. Locks in address order so two
+ * contexts sharing the same pair of pools cannot deadlock.
+ */
+class PoolComputeLock {
+public:
+    explicit PoolComputeLock(ModelContext* ctx) {
+        ThreadPool* a = ctx->threadpool.get();
+        ThreadPool* b = ctx->threadpool_batch.get();
+        if (a == b) b = nullptr;
+        if (!a) std::swap(a, b);
+        if (a && b && b < a) std::swap(a, b);
+        if (a) first_ = std::unique_lock<std::mutex>(a->compute_mutex);
+        if (b) second_ = std::unique_lock<std::mutex>(b->compute_mutex);
+    }
+
+private:
+    std::unique_lock<std::mutex> first_;
+    std::unique_lock<std::mutex> second_;
+};
+
+int32_t decode_batch(ModelContext* ctx, llama_batch batch) {
+    PoolComputeLock lock(ctx);
+    ctx->decode_epoch++;
+    return llama_decode(ctx->ctx, batch);
+}
+
+int32_t encode_batch(ModelContext* ctx, llama_batch batch) {
+    PoolComputeLock lock(ctx);
+    ctx->decode_epoch++;
+    return llama_encode(ctx->ctx, batch);
+}
+
+/**
+ * Drop KV cache state so a stateless request starts at position 0. The
+ * sequences of live sessions are kept.
+ */
+void reset_context(ModelContext* ctx) {
+    llama_memory_t mem = llama_get_memory(ctx->ctx);
+    if (ctx->session_count == 0) {
+        llama_memory_clear(mem, true);
+        return;
+    }
+    for (llama_seq_id seq = 0; seq < kMaxSequences; seq++) {
+        if (!ctx->sessions[seq]) {
+            llama_memory_seq_rm(mem, seq, -1, -1);
+        }
+    }
+}
+
+/** Sequences not held by a session, starting with 0. Call with ctx->mutex held. */
+std::vector<llama_seq_id> free_sequences(const ModelContext* ctx) {
+    std::vector<llama_seq_id> seqs;
+    for (llama_seq_id seq = 0; seq < kMaxSequences; seq++) {
+        if (!ctx->sessions[seq]) {
+            seqs.push_back(seq);
+        }
+    }
+    return seqs;
+}
+
+/** KV cells held by sessions, unavailable to stateless requests. */
+int32_t session_cells(const ModelContext* ctx) {
+    int32_t cells = 0;
+    for (const auto& session : ctx->sessions) {
+        if (session && session->context_generation == ctx->context_generation) {
+            cells += static_cast<int32_t>(session->tokens.size());
+        }
+    }
+    return cells;
+}
+
+/** Bumped whenever the layout of a prefix cache file changes. */
+const uint32_t PREFIX_CACHE_VERSION = 1;
+
+const char PREFIX_CACHE_MAGIC[4] = {'D', 'L', 'P', 'C'};
+
+/** Uses before a prefix is stored when dartllm_set_prefix_cache() gets 0. */
+constexpr int32_t kDefaultPrefixMinUses = 2;
+
+/** Prefix use counts kept per model before they start over. */
+constexpr size_t kMaxPrefixCounts = 4096;
+
+/**
+ * Prefix cache file layout: this header, the prefix tokens, then the
+ * llama.cpp state of the sequence holding them. The tokens are stored so
+ * a key collision reads as a miss.
+ */
+struct PrefixFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t model_key;
+    int32_t token_count;
+    int32_t reserved;
+    uint64_t state_size;
+};
+
+uint64_t mix_prefix_token(uint64_t hash, llama_token token) {
+    return dartllm::fnv1a_int(static_cast<uint32_t>(token), 4, hash);
+}
+
+/** A whole file mapped read-only, or read into memory where mmap is unavailable. */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#if !defined(_WIN32)
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                data_ = static_cast<const uint8_t*>(addr);
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        close(fd);
+#else
+        std::ifstream file(path, std::ios::binary);
+        buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data_ = reinterpret_cast<const uint8_t*>(buffer_.data());
+        size_ = buffer_.size();
+#endif
+    }
+
+    ~MappedFile() {
+#if !defined(_WIN32)
+        if (data_) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    std::vector<char> buffer_;
+#endif
+};
+
+/**
+ * Restore the stored state after the first `length` prompt tokens into
+ * sequence 0, which must be empty. The state is read straight from the
+ * mapped file. Call with ctx->mutex held.
+ */
+bool load_prefix(ModelContext* ctx, const std::string& key, const llama_token* tokens, int32_t length) {
+    PrefixStore* store = ctx->prefix_store.get();
+    {
+        std::lock_guard<std::mutex> lock(store->mutex);
+        if (!store->entries.count(key)) return false;
+    }
+
+    MappedFile file(dartllm::prefix_file(*store, key));
+    const size_t tokens_bytes = static_cast<size_t>(length) * sizeof(llama_token);
+
+    PrefixFileHeader header;
+    bool valid = file.size() >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, file.data(), sizeof(header));
+        valid = std::memcmp(header.magic, PREFIX_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+                header.version == PREFIX_CACHE_VERSION &&
+                header.model_key == ctx->prefix_model_key &&
+                header.token_count == length &&
+                file.size() == sizeof(header) + tokens_bytes + header.state_size;
+    }
+    if (valid && std::memcmp(file.data() + sizeof(header), tokens, tokens_bytes) != 0) {
+        // Another prefix with the same key; leave its entry alone.
+        return false;
+    }
+
+    const uint8_t* state = valid ? file.data() + sizeof(header) + tokens_bytes : nullptr;
+    if (valid && llama_state_seq_set_data(ctx->ctx, state, header.state_size, 0) != 0) {
+        std::lock_guard<std::mutex> lock(store->mutex);
+        dartllm::touch_prefix(store, key);
+        return true;
+    }
+
+    // Unreadable or written for an incompatible context: drop it.
+    llama_memory_seq_rm(llama_get_memory(ctx->ctx), 0, -1, -1);
+    std::lock_guard<std::mutex> lock(store->mutex);
+    dartllm::drop_prefix(store, key);
+    return false;
+}
+
+/**
+ * Store the state of sequence 0, which holds exactly the first `length`
+ * prompt tokens, evicting older prefixes to stay within the budget.
+ * Call with ctx->mutex held.
+ */
+void save_prefix(ModelContext* ctx, const std::string& key, const llama_token* tokens, int32_t length) {
+    PrefixStore* store = ctx->prefix_store.get();
+    const size_t state_size = llama_state_seq_get_size(ctx->ctx, 0);
+    const size_t tokens_bytes = static_cast<size_t>(length) * sizeof(llama_token);
+    const int64_t file_bytes = static_cast<int64_t>(sizeof(PrefixFileHeader) + tokens_bytes + state_size);
+    {
+        std::lock_guard<std::mutex> lock(store->mutex);
+        if (state_size == 0 || file_bytes > store->budget_bytes || store->entries.count(key)) {
+            return;
+        }
+    }
+
+    std::vector<uint8_t> state(state_size);
+    if (llama_state_seq_get_data(ctx->ctx, state.data(), state_size, 0) != state_size) {
+        return;
+    }
+
+    PrefixFileHeader header = {};
+    std::memcpy(header.magic, PREFIX_CACHE_MAGIC, sizeof(header.magic));
+    header.version = PREFIX_CACHE_VERSION;
+    header.model_key = ctx->prefix_model_key;
+    header.token_count = length;
+    header.state_size = state_size;
+
+    // Write beside the final name and rename so readers never see a partial
+    // file. Models sharing the store write distinct temporary files.
+    const std::string path = dartllm::prefix_file(*store, key);
+    const std::string temp_path = path + ".tmp" + std::to_string(reinterpret_cast<uintptr_t>(ctx));
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file) return;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(tokens), static_cast<std::streamsize>(tokens_bytes));
+        file.write(reinterpret_cast<const char*>(state.data()), static_cast<std::streamsize>(state_size));
+        if (!file) {
+            file.close();
+            std::remove(temp_path.c_str());
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(store->mutex);
+    if (store->entries.count(key)) {
+        std::remove(temp_path.c_str());
+        return;
+    }
+    dartllm::evict_prefixes(store, file_bytes);
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return;
+    }
+    dartllm::add_prefix(store, key, file_bytes);
+}
+
+/**
+ * Decode a stateless request's prompt into sequence 0 after
+ * reset_context(). With a prefix cache set, the longest stored prefix is
+ * restored instead of decoded, and the longest prefix that has now been
+ * seen prefix_min_uses times is stored on the way. Prefixes end on a
+ * DARTLLM_PREFIX_BLOCK boundary before the last prompt token, which is
+ * always decoded so its logits are current. Call with ctx->mutex held.
+ */
+bool decode_prompt(ModelContext* ctx, const int32_t* prompt_tokens, int32_t prompt_length) {
+    std::vector<llama_token> prompt(prompt_tokens, prompt_tokens + prompt_length);
+    const int32_t blocks = (prompt_length - 1) / DARTLLM_PREFIX_BLOCK;
+    PrefixStore* store = ctx->prefix_store.get();
+
+    // Adapters change the KV state, which the keys do not cover.
+    if (!store || ctx->lora_applied || blocks == 0) {
+        return decode_batch(ctx, llama_batch_get_one(prompt.data(), prompt_length)) == 0;
+    }
+
+    std::vector<std::string> keys;
+    uint64_t hash = ctx->prefix_model_key;
+    for (int32_t b = 0; b < blocks; b++) {
+        for (int32_t i = b * DARTLLM_PREFIX_BLOCK; i < (b + 1) * DARTLLM_PREFIX_BLOCK; i++) {
+            hash = mix_prefix_token(hash, prompt[i]);
+        }
+        char key[17];
+        std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+        keys.push_back(key);
+    }
+
+    int32_t start = 0;
+    for (int32_t b = blocks - 1; b >= 0; b--) {
+        if (load_prefix(ctx, keys[b], prompt.data(), (b + 1) * DARTLLM_PREFIX_BLOCK)) {
+            start = (b + 1) * DARTLLM_PREFIX_BLOCK;
+            break;
+        }
+    }
+
+    if (ctx->prefix_uses.size() + blocks > kMaxPrefixCounts) {
+        ctx->prefix_uses.clear();
+    }
+    int32_t save_block = -1;
+    for (int32_t b = 0; b < blocks; b++) {
+        int32_t uses = ++ctx->prefix_uses[keys[b]];
+        if ((b + 1) * DARTLLM_PREFIX_BLOCK > start && uses >= ctx->prefix_min_uses) {
+            save_block = b;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(store->mutex);
+        if (start > 0) {
+            store->hits++;
+            store->tokens_restored += start;
+        } else {
+            store->misses++;
+        }
+        if (save_block >= 0 && store->entries.count(keys[save_block])) {
+            save_block = -1;
+        }
+    }
+
+    if (save_block >= 0) {
+        const int32_t save_at = (save_block + 1) * DARTLLM_PREFIX_BLOCK;
+        if (decode_batch(ctx, llama_batch_get_one(prompt.data() + start, save_at - start)) != 0) {
+            return false;
+        }
+        save_prefix(ctx, keys[save_block], prompt.data(), save_at);
+        // Count again before retrying a prefix that did not fit.
+        ctx->prefix_uses.erase(keys[save_block]);
+        start = save_at;
+    }
+
+    return decode_batch(ctx, llama_batch_get_one(prompt.data() + start, prompt_length - start)) == 0;
+}
+
+/** Whether `adapter` was loaded for the model. Call with ctx->lora_mutex held. */
+bool owns_lora(const ModelContext* ctx, const llama_adapter_lora* adapter) {
+    return std::find(ctx->lora_adapters.begin(), ctx->lora_adapters.end(), adapter) != ctx->lora_adapters.end();
+}
+
+/**
+ * Set a request's LoRA adapter (null for the base model) on the context.
+ * Adapters only scale tensors the graph reads, so switching does not
+ * touch the base weights. Call with ctx->mutex held.
+ */
+bool apply_lora(ModelContext* ctx, llama_adapter_lora* adapter, float scale) {
+    if (adapter) {
+        std::lock_guard<std::mutex> lock(ctx->lora_mutex);
+        if (!owns_lora(ctx, adapter)) {
+            set_error("LoRA adapter does not belong to this model");
+            return false;
+        }
+    }
+
+    if (adapter == ctx->lora_applied && (!adapter || scale == ctx->lora_applied_scale)) {
+        return true;
+    }
+
+    llama_clear_adapter_lora(ctx->ctx);
+    ctx->lora_applied = nullptr;
+    if (adapter && llama_set_adapter_lora(ctx->ctx, adapter, scale) != 0) {
+        set_error("Failed to apply LoRA adapter");
+        return false;
+    }
+
+    ctx->lora_applied = adapter;
+    ctx->lora_applied_scale = scale;
+    return true;
+}
+
+/**
+ * Most tokens a request for max_tokens can produce: decoding stops once
+ * the context is full. Call with ctx->mutex held.
+ */
+int32_t generate_capacity(ModelContext* ctx, int32_t max_tokens) {
+    return dartllm::generate_capacity(max_tokens, static_cast<int32_t>(llama_n_ctx(ctx->ctx)));
+}
+
+/**
+ * Shared body of the dartllm_generate*() functions. Writes up to
+ * max_tokens tokens, and never more than the context holds, to
+ * `out_tokens` and returns how many, or -1 on failure. When `logprobs` is
+ * non-null, 1 + top_n entries are appended per token. Call with
+ * ctx->mutex held.
+ */
+int32_t run_generate(
+    ModelContext* ctx,
+    const int32_t* prompt_tokens,
+    int32_t prompt_length,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    int32_t seed,
+    llama_adapter_lora* lora,
+    float lora_scale,
+    const RequestConstraints& constraints,
+    int32_t top_n,
+    std::vector<DartLLMTokenLogprob>* logprobs,
+    int32_t* out_tokens,
+    int32_t* out_finish_reason
+) {
+    if (!ctx->ctx) {
+        set_error("Model context is not available");
+        return -1;
+    }
+    if (!apply_lora(ctx, lora, lora_scale)) {
+        return -1;
+    }
+
+    configure_sampler(ctx, constraints, temperature, top_p, top_k, min_p, seed);
+    reset_context(ctx);
+
+    if (!decode_prompt(ctx, prompt_tokens, prompt_length)) {
+        set_error("Failed to process prompt");
+        return -1;
+    }
+
+    // Decoding fails once the context is full, so no more tokens than the
+    // context holds are produced or reserved.
+    const int32_t limit = generate_capacity(ctx, max_tokens);
+    if (logprobs) {
+        logprobs->reserve(static_cast<size_t>(limit) * (1 + top_n));
+    }
+    const int32_t n_vocab = llama_vocab_n_tokens(ctx->vocab);
+
+    int32_t count = 0;
+    int32_t finish_reason = 1;
+
+    for (int32_t i = 0; i < limit; i++) {
+        llama_token new_token = llama_sampler_sample(ctx->sampler, ctx->ctx, -1);
+
+        if (llama_vocab_is_eog(ctx->vocab, new_token)) {
+            finish_reason = 0;
+            break;
+        }
+
+        out_tokens[count++] = new_token;
+        if (logprobs) {
+            dartllm::collect_logprobs(llama_get_logits_ith(ctx->ctx, -1), n_vocab, new_token, top_n, logprobs);
+        }
+
+        llama_batch next_batch = llama_batch_get_one(&new_token, 1);
+
+        if (decode_batch(ctx, next_batch) != 0) {
+            finish_reason = 2;
+            break;
+        }
+    }
+
+    *out_finish_reason = finish_reason;
+    return count;
+}
+
+/**
+ * Allocate a DartLLMGenerateResult with room for every token run_generate()
+ * can produce for max_tokens, so it can write straight into it. Call with
+ * ctx->mutex held.
+ */
+DartLLMGenerateResult* alloc_generate_result(ModelContext* ctx, int32_t max_tokens) {
+    if (!ctx->ctx) {
+        set_error("Model context is not available");
+        return nullptr;
+    }
+    size_t capacity = static_cast<size_t>(generate_capacity(ctx, max_tokens));
+    auto* result = static_cast<DartLLMGenerateResult*>(
+        std::malloc(sizeof(DartLLMGenerateResult) + capacity * sizeof(int32_t)));
+    if (!result) {
+        set_error("Failed to allocate result");
+    }
+    return result;
+}
+
+/**
+ * Decode `count` tokens into the session's sequence after its resident
+ * tokens, in n_batch chunks, keeping logits for the last one only.
+ * Call with the owner's mutex held.
+ */
+bool session_decode(SessionContext* session, const llama_token* tokens, int32_t count) {
+    ModelContext* ctx = session->owner;
+    const int32_t n_ctx = static_cast<int32_t>(llama_n_ctx(ctx->ctx));
+    if (static_cast<int64_t>(session->tokens.size()) + count > n_ctx) {
+        set_error("Session exceeds the context size");
+        return false;
+    }
+
+    const int32_t n_batch = static_cast<int32_t>(llama_n_batch(ctx->ctx));
+    llama_batch batch = llama_batch_init(std::min(count, n_batch), 0, 1);
+    bool ok = true;
+    for (int32_t start = 0; start < count; start += n_batch) {
+        const int32_t chunk = std::min(n_batch, count - start);
+        const int32_t base = static_cast<int32_t>(session->tokens.size());
+        for (int32_t k = 0; k < chunk; k++) {
+            batch.token[k] = tokens[start + k];
+            batch.pos[k] = base + k;
+            batch.n_seq_id[k] = 1;
+            batch.seq_id[k][0] = session->seq;
+            batch.logits[k] = (start + k == count - 1) ? 1 : 0;
+        }
+        batch.n_tokens = chunk;
+
+        if (decode_batch(ctx, batch) != 0) {
+            set_error("Failed to decode session tokens");
+            ok = false;
+            break;
+        }
+        session->tokens.insert(session->tokens.end(), tokens + start, tokens + start + chunk);
+    }
+    llama_batch_free(batch);
+
+    if (ok) {
+        session->logits_epoch = ctx->decode_epoch;
+    }
+    return ok;
+}
+
+/**
+ * Re-decode a session's tokens if its model's context was recreated since
+ * they were decoded, e.g. after a registry released it.
+ * Call with the owner's mutex held.
+ */
+bool restore_session(SessionContext* session) {
+    ModelContext* ctx = session->owner;
+    if (!ctx->ctx) {
+        set_error("Model context is not available");
+        return false;
+    }
+    if (session->context_generation == ctx->context_generation) {
+        return true;
+    }
+
+    std::vector<llama_token> tokens;
+    tokens.swap(session->tokens);
+    session->context_generation = ctx->context_generation;
+    session->logits_epoch = 0;
+    return tokens.empty() || session_decode(session, tokens.data(), static_cast<int32_t>(tokens.size()));
+}
+
+/**
+ * Make the logits of the session's last token current before sampling,
+ * re-decoding that token if another request has decoded since.
+ * Call with the owner's mutex held.
+ */
+bool session_logits(SessionContext* session) {
+    if (!restore_session(session)) {
+        return false;
+    }
+    if (session->tokens.empty()) {
+        set_error("Session is empty");
+        return false;
+    }
+
+    ModelContext* ctx = session->owner;
+    if (session->logits_epoch == ctx->decode_epoch) {
+        return true;
+    }
+
+    const llama_token last = session->tokens.back();
+    session->tokens.pop_back();
+    llama_memory_seq_rm(llama_get_memory(ctx->ctx), session->seq,
+                        static_cast<llama_pos>(session->tokens.size()), -1);
+    return session_decode(session, &last, 1);
+}
+
+/**
+ * Run inference on `tokens` and write the embedding to `out` if it has room
+ * for the model's dimension. Returns the dimension, or -1 on failure.
+ */
+int32_t embed_tokens(
+    ModelContext* ctx,
+    const int32_t* tokens,
+    int32_t token_count,
+    int8_t normalize,
+    float* out,
+    int32_t capacity
+) {
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (!llama_model_has_encoder(ctx->model)) {
+        set_error("Model does not support embeddings");
+        return -1;
+    }
+
+    // Embeddings always come from the base model.
+    if (!apply_lora(ctx, nullptr, 0.0f)) {
+        return -1;
+    }
+
+    int32_t n_embd = llama_model_n_embd(ctx->model);
+    if (capacity < n_embd) {
+        return n_embd;
+    }
+
+    std::vector<llama_token> token_vec(tokens, tokens + token_count);
+    llama_batch batch = llama_batch_get_one(token_vec.data(), token_vec.size());
+
+    if (encode_batch(ctx, batch) != 0) {
+        set_error("Failed to encode tokens");
+        return -1;
+    }
+
+    float* embeddings = llama_get_embeddings(ctx->ctx);
+
+    if (!embeddings) {
+        set_error("Failed to get embeddings");
+        return -1;
+    }
+
+    std::memcpy(out, embeddings, n_embd * sizeof(float));
+
+    if (normalize) {
+        dartllm::l2_normalize(out, n_embd);
+    }
+
+    return n_embd;
+}
+
+/**
+ * Look up or parse a grammar. Hits move to the front of the model's cache;
+ * the least recently used entry is dropped once it is full. Returns nullptr
+ * and sets the error if the grammar does not parse.
+ */
+std::shared_ptr<CompiledGrammar> compile_grammar(ModelContext* ctx, int32_t kind, const std::string& source) {
+    uint64_t hash = dartllm::grammar_key(kind, source);
+    {
+        std::lock_guard<std::mutex> lock(ctx->grammar_mutex);
+        for (auto it = ctx->grammar_cache.begin(); it != ctx->grammar_cache.end(); ++it) {
+            if ((*it)->hash == hash && (*it)->kind == kind && (*it)->source == source) {
+                ctx->grammar_cache.splice(ctx->grammar_cache.begin(), ctx->grammar_cache, it);
+                return ctx->grammar_cache.front();
+            }
+        }
+    }
+
+    std::string gbnf = source;
+    if (kind == DARTLLM_GRAMMAR_JSON_SCHEMA) {
+        std::string error;
+        if (!dartllm::json_schema_to_grammar(source, &gbnf, &error)) {
+            set_error(error);
+            return nullptr;
+        }
+    }
+
+    // Parsing only reads the vocabulary, so it runs outside the lock.
+    auto compiled = std::make_shared<CompiledGrammar>();
+    compiled->hash = hash;
+    compiled->kind = kind;
+    compiled->source = source;
+    compiled->sampler = llama_sampler_init_grammar(ctx->vocab, gbnf.c_str(), "root");
+    if (!compiled->sampler) {
+        set_error("Failed to parse grammar");
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->grammar_mutex);
+    ctx->grammar_cache.push_front(compiled);
+    if (ctx->grammar_cache.size() > kGrammarCacheSize) {
+        ctx->grammar_cache.pop_back();
+    }
+    return compiled;
+}
+
+/**
+ * Check a request's constraints and look up its grammar, so errors are
+ * reported before anything is decoded. NULL constraints mean none. Returns
+ * 0 on success, -1 on invalid parameters or an out-of-range token, or -2
+ * if the grammar does not parse.
+ */
+int32_t resolve_constraints(ModelContext* ctx, const DartLLMConstraints* constraints, RequestConstraints* out) {
+    if (!constraints) {
+        return 0;
+    }
+    if ((constraints->grammar_kind != DARTLLM_GRAMMAR_GBNF &&
+         constraints->grammar_kind != DARTLLM_GRAMMAR_JSON_SCHEMA) ||
+        constraints->bias_count < 0 ||
+        (constraints->bias_count > 0 && (!constraints->bias_tokens || !constraints->biases))) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    const int32_t n_vocab = llama_vocab_n_tokens(ctx->vocab);
+    out->logit_bias.reserve(constraints->bias_count);
+    for (int32_t i = 0; i < constraints->bias_count; i++) {
+        const int32_t token = constraints->bias_tokens[i];
+        if (token < 0 || token >= n_vocab) {
+            set_error("Token out of range: " + std::to_string(token));
+            return -1;
+        }
+        out->logit_bias.push_back({token, constraints->biases[i]});
+    }
+
+    if (constraints->grammar && constraints->grammar[0] != '\0') {
+        out->grammar = compile_grammar(ctx, constraints->grammar_kind, constraints->grammar);
+        if (!out->grammar) {
+            return -2;
+        }
+    }
+    return 0;
+}
+
+/** Ask the kernel to start reading the model file into the page cache. */
+bool advise_model_file(const std::string& path) {
+#if !defined(_WIN32)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && st.st_size > 0;
+    if (ok) {
+        // Mapping the file ourselves and advising that mapping populates the
+        // same page cache pages llama.cpp's mapping faults on.
+        void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ok = addr != MAP_FAILED;
+        if (ok) {
+            madvise(addr, static_cast<size_t>(st.st_size), MADV_WILLNEED);
+            munmap(addr, static_cast<size_t>(st.st_size));
+        }
+    }
+    close(fd);
+    return ok;
+#else
+    (void)path;
+    return true;
+#endif
+}
+
+/**
+ * Read the model file sequentially so its pages are resident before the
+ * first request. Returns false on I/O error or cancellation.
+ */
+bool read_model_file(ModelContext* ctx) {
+    std::ifstream file(ctx->model_path, std::ios::binary);
+    if (!file) {
+        ctx->warmup_error = "Failed to open model file: " + ctx->model_path;
+        return false;
+    }
+
+    std::vector<char> buffer(4 * 1024 * 1024);
+    while (!ctx->warmup_cancel) {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        std::streamsize n = file.gcount();
+        if (n <= 0) break;
+        ctx->warmup_bytes_done += n;
+    }
+
+    if (file.bad()) {
+        ctx->warmup_error = "Failed to read model file: " + ctx->model_path;
+        return false;
+    }
+    return !ctx->warmup_cancel;
+}
+
+/**
+ * Decode a single token and discard it. This faults in every weight the
+ * forward pass touches and lets backends compile kernels and size their
+ * compute buffers ahead of the first real request.
+ */
+bool warmup_decode(ModelContext* ctx) {
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    if (!ctx->ctx) {
+        ctx->warmup_error = "Model context was released";
+        return false;
+    }
+
+    llama_token token = llama_vocab_bos(ctx->vocab);
+    if (token == LLAMA_TOKEN_NULL) {
+        token = 0;
+    }
+
+    reset_context(ctx);
+    llama_batch batch = llama_batch_get_one(&token, 1);
+    int32_t result = llama_model_has_encoder(ctx->model)
+        ? encode_batch(ctx, batch)
+        : decode_batch(ctx, batch);
+    reset_context(ctx);
+
+    if (result != 0) {
+        ctx->warmup_error = "Warm-up decode failed";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Create the llama_context and sampler for a loaded model from the settings
+ * stored on `ctx`, reattaching any shared threadpools.
+ */
+bool create_context(ModelContext* ctx, std::string* error) {
+    llama_context_params ctx_params = llama_context_default_params();
+    ctx_params.n_ctx = ctx->context_size;
+    ctx_params.n_batch = (ctx->batch_size <= 0) ? 512 : ctx->batch_size;
+    ctx_params.n_threads = ctx->n_threads;
+    ctx_params.n_threads_batch = ctx->n_threads_batch;
+    // Extra sequences share one KV cache for forked prompts; with a
+    // unified cache they cost no memory until used.
+    ctx_params.n_seq_max = kMaxSequences;
+    ctx_params.kv_unified = true;
+
+    ctx->ctx = llama_init_from_model(ctx->model, ctx_params);
+    if (!ctx->ctx) {
+        *error = "Failed to create context";
+        return false;
+    }
+    // Sessions decoded into the previous context must be restored.
+    ctx->context_generation++;
+
+    if (ctx->threadpool) {
+        llama_attach_threadpool(ctx->ctx, ctx->threadpool->pool, ctx->threadpool_batch->pool);
+        llama_set_n_threads(ctx->ctx, ctx->threadpool->n_threads, ctx->threadpool_batch->n_threads);
+    }
+
+    llama_sampler_chain_params sampler_params = llama_sampler_chain_default_params();
+    ctx->sampler = llama_sampler_chain_init(sampler_params);
+    return true;
+}
+
+/** Cancel a running warm-up and wait for its thread to exit. */
+void stop_warmup(ModelContext* ctx) {
+    ctx->warmup_cancel = true;
+    std::lock_guard<std::mutex> lock(ctx->warmup_mutex);
+    if (ctx->warmup_thread.joinable()) {
+        ctx->warmup_thread.join();
+    }
+}
+
+/**
+ * Free the llama_context and sampler but keep the weights loaded. The KV
+ * cache and compute buffers go; mmap'd weights stay mapped. Stop any
+ * warm-up first: its dummy decode runs on the context.
+ */
+void release_context(ModelContext* ctx) {
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    if (ctx->sampler) {
+        llama_sampler_free(ctx->sampler);
+        ctx->sampler = nullptr;
+    }
+    if (ctx->ctx) {
+        llama_free(ctx->ctx);
+        ctx->ctx = nullptr;
+    }
+    ctx->lora_applied = nullptr;
+}
+
+/** Load a model and create its context. Returns nullptr and sets `error` on failure. */
+std::unique_ptr<ModelContext> load_model_context(
+    const std::string& path,
+    int32_t context_size,
+    int32_t gpu_layers,
+    int32_t threads,
+    int32_t batch_size,
+    bool use_mmap,
+    std::string* error
+) {
+    auto model_ctx = std::make_unique<ModelContext>();
+    model_ctx->model_path = path;
+    model_ctx->batch_size = batch_size;
+
+    llama_model_params model_params = llama_model_default_params();
+    model_params.n_gpu_layers = (gpu_layers < 0) ? 999 : gpu_layers;
+    model_params.use_mmap = use_mmap;
+    model_ctx->use_mmap = use_mmap;
+
+    model_ctx->model = llama_model_load_from_file(path.c_str(), model_params);
+    if (!model_ctx->model) {
+        *error = "Failed to load model from: " + path;
+        return nullptr;
+    }
+
+    model_ctx->vocab = llama_model_get_vocab(model_ctx->model);
+
+    int32_t model_ctx_size = llama_model_n_ctx_train(model_ctx->model);
+    if (context_size <= 0) {
+        context_size = model_ctx_size;
+    }
+    model_ctx->context_size = std::min(context_size, model_ctx_size);
+
+    if (threads <= 0) {
+        dartllm::ThreadPlan plan = default_thread_plan(model_ctx->model_path);
+        model_ctx->n_threads = plan.decode_threads;
+        model_ctx->n_threads_batch = plan.prefill_threads;
+    } else {
+        model_ctx->n_threads = threads;
+        model_ctx->n_threads_batch = threads;
+    }
+
+    if (!create_context(model_ctx.get(), error)) {
+        return nullptr;
+    }
+
+    return model_ctx;
+}
+
+void run_warmup(ModelContext* ctx, int32_t mode) {
+    bool ok = true;
+
+    if (ctx->use_mmap && (mode & DARTLLM_WARMUP_ADVISE) && !(mode & DARTLLM_WARMUP_READ)) {
+        ok = advise_model_file(ctx->model_path);
+        if (!ok) {
+            ctx->warmup_error = "Failed to map model file: " + ctx->model_path;
+        }
+    }
+
+    if (ok && ctx->use_mmap && (mode & DARTLLM_WARMUP_READ)) {
+        ok = read_model_file(ctx);
+    }
+
+    if (ok && !ctx->warmup_cancel && (mode & DARTLLM_WARMUP_DECODE)) {
+        ok = warmup_decode(ctx);
+        ctx->warmup_decoded = ok;
+    }
+
+    if (ctx->warmup_cancel) {
+        ctx->warmup_state = DARTLLM_WARMUP_CANCELLED;
+    } else {
+        ctx->warmup_state = ok ? DARTLLM_WARMUP_DONE : DARTLLM_WARMUP_FAILED;
+    }
+}
+
+/** A model registered with a ModelRegistry. */
+struct RegistryEntry {
+    std::string id;
+    std::string path;
+    int32_t context_size = 0;
+    int32_t gpu_layers = 0;
+    int32_t threads = 0;
+    int32_t batch_size = 0;
+    bool use_mmap = true;
+
+    /** Estimated bytes while resident. */
+    int64_t cost_bytes = 0;
+
+    /** Loaded model, or null. Warm models keep their weights but no context. */
+    std::unique_ptr<ModelContext> model;
+    bool warm = false;
+
+    /** A thread is loading or reviving this entry outside the registry lock. */
+    bool loading = false;
+
+    int32_t refs = 0;
+    uint64_t last_used = 0;
+
+    /** Only mmap'd CPU weights are cheap to keep: their pages are reclaimable. */
+    bool can_stay_warm() const {
+        return use_mmap && gpu_layers == 0;
+    }
+};
+
+/** Opaque handle returned by dartllm_registry_create(). */
+struct ModelRegistry {
+    std::mutex mutex;
+    std::condition_variable load_finished;
+
+    int64_t budget_bytes = 0;
+    int32_t max_warm_models = 0;
+    int64_t resident_bytes = 0;
+    uint64_t clock = 0;
+
+    std::map<std::string, std::unique_ptr<RegistryEntry>> entries;
+    std::map<const ModelContext*, RegistryEntry*> by_handle;
+
+    int64_t hits = 0;
+    int64_t warm_hits = 0;
+    int64_t loads = 0;
+    int64_t evictions = 0;
+};
+
+/**
+ * Take an entry's model out of the registry. Models are handed back to the
+ * caller so they can be freed after the registry lock is released.
+ */
+void unload_entry(
+    ModelRegistry* registry,
+    RegistryEntry* entry,
+    std::vector<std::unique_ptr<ModelContext>>* freed
+) {
+    registry->by_handle.erase(entry->model.get());
+    freed->push_back(std::move(entry->model));
+    entry->warm = false;
+}
+
+/**
+ * Describe the registry's entries for the eviction policy. `entries`
+ * receives the entry of each slot.
+ */
+std::vector<dartllm::ResidencySlot> residency_slots(
+    ModelRegistry* registry,
+    std::vector<RegistryEntry*>* entries
+) {
+    std::vector<dartllm::ResidencySlot> slots;
+    for (auto& pair : registry->entries) {
+        RegistryEntry* entry = pair.second.get();
+        dartllm::ResidencySlot slot;
+        slot.cost_bytes = entry->cost_bytes;
+        slot.last_used = entry->last_used;
+        slot.resident = entry->model && !entry->warm;
+        slot.warm = entry->model && entry->warm;
+        slot.busy = entry->loading || entry->refs > 0;
+        slots.push_back(slot);
+        entries->push_back(entry);
+    }
+    return slots;
+}
+
+/** Fully unload the least recently used warm models beyond the warm limit. */
+void trim_warm_models(ModelRegistry* registry, std::vector<std::unique_ptr<ModelContext>>* freed) {
+    std::vector<RegistryEntry*> entries;
+    std::vector<dartllm::ResidencySlot> slots = residency_slots(registry, &entries);
+    for (int32_t i : dartllm::plan_warm_trim(slots, registry->max_warm_models)) {
+        unload_entry(registry, entries[i], freed);
+    }
+}
+
+/** Evict a resident idle entry, keeping it warm when possible. */
+void evict_entry(
+    ModelRegistry* registry,
+    RegistryEntry* entry,
+    std::vector<std::unique_ptr<ModelContext>>* freed
+) {
+    registry->resident_bytes -= entry->cost_bytes;
+    registry->evictions++;
+
+    if (registry->max_warm_models > 0 && entry->can_stay_warm()) {
+        stop_warmup(entry->model.get());
+        release_context(entry->model.get());
+        entry->warm = true;
+        trim_warm_models(registry, freed);
+    } else {
+        unload_entry(registry, entry, freed);
+    }
+}
+
+/**
+ * Evict least recently used idle models until `needed` more bytes fit in
+ * the budget. Returns false, evicting nothing, if they cannot fit even
+ * with all idle models evicted.
+ */
+bool make_room(
+    ModelRegistry* registry,
+    const RegistryEntry* target,
+    int64_t needed,
+    std::vector<std::unique_ptr<ModelContext>>* freed
+) {
+    std::vector<RegistryEntry*> entries;
+    std::vector<dartllm::ResidencySlot> slots = residency_slots(registry, &entries);
+    int32_t target_slot = -1;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i] == target) target_slot = static_cast<int32_t>(i);
+    }
+
+    std::vector<int32_t> victims;
+    if (!dartllm::plan_evictions(slots, target_slot, registry->resident_bytes, needed,
+                                 registry->budget_bytes, &victims)) {
+        return false;
+    }
+    for (int32_t i : victims) {
+        evict_entry(registry, entries[i], freed);
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+extern "C" {
+
+DARTLLM_API int32_t dartllm_init(void) {
+    std::lock_guard<std::mutex> lock(g_init_mutex);
+
+    if (g_initialized) {
+        return 0;
+    }
+
+    ggml_backend_load_all();
+    g_initialized = true;
+    clear_error();
+
+    return 0;
+}
+
+DARTLLM_API const char* dartllm_version(void) {
+    return VERSION;
+}
+
+DARTLLM_API const char* dartllm_llama_version(void) {
+    return "unknown";
+}
+
+DARTLLM_API void* dartllm_load_model(
+    const char* path,
+    int32_t context_size,
+    int32_t gpu_layers,
+    int32_t threads,
+    int32_t batch_size,
+    int8_t use_mmap
+) {
+    if (!g_initialized) {
+        set_error("Library not initialized. Call dartllm_init() first.");
+        return nullptr;
+    }
+
+    if (!path) {
+        set_error("Model path is null");
+        return nullptr;
+    }
+
+    clear_error();
+
+    std::string error;
+    std::unique_ptr<ModelContext> model_ctx = load_model_context(
+        path, context_size, gpu_layers, threads, batch_size, use_mmap != 0, &error);
+    if (!model_ctx) {
+        set_error(error);
+        return nullptr;
+    }
+
+    return model_ctx.release();
+}
+
+DARTLLM_API int32_t dartllm_get_thread_config(void* model, DartLLMThreadConfig* out) {
+    if (!out) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    if (!model) {
+        dartllm::ThreadPlan plan = host_thread_plan();
+        fill_thread_config(out, plan.decode_threads, plan.prefill_threads, false);
+        return 0;
+    }
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    fill_thread_config(out, ctx->n_threads, ctx->n_threads_batch, ctx->threads_calibrated);
+    return 0;
+}
+
+DARTLLM_API int32_t dartllm_calibrate_threads(
+    void* model,
+    const char* cache_dir,
+    DartLLMThreadConfig* out
+) {
+    if (!model) {
+        set_error("Model handle is null");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (ctx->threadpool) {
+        set_error("Detach the threadpool before calibrating");
+        return -4;
+    }
+
+    std::string key = calibration_key(ctx->model_path);
+    dartllm::ThreadPlan best;
+
+    if (!find_calibration(key, cache_dir, &best)) {
+        using Clock = std::chrono::steady_clock;
+
+        const dartllm::CpuTopology& topology = host_topology();
+        dartllm::ThreadPlan base = host_thread_plan();
+        int32_t quota_cap = topology.cpu_quota > 0.0
+            ? std::max(1, static_cast<int32_t>(std::floor(topology.cpu_quota)))
+            : static_cast<int32_t>(topology.cpus.size());
+        if (host_thread_limit() > 0) {
+            quota_cap = std::min(quota_cap, host_thread_limit());
+        }
+
+        std::vector<int32_t> decode_candidates = {
+            std::max(1, base.decode_threads / 2),
+            std::max(1, base.decode_threads - 1),
+            base.decode_threads,
+            base.prefill_threads,
+        };
+        std::vector<int32_t> prefill_candidates = {
+            base.prefill_threads,
+            std::min(static_cast<int32_t>(topology.cpus.size()), quota_cap),
+        };
+        for (auto* list : {&decode_candidates, &prefill_candidates}) {
+            std::sort(list->begin(), list->end());
+            list->erase(std::unique(list->begin(), list->end()), list->end());
+        }
+
+        llama_token filler = llama_vocab_bos(ctx->vocab);
+        if (filler == LLAMA_TOKEN_NULL) filler = 0;
+
+        int32_t n_prompt = std::min<int32_t>(64, std::min<int32_t>(ctx->context_size / 2, llama_n_batch(ctx->ctx)));
+        const int32_t n_steps = 8;
+        if (n_prompt < 1 || ctx->context_size < n_prompt + n_steps + 1) {
+            set_error("Context too small for calibration");
+            return -2;
+        }
+
+        std::vector<llama_token> prompt(n_prompt, filler);
+        auto seconds_since = [](Clock::time_point start) {
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        // Prefill: time the whole prompt at each candidate batch thread count.
+        double best_prefill = 1e30;
+        best.prefill_threads = base.prefill_threads;
+        for (int32_t candidate : prefill_candidates) {
+            reset_context(ctx);
+            llama_set_n_threads(ctx->ctx, base.decode_threads, candidate);
+            Clock::time_point start = Clock::now();
+            if (decode_batch(ctx, llama_batch_get_one(prompt.data(), n_prompt)) != 0) {
+                reset_context(ctx);
+                llama_set_n_threads(ctx->ctx, ctx->n_threads, ctx->n_threads_batch);
+                set_error("Calibration decode failed");
+                return -3;
+            }
+            double elapsed = seconds_since(start);
+            if (elapsed < best_prefill) {
+                best_prefill = elapsed;
+                best.prefill_threads = candidate;
+            }
+        }
+
+        // Decode: reuse the last prompt and time single-token steps, rolling
+        // the KV cache back to the prompt after each candidate.
+        llama_memory_t mem = llama_get_memory(ctx->ctx);
+        double best_decode = 1e30;
+        best.decode_threads = base.decode_threads;
+        for (int32_t candidate : decode_candidates) {
+            llama_set_n_threads(ctx->ctx, candidate, best.prefill_threads);
+            llama_token token = filler;
+
+            // One untimed step absorbs thread start-up.
+            bool ok = decode_batch(ctx, llama_batch_get_one(&token, 1)) == 0;
+            Clock::time_point start = Clock::now();
+            for (int32_t step = 0; ok && step < n_steps; step++) {
+                ok = decode_batch(ctx, llama_batch_get_one(&token, 1)) == 0;
+            }
+            double elapsed = seconds_since(start);
+            llama_memory_seq_rm(mem, 0, n_prompt, -1);
+
+            if (!ok) {
+                reset_context(ctx);
+                llama_set_n_threads(ctx->ctx, ctx->n_threads, ctx->n_threads_batch);
+                set_error("Calibration decode failed");
+                return -3;
+            }
+            if (elapsed < best_decode) {
+                best_decode = elapsed;
+                best.decode_threads = candidate;
+            }
+        }
+
+        reset_context(ctx);
+        store_calibration(key, cache_dir, best);
+    }
+
+    ctx->n_threads = best.decode_threads;
+    ctx->n_threads_batch = best.prefill_threads;
+    ctx->threads_calibrated = true;
+    llama_set_n_threads(ctx->ctx, ctx->n_threads, ctx->n_threads_batch);
+
+    if (out) {
+        fill_thread_config(out, ctx->n_threads, ctx->n_threads_batch, true);
+    }
+    return 0;
+}
+
+DARTLLM_API void dartllm_threadpool_default_params(DartLLMThreadpoolParams* params) {
+    if (!params) return;
+
+    std::memset(params, 0, sizeof(DartLLMThreadpoolParams));
+    params->n_threads = 0;
+    params->cpu_list = nullptr;
+    params->priority = 0;
+    params->poll = 50;
+    params->strict_cpu = 0;
+}
+
+DARTLLM_API void* dartllm_threadpool_create(const DartLLMThreadpoolParams* params) {
+    if (!g_initialized) {
+        set_error("Library not initialized. Call dartllm_init() first.");
+        return nullptr;
+    }
+
+    DartLLMThreadpoolParams defaults;
+    if (!params) {
+        dartllm_threadpool_default_params(&defaults);
+        params = &defaults;
+    }
+
+    if (params->priority < -1 || params->priority > 3 || params->poll > 100) {
+        set_error("Invalid threadpool parameters");
+        return nullptr;
+    }
+
+    clear_error();
+
+    const dartllm::CpuTopology& topology = host_topology();
+    int32_t n_threads = params->n_threads;
+
+    ggml_threadpool_params tp_params = ggml_threadpool_params_default(1);
+    std::memset(tp_params.cpumask, 0, sizeof(tp_params.cpumask));
+
+    if (params->cpu_list && *params->cpu_list) {
+        int32_t n_cpus = dartllm::parse_cpu_mask(params->cpu_list, tp_params.cpumask, GGML_MAX_N_THREADS);
+        if (n_cpus <= 0) {
+            set_error("Invalid CPU list: " + std::string(params->cpu_list));
+            return nullptr;
+        }
+        if (n_threads <= 0) n_threads = n_cpus;
+    } else {
+        // Default: one thread pinned to each physical core, fastest first.
+        if (n_threads <= 0) n_threads = host_thread_plan().prefill_threads;
+        int32_t pinned = 0;
+        for (int32_t cpu : topology.core_cpu_ids) {
+            if (pinned >= n_threads) break;
+            if (cpu < GGML_MAX_N_THREADS) {
+                tp_params.cpumask[cpu] = true;
+                pinned++;
+            }
+        }
+    }
+
+    n_threads = std::min(n_threads, GGML_MAX_N_THREADS);
+    tp_params.n_threads = n_threads;
+    tp_params.prio = static_cast<ggml_sched_priority>(params->priority);
+    tp_params.poll = params->poll;
+    tp_params.strict_cpu = params->strict_cpu != 0;
+    tp_params.paused = false;
+
+    auto pool = std::make_shared<ThreadPool>();
+    pool->pool = ggml_threadpool_new(&tp_params);
+    if (!pool->pool) {
+        set_error("Failed to create threadpool");
+        return nullptr;
+    }
+    pool->n_threads = n_threads;
+
+    auto* handle = new ThreadPoolHandle();
+    handle->pool = std::move(pool);
+    return handle;
+}
+
+DARTLLM_API void dartllm_threadpool_free(void* pool) {
+    if (pool) {
+        delete static_cast<ThreadPoolHandle*>(pool);
+    }
+}
+
+DARTLLM_API int32_t dartllm_threadpool_n_threads(void* pool) {
+    if (!pool) {
+        set_error("Threadpool handle is null");
+        return -1;
+    }
+    return static_cast<ThreadPoolHandle*>(pool)->pool->n_threads;
+}
+
+DARTLLM_API int32_t dartllm_attach_threadpool(void* model, void* pool, void* pool_batch) {
+    if (!model || !pool) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    std::shared_ptr<ThreadPool> decode_pool = static_cast<ThreadPoolHandle*>(pool)->pool;
+    std::shared_ptr<ThreadPool> batch_pool = pool_batch
+        ? static_cast<ThreadPoolHandle*>(pool_batch)->pool
+        : decode_pool;
+
+    // A context computes on its own threads while no pool is attached, so
+    // only the previously attached pools need their compute locks here.
+    PoolComputeLock compute_lock(ctx);
+
+    llama_attach_threadpool(ctx->ctx, decode_pool->pool, batch_pool->pool);
+    llama_set_n_threads(ctx->ctx, decode_pool->n_threads, batch_pool->n_threads);
+
+    ctx->threadpool = std::move(decode_pool);
+    ctx->threadpool_batch = std::move(batch_pool);
+    return 0;
+}
+
+DARTLLM_API int32_t dartllm_detach_threadpool(void* model) {
+    if (!model) {
+        set_error("Model handle is null");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (!ctx->threadpool) {
+        return 0;
+    }
+
+    {
+        PoolComputeLock compute_lock(ctx);
+        llama_detach_threadpool(ctx->ctx);
+        llama_set_n_threads(ctx->ctx, ctx->n_threads, ctx->n_threads_batch);
+    }
+
+    ctx->threadpool.reset();
+    ctx->threadpool_batch.reset();
+    return 0;
+}
+
+DARTLLM_API void* dartllm_registry_create(int64_t budget_bytes, int32_t max_warm_models) {
+    if (budget_bytes < 0 || max_warm_models < 0) {
+        set_error("Invalid parameters");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* registry = new ModelRegistry();
+    registry->budget_bytes = budget_bytes;
+    registry->max_warm_models = max_warm_models;
+    return registry;
+}
+
+DARTLLM_API void dartllm_registry_free(void* registry) {
+    if (registry) {
+        delete static_cast<ModelRegistry*>(registry);
+    }
+}
+
+DARTLLM_API int32_t dartllm_registry_register(
+    void* registry,
+    const char* id,
+    const char* path,
+    int32_t context_size,
+    int32_t gpu_layers,
+    int32_t threads,
+    int32_t batch_size,
+    int8_t use_mmap
+) {
+    if (!registry || !id || !path) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    std::string error;
+    std::unique_ptr<dartllm::GgufFile> file = dartllm::GgufFile::open(path, &error);
+    if (!file) {
+        set_error(error);
+        return -1;
+    }
+
+    dartllm::MemoryEstimateParams params;
+    params.context_size = context_size;
+    params.batch_size = batch_size;
+
+    dartllm::MemoryEstimate estimate;
+    if (!dartllm::estimate_memory(*file, params, &estimate, &error)) {
+        set_error(error);
+        return -1;
+    }
+
+    auto entry = std::make_unique<RegistryEntry>();
+    entry->id = id;
+    entry->path = path;
+    entry->context_size = context_size;
+    entry->gpu_layers = gpu_layers;
+    entry->threads = threads;
+    entry->batch_size = batch_size;
+    entry->use_mmap = use_mmap != 0;
+    entry->cost_bytes = estimate.weights_bytes + estimate.kv_cache_bytes
+        + estimate.compute_bytes + estimate.output_bytes;
+
+    auto* reg = static_cast<ModelRegistry*>(registry);
+    std::lock_guard<std::mutex> lock(reg->mutex);
+    if (reg->entries.count(entry->id)) {
+        set_error("Model id already registered: " + entry->id);
+        return -2;
+    }
+    reg->entries[entry->id] = std::move(entry);
+    return 0;
+}
+
+DARTLLM_API int32_t dartllm_registry_unregister(void* registry, const char* id) {
+    if (!registry || !id) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* reg = static_cast<ModelRegistry*>(registry);
+    std::vector<std::unique_ptr<ModelContext>> freed;
+    {
+        std::lock_guard<std::mutex> lock(reg->mutex);
+        auto it = reg->entries.find(id);
+        if (it == reg->entries.end()) {
+            set_error("Unknown model id: " + std::string(id));
+            return -1;
+        }
+
+        RegistryEntry* entry = it->second.get();
+        if (entry->refs > 0 || entry->loading) {
+            set_error("Model is in use: " + std::string(id));
+            return -2;
+        }
+
+        if (entry->model) {
+            if (!entry->warm) {
+                reg->resident_bytes -= entry->cost_bytes;
+            }
+            unload_entry(reg, entry, &freed);
+        }
+        reg->entries.erase(it);
+    }
+    return 0;
+}
+
+DARTLLM_API void* dartllm_registry_acquire(void* registry, const char* id) {
+    if (!g_initialized) {
+        set_error("Library not initialized. Call dartllm_init() first.");
+        return nullptr;
+    }
+
+    if (!registry || !id) {
+        set_error("Invalid parameters");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* reg = static_cast<ModelRegistry*>(registry);
+    std::vector<std::unique_ptr<ModelContext>> freed;
+    std::unique_lock<std::mutex> lock(reg->mutex);
+
+    // Look the entry up again after each wait: it may be unregistered
+    // between another thread's load finishing and this one waking.
+    RegistryEntry* entry = nullptr;
+    while (true) {
+        auto it = reg->entries.find(id);
+        if (it == reg->entries.end()) {
+            set_error("Unknown model id: " + std::string(id));
+            return nullptr;
+        }
+        entry = it->second.get();
+        if (!entry->loading) break;
+        reg->load_finished.wait(lock);
+    }
+
+    if (entry->model && !entry->warm) {
+        reg->hits++;
+        entry->refs++;
+        entry->last_used = ++reg->clock;
+        return entry->model.get();
+    }
+
+    if (!make_room(reg, entry, entry->cost_bytes, &freed)) {
+        set_error("Model does not fit in the memory budget: " + entry->id);
+        lock.unlock();
+        return nullptr;
+    }
+
+    // Reserve the budget and load outside the lock so other models stay usable.
+    bool revive = entry->model != nullptr;
+    reg->resident_bytes += entry->cost_bytes;
+    entry->loading = true;
+    lock.unlock();
+    freed.clear();
+
+    std::string error;
+    std::unique_ptr<ModelContext> loaded;
+    bool ok;
+    if (revive) {
+        std::lock_guard<std::mutex> model_lock(entry->model->mutex);
+        ok = create_context(entry->model.get(), &error);
+    } else {
+        loaded = load_model_context(
+            entry->path, entry->context_size, entry->gpu_layers,
+            entry->threads, entry->batch_size, entry->use_mmap, &error);
+        ok = loaded != nullptr;
+    }
+
+    lock.lock();
+    entry->loading = false;
+    reg->load_finished.notify_all();
+
+    if (!ok) {
+        reg->resident_bytes -= entry->cost_bytes;
+        set_error(error);
+        return nullptr;
+    }
+
+    if (revive) {
+        reg->warm_hits++;
+        entry->warm = false;
+    } else {
+        reg->loads++;
+        entry->model = std::move(loaded);
+        reg->by_handle[entry->model.get()] = entry;
+    }
+    entry->refs++;
+    entry->last_used = ++reg->clock;
+    return entry->model.get();
+}
+
+DARTLLM_API int32_t dartllm_registry_release(void* registry, void* model) {
+    if (!registry || !model) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* reg = static_cast<ModelRegistry*>(registry);
+    std::lock_guard<std::mutex> lock(reg->mutex);
+
+    auto it = reg->by_handle.find(static_cast<ModelContext*>(model));
+    if (it == reg->by_handle.end() || it->second->refs <= 0) {
+        set_error("Model handle was not acquired from this registry");
+        return -1;
+    }
+
+    it->second->refs--;
+    it->second->last_used = ++reg->clock;
+    return 0;
+}
+
+DARTLLM_API int32_t dartllm_registry_stats(void* registry, DartLLMRegistryStats* out) {
+    if (!registry || !out) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    auto* reg = static_cast<ModelRegistry*>(registry);
+    std::lock_guard<std::mutex> lock(reg->mutex);
+
+    std::memset(out, 0, sizeof(DartLLMRegistryStats));
+    out->budget_bytes = reg->budget_bytes;
+    out->resident_bytes = reg->resident_bytes;
+    out->registered_models = static_cast<int32_t>(reg->entries.size());
+    for (const auto& pair : reg->entries) {
+        const RegistryEntry* entry = pair.second.get();
+        if (entry->model && entry->warm) {
+            out->warm_models++;
+        } else if (entry->model) {
+            out->resident_models++;
+        }
+        out->active_handles += entry->refs;
+    }
+    out->hits = reg->hits;
+    out->warm_hits = reg->warm_hits;
+    out->loads = reg->loads;
+    out->evictions = reg->evictions;
+    return 0;
+}
+
+DARTLLM_API void* dartllm_lora_load(void* model, const char* path) {
+    if (!model || !path) {
+        set_error("Invalid parameters");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    llama_adapter_lora* adapter = llama_adapter_lora_init(ctx->model, path);
+    if (!adapter) {
+        set_error("Failed to load LoRA adapter from: " + std::string(path));
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->lora_mutex);
+    ctx->lora_adapters.push_back(adapter);
+    return adapter;
+}
+
+DARTLLM_API int32_t dartllm_lora_free(void* model, void* adapter) {
+    if (!model || !adapter) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    auto* lora = static_cast<llama_adapter_lora*>(adapter);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    std::lock_guard<std::mutex> lora_lock(ctx->lora_mutex);
+
+    auto it = std::find(ctx->lora_adapters.begin(), ctx->lora_adapters.end(), lora);
+    if (it == ctx->lora_adapters.end()) {
+        set_error("LoRA adapter does not belong to this model");
+        return -1;
+    }
+
+    for (const auto& session : ctx->sessions) {
+        if (session && session->lora == lora) {
+            set_error("LoRA adapter is in use by a session");
+            return -2;
+        }
+    }
+    if (ctx->lora_applied == lora && ctx->ctx) {
+        llama_clear_adapter_lora(ctx->ctx);
+        ctx->lora_applied = nullptr;
+    }
+
+    llama_adapter_lora_free(lora);
+    ctx->lora_adapters.erase(it);
+    return 0;
+}
+
+DARTLLM_API int32_t dartllm_warmup(void* model, int32_t mode) {
+    const int32_t all_modes = DARTLLM_WARMUP_ADVISE | DARTLLM_WARMUP_READ | DARTLLM_WARMUP_DECODE;
+    if (mode == 0 || (mode & ~all_modes) != 0) {
+        set_error("Invalid warm-up mode: " + std::to_string(mode));
+        return -1;
+    }
+    if (!model) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    std::lock_guard<std::mutex> lock(ctx->warmup_mutex);
+
+    if (ctx->warmup_state == DARTLLM_WARMUP_RUNNING) {
+        set_error("Warm-up already running");
+        return -2;
+    }
+    if (ctx->warmup_thread.joinable()) {
+        ctx->warmup_thread.join();
+    }
+
+    // Only reads are metered: the kernel's read-ahead reports no progress.
+    int64_t total = 0;
+    if (ctx->use_mmap && (mode & DARTLLM_WARMUP_READ)) {
+        struct stat st;
+        if (stat(ctx->model_path.c_str(), &st) == 0) {
+            total = static_cast<int64_t>(st.st_size);
+        }
+    }
+
+    ctx->warmup_error.clear();
+    ctx->warmup_cancel = false;
+    ctx->warmup_decoded = false;
+    ctx->warmup_bytes_done = 0;
+    ctx->warmup_bytes_total = total;
+    ctx->warmup_mode = mode;
+    ctx->warmup_state = DARTLLM_WARMUP_RUNNING;
+
+    try {
+        ctx->warmup_thread = std::thread(run_warmup, ctx, mode);
+    } catch (const std::system_error& e) {
+        ctx->warmup_state = DARTLLM_WARMUP_FAILED;
+        set_error(std::string("Failed to start warm-up thread: ") + e.what());
+        return -1;
+    }
+
+    return 0;
+}
+
+DARTLLM_API int32_t dartllm_warmup_status(void* model, DartLLMWarmupStatus* out) {
+    if (!model || !out) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    std::memset(out, 0, sizeof(DartLLMWarmupStatus));
+    out->state = ctx->warmup_state;
+    out->mode = ctx->warmup_mode;
+    out->bytes_done = ctx->warmup_bytes_done;
+    out->bytes_total = ctx->warmup_bytes_total;
+    out->decoded = ctx->warmup_decoded ? 1 : 0;
+    return 0;
+}
+
+DARTLLM_API int32_t dartllm_warmup_wait(void* model) {
+    if (!model) {
+        set_error("Model handle is null");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    std::lock_guard<std::mutex> lock(ctx->warmup_mutex);
+    if (ctx->warmup_thread.joinable()) {
+        ctx->warmup_thread.join();
+    }
+
+    int32_t state = ctx->warmup_state;
+    if (state == DARTLLM_WARMUP_FAILED || state == DARTLLM_WARMUP_CANCELLED) {
+        set_error(state == DARTLLM_WARMUP_CANCELLED ? "Warm-up cancelled" : ctx->warmup_error);
+        return -1;
+    }
+    return 0;
+}
+
+DARTLLM_API void dartllm_free_model(void* model) {
+    if (model) {
+        delete static_cast<ModelContext*>(model);
+    }
+}
+
+DARTLLM_API DartLLMModelInfo* dartllm_get_model_info(void* model) {
+    if (!model) {
+        set_error("Model handle is null");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    auto* info = static_cast<DartLLMModelInfo*>(std::malloc(sizeof(DartLLMModelInfo)));
+    if (!info) {
+        set_error("Failed to allocate model info");
+        return nullptr;
+    }
+
+    std::memset(info, 0, sizeof(DartLLMModelInfo));
+
+    char meta_buf[256];
+    int32_t meta_len = llama_model_meta_val_str(ctx->model, "general.name", meta_buf, sizeof(meta_buf));
+    if (meta_len > 0) {
+        copy_string(info->name, sizeof(info->name), meta_buf);
+    } else {
+        copy_string(info->name, sizeof(info->name), file_basename(ctx->model_path));
+    }
+
+    meta_len = llama_model_meta_val_str(ctx->model, "general.architecture", meta_buf, sizeof(meta_buf));
+    if (meta_len > 0) {
+        copy_string(info->architecture, sizeof(info->architecture), meta_buf);
+    } else {
+        copy_string(info->architecture, sizeof(info->architecture), "unknown");
+    }
+
+    // general.quantization_version is the quantization format revision, not
+    // the file type; the file type is a llama_ftype number.
+    meta_len = llama_model_meta_val_str(ctx->model, "general.file_type", meta_buf, sizeof(meta_buf));
+    int64_t file_type = meta_len > 0 ? std::atoll(meta_buf) : -1;
+    copy_string(info->quantization, sizeof(info->quantization), dartllm::file_type_name(file_type));
+
+    info->parameter_count = llama_model_n_params(ctx->model);
+    info->context_size = ctx->context_size;
+    info->vocabulary_size = llama_vocab_n_tokens(ctx->vocab);
+    info->embedding_size = llama_model_n_embd(ctx->model);
+    info->layer_count = llama_model_n_layer(ctx->model);
+    info->head_count = llama_model_n_head(ctx->model);
+    info->file_size_bytes = llama_model_size(ctx->model);
+    info->supports_embedding = llama_model_has_encoder(ctx->model) ? 1 : 0;
+    info->supports_vision = 0;
+
+    std::vector<char> template_buf(4096);
+    int32_t template_len = llama_model_meta_val_str(
+        ctx->model,
+        "tokenizer.chat_template",
+        template_buf.data(),
+        template_buf.size()
+    );
+    if (template_len > 0) {
+        copy_string(info->chat_template, sizeof(info->chat_template), template_buf.data());
+    } else {
+        info->chat_template[0] = '\0';
+    }
+
+    return info;
+}
+
+DARTLLM_API DartLLMMemoryEstimate* dartllm_estimate_memory(
+    const char* path,
+    int32_t context_size,
+    int32_t batch_size,
+    int32_t type_k,
+    int32_t type_v
+) {
+    if (!path) {
+        set_error("Model path is null");
+        return nullptr;
+    }
+
+    clear_error();
+
+    std::string error;
+    std::unique_ptr<dartllm::GgufFile> file = dartllm::GgufFile::open(path, &error);
+    if (!file) {
+        set_error(error);
+        return nullptr;
+    }
+
+    dartllm::MemoryEstimateParams params;
+    params.context_size = context_size;
+    params.batch_size = batch_size;
+    params.type_k = type_k;
+    params.type_v = type_v;
+
+    dartllm::MemoryEstimate estimate;
+    if (!dartllm::estimate_memory(*file, params, &estimate, &error)) {
+        set_error(error);
+        return nullptr;
+    }
+
+    auto* result = static_cast<DartLLMMemoryEstimate*>(std::malloc(sizeof(DartLLMMemoryEstimate)));
+    if (!result) {
+        set_error("Failed to allocate memory estimate");
+        return nullptr;
+    }
+
+    std::memset(result, 0, sizeof(DartLLMMemoryEstimate));
+    result->weights_bytes = estimate.weights_bytes;
+    result->kv_cache_bytes = estimate.kv_cache_bytes;
+    result->compute_bytes = estimate.compute_bytes;
+    result->output_bytes = estimate.output_bytes;
+    result->total_bytes = estimate.weights_bytes + estimate.kv_cache_bytes
+        + estimate.compute_bytes + estimate.output_bytes;
+    result->context_size = estimate.context_size;
+    result->layer_count = estimate.layer_count;
+
+    return result;
+}
+
+DARTLLM_API DartLLMModelInfo* dartllm_probe_model(const char* path, const char* cache_dir) {
+    if (!path) {
+        set_error("Model path is null");
+        return nullptr;
+    }
+
+    clear_error();
+
+    std::string error;
+    std::shared_ptr<const ProbedModel> probe = probe_model(path, cache_dir, &error);
+    if (!probe) {
+        set_error(error);
+        return nullptr;
+    }
+
+    auto* info = static_cast<DartLLMModelInfo*>(std::malloc(sizeof(DartLLMModelInfo)));
+    if (!info) {
+        set_error("Failed to allocate model info");
+        return nullptr;
+    }
+
+    std::memcpy(info, &probe->info, sizeof(DartLLMModelInfo));
+    return info;
+}
+
+DARTLLM_API char* dartllm_probe_chat_template(const char* path, const char* cache_dir) {
+    if (!path) {
+        set_error("Model path is null");
+        return nullptr;
+    }
+
+    clear_error();
+
+    std::string error;
+    std::shared_ptr<const ProbedModel> probe = probe_model(path, cache_dir, &error);
+    if (!probe) {
+        set_error(error);
+        return nullptr;
+    }
+
+    auto* result = static_cast<char*>(std::malloc(probe->chat_template.size() + 1));
+    if (!result) {
+        set_error("Failed to allocate chat template");
+        return nullptr;
+    }
+
+    std::memcpy(result, probe->chat_template.c_str(), probe->chat_template.size() + 1);
+    return result;
+}
+
+DARTLLM_API int32_t* dartllm_tokenize(
+    void* model,
+    const char* text,
+    int8_t add_special,
+    int32_t* out_length
+) {
+    if (!model || !text || !out_length) {
+        set_error("Invalid parameters");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    size_t text_len = std::strlen(text);
+
+    int32_t n_tokens = -llama_tokenize(ctx->vocab, text, text_len, nullptr, 0, add_special != 0, true);
+
+    if (n_tokens <= 0) {
+        set_error("Tokenization failed");
+        return nullptr;
+    }
+
+    auto* result = static_cast<int32_t*>(std::malloc(n_tokens * sizeof(int32_t)));
+    if (!result) {
+        set_error("Failed to allocate token array");
+        return nullptr;
+    }
+
+    int32_t actual = llama_tokenize(ctx->vocab, text, text_len, result, n_tokens, add_special != 0, true);
+
+    if (actual < 0) {
+        std::free(result);
+        set_error("Tokenization failed");
+        return nullptr;
+    }
+
+    *out_length = actual;
+    return result;
+}
+
+DARTLLM_API int32_t dartllm_tokenize_into(
+    void* model,
+    const char* text,
+    int8_t add_special,
+    int32_t* out_tokens,
+    int32_t capacity
+) {
+    if (capacity < 0 || (capacity > 0 && !out_tokens)) {
+        set_error("Invalid output buffer");
+        return -1;
+    }
+    if (!model || !text) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    int32_t n_tokens = llama_tokenize(ctx->vocab, text, std::strlen(text), out_tokens, capacity,
+                                      add_special != 0, true);
+
+    // A negative count is the size the buffer needs to be.
+    return n_tokens < 0 ? -n_tokens : n_tokens;
+}
+
+DARTLLM_API char* dartllm_detokenize(
+    void* model,
+    const int32_t* tokens,
+    int32_t token_count
+) {
+    if (!model || !tokens || token_count <= 0) {
+        set_error("Invalid parameters");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+
+    std::string result;
+    result.reserve(token_count * 8);
+
+    for (int32_t i = 0; i < token_count; i++) {
+        char buf[256];
+        int32_t n = llama_token_to_piece(ctx->vocab, tokens[i], buf, sizeof(buf), 0, true);
+        if (n > 0) {
+            result.append(buf, n);
+        }
+    }
+
+    char* output = static_cast<char*>(std::malloc(result.length() + 1));
+    if (!output) {
+        set_error("Failed to allocate output string");
+        return nullptr;
+    }
+
+    std::memcpy(output, result.c_str(), result.length() + 1);
+    return output;
+}
+
+DARTLLM_API char* dartllm_get_chat_template(void* model) {
+    if (!model) {
+        set_error("Model handle is null");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    const char* tmpl = llama_model_chat_template(ctx->model, nullptr);
+    if (!tmpl) {
+        set_error("Model has no chat template");
+        return nullptr;
+    }
+
+    size_t length = std::strlen(tmpl);
+    auto* result = static_cast<char*>(std::malloc(length + 1));
+    if (!result) {
+        set_error("Failed to allocate string");
+        return nullptr;
+    }
+
+    std::memcpy(result, tmpl, length + 1);
+    return result;
+}
+
+DARTLLM_API char* dartllm_apply_chat_template(
+    void* model,
+    const char* const* roles,
+    const char* const* contents,
+    int32_t message_count,
+    int32_t previous_count,
+    int8_t add_generation_prompt,
+    int32_t* out_prefix_length
+) {
+    if (!model || message_count < 0 || (message_count > 0 && (!roles || !contents)) ||
+        previous_count < 0 || previous_count > message_count) {
+        set_error("Invalid parameters");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    const char* tmpl = llama_model_chat_template(ctx->model, nullptr);
+    if (!tmpl) {
+        set_error("Model has no chat template");
+        return nullptr;
+    }
+
+    std::vector<llama_chat_message> messages(message_count);
+    size_t content_bytes = 0;
+    for (int32_t i = 0; i < message_count; i++) {
+        if (!roles[i] || !contents[i]) {
+            set_error("Invalid parameters");
+            return nullptr;
+        }
+        messages[i] = {roles[i], contents[i]};
+        content_bytes += std::strlen(contents[i]);
+    }
+
+    // Renders into buf, growing it once if the first guess is too small.
+    std::vector<char> buf(content_bytes * 2 + 256);
+    auto render = [&](int32_t count, bool add_ass) -> int32_t {
+        int32_t length = llama_chat_apply_template(tmpl, messages.data(), count, add_ass,
+                                                   buf.data(), static_cast<int32_t>(buf.size()));
+        if (length > static_cast<int32_t>(buf.size())) {
+            buf.resize(length);
+            length = llama_chat_apply_template(tmpl, messages.data(), count, add_ass,
+                                               buf.data(), static_cast<int32_t>(buf.size()));
+        }
+        return length;
+    };
+
+    std::string previous;
+    if (previous_count > 0) {
+        int32_t length = render(previous_count, false);
+        if (length < 0) {
+            set_error("Unsupported chat template");
+            return nullptr;
+        }
+        previous.assign(buf.data(), length);
+    }
+
+    int32_t length = render(message_count, add_generation_prompt != 0);
+    if (length < 0) {
+        set_error("Unsupported chat template");
+        return nullptr;
+    }
+
+    // Only skip the earlier turns if they render identically as a prefix.
+    int32_t prefix = static_cast<int32_t>(dartllm::chat_delta_prefix(previous, buf.data(), length));
+
+    auto* result = static_cast<char*>(std::malloc(length - prefix + 1));
+    if (!result) {
+        set_error("Failed to allocate string");
+        return nullptr;
+    }
+
+    std::memcpy(result, buf.data() + prefix, length - prefix);
+    result[length - prefix] = '\0';
+    if (out_prefix_length) {
+        *out_prefix_length = prefix;
+    }
+    return result;
+}
+
+DARTLLM_API DartLLMGenerateResult* dartllm_generate(
+    void* model,
+    const int32_t* prompt_tokens,
+    int32_t prompt_length,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    float repetition_penalty,
+    int32_t seed,
+    void* lora,
+    float lora_scale,
+    const DartLLMConstraints* constraints
+) {
+    (void)repetition_penalty;
+
+    if (!model || !prompt_tokens || prompt_length <= 0) {
+        set_error("Invalid parameters");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    RequestConstraints request;
+    if (resolve_constraints(ctx, constraints, &request) != 0) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    DartLLMGenerateResult* result = alloc_generate_result(ctx, max_tokens);
+    if (!result) {
+        return nullptr;
+    }
+
+    result->token_count = run_generate(ctx, prompt_tokens, prompt_length, max_tokens,
+                                       temperature, top_p, top_k, min_p, seed,
+                                       static_cast<llama_adapter_lora*>(lora), lora_scale, request, 0, nullptr,
+                                       result->tokens, &result->finish_reason);
+    if (result->token_count < 0) {
+        std::free(result);
+        return nullptr;
+    }
+    return result;
+}
+
+DARTLLM_API int32_t dartllm_generate_into(
+    void* model,
+    const int32_t* prompt_tokens,
+    int32_t prompt_length,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    float repetition_penalty,
+    int32_t seed,
+    void* lora,
+    float lora_scale,
+    const DartLLMConstraints* constraints,
+    int32_t* out_tokens,
+    int32_t* out_finish_reason
+) {
+    (void)repetition_penalty;
+
+    if (!model || !prompt_tokens || prompt_length <= 0 || !out_tokens || !out_finish_reason) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    RequestConstraints request;
+    if (resolve_constraints(ctx, constraints, &request) != 0) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    return run_generate(ctx, prompt_tokens, prompt_length, max_tokens,
+                        temperature, top_p, top_k, min_p, seed,
+                        static_cast<llama_adapter_lora*>(lora), lora_scale, request, 0, nullptr,
+                        out_tokens, out_finish_reason);
+}
+
+DARTLLM_API DartLLMGenerateResult* dartllm_generate_logprobs(
+    void* model,
+    const int32_t* prompt_tokens,
+    int32_t prompt_length,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    float repetition_penalty,
+    int32_t seed,
+    void* lora,
+    float lora_scale,
+    const DartLLMConstraints* constraints,
+    int32_t top_n,
+    DartLLMTokenLogprob** out_logprobs
+) {
+    (void)repetition_penalty;
+
+    if (max_tokens < 0) {
+        set_error("max_tokens must not be negative");
+        return nullptr;
+    }
+    if (top_n < 0 || top_n > DARTLLM_MAX_TOP_LOGPROBS) {
+        set_error("top_n must be between 0 and " + std::to_string(DARTLLM_MAX_TOP_LOGPROBS));
+        return nullptr;
+    }
+    if (!model || !prompt_tokens || prompt_length <= 0 || !out_logprobs) {
+        set_error("Invalid parameters");
+        return nullptr;
+    }
+
+    clear_error();
+    *out_logprobs = nullptr;
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    RequestConstraints request;
+    if (resolve_constraints(ctx, constraints, &request) != 0) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    DartLLMGenerateResult* result = alloc_generate_result(ctx, max_tokens);
+    if (!result) {
+        return nullptr;
+    }
+
+    std::vector<DartLLMTokenLogprob> logprobs;
+    result->token_count = run_generate(ctx, prompt_tokens, prompt_length, max_tokens,
+                                       temperature, top_p, top_k, min_p, seed,
+                                       static_cast<llama_adapter_lora*>(lora), lora_scale, request, top_n, &logprobs,
+                                       result->tokens, &result->finish_reason);
+    if (result->token_count < 0) {
+        std::free(result);
+        return nullptr;
+    }
+    if (logprobs.empty()) {
+        return result;
+    }
+
+    auto* packed = static_cast<DartLLMTokenLogprob*>(std::malloc(logprobs.size() * sizeof(DartLLMTokenLogprob)));
+    if (!packed) {
+        std::free(result);
+        set_error("Failed to allocate result");
+        return nullptr;
+    }
+    std::memcpy(packed, logprobs.data(), logprobs.size() * sizeof(DartLLMTokenLogprob));
+    *out_logprobs = packed;
+    return result;
+}
+
+DARTLLM_API int32_t dartllm_generate_n(
+    void* model,
+    const int32_t* prompt_tokens,
+    int32_t prompt_length,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    float repetition_penalty,
+    int32_t seed,
+    void* lora,
+    float lora_scale,
+    const DartLLMConstraints* constraints,
+    int32_t n,
+    DartLLMGenerateResult** out_results
+) {
+    (void)repetition_penalty;
+
+    if (max_tokens < 0) {
+        set_error("max_tokens must not be negative");
+        return -1;
+    }
+    if (n <= 0 || n > DARTLLM_MAX_PARALLEL) {
+        set_error("n must be between 1 and " + std::to_string(DARTLLM_MAX_PARALLEL));
+        return -1;
+    }
+    if (!model || !prompt_tokens || prompt_length <= 0 || !out_results) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    RequestConstraints request;
+    const int32_t resolved = resolve_constraints(ctx, constraints, &request);
+    if (resolved != 0) {
+        return resolved;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (!apply_lora(ctx, static_cast<llama_adapter_lora*>(lora), lora_scale)) {
+        return -2;
+    }
+
+    const std::vector<llama_seq_id> seqs = free_sequences(ctx);
+    if (n > static_cast<int32_t>(seqs.size())) {
+        set_error("Only " + std::to_string(seqs.size()) + " sequences are free of sessions");
+        return -2;
+    }
+
+    reset_context(ctx);
+
+    if (!decode_prompt(ctx, prompt_tokens, prompt_length)) {
+        set_error("Failed to process prompt");
+        return -2;
+    }
+
+    // One KV sequence and sampler per branch. Branches share the prompt's
+    // cells, so only their generated tokens use extra cache.
+    struct Branch {
+        llama_sampler* sampler = nullptr;
+        std::vector<llama_token> tokens;
+        int32_t finish_reason = 1;
+        bool active = true;
+        int32_t row = -1;
+    };
+    std::vector<Branch> branches(n);
+    llama_memory_t mem = llama_get_memory(ctx->ctx);
+    for (int32_t i = 0; i < n; i++) {
+        if (i > 0) {
+            llama_memory_seq_cp(mem, 0, seqs[i], -1, -1);
+        }
+        branches[i].sampler = build_sampler(ctx, request, temperature, top_p, top_k, min_p, dartllm::branch_seed(seed, i));
+        // Decoding fails once the context is full, whatever max_tokens says.
+        branches[i].tokens.reserve(generate_capacity(ctx, max_tokens));
+    }
+
+    llama_batch batch = llama_batch_init(n, 0, 1);
+    int32_t active = n;
+
+    for (int32_t step = 0; step < max_tokens && active > 0; step++) {
+        // All branches sample from the prompt's logits on the first step.
+        batch.n_tokens = 0;
+        for (int32_t i = 0; i < n; i++) {
+            Branch& branch = branches[i];
+            if (!branch.active) continue;
+
+            llama_token token = llama_sampler_sample(branch.sampler, ctx->ctx, step == 0 ? -1 : branch.row);
+            if (llama_vocab_is_eog(ctx->vocab, token)) {
+                branch.finish_reason = 0;
+                branch.active = false;
+                active--;
+                continue;
+            }
+            branch.tokens.push_back(token);
+            if (step + 1 == max_tokens) continue;
+
+            const int32_t k = batch.n_tokens++;
+            batch.token[k] = token;
+            batch.pos[k] = prompt_length + step;
+            batch.n_seq_id[k] = 1;
+            batch.seq_id[k][0] = seqs[i];
+            batch.logits[k] = 1;
+            branch.row = k;
+        }
+
+        if (batch.n_tokens > 0 && decode_batch(ctx, batch) != 0) {
+            for (Branch& branch : branches) {
+                if (branch.active) branch.finish_reason = 2;
+            }
+            break;
+        }
+    }
+    llama_batch_free(batch);
+
+    int32_t status = 0;
+    for (int32_t i = 0; i < n; i++) {
+        Branch& branch = branches[i];
+        llama_sampler_free(branch.sampler);
+
+        size_t result_size = sizeof(DartLLMGenerateResult) + branch.tokens.size() * sizeof(int32_t);
+        auto* result = static_cast<DartLLMGenerateResult*>(std::malloc(result_size));
+        out_results[i] = result;
+        if (!result) {
+            status = -2;
+            continue;
+        }
+        result->token_count = static_cast<int32_t>(branch.tokens.size());
+        result->finish_reason = branch.finish_reason;
+        std::memcpy(result->tokens, branch.tokens.data(), branch.tokens.size() * sizeof(int32_t));
+    }
+
+    if (status != 0) {
+        for (int32_t i = 0; i < n; i++) {
+            std::free(out_results[i]);
+            out_results[i] = nullptr;
+        }
+        set_error("Failed to allocate result");
+    }
+    return status;
+}
+
+DARTLLM_API int32_t dartllm_generate_stream(
+    void* model,
+    const int32_t* prompt_tokens,
+    int32_t prompt_length,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    float repetition_penalty,
+    int32_t seed,
+    void* lora,
+    float lora_scale,
+    const DartLLMConstraints* constraints,
+    DartLLMStreamCallback callback,
+    void* user_data
+) {
+    (void)repetition_penalty;
+
+    if (!model || !prompt_tokens || prompt_length <= 0 || !callback) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    RequestConstraints request;
+    const int32_t resolved = resolve_constraints(ctx, constraints, &request);
+    if (resolved != 0) {
+        return resolved;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (!apply_lora(ctx, static_cast<llama_adapter_lora*>(lora), lora_scale)) {
+        return -2;
+    }
+
+    configure_sampler(ctx, request, temperature, top_p, top_k, min_p, seed);
+    reset_context(ctx);
+
+    if (!decode_prompt(ctx, prompt_tokens, prompt_length)) {
+        set_error("Failed to process prompt");
+        return -2;
+    }
+
+    int32_t finish_reason = 1;
+    char token_buf[256];
+
+    for (int32_t i = 0; i < max_tokens; i++) {
+        llama_token new_token = llama_sampler_sample(ctx->sampler, ctx->ctx, -1);
+
+        int8_t is_eog = llama_vocab_is_eog(ctx->vocab, new_token) ? 1 : 0;
+        if (is_eog) {
+            finish_reason = 0;
+        }
+
+        int32_t text_len = llama_token_to_piece(ctx->vocab, new_token, token_buf, sizeof(token_buf) - 1, 0, true);
+        if (text_len > 0) {
+            token_buf[text_len] = '\0';
+        } else {
+            token_buf[0] = '\0';
+        }
+
+        int32_t should_continue = callback(
+            new_token,
+            token_buf,
+            is_eog ? 1 : 0,
+            is_eog ? finish_reason : -1,
+            user_data
+        );
+
+        if (is_eog || !should_continue) {
+            break;
+        }
+
+        llama_batch next_batch = llama_batch_get_one(&new_token, 1);
+
+        if (decode_batch(ctx, next_batch) != 0) {
+            callback(0, "", 1, 2, user_data);
+            return -3;
+        }
+    }
+
+    if (finish_reason == 1) {
+        callback(0, "", 1, 1, user_data);
+    }
+
+    return 0;
+}
+
+DARTLLM_API void* dartllm_session_create(void* model) {
+    if (!model) {
+        set_error("Invalid model handle");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (!ctx->ctx) {
+        set_error("Model context is not available");
+        return nullptr;
+    }
+    if (llama_model_has_encoder(ctx->model)) {
+        set_error("Sessions are not supported for encoder models");
+        return nullptr;
+    }
+    if (ctx->session_count >= DARTLLM_MAX_SESSIONS) {
+        set_error("Too many sessions (max " + std::to_string(DARTLLM_MAX_SESSIONS) + ")");
+        return nullptr;
+    }
+
+    // Take sequences from the top so forked requests keep the low ones.
+    llama_seq_id seq = kMaxSequences - 1;
+    while (ctx->sessions[seq]) {
+        seq--;
+    }
+
+    auto session = std::make_unique<SessionContext>();
+    session->owner = ctx;
+    session->seq = seq;
+    session->context_generation = ctx->context_generation;
+
+    // A forked request may have left cells in this sequence.
+    llama_memory_seq_rm(llama_get_memory(ctx->ctx), seq, -1, -1);
+
+    ctx->sessions[seq] = std::move(session);
+    ctx->session_count++;
+    return ctx->sessions[seq].get();
+}
+
+DARTLLM_API void dartllm_session_free(void* session) {
+    if (!session) return;
+
+    auto* s = static_cast<SessionContext*>(session);
+    ModelContext* ctx = s->owner;
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (ctx->ctx && s->context_generation == ctx->context_generation) {
+        llama_memory_seq_rm(llama_get_memory(ctx->ctx), s->seq, -1, -1);
+    }
+    ctx->sessions[s->seq].reset();
+    ctx->session_count--;
+}
+
+DARTLLM_API int32_t dartllm_session_length(void* session) {
+    if (!session) {
+        set_error("Invalid session handle");
+        return -1;
+    }
+
+    auto* s = static_cast<SessionContext*>(session);
+    std::lock_guard<std::mutex> lock(s->owner->mutex);
+    return static_cast<int32_t>(s->tokens.size());
+}
+
+DARTLLM_API int32_t dartllm_session_set_lora(void* session, void* adapter, float scale) {
+    if (!session) {
+        set_error("Invalid session handle");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* s = static_cast<SessionContext*>(session);
+    auto* lora = static_cast<llama_adapter_lora*>(adapter);
+    ModelContext* ctx = s->owner;
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (lora) {
+        std::lock_guard<std::mutex> lora_lock(ctx->lora_mutex);
+        if (!owns_lora(ctx, lora)) {
+            set_error("LoRA adapter does not belong to this model");
+            return -1;
+        }
+    }
+
+    // The KV cache holds activations computed under the old adapter, so
+    // mixing adapters within one conversation would silently blend them.
+    if (!dartllm::can_change_lora(s->tokens.size(), s->lora, s->lora_scale, lora, scale)) {
+        set_error("Session already holds tokens; truncate it to 0 before changing its LoRA adapter");
+        return -2;
+    }
+
+    s->lora = lora;
+    s->lora_scale = scale;
+    return 0;
+}
+
+DARTLLM_API int32_t dartllm_session_truncate(void* session, int32_t length) {
+    if (!session || length < 0) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    auto* s = static_cast<SessionContext*>(session);
+    ModelContext* ctx = s->owner;
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (length > static_cast<int32_t>(s->tokens.size())) {
+        set_error("Cannot truncate session to " + std::to_string(length) +
+                  " tokens: it holds " + std::to_string(s->tokens.size()));
+        return -1;
+    }
+    if (length == static_cast<int32_t>(s->tokens.size())) {
+        return 0;
+    }
+
+    // A stale session is re-decoded from its tokens later, so only the
+    // list needs trimming.
+    s->tokens.resize(length);
+    s->logits_epoch = 0;
+    if (ctx->ctx && s->context_generation == ctx->context_generation) {
+        llama_memory_seq_rm(llama_get_memory(ctx->ctx), s->seq, length, -1);
+    }
+    return 0;
+}
+
+DARTLLM_API int32_t dartllm_session_append(void* session, const int32_t* tokens, int32_t count) {
+    if (!session || !tokens || count <= 0) {
+        set_error("Invalid parameters");
+        return -1;
     }
 
     clear_error();
 
-    auto* ctx = static_cast<ModelContext*>(model);
+    auto* s = static_cast<SessionContext*>(session);
+    ModelContext* ctx = s->owner;
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (!ctx->ctx) {
+        set_error("Model context is not available");
+        return -1;
+    }
+    if (!apply_lora(ctx, s->lora, s->lora_scale) || !restore_session(s) || !session_decode(s, tokens, count)) {
+        return -1;
+    }
+    return static_cast<int32_t>(s->tokens.size());
+}
 
-    llama_sampler_reset(ctx->sampler);
-    llama_sampler_chain_add(ctx->sampler, llama_sampler_init_top_k(top_k));
-    llama_sampler_chain_add(ctx->sampler, llama_sampler_init_top_p(top_p, 1));
-    llama_sampler_chain_add(ctx->sampler, llama_sampler_init_min_p(min_p, 1));
-    llama_sampler_chain_add(ctx->sampler, llama_sampler_init_temp(temperature));
-    llama_sampler_chain_add(ctx->sampler, llama_sampler_init_dist(seed >= 0 ? seed : LLAMA_DEFAULT_SEED));
+DARTLLM_API int32_t dartllm_session_generate(
+    void* session,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    int32_t seed,
+    const DartLLMConstraints* constraints,
+    int32_t* out_tokens,
+    int32_t* out_finish_reason
+) {
+    if (!session || max_tokens < 0 || (max_tokens > 0 && !out_tokens) || !out_finish_reason) {
+        set_error("Invalid parameters");
+        return -1;
+    }
 
-    std::vector<llama_token> prompt_vec(prompt_tokens, prompt_tokens + prompt_length);
-    llama_batch batch = llama_batch_get_one(prompt_vec.data(), prompt_vec.size());
+    clear_error();
 
-    if (llama_decode(ctx->ctx, batch) != 0) {
-        set_error("Failed to process prompt");
-        return nullptr;
+    auto* s = static_cast<SessionContext*>(session);
+    ModelContext* ctx = s->owner;
+    RequestConstraints request;
+    if (resolve_constraints(ctx, constraints, &request) != 0) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (!ctx->ctx) {
+        set_error("Model context is not available");
+        return -1;
+    }
+    if (!apply_lora(ctx, s->lora, s->lora_scale) || !session_logits(s)) {
+        return -1;
     }
 
-    std::vector<llama_token> generated;
-    generated.reserve(max_tokens);
+    llama_sampler* sampler = build_sampler(ctx, request, temperature, top_p, top_k, min_p, seed);
+    const size_t n_ctx = llama_n_ctx(ctx->ctx);
 
+    int32_t count = 0;
     int32_t finish_reason = 1;
 
-    for (int32_t i = 0; i < max_tokens; i++) {
-        llama_token new_token = llama_sampler_sample(ctx->sampler, ctx->ctx, -1);
+    for (int32_t i = 0; i < max_tokens && s->tokens.size() < n_ctx; i++) {
+        llama_token new_token = llama_sampler_sample(sampler, ctx->ctx, -1);
 
         if (llama_vocab_is_eog(ctx->vocab, new_token)) {
             finish_reason = 0;
             break;
         }
 
-        generated.push_back(new_token);
-
-        llama_batch next_batch = llama_batch_get_one(&new_token, 1);
+        out_tokens[count++] = new_token;
 
-        if (llama_decode(ctx->ctx, next_batch) != 0) {
+        if (!session_decode(s, &new_token, 1)) {
             finish_reason = 2;
             break;
         }
     }
+    llama_sampler_free(sampler);
 
-    size_t result_size = sizeof(DartLLMGenerateResult) + generated.size() * sizeof(int32_t);
-    auto* result = static_cast<DartLLMGenerateResult*>(std::malloc(result_size));
-    if (!result) {
-        set_error("Failed to allocate result");
-        return nullptr;
-    }
-
-    result->token_count = static_cast<int32_t>(generated.size());
-    result->finish_reason = finish_reason;
-
-    for (size_t i = 0; i < generated.size(); i++) {
-        result->tokens[i] = generated[i];
-    }
-
-    return result;
+    *out_finish_reason = finish_reason;
+    return count;
 }
 
-DARTLLM_API int32_t dartllm_generate_stream(
-    void* model,
-    const int32_t* prompt_tokens,
-    int32_t prompt_length,
+DARTLLM_API int32_t dartllm_session_generate_stream(
+    void* session,
     int32_t max_tokens,
     float temperature,
     float top_p,
     int32_t top_k,
     float min_p,
-    float repetition_penalty,
     int32_t seed,
+    const DartLLMConstraints* constraints,
     DartLLMStreamCallback callback,
     void* user_data
 ) {
-    (void)repetition_penalty;
-
-    if (!model || !prompt_tokens || prompt_length <= 0 || !callback) {
+    if (!session || !callback) {
         set_error("Invalid parameters");
         return -1;
     }
 
     clear_error();
 
-    auto* ctx = static_cast<ModelContext*>(model);
-
-    llama_sampler_reset(ctx->sampler);
-    llama_sampler_chain_add(ctx->sampler, llama_sampler_init_top_k(top_k));
-    llama_sampler_chain_add(ctx->sampler, llama_sampler_init_top_p(top_p, 1));
-    llama_sampler_chain_add(ctx->sampler, llama_sampler_init_min_p(min_p, 1));
-    llama_sampler_chain_add(ctx->sampler, llama_sampler_init_temp(temperature));
-    llama_sampler_chain_add(ctx->sampler, llama_sampler_init_dist(seed >= 0 ? seed : LLAMA_DEFAULT_SEED));
+    auto* s = static_cast<SessionContext*>(session);
+    ModelContext* ctx = s->owner;
+    RequestConstraints request;
+    const int32_t resolved = resolve_constraints(ctx, constraints, &request);
+    if (resolved != 0) {
+        return resolved;
+    }
 
-    std::vector<llama_token> prompt_vec(prompt_tokens, prompt_tokens + prompt_length);
-    llama_batch batch = llama_batch_get_one(prompt_vec.data(), prompt_vec.size());
+    std::lock_guard<std::mutex> lock(ctx->mutex);
 
-    if (llama_decode(ctx->ctx, batch) != 0) {
-        set_error("Failed to process prompt");
+    if (!ctx->ctx) {
+        set_error("Model context is not available");
+        return -2;
+    }
+    if (!apply_lora(ctx, s->lora, s->lora_scale) || !session_logits(s)) {
         return -2;
     }
 
+    llama_sampler* sampler = build_sampler(ctx, request, temperature, top_p, top_k, min_p, seed);
+    const size_t n_ctx = llama_n_ctx(ctx->ctx);
+
     int32_t finish_reason = 1;
+    int32_t status = 0;
     char token_buf[256];
 
-    for (int32_t i = 0; i < max_tokens; i++) {
-        llama_token new_token = llama_sampler_sample(ctx->sampler, ctx->ctx, -1);
+    for (int32_t i = 0; i < max_tokens && s->tokens.size() < n_ctx; i++) {
+        llama_token new_token = llama_sampler_sample(sampler, ctx->ctx, -1);
 
         int8_t is_eog = llama_vocab_is_eog(ctx->vocab, new_token) ? 1 : 0;
         if (is_eog) {
@@ -435,16 +3509,12 @@ DARTLLM_API int32_t dartllm_generate_stream(
         }
 
         int32_t text_len = llama_token_to_piece(ctx->vocab, new_token, token_buf, sizeof(token_buf) - 1, 0, true);
-        if (text_len > 0) {
-            token_buf[text_len] = '\0';
-        } else {
-            token_buf[0] = '\0';
-        }
+        token_buf[text_len > 0 ? text_len : 0] = '\0';
 
         int32_t should_continue = callback(
             new_token,
             token_buf,
-            is_eog ? 1 : 0,
+            is_eog,
             is_eog ? finish_reason : -1,
             user_data
         );
@@ -453,83 +3523,434 @@ DARTLLM_API int32_t dartllm_generate_stream(
             break;
         }
 
-        llama_batch next_batch = llama_batch_get_one(&new_token, 1);
-
-        if (llama_decode(ctx->ctx, next_batch) != 0) {
+        if (!session_decode(s, &new_token, 1)) {
             callback(0, "", 1, 2, user_data);
-            return -3;
+            status = -3;
+            break;
         }
     }
+    llama_sampler_free(sampler);
 
-    if (finish_reason == 1) {
+    if (status == 0 && finish_reason == 1) {
         callback(0, "", 1, 1, user_data);
     }
+    return status;
+}
+
+DARTLLM_API void* dartllm_stream_begin(
+    void* session,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    int32_t seed,
+    const DartLLMConstraints* constraints
+) {
+    if (!session || max_tokens < 0) {
+        set_error("Invalid parameters");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* s = static_cast<SessionContext*>(session);
+    ModelContext* ctx = s->owner;
+    RequestConstraints request;
+    if (resolve_constraints(ctx, constraints, &request) != 0) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (s->tokens.empty()) {
+        set_error("Session is empty");
+        return nullptr;
+    }
+
+    auto* stream = new StreamContext();
+    stream->session = s;
+    stream->sampler = build_sampler(ctx, request, temperature, top_p, top_k, min_p, seed);
+    stream->remaining = max_tokens;
+    return stream;
+}
+
+DARTLLM_API int32_t dartllm_stream_next(void* stream, DartLLMStreamToken* out) {
+    if (!stream || !out) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* st = static_cast<StreamContext*>(stream);
+    if (st->finished) {
+        set_error("Stream is exhausted");
+        return -1;
+    }
+
+    SessionContext* s = st->session;
+    ModelContext* ctx = s->owner;
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    out->token = 0;
+    out->is_final = 0;
+    out->finish_reason = -1;
+    out->text[0] = '\0';
+
+    auto finish = [&](int32_t reason) {
+        out->is_final = 1;
+        out->finish_reason = reason;
+        st->finished = true;
+        return 0;
+    };
+
+    // The registry may have released the context since the last token.
+    if (!ctx->ctx) {
+        set_error("Model context is not available");
+        return finish(2);
+    }
+    if (!apply_lora(ctx, s->lora, s->lora_scale)) {
+        return finish(2);
+    }
+
+    if (st->pending != LLAMA_TOKEN_NULL) {
+        llama_token token = st->pending;
+        st->pending = LLAMA_TOKEN_NULL;
+        if (!restore_session(s) || !session_decode(s, &token, 1)) {
+            return finish(2);
+        }
+    }
+
+    if (st->remaining == 0 || s->tokens.size() >= llama_n_ctx(ctx->ctx)) {
+        return finish(1);
+    }
+    if (!session_logits(s)) {
+        return finish(2);
+    }
+
+    llama_token new_token = llama_sampler_sample(st->sampler, ctx->ctx, -1);
+    st->remaining--;
+
+    out->token = new_token;
+    int32_t text_len = llama_token_to_piece(ctx->vocab, new_token, out->text, sizeof(out->text) - 1, 0, true);
+    out->text[text_len > 0 ? text_len : 0] = '\0';
+
+    if (llama_vocab_is_eog(ctx->vocab, new_token)) {
+        return finish(0);
+    }
 
+    st->pending = new_token;
     return 0;
 }
 
-DARTLLM_API float* dartllm_embed(
+DARTLLM_API void dartllm_stream_free(void* stream) {
+    delete static_cast<StreamContext*>(stream);
+}
+
+DARTLLM_API int32_t dartllm_set_prefix_cache(
     void* model,
-    const int32_t* tokens,
-    int32_t token_count,
-    int8_t normalize,
-    int32_t* out_dimension
+    const char* cache_dir,
+    int64_t budget_bytes,
+    int32_t min_uses
 ) {
-    if (!model || !tokens || token_count <= 0 || !out_dimension) {
+    if (!model || (cache_dir && (budget_bytes <= 0 || min_uses < 0))) {
         set_error("Invalid parameters");
-        return nullptr;
+        return -1;
     }
 
     clear_error();
 
     auto* ctx = static_cast<ModelContext*>(model);
 
-    if (!llama_model_has_encoder(ctx->model)) {
-        set_error("Model does not support embeddings");
+    std::shared_ptr<PrefixStore> store;
+    uint64_t model_key = 0;
+    if (cache_dir) {
+        struct stat st;
+        if (stat(cache_dir, &st) != 0) {
+            set_error(std::string("Prefix cache directory does not exist: ") + cache_dir);
+            return -2;
+        }
+        if (stat(ctx->model_path.c_str(), &st) != 0) {
+            set_error("Failed to stat model file: " + ctx->model_path);
+            return -2;
+        }
+
+        // States are only valid for the same weights and context layout.
+        uint64_t hash = file_identity_hash(ctx->model_path, st, dartllm::kFnv1aOffsetBasis);
+        hash = dartllm::fnv1a(std::to_string(ctx->context_size), hash);
+        model_key = dartllm::fnv1a(std::to_string(PREFIX_CACHE_VERSION), hash);
+
+        store = dartllm::open_prefix_store(cache_dir, budget_bytes);
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    {
+        std::lock_guard<std::mutex> prefix_lock(ctx->prefix_mutex);
+        ctx->prefix_store = std::move(store);
+    }
+    ctx->prefix_model_key = model_key;
+    ctx->prefix_min_uses = min_uses > 0 ? min_uses : kDefaultPrefixMinUses;
+    ctx->prefix_uses.clear();
+    return 0;
+}
+
+DARTLLM_API int32_t dartllm_prefix_cache_stats(void* model, DartLLMPrefixCacheStats* out) {
+    if (!model || !out) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+    std::memset(out, 0, sizeof(DartLLMPrefixCacheStats));
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    std::shared_ptr<PrefixStore> store;
+    {
+        std::lock_guard<std::mutex> lock(ctx->prefix_mutex);
+        store = ctx->prefix_store;
+    }
+    if (!store) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(store->mutex);
+    out->budget_bytes = store->budget_bytes;
+    out->stored_bytes = store->stored_bytes;
+    out->entries = static_cast<int32_t>(store->entries.size());
+    out->hits = store->hits;
+    out->misses = store->misses;
+    out->tokens_restored = store->tokens_restored;
+    out->stores = store->stores;
+    out->evictions = store->evictions;
+    return 0;
+}
+
+DARTLLM_API float* dartllm_score(
+    void* model,
+    const int32_t* prompt_tokens,
+    int32_t prompt_length,
+    const int32_t* candidate_tokens,
+    const int32_t* candidate_lengths,
+    int32_t candidate_count,
+    void* lora,
+    float lora_scale,
+    float* out_totals
+) {
+    if (!prompt_tokens || prompt_length <= 0 || !candidate_tokens ||
+        !candidate_lengths || candidate_count <= 0 || !out_totals) {
+        set_error("Invalid parameters");
         return nullptr;
     }
 
-    std::vector<llama_token> token_vec(tokens, tokens + token_count);
-    llama_batch batch = llama_batch_get_one(token_vec.data(), token_vec.size());
+    std::vector<int64_t> offsets(candidate_count + 1, 0);
+    for (int32_t i = 0; i < candidate_count; i++) {
+        if (candidate_lengths[i] <= 0) {
+            set_error("Candidates must not be empty");
+            return nullptr;
+        }
+        offsets[i + 1] = offsets[i] + candidate_lengths[i];
+    }
 
-    if (llama_encode(ctx->ctx, batch) != 0) {
-        set_error("Failed to encode tokens");
+    if (!model) {
+        set_error("Invalid parameters");
         return nullptr;
     }
 
-    int32_t n_embd = llama_model_n_embd(ctx->model);
-    float* embeddings = llama_get_embeddings(ctx->ctx);
+    // Every candidate token indexes a logits row, including the last ones,
+    // which are never decoded.
+    auto* ctx = static_cast<ModelContext*>(model);
+    const int32_t n_vocab = llama_vocab_n_tokens(ctx->vocab);
+    const int64_t invalid = dartllm::find_invalid_token(candidate_tokens, offsets[candidate_count], n_vocab);
+    if (invalid >= 0) {
+        set_error("Token out of range: " + std::to_string(candidate_tokens[invalid]));
+        return nullptr;
+    }
 
-    if (!embeddings) {
-        set_error("Failed to get embeddings");
+    clear_error();
+
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    if (!apply_lora(ctx, static_cast<llama_adapter_lora*>(lora), lora_scale)) {
         return nullptr;
     }
 
-    float* result = static_cast<float*>(std::malloc(n_embd * sizeof(float)));
-    if (!result) {
-        set_error("Failed to allocate embedding array");
+    reset_context(ctx);
+
+    // Sessions keep their cells and sequences; candidates use the rest.
+    const std::vector<llama_seq_id> seqs = free_sequences(ctx);
+    const int32_t n_ctx = static_cast<int32_t>(llama_n_ctx(ctx->ctx)) - session_cells(ctx);
+    const int32_t n_batch = static_cast<int32_t>(llama_n_batch(ctx->ctx));
+    llama_memory_t mem = llama_get_memory(ctx->ctx);
+
+    // Prefill the shared prompt once in sequence 0.
+    if (!decode_prompt(ctx, prompt_tokens, prompt_length)) {
+        set_error("Failed to process prompt");
         return nullptr;
     }
 
-    std::memcpy(result, embeddings, n_embd * sizeof(float));
+    // The prompt's last logits predict every candidate's first token.
+    std::vector<float> first_logits(llama_get_logits_ith(ctx->ctx, -1),
+                                    llama_get_logits_ith(ctx->ctx, -1) + n_vocab);
+    const float first_norm = dartllm::log_normalizer(first_logits.data(), n_vocab);
 
-    if (normalize) {
-        float norm = 0.0f;
-        for (int32_t i = 0; i < n_embd; i++) {
-            norm += result[i] * result[i];
-        }
-        norm = std::sqrt(norm);
-        if (norm > 0.0f) {
-            for (int32_t i = 0; i < n_embd; i++) {
-                result[i] /= norm;
+    auto* logprobs = static_cast<float*>(std::malloc(offsets[candidate_count] * sizeof(float)));
+    if (!logprobs) {
+        set_error("Failed to allocate score array");
+        return nullptr;
+    }
+
+    for (int32_t i = 0; i < candidate_count; i++) {
+        logprobs[offsets[i]] = first_logits[candidate_tokens[offsets[i]]] - first_norm;
+    }
+
+    // Each candidate is decoded in its own sequence, forked from the prompt.
+    // The last token of a candidate is never decoded: nothing is predicted
+    // from it. Candidates are grouped so each group fits in the free
+    // sequences and KV cells.
+    llama_batch batch = llama_batch_init(n_batch, 0, 1);
+    struct Row {
+        int32_t candidate;
+        int32_t index;
+    };
+    std::vector<Row> rows;
+    rows.reserve(n_batch);
+
+    // Score the logits of the pending rows, then start a new batch.
+    auto flush = [&]() -> bool {
+        if (batch.n_tokens == 0) return true;
+        if (decode_batch(ctx, batch) != 0) return false;
+        for (int32_t r = 0; r < batch.n_tokens; r++) {
+            const float* logits = llama_get_logits_ith(ctx->ctx, r);
+            const int64_t next = offsets[rows[r].candidate] + rows[r].index + 1;
+            const llama_token target = candidate_tokens[next];
+            logprobs[next] = logits[target] - dartllm::log_normalizer(logits, n_vocab);
+        }
+        batch.n_tokens = 0;
+        rows.clear();
+        return true;
+    };
+
+    bool ok = true;
+    int32_t group_start = 0;
+    while (ok && group_start < candidate_count) {
+        int32_t group_end = group_start;
+        int32_t cells = prompt_length;
+        while (group_end < candidate_count && group_end - group_start < static_cast<int32_t>(seqs.size()) - 1) {
+            const int32_t length = candidate_lengths[group_end];
+            if (prompt_length + length > n_ctx) {
+                set_error("Prompt and candidate exceed the context size");
+                ok = false;
+                break;
             }
+            if (cells + length - 1 > n_ctx) break;
+            cells += length - 1;
+            group_end++;
+        }
+        if (!ok) break;
+
+        for (int32_t c = group_start; c < group_end && ok; c++) {
+            const llama_seq_id seq = seqs[1 + (c - group_start)];
+            llama_memory_seq_cp(mem, 0, seq, -1, -1);
+
+            for (int32_t t = 0; t + 1 < candidate_lengths[c]; t++) {
+                if (batch.n_tokens == n_batch && !flush()) {
+                    ok = false;
+                    break;
+                }
+                const int32_t k = batch.n_tokens++;
+                batch.token[k] = candidate_tokens[offsets[c] + t];
+                batch.pos[k] = prompt_length + t;
+                batch.n_seq_id[k] = 1;
+                batch.seq_id[k][0] = seq;
+                batch.logits[k] = 1;
+                rows.push_back({c, t});
+            }
+        }
+        if (ok && !flush()) {
+            ok = false;
+        }
+
+        for (int32_t i = 1; i <= group_end - group_start; i++) {
+            llama_memory_seq_rm(mem, seqs[i], -1, -1);
+        }
+        group_start = group_end;
+    }
+    llama_batch_free(batch);
+
+    if (!ok) {
+        if (g_last_error.empty()) {
+            set_error("Failed to score candidates");
         }
+        std::free(logprobs);
+        return nullptr;
+    }
+
+    for (int32_t i = 0; i < candidate_count; i++) {
+        float total = 0.0f;
+        for (int64_t t = offsets[i]; t < offsets[i + 1]; t++) {
+            total += logprobs[t];
+        }
+        out_totals[i] = total;
+    }
+    return logprobs;
+}
+
+DARTLLM_API float* dartllm_embed(
+    void* model,
+    const int32_t* tokens,
+    int32_t token_count,
+    int8_t normalize,
+    int32_t* out_dimension
+) {
+    if (!model || !tokens || token_count <= 0 || !out_dimension) {
+        set_error("Invalid parameters");
+        return nullptr;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    int32_t n_embd = llama_model_n_embd(ctx->model);
+
+    float* result = static_cast<float*>(std::malloc(n_embd * sizeof(float)));
+    if (!result) {
+        set_error("Failed to allocate embedding array");
+        return nullptr;
+    }
+
+    if (embed_tokens(ctx, tokens, token_count, normalize, result, n_embd) < 0) {
+        std::free(result);
+        return nullptr;
     }
 
     *out_dimension = n_embd;
     return result;
 }
 
+DARTLLM_API int32_t dartllm_embed_into(
+    void* model,
+    const int32_t* tokens,
+    int32_t token_count,
+    int8_t normalize,
+    float* out_embedding,
+    int32_t capacity
+) {
+    if (capacity < 0 || (capacity > 0 && !out_embedding)) {
+        set_error("Invalid output buffer");
+        return -1;
+    }
+    if (!model || !tokens || token_count <= 0) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    clear_error();
+
+    auto* ctx = static_cast<ModelContext*>(model);
+    return embed_tokens(ctx, tokens, token_count, normalize, out_embedding, capacity);
+}
+
 DARTLLM_API int8_t dartllm_has_gpu_support(void) {
 #if defined(GGML_USE_METAL) || defined(GGML_USE_CUDA) || defined(GGML_USE_VULKAN)
     return 1;
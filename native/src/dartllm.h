@@ -40,7 +40,8 @@ extern "C" {
 /**
  * Model information structure.
  *
- * Returned by dartllm_get_model_info(). All strings are null-terminated.
+ * Returned by dartllm_get_model_info() and dartllm_probe_model().
+ * All strings are null-terminated.
  * The structure uses fixed-size arrays for ABI stability.
  */
 typedef struct DartLLMModelInfo {
@@ -106,6 +107,268 @@ typedef struct DartLLMGenerateResult {
     int32_t tokens[];
 } DartLLMGenerateResult;
 
+/**
+ * Log-probability of one token.
+ *
+ * dartllm_generate_logprobs() returns these packed as token_count groups
+ * of (1 + top_n) entries: the sampled token, then the top_n most likely
+ * tokens in descending order.
+ */
+typedef struct DartLLMTokenLogprob {
+    /** Token ID */
+    int32_t token;
+
+    /** Natural-log probability under the model's unmodified distribution */
+    float logprob;
+} DartLLMTokenLogprob;
+
+/** Largest top_n accepted by dartllm_generate_logprobs() */
+#define DARTLLM_MAX_TOP_LOGPROBS 20
+
+/** Largest n accepted by dartllm_generate_n() */
+#define DARTLLM_MAX_PARALLEL 16
+
+/** Live sessions per model accepted by dartllm_session_create() */
+#define DARTLLM_MAX_SESSIONS 8
+
+/**
+ * Memory estimate structure.
+ *
+ * Returned by dartllm_estimate_memory(). All sizes are in bytes.
+ */
+typedef struct DartLLMMemoryEstimate {
+    /** Tensor data as stored in the file (mapped or loaded) */
+    int64_t weights_bytes;
+
+    /** KV cache for the full context at the requested cache types */
+    int64_t kv_cache_bytes;
+
+    /** Worst-case compute buffer for one prompt-processing ubatch (heuristic) */
+    int64_t compute_bytes;
+
+    /** Host output buffer for logits and embeddings */
+    int64_t output_bytes;
+
+    /** Sum of the above */
+    int64_t total_bytes;
+
+    /** Context size the estimate was computed for, after clamping */
+    int32_t context_size;
+
+    /** Number of transformer layers */
+    int32_t layer_count;
+} DartLLMMemoryEstimate;
+
+/**
+ * Thread configuration structure.
+ *
+ * Filled by dartllm_get_thread_config() and dartllm_calibrate_threads().
+ */
+typedef struct DartLLMThreadConfig {
+    /** Threads used for single-token decode */
+    int32_t n_threads;
+
+    /** Threads used for batched prompt processing */
+    int32_t n_threads_batch;
+
+    /** Logical CPUs in the process affinity mask */
+    int32_t logical_cpus;
+
+    /** Physical cores in the process affinity mask */
+    int32_t physical_cores;
+
+    /** Physical cores in the fastest capacity/frequency class */
+    int32_t performance_cores;
+
+    /** cgroup CPU quota in CPUs (e.g. 2.5), or 0 if unlimited */
+    float cpu_quota;
+
+    /** Non-zero if the thread counts come from a calibration run */
+    int8_t calibrated;
+} DartLLMThreadConfig;
+
+/**
+ * Threadpool configuration structure.
+ *
+ * Initialize with dartllm_threadpool_default_params() before setting fields.
+ */
+typedef struct DartLLMThreadpoolParams {
+    /** Number of worker threads (0 for one per physical core, or one per CPU in cpu_list) */
+    int32_t n_threads;
+
+    /**
+     * CPUs to pin workers to, as a list such as "0-7,16" (UTF-8, null-terminated).
+     * NULL pins one worker to each physical core, fastest cores first.
+     */
+    const char* cpu_list;
+
+    /** Scheduling priority: -1 low, 0 normal, 1 medium, 2 high, 3 realtime */
+    int32_t priority;
+
+    /** Polling level 0-100: 0 sleeps between graphs, higher spins longer before sleeping */
+    uint32_t poll;
+
+    /** Non-zero to pin each worker to a single CPU instead of the whole mask */
+    int8_t strict_cpu;
+} DartLLMThreadpoolParams;
+
+/**
+ * Model registry statistics structure.
+ *
+ * Filled by dartllm_registry_stats().
+ */
+typedef struct DartLLMRegistryStats {
+    /** Memory budget in bytes (0 for unlimited) */
+    int64_t budget_bytes;
+
+    /** Estimated bytes held by resident models */
+    int64_t resident_bytes;
+
+    /** Registered model ids */
+    int32_t registered_models;
+
+    /** Models with weights and context loaded */
+    int32_t resident_models;
+
+    /** Evicted models whose mmap'd weights are kept loaded */
+    int32_t warm_models;
+
+    /** Handles currently acquired and not yet released */
+    int32_t active_handles;
+
+    /** Acquires served by an already resident model */
+    int64_t hits;
+
+    /** Acquires served by recreating the context of a warm model */
+    int64_t warm_hits;
+
+    /** Acquires that loaded the model from disk */
+    int64_t loads;
+
+    /** Models evicted to stay within the budget */
+    int64_t evictions;
+} DartLLMRegistryStats;
+
+/**
+ * Prefix cache statistics structure.
+ *
+ * Filled by dartllm_prefix_cache_stats(). Counts cover every model using
+ * the same cache directory.
+ */
+typedef struct DartLLMPrefixCacheStats {
+    /** Disk budget in bytes */
+    int64_t budget_bytes;
+
+    /** Bytes of stored prefix states */
+    int64_t stored_bytes;
+
+    /** Stored prefixes */
+    int32_t entries;
+
+    /** Prompts that started from a stored prefix */
+    int64_t hits;
+
+    /** Prompts with a cacheable prefix that had none stored */
+    int64_t misses;
+
+    /** Prompt tokens restored instead of decoded */
+    int64_t tokens_restored;
+
+    /** Prefixes written to disk */
+    int64_t stores;
+
+    /** Prefixes deleted to stay within the budget */
+    int64_t evictions;
+} DartLLMPrefixCacheStats;
+
+/** dartllm_warmup() mode flags */
+#define DARTLLM_WARMUP_ADVISE 1  /* madvise(WILLNEED) the mapping; returns immediately */
+#define DARTLLM_WARMUP_READ   2  /* read the file sequentially, with progress */
+#define DARTLLM_WARMUP_DECODE 4  /* run one dummy decode after prefetching */
+
+/** DartLLMWarmupStatus.state values */
+#define DARTLLM_WARMUP_IDLE      0
+#define DARTLLM_WARMUP_RUNNING   1
+#define DARTLLM_WARMUP_DONE      2
+#define DARTLLM_WARMUP_FAILED    3
+#define DARTLLM_WARMUP_CANCELLED 4
+
+/**
+ * Warm-up progress structure.
+ *
+ * Filled by dartllm_warmup_status().
+ */
+typedef struct DartLLMWarmupStatus {
+    /** One of the DARTLLM_WARMUP_IDLE ... DARTLLM_WARMUP_CANCELLED values */
+    int32_t state;
+
+    /** Mode flags the warm-up was started with */
+    int32_t mode;
+
+    /** Bytes of the model file prefetched so far */
+    int64_t bytes_done;
+
+    /**
+     * Bytes to prefetch, or 0 when progress is not metered: the model is
+     * not memory-mapped or the mode has DARTLLM_WARMUP_ADVISE without
+     * DARTLLM_WARMUP_READ
+     */
+    int64_t bytes_total;
+
+    /** Non-zero once the dummy decode has completed */
+    int8_t decoded;
+} DartLLMWarmupStatus;
+
+/**
+ * One step of a polled stream.
+ *
+ * Filled by dartllm_stream_next(). Mirrors the arguments of
+ * DartLLMStreamCallback.
+ */
+typedef struct DartLLMStreamToken {
+    /** Generated token ID (0 in a closing report without a token) */
+    int32_t token;
+
+    /** Non-zero if this is the last report of the stream */
+    int8_t is_final;
+
+    /** 0=stop, 1=length, 2=error (only valid when is_final) */
+    int32_t finish_reason;
+
+    /** Token text (UTF-8, null-terminated) */
+    char text[256];
+} DartLLMStreamToken;
+
+/** DartLLMConstraints grammar kinds */
+#define DARTLLM_GRAMMAR_GBNF        0  /* llama.cpp GBNF with a "root" rule */
+#define DARTLLM_GRAMMAR_JSON_SCHEMA 1  /* JSON Schema, converted to GBNF */
+
+/**
+ * Grammar and logit biases constraining one generate or stream call.
+ *
+ * Constraints are checked and the grammar parsed before anything is
+ * decoded. Parsed grammars are cached per model by their source text, so
+ * repeating a recent grammar does not parse it again. Biases are added to
+ * the logits before any other sampler runs; a bias of -INFINITY bans the
+ * token outright.
+ */
+typedef struct DartLLMConstraints {
+    /** GBNF grammar or JSON Schema (UTF-8), or NULL/"" for none */
+    const char* grammar;
+
+    /** DARTLLM_GRAMMAR_GBNF or DARTLLM_GRAMMAR_JSON_SCHEMA */
+    int32_t grammar_kind;
+
+    /** Token IDs to bias (may be NULL when bias_count is 0) */
+    const int32_t* bias_tokens;
+
+    /** Bias for each token */
+    const float* biases;
+
+    /** Number of biased tokens */
+    int32_t bias_count;
+} DartLLMConstraints;
+
 /* ============================================================================
  * Library Initialization
  * ============================================================================ */
@@ -144,7 +407,7 @@ DARTLLM_API const char* dartllm_llama_version(void);
  * @param path          Absolute path to the GGUF model file (UTF-8)
  * @param context_size  Context size in tokens (0 for model default)
  * @param gpu_layers    Number of layers to offload to GPU (-1 for auto, 0 for CPU-only)
- * @param threads       Number of CPU threads (0 for auto-detect)
+ * @param threads       Number of CPU threads (0 to pick from the CPU topology)
  * @param batch_size    Batch size for prompt processing (0 for default)
  * @param use_mmap      Non-zero to memory-map the model file
  *
@@ -159,6 +422,84 @@ DARTLLM_API void* dartllm_load_model(
     int8_t use_mmap
 );
 
+/**
+ * Get the thread configuration for a model, or the recommendation for this host.
+ *
+ * When threads is 0, dartllm_load_model() picks separate decode and prefill
+ * thread counts from the CPU topology: one decode thread per performance
+ * core (SMT siblings excluded) and one prefill thread per physical core,
+ * both clamped to the cgroup CPU quota.
+ *
+ * @param model Model handle, or NULL for the host recommendation
+ * @param out   Output: thread configuration
+ *
+ * @return 0 on success, negative error code on failure
+ */
+DARTLLM_API int32_t dartllm_get_thread_config(void* model, DartLLMThreadConfig* out);
+
+/**
+ * Measure decode and prefill speed at a few candidate thread counts and
+ * apply the fastest to the model's context.
+ *
+ * Takes a few hundred milliseconds to a few seconds depending on the model.
+ * Results are cached per model file (path, size, mtime) and host CPU
+ * configuration: in memory for the lifetime of the process, and on disk
+ * when cache_dir is given. Models loaded later with threads = 0 reuse an
+ * in-memory result. Clears the model's KV cache.
+ *
+ * @param model     Model handle
+ * @param cache_dir Directory for the persistent cache, or NULL for none
+ * @param out       Output: applied thread configuration (may be NULL)
+ *
+ * @return 0 on success, negative error code on failure
+ */
+DARTLLM_API int32_t dartllm_calibrate_threads(
+    void* model,
+    const char* cache_dir,
+    DartLLMThreadConfig* out
+);
+
+/**
+ * Start warming up a model in a background thread.
+ *
+ * With use_mmap the first request after loading pays page faults across
+ * the whole weight file. Warm-up moves that cost off the request path:
+ * DARTLLM_WARMUP_READ reads the file sequentially into the page cache
+ * (reporting progress), DARTLLM_WARMUP_ADVISE only asks the kernel to
+ * read ahead, and DARTLLM_WARMUP_DECODE then runs one dummy decode so
+ * backend kernels and compute buffers are ready. Prefetching is skipped
+ * for models loaded without use_mmap.
+ *
+ * Requests may run while warm-up is in progress; the dummy decode waits
+ * for them. Freeing the model cancels the warm-up.
+ *
+ * @param model Model handle from dartllm_load_model()
+ * @param mode  Bitwise OR of DARTLLM_WARMUP_* mode flags
+ *
+ * @return 0 if started, -1 on invalid arguments, -2 if already running
+ */
+DARTLLM_API int32_t dartllm_warmup(void* model, int32_t mode);
+
+/**
+ * Get the progress of the current or last warm-up.
+ *
+ * @param model Model handle from dartllm_load_model()
+ * @param out   Output: warm-up status
+ *
+ * @return 0 on success, negative on invalid arguments
+ */
+DARTLLM_API int32_t dartllm_warmup_status(void* model, DartLLMWarmupStatus* out);
+
+/**
+ * Block until the current warm-up finishes.
+ *
+ * @param model Model handle from dartllm_load_model()
+ *
+ * @return 0 if the warm-up completed (or none was started), -1 if it
+ *         failed or was cancelled; see dartllm_get_last_error()
+ */
+DARTLLM_API int32_t dartllm_warmup_wait(void* model);
+
 /**
  * Unload a model and free all associated resources.
  *
@@ -176,6 +517,268 @@ DARTLLM_API void dartllm_free_model(void* model);
  */
 DARTLLM_API DartLLMModelInfo* dartllm_get_model_info(void* model);
 
+/**
+ * Estimate the memory a model would need, without loading it.
+ *
+ * Reads only the GGUF header and tensor table; the weights are neither read
+ * nor mapped, so this takes milliseconds. The context size is clamped to
+ * the model's training context exactly as dartllm_load_model() does.
+ *
+ * @param path          Path to the GGUF model file (UTF-8)
+ * @param context_size  Context size in tokens (0 for model default)
+ * @param batch_size    Batch size for prompt processing (0 for default)
+ * @param type_k        ggml type of the K cache (-1 for F16)
+ * @param type_v        ggml type of the V cache (-1 for F16)
+ *
+ * @return Pointer to DartLLMMemoryEstimate, or NULL on failure.
+ *         Must be freed with dartllm_free().
+ */
+DARTLLM_API DartLLMMemoryEstimate* dartllm_estimate_memory(
+    const char* path,
+    int32_t context_size,
+    int32_t batch_size,
+    int32_t type_k,
+    int32_t type_v
+);
+
+/**
+ * Read model information from a GGUF file without loading it.
+ *
+ * Parses only the GGUF key/value section and tensor table, so listing a
+ * catalog of models takes milliseconds per file. Fields are as for
+ * dartllm_get_model_info() except that context_size is the training
+ * context and file_size_bytes is the size of the file on disk.
+ *
+ * Results are cached in memory keyed by path, size and modification
+ * time. If cache_dir is given they are also stored there and reused
+ * across processes.
+ *
+ * @param path      Path to the GGUF model file (UTF-8)
+ * @param cache_dir Directory for the probe cache, or NULL for memory only
+ *
+ * @return Pointer to DartLLMModelInfo, or NULL on failure.
+ *         Must be freed with dartllm_free().
+ */
+DARTLLM_API DartLLMModelInfo* dartllm_probe_model(const char* path, const char* cache_dir);
+
+/**
+ * Get the full chat template of a GGUF file without loading it.
+ *
+ * DartLLMModelInfo.chat_template is truncated to 4095 bytes; this returns
+ * the whole template. Shares the cache used by dartllm_probe_model().
+ *
+ * @param path      Path to the GGUF model file (UTF-8)
+ * @param cache_dir Directory for the probe cache, or NULL for memory only
+ *
+ * @return Template string (empty if the model has none), or NULL on failure.
+ *         Must be freed with dartllm_free().
+ */
+DARTLLM_API char* dartllm_probe_chat_template(const char* path, const char* cache_dir);
+
+/* ============================================================================
+ * Shared Threadpools
+ * ============================================================================ */
+
+/**
+ * Fill threadpool parameters with defaults.
+ *
+ * @param params Output: parameters to initialize
+ */
+DARTLLM_API void dartllm_threadpool_default_params(DartLLMThreadpoolParams* params);
+
+/**
+ * Create a pinned CPU threadpool that can be shared by several models.
+ *
+ * Without a threadpool every model context runs its own compute threads.
+ * Models attached to the same pool instead take turns on one set of pinned
+ * workers, one decode call at a time, so several loaded models no longer
+ * oversubscribe the cores.
+ *
+ * @param params Pool configuration, or NULL for defaults
+ *
+ * @return Opaque threadpool handle, or NULL on failure.
+ *         Must be freed with dartllm_threadpool_free().
+ */
+DARTLLM_API void* dartllm_threadpool_create(const DartLLMThreadpoolParams* params);
+
+/**
+ * Release a threadpool handle.
+ *
+ * Models still attached keep the pool alive until they are detached or freed.
+ *
+ * @param pool Threadpool handle from dartllm_threadpool_create()
+ */
+DARTLLM_API void dartllm_threadpool_free(void* pool);
+
+/**
+ * Get the number of worker threads in a threadpool.
+ *
+ * @param pool Threadpool handle
+ *
+ * @return Thread count, or negative error code on failure
+ */
+DARTLLM_API int32_t dartllm_threadpool_n_threads(void* pool);
+
+/**
+ * Run a model's computation on shared threadpools.
+ *
+ * The context's thread counts are set to the pools' thread counts while
+ * attached. Replaces any previously attached pools.
+ *
+ * @param model      Model handle
+ * @param pool       Threadpool for single-token decode
+ * @param pool_batch Threadpool for batched prompt processing (NULL to use pool)
+ *
+ * @return 0 on success, negative error code on failure
+ */
+DARTLLM_API int32_t dartllm_attach_threadpool(void* model, void* pool, void* pool_batch);
+
+/**
+ * Return a model to its own compute threads and thread counts.
+ *
+ * @param model Model handle
+ *
+ * @return 0 on success, negative error code on failure
+ */
+DARTLLM_API int32_t dartllm_detach_threadpool(void* model);
+
+/* ============================================================================
+ * Model Registry
+ * ============================================================================ */
+
+/**
+ * Create a model registry with a memory budget.
+ *
+ * A registry loads models on demand by id, reference-counts the handles it
+ * hands out, and when a load would exceed the budget evicts the least
+ * recently used models that have no active handles. Each model's cost is
+ * estimated from its GGUF header (see dartllm_estimate_memory()).
+ *
+ * Evicted CPU models loaded with mmap can be kept "warm": the context, KV
+ * cache and compute buffers are freed but the weights stay mapped. Their
+ * pages are file-backed and reclaimable, so warm models do not count
+ * against the budget, and reacquiring one only recreates the context.
+ *
+ * @param budget_bytes    Memory budget in bytes (0 for unlimited)
+ * @param max_warm_models Maximum evicted models to keep warm (0 to disable)
+ *
+ * @return Registry handle, or NULL on failure.
+ *         Must be freed with dartllm_registry_free().
+ */
+DARTLLM_API void* dartllm_registry_create(int64_t budget_bytes, int32_t max_warm_models);
+
+/**
+ * Free a registry and every model it holds.
+ *
+ * All handles from dartllm_registry_acquire() become invalid.
+ *
+ * @param registry Registry handle from dartllm_registry_create()
+ */
+DARTLLM_API void dartllm_registry_free(void* registry);
+
+/**
+ * Register a model under an id. The model is not loaded until acquired.
+ *
+ * Parameters match dartllm_load_model().
+ *
+ * @param registry Registry handle
+ * @param id       Model id (UTF-8, null-terminated)
+ * @param path     Path to the GGUF model file (UTF-8)
+ *
+ * @return 0 on success, -1 on invalid arguments or an unreadable model
+ *         file, -2 if the id is already registered
+ */
+DARTLLM_API int32_t dartllm_registry_register(
+    void* registry,
+    const char* id,
+    const char* path,
+    int32_t context_size,
+    int32_t gpu_layers,
+    int32_t threads,
+    int32_t batch_size,
+    int8_t use_mmap
+);
+
+/**
+ * Remove a model from the registry, freeing it if loaded.
+ *
+ * @param registry Registry handle
+ * @param id       Model id
+ *
+ * @return 0 on success, -1 if the id is unknown, -2 if handles are active
+ */
+DARTLLM_API int32_t dartllm_registry_unregister(void* registry, const char* id);
+
+/**
+ * Get a handle to a registered model, loading it if needed.
+ *
+ * The handle works with every function that takes a model handle, except
+ * dartllm_free_model(); return it with dartllm_registry_release(). Blocks
+ * while the model loads. Concurrent acquires of the same id share one load.
+ *
+ * @param registry Registry handle
+ * @param id       Model id
+ *
+ * @return Model handle, or NULL if the id is unknown, the load failed, or
+ *         the model does not fit in the budget with all idle models evicted
+ */
+DARTLLM_API void* dartllm_registry_acquire(void* registry, const char* id);
+
+/**
+ * Release a handle from dartllm_registry_acquire().
+ *
+ * The model stays resident until the budget needs its memory.
+ *
+ * @param registry Registry handle
+ * @param model    Model handle
+ *
+ * @return 0 on success, -1 if the handle was not acquired from this registry
+ */
+DARTLLM_API int32_t dartllm_registry_release(void* registry, void* model);
+
+/**
+ * Get registry statistics.
+ *
+ * @param registry Registry handle
+ * @param out      Output: statistics
+ *
+ * @return 0 on success, negative on invalid arguments
+ */
+DARTLLM_API int32_t dartllm_registry_stats(void* registry, DartLLMRegistryStats* out);
+
+/* ============================================================================
+ * LoRA Adapters
+ * ============================================================================ */
+
+/**
+ * Load a LoRA adapter for a loaded base model.
+ *
+ * The adapter shares the base weights; only its low-rank tensors are
+ * loaded. Any number of adapters can be loaded per model. They are freed
+ * with the model or by dartllm_lora_free(). Stateless requests name their
+ * adapter per call and sessions pin one with dartllm_session_set_lora(),
+ * so concurrent callers never see each other's choice. Switching adapters
+ * only rebinds tensors; nothing is reloaded. Embeddings always use the
+ * base model.
+ *
+ * @param model Model handle from dartllm_load_model()
+ * @param path  Path to the GGUF LoRA adapter file (UTF-8)
+ *
+ * @return Adapter handle, or NULL on failure
+ */
+DARTLLM_API void* dartllm_lora_load(void* model, const char* path);
+
+/**
+ * Free a LoRA adapter.
+ *
+ * @param model   Model handle the adapter was loaded for
+ * @param adapter Adapter handle from dartllm_lora_load()
+ *
+ * @return 0 on success, -1 if the adapter does not belong to the model,
+ *         -2 if a session still uses it
+ */
+DARTLLM_API int32_t dartllm_lora_free(void* model, void* adapter);
+
 /* ============================================================================
  * Tokenization
  * ============================================================================ */
@@ -198,6 +801,29 @@ DARTLLM_API int32_t* dartllm_tokenize(
     int32_t* out_length
 );
 
+/**
+ * Tokenize text into a caller-provided buffer.
+ *
+ * Avoids the allocation of dartllm_tokenize(). If the tokens do not fit,
+ * the return value exceeds capacity and the call should be repeated with
+ * a buffer of that size.
+ *
+ * @param model       Model handle
+ * @param text        Input text (UTF-8, null-terminated)
+ * @param add_special Non-zero to add BOS/EOS tokens
+ * @param out_tokens  Output buffer for token IDs
+ * @param capacity    Number of tokens out_tokens can hold
+ *
+ * @return Number of tokens in the text, or -1 on invalid parameters
+ */
+DARTLLM_API int32_t dartllm_tokenize_into(
+    void* model,
+    const char* text,
+    int8_t add_special,
+    int32_t* out_tokens,
+    int32_t capacity
+);
+
 /**
  * Convert token IDs back to text.
  *
@@ -214,6 +840,55 @@ DARTLLM_API char* dartllm_detokenize(
     int32_t token_count
 );
 
+/* ============================================================================
+ * Chat Templates
+ * ============================================================================ */
+
+/**
+ * Get a model's full chat template.
+ *
+ * Unlike DartLLMModelInfo.chat_template, the result is not truncated.
+ *
+ * @param model Model handle
+ *
+ * @return Template text, or NULL if the model has none.
+ *         Must be freed with dartllm_free().
+ */
+DARTLLM_API char* dartllm_get_chat_template(void* model);
+
+/**
+ * Render chat messages with the model's embedded chat template.
+ *
+ * Only templates llama.cpp recognizes can be rendered; arbitrary Jinja is
+ * not evaluated. In incremental mode (previous_count > 0) the first
+ * previous_count messages are assumed to be rendered already, and only
+ * the text that follows them is returned, so a caller extending a
+ * conversation only tokenizes the new turn. If the template renders the
+ * earlier messages differently once more are appended, the full text is
+ * returned instead and out_prefix_length is 0.
+ *
+ * @param model                 Model handle
+ * @param roles                 Message roles ("system", "user", "assistant")
+ * @param contents              Message contents (UTF-8)
+ * @param message_count         Number of messages
+ * @param previous_count        Messages already rendered (0 for all)
+ * @param add_generation_prompt Non-zero to append the assistant turn prefix
+ * @param out_prefix_length     Output: bytes of the full rendering omitted
+ *                              from the result (may be NULL)
+ *
+ * @return Rendered text, or NULL if the model has no template or it is not
+ *         supported. Must be freed with dartllm_free().
+ */
+DARTLLM_API char* dartllm_apply_chat_template(
+    void* model,
+    const char* const* roles,
+    const char* const* contents,
+    int32_t message_count,
+    int32_t previous_count,
+    int8_t add_generation_prompt,
+    int32_t* out_prefix_length
+);
+
 /* ============================================================================
  * Text Generation
  * ============================================================================ */
@@ -231,6 +906,10 @@ DARTLLM_API char* dartllm_detokenize(
  * @param min_p             Minimum probability threshold
  * @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
  * @param seed              Random seed (-1 for random)
+ * @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+ *                          the base model
+ * @param lora_scale        Adapter strength (1.0 for the trained strength)
+ * @param constraints       Grammar and logit biases, or NULL for none
  *
  * @return Generation result, or NULL on failure.
  *         Must be freed with dartllm_free().
@@ -245,7 +924,149 @@ DARTLLM_API DartLLMGenerateResult* dartllm_generate(
     int32_t top_k,
     float min_p,
     float repetition_penalty,
-    int32_t seed
+    int32_t seed,
+    void* lora,
+    float lora_scale,
+    const DartLLMConstraints* constraints
+);
+
+/**
+ * Generate tokens from a prompt and report log-probabilities.
+ *
+ * Same as dartllm_generate(), but also returns, for every generated token,
+ * its log-probability and the top_n most likely alternatives. Probabilities
+ * come from the raw logits, before temperature, truncation, grammar or
+ * logit bias. The alternatives are found by partial selection, so the cost
+ * is one pass over the vocabulary per token.
+ *
+ * @param model             Model handle
+ * @param prompt_tokens     Input token IDs
+ * @param prompt_length     Number of prompt tokens
+ * @param max_tokens        Maximum tokens to generate
+ * @param temperature       Sampling temperature (0.0-2.0)
+ * @param top_p             Nucleus sampling threshold (0.0-1.0)
+ * @param top_k             Top-K sampling limit
+ * @param min_p             Minimum probability threshold
+ * @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
+ * @param seed              Random seed (-1 for random)
+ * @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+ *                          the base model
+ * @param lora_scale        Adapter strength (1.0 for the trained strength)
+ * @param constraints       Grammar and logit biases, or NULL for none
+ * @param top_n             Alternatives per token (0-DARTLLM_MAX_TOP_LOGPROBS)
+ * @param out_logprobs      Output: token_count * (1 + top_n) packed entries,
+ *                          or NULL if no tokens were generated.
+ *                          Must be freed with dartllm_free().
+ *
+ * @return Generation result, or NULL on failure.
+ *         Must be freed with dartllm_free().
+ */
+DARTLLM_API DartLLMGenerateResult* dartllm_generate_logprobs(
+    void* model,
+    const int32_t* prompt_tokens,
+    int32_t prompt_length,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    float repetition_penalty,
+    int32_t seed,
+    void* lora,
+    float lora_scale,
+    const DartLLMConstraints* constraints,
+    int32_t top_n,
+    DartLLMTokenLogprob** out_logprobs
+);
+
+/**
+ * Generate n independent completions of one prompt.
+ *
+ * The prompt is decoded once and shared by all branches through the KV
+ * cache. Branches are then decoded together, one token each per batch,
+ * with their own sampler seeded from seed + branch index, wrapping past
+ * INT32_MAX to 0 (or randomly when seed is -1). A branch that reaches an
+ * end-of-generation token drops out while the others continue. Each branch
+ * needs a KV sequence not held by a session (see dartllm_session_create()).
+ *
+ * @param model             Model handle
+ * @param prompt_tokens     Input token IDs
+ * @param prompt_length     Number of prompt tokens
+ * @param max_tokens        Maximum tokens to generate per branch (>= 0)
+ * @param temperature       Sampling temperature (0.0-2.0)
+ * @param top_p             Nucleus sampling threshold (0.0-1.0)
+ * @param top_k             Top-K sampling limit
+ * @param min_p             Minimum probability threshold
+ * @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
+ * @param seed              Random seed (-1 for random)
+ * @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+ *                          the base model
+ * @param lora_scale        Adapter strength (1.0 for the trained strength)
+ * @param constraints       Grammar and logit biases, or NULL for none
+ * @param n                 Number of branches (1-DARTLLM_MAX_PARALLEL)
+ * @param out_results       Output: n results (caller-allocated array).
+ *                          Each must be freed with dartllm_free().
+ *
+ * @return 0 on success, -1 on invalid parameters, -2 on failure
+ */
+DARTLLM_API int32_t dartllm_generate_n(
+    void* model,
+    const int32_t* prompt_tokens,
+    int32_t prompt_length,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    float repetition_penalty,
+    int32_t seed,
+    void* lora,
+    float lora_scale,
+    const DartLLMConstraints* constraints,
+    int32_t n,
+    DartLLMGenerateResult** out_results
+);
+
+/**
+ * Generate tokens from a prompt into a caller-provided buffer.
+ *
+ * Same as dartllm_generate(), without allocating a result.
+ *
+ * @param model             Model handle
+ * @param prompt_tokens     Input token IDs
+ * @param prompt_length     Number of prompt tokens
+ * @param max_tokens        Maximum tokens to generate
+ * @param temperature       Sampling temperature (0.0-2.0)
+ * @param top_p             Nucleus sampling threshold (0.0-1.0)
+ * @param top_k             Top-K sampling limit
+ * @param min_p             Minimum probability threshold
+ * @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
+ * @param seed              Random seed (-1 for random)
+ * @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+ *                          the base model
+ * @param lora_scale        Adapter strength (1.0 for the trained strength)
+ * @param constraints       Grammar and logit biases, or NULL for none
+ * @param out_tokens        Output buffer with room for max_tokens token IDs
+ * @param out_finish_reason Output: 0=stop, 1=length, 2=error
+ *
+ * @return Number of tokens generated, or -1 on failure
+ */
+DARTLLM_API int32_t dartllm_generate_into(
+    void* model,
+    const int32_t* prompt_tokens,
+    int32_t prompt_length,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    float repetition_penalty,
+    int32_t seed,
+    void* lora,
+    float lora_scale,
+    const DartLLMConstraints* constraints,
+    int32_t* out_tokens,
+    int32_t* out_finish_reason
 );
 
 /* ============================================================================
@@ -288,6 +1109,10 @@ typedef int32_t (*DartLLMStreamCallback)(
  * @param min_p             Minimum probability threshold
  * @param repetition_penalty Penalty for repeated tokens (1.0-2.0)
  * @param seed              Random seed (-1 for random)
+ * @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+ *                          the base model
+ * @param lora_scale        Adapter strength (1.0 for the trained strength)
+ * @param constraints       Grammar and logit biases, or NULL for none
  * @param callback          Streaming callback function
  * @param user_data         User context passed to callback
  *
@@ -304,10 +1129,301 @@ DARTLLM_API int32_t dartllm_generate_stream(
     float min_p,
     float repetition_penalty,
     int32_t seed,
+    void* lora,
+    float lora_scale,
+    const DartLLMConstraints* constraints,
     DartLLMStreamCallback callback,
     void* user_data
 );
 
+/* ============================================================================
+ * Sessions
+ * ============================================================================ */
+
+/**
+ * Create a conversation session on a loaded model.
+ *
+ * A session owns one KV sequence of the model's context and keeps the
+ * tokens it has decoded resident between calls, so each turn only decodes
+ * its new tokens. Sessions share the context's cache cells with each other
+ * and with stateless requests, which leave session state untouched.
+ *
+ * Sessions are freed together with their model, but should be freed with
+ * dartllm_session_free() first when the model is released to a registry.
+ * Encoder models are not supported.
+ *
+ * @param model Model handle
+ *
+ * @return Session handle, or NULL if DARTLLM_MAX_SESSIONS are already live
+ */
+DARTLLM_API void* dartllm_session_create(void* model);
+
+/**
+ * Free a session and drop its KV state.
+ *
+ * @param session Session handle (can be NULL)
+ */
+DARTLLM_API void dartllm_session_free(void* session);
+
+/**
+ * Get the number of tokens resident in a session.
+ *
+ * @param session Session handle
+ *
+ * @return Token count, or -1 on failure
+ */
+DARTLLM_API int32_t dartllm_session_length(void* session);
+
+/**
+ * Drop the resident tokens after the first `length`.
+ *
+ * Use this to rewind to the part of the conversation that is unchanged
+ * before appending the rest.
+ *
+ * @param session Session handle
+ * @param length  Number of tokens to keep (0 to session length)
+ *
+ * @return 0 on success, -1 on failure
+ */
+DARTLLM_API int32_t dartllm_session_truncate(void* session, int32_t length);
+
+/**
+ * Set the LoRA adapter a session decodes and samples with.
+ *
+ * The KV cache holds activations computed under the session's adapter, so
+ * the adapter can only change while the session is empty; truncate it to
+ * 0 first to switch.
+ *
+ * @param session Session handle
+ * @param adapter Adapter handle from dartllm_lora_load(), or NULL for the base model
+ * @param scale   Adapter strength (1.0 for the trained strength)
+ *
+ * @return 0 on success, -1 on invalid parameters or an adapter from another
+ *         model, -2 if the session holds tokens
+ */
+DARTLLM_API int32_t dartllm_session_set_lora(void* session, void* adapter, float scale);
+
+/**
+ * Decode tokens after the session's resident ones.
+ *
+ * The tokens stay resident; the cost is proportional to `count`, not to the
+ * length of the conversation.
+ *
+ * @param session Session handle
+ * @param tokens  Token IDs to append
+ * @param count   Number of tokens
+ *
+ * @return New session length, or -1 on failure
+ */
+DARTLLM_API int32_t dartllm_session_append(void* session, const int32_t* tokens, int32_t count);
+
+/**
+ * Generate tokens continuing the session.
+ *
+ * Sampling uses the session's LoRA adapter. Generated tokens stay
+ * resident, except a final end-of-generation token, which is not returned
+ * either.
+ *
+ * @param session           Session handle (must hold at least one token)
+ * @param max_tokens        Maximum tokens to generate
+ * @param temperature       Sampling temperature (0.0-2.0)
+ * @param top_p             Nucleus sampling threshold (0.0-1.0)
+ * @param top_k             Top-K sampling limit
+ * @param min_p             Minimum probability threshold
+ * @param seed              Random seed (-1 for random)
+ * @param constraints       Grammar and logit biases, or NULL for none
+ * @param out_tokens        Output buffer with room for max_tokens token IDs
+ * @param out_finish_reason Output: 0=stop, 1=length, 2=error
+ *
+ * @return Number of tokens generated, or -1 on failure
+ */
+DARTLLM_API int32_t dartllm_session_generate(
+    void* session,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    int32_t seed,
+    const DartLLMConstraints* constraints,
+    int32_t* out_tokens,
+    int32_t* out_finish_reason
+);
+
+/**
+ * Generate tokens continuing the session, with a streaming callback.
+ *
+ * Same as dartllm_session_generate(), reporting tokens as
+ * dartllm_generate_stream() does.
+ *
+ * @param session     Session handle (must hold at least one token)
+ * @param max_tokens  Maximum tokens to generate
+ * @param temperature Sampling temperature (0.0-2.0)
+ * @param top_p       Nucleus sampling threshold (0.0-1.0)
+ * @param top_k       Top-K sampling limit
+ * @param min_p       Minimum probability threshold
+ * @param seed        Random seed (-1 for random)
+ * @param constraints Grammar and logit biases, or NULL for none
+ * @param callback    Streaming callback function
+ * @param user_data   User context passed to callback
+ *
+ * @return 0 on success, non-zero error code on failure
+ */
+DARTLLM_API int32_t dartllm_session_generate_stream(
+    void* session,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    int32_t seed,
+    const DartLLMConstraints* constraints,
+    DartLLMStreamCallback callback,
+    void* user_data
+);
+
+/**
+ * Start a polled generation continuing the session.
+ *
+ * The pull-based counterpart of dartllm_session_generate_stream() for hosts
+ * that cannot block in a callback, such as a browser's main thread: each
+ * dartllm_stream_next() call produces one token, so the caller can yield
+ * between tokens. Decode state lives in the session, so other requests may
+ * run between calls. The sampler, with its grammar and logit biases, is
+ * built here.
+ *
+ * @param session     Session handle (must hold at least one token)
+ * @param max_tokens  Maximum tokens to generate
+ * @param temperature Sampling temperature (0.0-2.0)
+ * @param top_p       Nucleus sampling threshold (0.0-1.0)
+ * @param top_k       Top-K sampling limit
+ * @param min_p       Minimum probability threshold
+ * @param seed        Random seed (-1 for random)
+ * @param constraints Grammar and logit biases, or NULL for none
+ *
+ * @return Stream handle, or NULL on failure.
+ *         Must be freed with dartllm_stream_free() before the session.
+ */
+DARTLLM_API void* dartllm_stream_begin(
+    void* session,
+    int32_t max_tokens,
+    float temperature,
+    float top_p,
+    int32_t top_k,
+    float min_p,
+    int32_t seed,
+    const DartLLMConstraints* constraints
+);
+
+/**
+ * Produce the next token of a polled stream.
+ *
+ * Reports match the callback of dartllm_session_generate_stream(): the
+ * last one has is_final set, after which the stream is exhausted.
+ *
+ * @param stream Stream handle
+ * @param out    Output: the report
+ *
+ * @return 0 on success, -1 on failure or once the stream is exhausted
+ */
+DARTLLM_API int32_t dartllm_stream_next(void* stream, DartLLMStreamToken* out);
+
+/**
+ * Free a polled stream. Tokens it generated stay resident in the session.
+ *
+ * @param stream Stream handle (can be NULL)
+ */
+DARTLLM_API void dartllm_stream_free(void* stream);
+
+/* ============================================================================
+ * Prefix Cache
+ * ============================================================================ */
+
+/** Prefixes are stored at multiples of this many tokens. */
+#define DARTLLM_PREFIX_BLOCK 64
+
+/**
+ * Persist the KV state of frequently used prompt prefixes, such as system
+ * prompts, so later requests and later processes restore it instead of
+ * decoding it again.
+ *
+ * Stateless requests (generate, generate_n, generate_stream, score) count
+ * how often each prefix of a multiple of DARTLLM_PREFIX_BLOCK tokens is
+ * seen. Once one has been seen `min_uses` times, the KV state after it is
+ * written to `cache_dir`, keyed by the model file, the context size and
+ * the prefix tokens. A request starting with a stored prefix maps the file
+ * and restores the state, then decodes only the rest of its prompt. The
+ * last prompt token is always decoded.
+ *
+ * Models using the same directory share its entries and budget. Requests
+ * made with a LoRA adapter selected bypass the cache.
+ *
+ * @param model        Model handle
+ * @param cache_dir    Existing directory for the cache files, or NULL to
+ *                     stop using the cache for this model
+ * @param budget_bytes Disk budget of the directory; least recently used
+ *                     prefixes are deleted beyond it (must be > 0)
+ * @param min_uses     Requests that must share a prefix before it is
+ *                     stored (0 for the default of 2)
+ *
+ * @return 0 on success, negative error code on failure
+ */
+DARTLLM_API int32_t dartllm_set_prefix_cache(
+    void* model,
+    const char* cache_dir,
+    int64_t budget_bytes,
+    int32_t min_uses
+);
+
+/**
+ * Get the statistics of a model's prefix cache.
+ *
+ * @param model Model handle
+ * @param out   Output: statistics (zeroed if the model has no prefix cache)
+ *
+ * @return 0 on success, negative error code on failure
+ */
+DARTLLM_API int32_t dartllm_prefix_cache_stats(void* model, DartLLMPrefixCacheStats* out);
+
+/* ============================================================================
+ * Scoring
+ * ============================================================================ */
+
+/**
+ * Score candidate continuations of a prompt by log-likelihood.
+ *
+ * The prompt is decoded once and its KV cache is shared by every candidate,
+ * which are then evaluated together in batches rather than one run each.
+ * Useful for classification and reranking by comparing candidates.
+ *
+ * @param model             Model handle
+ * @param prompt_tokens     Shared prompt token IDs
+ * @param prompt_length     Number of prompt tokens
+ * @param candidate_tokens  All candidates' token IDs, concatenated
+ * @param candidate_lengths Number of tokens in each candidate (each > 0)
+ * @param candidate_count   Number of candidates
+ * @param lora              LoRA adapter from dartllm_lora_load(), or NULL for
+ *                          the base model
+ * @param lora_scale        Adapter strength (1.0 for the trained strength)
+ * @param out_totals        Output: summed log-probability of each candidate
+ *                          (caller-allocated, candidate_count elements)
+ *
+ * @return Log-probability of every candidate token, in the same layout as
+ *         candidate_tokens, or NULL on failure.
+ *         Must be freed with dartllm_free().
+ */
+DARTLLM_API float* dartllm_score(
+    void* model,
+    const int32_t* prompt_tokens,
+    int32_t prompt_length,
+    const int32_t* candidate_tokens,
+    const int32_t* candidate_lengths,
+    int32_t candidate_count,
+    void* lora,
+    float lora_scale,
+    float* out_totals
+);
+
 /* ============================================================================
  * Embeddings
  * ============================================================================ */
@@ -332,6 +1448,31 @@ DARTLLM_API float* dartllm_embed(
     int32_t* out_dimension
 );
 
+/**
+ * Generate an embedding into a caller-provided buffer.
+ *
+ * Avoids the allocation of dartllm_embed(). If capacity is smaller than
+ * the model's embedding dimension, nothing is computed and the dimension
+ * is returned so the caller can size the buffer.
+ *
+ * @param model         Model handle
+ * @param tokens        Input token IDs
+ * @param token_count   Number of tokens
+ * @param normalize     Non-zero to L2-normalize the embedding
+ * @param out_embedding Output buffer for the embedding
+ * @param capacity      Number of floats out_embedding can hold
+ *
+ * @return Embedding dimension, or -1 on failure
+ */
+DARTLLM_API int32_t dartllm_embed_into(
+    void* model,
+    const int32_t* tokens,
+    int32_t token_count,
+    int8_t normalize,
+    float* out_embedding,
+    int32_t capacity
+);
+
 /* ============================================================================
  * Hardware Detection
  * ============================================================================ */
@@ -0,0 +1,191 @@
+/**
+ * @file dartllm_internal.h
+ * @brief Internal helpers shared by the DartLLM implementation, tools and benchmarks
+ *
+ * Not part of the public C API and not installed.
+ */
+
+#ifndef DARTLLM_INTERNAL_H
+#define DARTLLM_INTERNAL_H
+
+#include "dartllm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace dartllm {
+
+/** Starting value of a 64-bit FNV-1a hash. */
+constexpr uint64_t kFnv1aOffsetBasis = 14695981039346656037ULL;
+
+/**
+ * Fold bytes into a 64-bit FNV-1a hash. Pass the previous result as `hash`
+ * to hash several values in sequence.
+ */
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t hash = kFnv1aOffsetBasis) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+inline uint64_t fnv1a(const std::string& value, uint64_t hash = kFnv1aOffsetBasis) {
+    return fnv1a(value.data(), value.size(), hash);
+}
+
+/**
+ * Fold the low `bytes` bytes of an integer into a 64-bit FNV-1a hash,
+ * least significant first, so the result does not depend on host byte
+ * order.
+ */
+inline uint64_t fnv1a_int(uint64_t value, int bytes, uint64_t hash = kFnv1aOffsetBasis) {
+    for (int i = 0; i < bytes; i++) {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * L2-normalize a vector in place. Zero vectors are left unchanged.
+ */
+inline void l2_normalize(float* values, int32_t count) {
+    float norm = 0.0f;
+    for (int32_t i = 0; i < count; i++) {
+        norm += values[i] * values[i];
+    }
+    norm = std::sqrt(norm);
+    if (norm > 0.0f) {
+        for (int32_t i = 0; i < count; i++) {
+            values[i] /= norm;
+        }
+    }
+}
+
+/**
+ * Length of the part of a full chat rendering that an earlier rendering of
+ * the leading messages already covers: previous.size() if `previous` is a
+ * byte prefix of `full`, otherwise 0 (the template rewrote earlier turns,
+ * so the caller must start over).
+ */
+inline size_t chat_delta_prefix(const std::string& previous, const char* full, size_t full_length) {
+    if (previous.empty() || full_length < previous.size() ||
+        std::memcmp(full, previous.data(), previous.size()) != 0) {
+        return 0;
+    }
+    return previous.size();
+}
+
+/**
+ * Seed of branch `branch` of a request seeded with `seed`: seed + branch,
+ * wrapping past INT32_MAX to 0 so it stays a valid seed. A random seed
+ * (negative) stays random.
+ */
+inline int32_t branch_seed(int32_t seed, int32_t branch) {
+    if (seed < 0) {
+        return -1;
+    }
+    const uint32_t sum = static_cast<uint32_t>(seed) + static_cast<uint32_t>(branch);
+    return static_cast<int32_t>(sum & 0x7fffffffu);
+}
+
+/**
+ * Index of the first of `count` tokens outside [0, n_vocab), or -1 if all
+ * are valid token IDs.
+ */
+inline int64_t find_invalid_token(const int32_t* tokens, int64_t count, int32_t n_vocab) {
+    for (int64_t i = 0; i < count; i++) {
+        if (tokens[i] < 0 || tokens[i] >= n_vocab) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/** Grammar cache key: FNV-1a over the grammar kind and source. */
+inline uint64_t grammar_key(int32_t kind, const std::string& source) {
+    return fnv1a(source, fnv1a_int(static_cast<uint32_t>(kind), 1));
+}
+
+/**
+ * Whether a session holding `token_count` tokens, decoded under `current`
+ * at `current_scale`, may switch to `next` at `next_scale`. Its KV cache
+ * holds activations computed under the current adapter, so only an empty
+ * session may change adapter or scale; without an adapter the scale is
+ * ignored.
+ */
+inline bool can_change_lora(size_t token_count, const void* current, float current_scale,
+                            const void* next, float next_scale) {
+    return token_count == 0 || (next == current && (!next || next_scale == current_scale));
+}
+
+/**
+ * Most tokens a request for max_tokens can produce in a context of n_ctx
+ * cells: decoding stops once the context is full.
+ */
+inline int32_t generate_capacity(int32_t max_tokens, int32_t n_ctx) {
+    return std::max(0, std::min(max_tokens, n_ctx));
+}
+
+/** log(sum(exp(logits))), so a token's log-probability is logit - this. */
+inline float log_normalizer(const float* logits, int32_t n_vocab) {
+    float max_logit = logits[0];
+    for (int32_t i = 1; i < n_vocab; i++) {
+        max_logit = std::max(max_logit, logits[i]);
+    }
+    double sum = 0.0;
+    for (int32_t i = 0; i < n_vocab; i++) {
+        sum += std::exp(static_cast<double>(logits[i] - max_logit));
+    }
+    return max_logit + static_cast<float>(std::log(sum));
+}
+
+/**
+ * Append the log-probability of `chosen` and of the `top_n` most likely
+ * tokens. A size-limited min-heap keeps the selection at one pass over the
+ * vocabulary instead of sorting it.
+ */
+inline void collect_logprobs(
+    const float* logits,
+    int32_t n_vocab,
+    int32_t chosen,
+    int32_t top_n,
+    std::vector<DartLLMTokenLogprob>* out
+) {
+    const float log_norm = log_normalizer(logits, n_vocab);
+
+    out->push_back({chosen, logits[chosen] - log_norm});
+    if (top_n == 0) {
+        return;
+    }
+
+    auto greater = [logits](int32_t a, int32_t b) { return logits[a] > logits[b]; };
+    int32_t heap[DARTLLM_MAX_TOP_LOGPROBS];
+    int32_t size = 0;
+    for (int32_t token = 0; token < n_vocab; token++) {
+        if (size < top_n) {
+            heap[size++] = token;
+            std::push_heap(heap, heap + size, greater);
+        } else if (logits[token] > logits[heap[0]]) {
+            std::pop_heap(heap, heap + size, greater);
+            heap[size - 1] = token;
+            std::push_heap(heap, heap + size, greater);
+        }
+    }
+
+    std::sort_heap(heap, heap + size, greater);
+    for (int32_t i = 0; i < size; i++) {
+        out->push_back({heap[i], logits[heap[i]] - log_norm});
+    }
+}
+
+} // namespace dartllm
+
+#endif /* DARTLLM_INTERNAL_H */
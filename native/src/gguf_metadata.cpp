@@ -0,0 +1,269 @@
+/**
+ * @file gguf_metadata.cpp
+ * @brief Read GGUF metadata and tensor tables without loading weights
+ */
+
+#include "gguf_metadata.h"
+
+#include "ggml.h"
+#include "gguf.h"
+
+#include <algorithm>
+
+namespace dartllm {
+
+namespace {
+
+int64_t read_scalar(const gguf_context* ctx, int64_t id, gguf_type type, int64_t fallback) {
+    switch (type) {
+        case GGUF_TYPE_UINT8:   return gguf_get_val_u8(ctx, id);
+        case GGUF_TYPE_INT8:    return gguf_get_val_i8(ctx, id);
+        case GGUF_TYPE_UINT16:  return gguf_get_val_u16(ctx, id);
+        case GGUF_TYPE_INT16:   return gguf_get_val_i16(ctx, id);
+        case GGUF_TYPE_UINT32:  return gguf_get_val_u32(ctx, id);
+        case GGUF_TYPE_INT32:   return gguf_get_val_i32(ctx, id);
+        case GGUF_TYPE_UINT64:  return static_cast<int64_t>(gguf_get_val_u64(ctx, id));
+        case GGUF_TYPE_INT64:   return gguf_get_val_i64(ctx, id);
+        case GGUF_TYPE_FLOAT32: return static_cast<int64_t>(gguf_get_val_f32(ctx, id));
+        case GGUF_TYPE_FLOAT64: return static_cast<int64_t>(gguf_get_val_f64(ctx, id));
+        case GGUF_TYPE_BOOL:    return gguf_get_val_bool(ctx, id) ? 1 : 0;
+        default:                return fallback;
+    }
+}
+
+/** Read element `i` of a numeric array, or `fallback` for other types. */
+int64_t read_array_element(const gguf_context* ctx, int64_t id, size_t i, int64_t fallback) {
+    const void* data = gguf_get_arr_data(ctx, id);
+    switch (gguf_get_arr_type(ctx, id)) {
+        case GGUF_TYPE_UINT8:   return static_cast<const uint8_t*>(data)[i];
+        case GGUF_TYPE_INT8:    return static_cast<const int8_t*>(data)[i];
+        case GGUF_TYPE_UINT16:  return static_cast<const uint16_t*>(data)[i];
+        case GGUF_TYPE_INT16:   return static_cast<const int16_t*>(data)[i];
+        case GGUF_TYPE_UINT32:  return static_cast<const uint32_t*>(data)[i];
+        case GGUF_TYPE_INT32:   return static_cast<const int32_t*>(data)[i];
+        case GGUF_TYPE_UINT64:  return static_cast<int64_t>(static_cast<const uint64_t*>(data)[i]);
+        case GGUF_TYPE_INT64:   return static_cast<const int64_t*>(data)[i];
+        case GGUF_TYPE_FLOAT32: return static_cast<int64_t>(static_cast<const float*>(data)[i]);
+        case GGUF_TYPE_FLOAT64: return static_cast<int64_t>(static_cast<const double*>(data)[i]);
+        case GGUF_TYPE_BOOL:    return static_cast<const int8_t*>(data)[i] ? 1 : 0;
+        default:                return fallback;
+    }
+}
+
+bool valid_cache_type(int32_t type) {
+    return type >= 0 && type < GGML_TYPE_COUNT && ggml_type_size(static_cast<ggml_type>(type)) > 0;
+}
+
+} // anonymous namespace
+
+std::unique_ptr<GgufFile> GgufFile::open(const std::string& path, std::string* error) {
+    gguf_init_params params;
+    params.no_alloc = true;
+    params.ctx = nullptr;
+
+    gguf_context* ctx = gguf_init_from_file(path.c_str(), params);
+    if (!ctx) {
+        if (error) *error = "Failed to read GGUF header from: " + path;
+        return nullptr;
+    }
+
+    std::unique_ptr<GgufFile> file(new GgufFile());
+    file->ctx_ = ctx;
+    file->architecture_ = file->get_string("general.architecture", "unknown");
+    return file;
+}
+
+GgufFile::~GgufFile() {
+    if (ctx_) {
+        gguf_free(ctx_);
+    }
+}
+
+std::string GgufFile::arch_key(const char* suffix) const {
+    return architecture_ + "." + suffix;
+}
+
+bool GgufFile::has(const std::string& key) const {
+    return gguf_find_key(ctx_, key.c_str()) >= 0;
+}
+
+std::string GgufFile::get_string(const std::string& key, const std::string& fallback) const {
+    int64_t id = gguf_find_key(ctx_, key.c_str());
+    if (id < 0 || gguf_get_kv_type(ctx_, id) != GGUF_TYPE_STRING) {
+        return fallback;
+    }
+    return gguf_get_val_str(ctx_, id);
+}
+
+int64_t GgufFile::get_int(const std::string& key, int64_t fallback) const {
+    int64_t id = gguf_find_key(ctx_, key.c_str());
+    if (id < 0) return fallback;
+
+    gguf_type type = gguf_get_kv_type(ctx_, id);
+    if (type == GGUF_TYPE_ARRAY) {
+        if (gguf_get_arr_n(ctx_, id) == 0) return fallback;
+        return read_array_element(ctx_, id, 0, fallback);
+    }
+    return read_scalar(ctx_, id, type, fallback);
+}
+
+std::vector<int64_t> GgufFile::get_int_per_layer(const std::string& key, int64_t fallback, int32_t n_layer) const {
+    std::vector<int64_t> values(std::max(n_layer, 0), fallback);
+
+    int64_t id = gguf_find_key(ctx_, key.c_str());
+    if (id < 0) return values;
+
+    if (gguf_get_kv_type(ctx_, id) != GGUF_TYPE_ARRAY) {
+        std::fill(values.begin(), values.end(), read_scalar(ctx_, id, gguf_get_kv_type(ctx_, id), fallback));
+        return values;
+    }
+
+    size_t n = gguf_get_arr_n(ctx_, id);
+    for (size_t i = 0; i < values.size() && n > 0; i++) {
+        values[i] = read_array_element(ctx_, id, std::min(i, n - 1), fallback);
+    }
+    return values;
+}
+
+int64_t GgufFile::get_array_length(const std::string& key) const {
+    int64_t id = gguf_find_key(ctx_, key.c_str());
+    if (id < 0 || gguf_get_kv_type(ctx_, id) != GGUF_TYPE_ARRAY) {
+        return 0;
+    }
+    return static_cast<int64_t>(gguf_get_arr_n(ctx_, id));
+}
+
+int64_t GgufFile::tensor_count() const {
+    return gguf_get_n_tensors(ctx_);
+}
+
+int64_t GgufFile::tensor_data_bytes() const {
+    int64_t total = 0;
+    int64_t n = gguf_get_n_tensors(ctx_);
+    for (int64_t i = 0; i < n; i++) {
+        total += static_cast<int64_t>(gguf_get_tensor_size(ctx_, i));
+    }
+    return total;
+}
+
+int64_t GgufFile::parameter_count() const {
+    int64_t total = 0;
+    int64_t n = gguf_get_n_tensors(ctx_);
+    for (int64_t i = 0; i < n; i++) {
+        ggml_type type = gguf_get_tensor_type(ctx_, i);
+        size_t type_size = ggml_type_size(type);
+        if (type_size == 0) continue;
+        total += static_cast<int64_t>(gguf_get_tensor_size(ctx_, i) / type_size * ggml_blck_size(type));
+    }
+    return total;
+}
+
+const char* file_type_name(int64_t file_type) {
+    // Values of llama_ftype; bit 10 marks a type guessed by the converter.
+    switch (file_type & ~1024) {
+        case 0:  return "F32";
+        case 1:  return "F16";
+        case 2:  return "Q4_0";
+        case 3:  return "Q4_1";
+        case 7:  return "Q8_0";
+        case 8:  return "Q5_0";
+        case 9:  return "Q5_1";
+        case 10: return "Q2_K";
+        case 11: return "Q3_K_S";
+        case 12: return "Q3_K_M";
+        case 13: return "Q3_K_L";
+        case 14: return "Q4_K_S";
+        case 15: return "Q4_K_M";
+        case 16: return "Q5_K_S";
+        case 17: return "Q5_K_M";
+        case 18: return "Q6_K";
+        case 19: return "IQ2_XXS";
+        case 20: return "IQ2_XS";
+        case 21: return "Q2_K_S";
+        case 22: return "IQ3_XS";
+        case 23: return "IQ3_XXS";
+        case 24: return "IQ1_S";
+        case 25: return "IQ4_NL";
+        case 26: return "IQ3_S";
+        case 27: return "IQ3_M";
+        case 28: return "IQ2_S";
+        case 29: return "IQ2_M";
+        case 30: return "IQ4_XS";
+        case 31: return "IQ1_M";
+        case 32: return "BF16";
+        case 36: return "TQ1_0";
+        case 37: return "TQ2_0";
+        case 38: return "MXFP4_MOE";
+        default: return "unknown";
+    }
+}
+
+bool estimate_memory(
+    const GgufFile& file,
+    const MemoryEstimateParams& params,
+    MemoryEstimate* out,
+    std::string* error
+) {
+    int32_t type_k = params.type_k < 0 ? GGML_TYPE_F16 : params.type_k;
+    int32_t type_v = params.type_v < 0 ? GGML_TYPE_F16 : params.type_v;
+    if (!valid_cache_type(type_k) || !valid_cache_type(type_v)) {
+        if (error) *error = "Invalid KV cache type";
+        return false;
+    }
+
+    int32_t n_layer = static_cast<int32_t>(file.get_int(file.arch_key("block_count"), 0));
+    int64_t n_embd = file.get_int(file.arch_key("embedding_length"), 0);
+    int64_t n_ctx_train = file.get_int(file.arch_key("context_length"), 0);
+    int64_t n_vocab = file.get_int(file.arch_key("vocab_size"), 0);
+    if (n_vocab <= 0) {
+        n_vocab = file.get_array_length("tokenizer.ggml.tokens");
+    }
+
+    std::vector<int64_t> n_head = file.get_int_per_layer(file.arch_key("attention.head_count"), 0, n_layer);
+    int64_t n_head_max = n_head.empty() ? 0 : *std::max_element(n_head.begin(), n_head.end());
+    std::vector<int64_t> n_head_kv = file.get_int_per_layer(file.arch_key("attention.head_count_kv"), n_head_max, n_layer);
+    std::vector<int64_t> n_ff = file.get_int_per_layer(file.arch_key("feed_forward_length"), 4 * n_embd, n_layer);
+    int64_t n_ff_max = n_ff.empty() ? 0 : *std::max_element(n_ff.begin(), n_ff.end());
+
+    int64_t head_dim = n_head_max > 0 ? n_embd / n_head_max : 0;
+    int64_t head_dim_k = file.get_int(file.arch_key("attention.key_length"), head_dim);
+    int64_t head_dim_v = file.get_int(file.arch_key("attention.value_length"), head_dim);
+
+    // Same context clamping as dartllm_load_model().
+    int64_t n_ctx = params.context_size > 0 ? params.context_size : n_ctx_train;
+    if (n_ctx_train > 0) n_ctx = std::min(n_ctx, n_ctx_train);
+    if (n_ctx <= 0) {
+        if (error) *error = "Model does not declare a context length";
+        return false;
+    }
+
+    int64_t n_batch = params.batch_size > 0 ? params.batch_size : 512;
+    int64_t n_ubatch = std::min<int64_t>(n_batch, 512);
+
+    out->weights_bytes = file.tensor_data_bytes();
+
+    int64_t kv_bytes = 0;
+    for (int32_t il = 0; il < n_layer; il++) {
+        kv_bytes += static_cast<int64_t>(ggml_row_size(static_cast<ggml_type>(type_k), n_head_kv[il] * head_dim_k));
+        kv_bytes += static_cast<int64_t>(ggml_row_size(static_cast<ggml_type>(type_v), n_head_kv[il] * head_dim_v));
+    }
+    out->kv_cache_bytes = kv_bytes * n_ctx;
+
+    // Compute buffer for the worst-case ubatch: one layer of F32 attention
+    // scores (n_head x n_ubatch x n_ctx) dominates at long contexts, plus
+    // FFN and residual activations and the full-ubatch logits tensor that
+    // llama.cpp reserves for.
+    int64_t attn_scores = n_head_max * n_ubatch * n_ctx * 4;
+    int64_t activations = n_ubatch * (4 * n_embd + 3 * n_ff_max) * 4;
+    int64_t logits = n_ubatch * n_vocab * 4;
+    out->compute_bytes = attn_scores + activations + logits;
+
+    // Host output buffer: logits for one sequence plus one pooled embedding.
+    out->output_bytes = (n_vocab + n_embd) * 4;
+
+    out->context_size = static_cast<int32_t>(n_ctx);
+    out->layer_count = n_layer;
+    return true;
+}
+
+} // namespace dartllm
@@ -0,0 +1,110 @@
+/**
+ * @file gguf_metadata.h
+ * @brief Read GGUF metadata and tensor tables without loading weights (internal)
+ */
+
+#ifndef DARTLLM_GGUF_METADATA_H
+#define DARTLLM_GGUF_METADATA_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct gguf_context;
+
+namespace dartllm {
+
+/**
+ * A GGUF file opened for metadata only.
+ *
+ * Parses the key/value section and tensor table; tensor data is never
+ * read or mapped.
+ */
+class GgufFile {
+public:
+    /**
+     * Open a GGUF file. Returns nullptr and sets `error` on failure.
+     */
+    static std::unique_ptr<GgufFile> open(const std::string& path, std::string* error);
+
+    ~GgufFile();
+
+    GgufFile(const GgufFile&) = delete;
+    GgufFile& operator=(const GgufFile&) = delete;
+
+    /** Value of general.architecture, or "unknown". */
+    const std::string& architecture() const { return architecture_; }
+
+    /** "<architecture>.<suffix>", the key form used for hyperparameters. */
+    std::string arch_key(const char* suffix) const;
+
+    bool has(const std::string& key) const;
+
+    std::string get_string(const std::string& key, const std::string& fallback) const;
+
+    /** Integer, bool or float value; the first element for numeric arrays. */
+    int64_t get_int(const std::string& key, int64_t fallback) const;
+
+    /**
+     * Per-layer integer value. Scalars are broadcast to `n_layer` entries;
+     * arrays shorter than `n_layer` are padded with their last element.
+     */
+    std::vector<int64_t> get_int_per_layer(const std::string& key, int64_t fallback, int32_t n_layer) const;
+
+    /** Number of elements of an array value, or 0. */
+    int64_t get_array_length(const std::string& key) const;
+
+    int64_t tensor_count() const;
+
+    /** Total bytes of tensor data described by the tensor table. */
+    int64_t tensor_data_bytes() const;
+
+    /** Total number of weights across all tensors. */
+    int64_t parameter_count() const;
+
+private:
+    GgufFile() = default;
+
+    gguf_context* ctx_ = nullptr;
+    std::string architecture_;
+};
+
+/**
+ * Short name of a general.file_type value (a llama_ftype), e.g. "Q4_K_M".
+ * Returns "unknown" for unrecognized values.
+ */
+const char* file_type_name(int64_t file_type);
+
+/** Inputs to estimate_memory(); mirrors the dartllm_load_model() arguments. */
+struct MemoryEstimateParams {
+    int32_t context_size = 0;
+    int32_t batch_size = 0;
+    int32_t type_k = -1;
+    int32_t type_v = -1;
+};
+
+struct MemoryEstimate {
+    int64_t weights_bytes = 0;
+    int64_t kv_cache_bytes = 0;
+    int64_t compute_bytes = 0;
+    int64_t output_bytes = 0;
+    int32_t context_size = 0;
+    int32_t layer_count = 0;
+};
+
+/**
+ * Estimate the memory a model would use once loaded with `params`.
+ *
+ * Returns false and sets `error` if the parameters are invalid.
+ */
+bool estimate_memory(
+    const GgufFile& file,
+    const MemoryEstimateParams& params,
+    MemoryEstimate* out,
+    std::string* error
+);
+
+} // namespace dartllm
+
+#endif /* DARTLLM_GGUF_METADATA_H */
@@ -0,0 +1,729 @@
+/**
+ * @file json_schema_grammar.cpp
+ * @brief Convert JSON Schema to a GBNF grammar
+ */
+
+#include "json_schema_grammar.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace dartllm {
+
+namespace {
+
+/** Minimal JSON document model; objects keep their key order. */
+struct JsonValue {
+    enum Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Null;
+    bool boolean = false;
+    double number = 0.0;
+    /** Numbers keep their source text so literals round-trip exactly. */
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* get(const std::string& key) const {
+        if (type != Object) return nullptr;
+        for (const auto& member : members) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& input) : input_(input) {}
+
+    bool parse(JsonValue* out, std::string* error) {
+        skip_space();
+        if (!parse_value(out, 0)) {
+            *error = error_;
+            return false;
+        }
+        skip_space();
+        if (pos_ != input_.size()) {
+            *error = fail("Unexpected trailing characters");
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr int kMaxDepth = 128;
+
+    std::string fail(const char* message) {
+        char buf[128];
+        std::snprintf(buf, sizeof(buf), "%s at offset %zu", message, pos_);
+        error_ = buf;
+        return error_;
+    }
+
+    void skip_space() {
+        while (pos_ < input_.size()) {
+            char c = input_[pos_];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+            pos_++;
+        }
+    }
+
+    bool consume(const char* literal) {
+        size_t n = std::char_traits<char>::length(literal);
+        if (input_.compare(pos_, n, literal) != 0) return false;
+        pos_ += n;
+        return true;
+    }
+
+    bool parse_value(JsonValue* out, int depth) {
+        if (depth > kMaxDepth) {
+            fail("JSON nested too deeply");
+            return false;
+        }
+        if (pos_ >= input_.size()) {
+            fail("Unexpected end of JSON");
+            return false;
+        }
+
+        char c = input_[pos_];
+        if (c == '{') return parse_object(out, depth);
+        if (c == '[') return parse_array(out, depth);
+        if (c == '"') {
+            out->type = JsonValue::String;
+            return parse_string(&out->text);
+        }
+        if (consume("true")) {
+            out->type = JsonValue::Bool;
+            out->boolean = true;
+            return true;
+        }
+        if (consume("false")) {
+            out->type = JsonValue::Bool;
+            return true;
+        }
+        if (consume("null")) {
+            out->type = JsonValue::Null;
+            return true;
+        }
+        if (c == '-' || (c >= '0' && c <= '9')) return parse_number(out);
+
+        fail("Unexpected character");
+        return false;
+    }
+
+    bool parse_object(JsonValue* out, int depth) {
+        out->type = JsonValue::Object;
+        pos_++;
+        skip_space();
+        if (pos_ < input_.size() && input_[pos_] == '}') {
+            pos_++;
+            return true;
+        }
+        while (true) {
+            skip_space();
+            std::string key;
+            if (pos_ >= input_.size() || input_[pos_] != '"' || !parse_string(&key)) {
+                if (error_.empty()) fail("Expected object key");
+                return false;
+            }
+            skip_space();
+            if (pos_ >= input_.size() || input_[pos_] != ':') {
+                fail("Expected ':'");
+                return false;
+            }
+            pos_++;
+            skip_space();
+            JsonValue value;
+            if (!parse_value(&value, depth + 1)) return false;
+            out->members.emplace_back(std::move(key), std::move(value));
+            skip_space();
+            if (pos_ < input_.size() && input_[pos_] == ',') {
+                pos_++;
+                continue;
+            }
+            if (pos_ < input_.size() && input_[pos_] == '}') {
+                pos_++;
+                return true;
+            }
+            fail("Expected ',' or '}'");
+            return false;
+        }
+    }
+
+    bool parse_array(JsonValue* out, int depth) {
+        out->type = JsonValue::Array;
+        pos_++;
+        skip_space();
+        if (pos_ < input_.size() && input_[pos_] == ']') {
+            pos_++;
+            return true;
+        }
+        while (true) {
+            skip_space();
+            JsonValue value;
+            if (!parse_value(&value, depth + 1)) return false;
+            out->items.push_back(std::move(value));
+            skip_space();
+            if (pos_ < input_.size() && input_[pos_] == ',') {
+                pos_++;
+                continue;
+            }
+            if (pos_ < input_.size() && input_[pos_] == ']') {
+                pos_++;
+                return true;
+            }
+            fail("Expected ',' or ']'");
+            return false;
+        }
+    }
+
+    static void append_utf8(std::string* out, uint32_t cp) {
+        if (cp < 0x80) {
+            out->push_back(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+            out->push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            out->push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else {
+            out->push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out->push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    bool parse_hex4(uint32_t* out) {
+        if (pos_ + 4 > input_.size()) return false;
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = input_[pos_++];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        *out = value;
+        return true;
+    }
+
+    bool parse_string(std::string* out) {
+        pos_++;
+        while (pos_ < input_.size()) {
+            char c = input_[pos_++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out->push_back(c);
+                continue;
+            }
+            if (pos_ >= input_.size()) break;
+            char e = input_[pos_++];
+            switch (e) {
+                case '"':  out->push_back('"'); break;
+                case '\\': out->push_back('\\'); break;
+                case '/':  out->push_back('/'); break;
+                case 'b':  out->push_back('\b'); break;
+                case 'f':  out->push_back('\f'); break;
+                case 'n':  out->push_back('\n'); break;
+                case 'r':  out->push_back('\r'); break;
+                case 't':  out->push_back('\t'); break;
+                case 'u': {
+                    uint32_t cp = 0;
+                    if (!parse_hex4(&cp)) {
+                        fail("Invalid \\u escape");
+                        return false;
+                    }
+                    if (cp >= 0xD800 && cp < 0xDC00 && consume("\\u")) {
+                        uint32_t low = 0;
+                        if (!parse_hex4(&low) || low < 0xDC00 || low >= 0xE000) {
+                            fail("Invalid surrogate pair");
+                            return false;
+                        }
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, cp);
+                    break;
+                }
+                default:
+                    fail("Invalid escape");
+                    return false;
+            }
+        }
+        fail("Unterminated string");
+        return false;
+    }
+
+    bool parse_number(JsonValue* out) {
+        size_t start = pos_;
+        if (input_[pos_] == '-') pos_++;
+        while (pos_ < input_.size()) {
+            char c = input_[pos_];
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                pos_++;
+            } else {
+                break;
+            }
+        }
+        out->type = JsonValue::Number;
+        out->text = input_.substr(start, pos_ - start);
+        char* end = nullptr;
+        out->number = std::strtod(out->text.c_str(), &end);
+        if (end != out->text.c_str() + out->text.size()) {
+            pos_ = start;
+            fail("Invalid number");
+            return false;
+        }
+        return true;
+    }
+
+    const std::string& input_;
+    size_t pos_ = 0;
+    std::string error_;
+};
+
+/** Serialize a value as compact JSON, the form the grammar must produce. */
+void write_json(const JsonValue& value, std::string* out) {
+    switch (value.type) {
+        case JsonValue::Null:
+            *out += "null";
+            break;
+        case JsonValue::Bool:
+            *out += value.boolean ? "true" : "false";
+            break;
+        case JsonValue::Number:
+            *out += value.text;
+            break;
+        case JsonValue::String:
+            out->push_back('"');
+            for (unsigned char c : value.text) {
+                if (c == '"' || c == '\\') {
+                    out->push_back('\\');
+                    out->push_back(static_cast<char>(c));
+                } else if (c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    *out += buf;
+                } else {
+                    out->push_back(static_cast<char>(c));
+                }
+            }
+            out->push_back('"');
+            break;
+        case JsonValue::Array:
+            out->push_back('[');
+            for (size_t i = 0; i < value.items.size(); i++) {
+                if (i > 0) out->push_back(',');
+                write_json(value.items[i], out);
+            }
+            out->push_back(']');
+            break;
+        case JsonValue::Object:
+            out->push_back('{');
+            for (size_t i = 0; i < value.members.size(); i++) {
+                if (i > 0) out->push_back(',');
+                JsonValue key;
+                key.type = JsonValue::String;
+                key.text = value.members[i].first;
+                write_json(key, out);
+                out->push_back(':');
+                write_json(value.members[i].second, out);
+            }
+            out->push_back('}');
+            break;
+    }
+}
+
+/** Quote text as a GBNF string literal. */
+std::string gbnf_literal(const std::string& text) {
+    std::string out = "\"";
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\x%02X", c);
+                    out += buf;
+                } else {
+                    out.push_back(static_cast<char>(c));
+                }
+        }
+    }
+    out += "\"";
+    return out;
+}
+
+/** GBNF for a JSON literal value followed by optional whitespace. */
+std::string json_literal(const JsonValue& value) {
+    std::string json;
+    write_json(value, &json);
+    return gbnf_literal(json) + " space";
+}
+
+/** Rule name characters are limited to letters, digits and '-'. */
+std::string sanitize_name(const std::string& name) {
+    std::string out;
+    for (char c : name) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        out.push_back(ok ? c : '-');
+    }
+    return out.empty() ? "rule" : out;
+}
+
+/** Primitive rules and the rules each depends on. */
+const std::map<std::string, std::pair<std::string, std::vector<std::string>>>& primitives() {
+    static const std::map<std::string, std::pair<std::string, std::vector<std::string>>> rules = {
+        {"space", {"| \" \" | \"\\n\" [ \\t]{0,20}", {}}},
+        {"boolean", {"(\"true\" | \"false\") space", {"space"}}},
+        {"null", {"\"null\" space", {"space"}}},
+        {"integral-part", {"[0] | [1-9] [0-9]{0,15}", {}}},
+        {"decimal-part", {"[0-9]{1,16}", {}}},
+        {"integer", {"(\"-\"? integral-part) space", {"integral-part", "space"}}},
+        {"number", {"(\"-\"? integral-part) (\".\" decimal-part)? ([eE] [-+]? integral-part)? space",
+                    {"integral-part", "decimal-part", "space"}}},
+        {"char", {"[^\"\\\\\\x7F\\x00-\\x1F] | [\\\\] ([\"\\\\bfnrt] | \"u\" [0-9a-fA-F]{4})", {}}},
+        {"string", {"\"\\\"\" char* \"\\\"\" space", {"char", "space"}}},
+        {"value", {"object | array | string | number | boolean | null",
+                   {"object", "array", "string", "number", "boolean", "null"}}},
+        {"object", {"\"{\" space ( string \":\" space value (\",\" space string \":\" space value)* )? \"}\" space",
+                    {"string", "value", "space"}}},
+        {"array", {"\"[\" space ( value (\",\" space value)* )? \"]\" space", {"value", "space"}}},
+    };
+    return rules;
+}
+
+class SchemaConverter {
+public:
+    explicit SchemaConverter(const JsonValue& root) : root_(root) {}
+
+    bool convert(std::string* grammar, std::string* error) {
+        std::string root_rule = visit(root_, "root");
+        if (!error_.empty()) {
+            *error = error_;
+            return false;
+        }
+        if (root_rule != "root") {
+            add_rule("root", root_rule);
+        }
+
+        grammar->clear();
+        for (const std::string& name : order_) {
+            *grammar += name + " ::= " + rules_[name] + "\n";
+        }
+        return true;
+    }
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    /** Add a rule, reusing an existing rule with the same body. */
+    std::string add_rule(const std::string& name, const std::string& body) {
+        auto same = bodies_.find(body);
+        if (same != bodies_.end() && name != "root") {
+            return same->second;
+        }
+
+        std::string key = sanitize_name(name);
+        std::string unique = key;
+        for (int i = 1; rules_.count(unique) && rules_[unique] != body; i++) {
+            unique = key + std::to_string(i);
+        }
+        if (!rules_.count(unique)) {
+            order_.push_back(unique);
+        }
+        rules_[unique] = body;
+        bodies_.emplace(body, unique);
+        return unique;
+    }
+
+    std::string primitive(const std::string& name) {
+        if (rules_.count(name)) return name;
+        const auto& entry = primitives().at(name);
+        order_.push_back(name);
+        rules_[name] = entry.first;
+        for (const std::string& dep : entry.second) {
+            primitive(dep);
+        }
+        return name;
+    }
+
+    int64_t get_int(const JsonValue& schema, const char* key, int64_t fallback) {
+        const JsonValue* value = schema.get(key);
+        if (!value || value->type != JsonValue::Number || value->number < 0) return fallback;
+        return static_cast<int64_t>(value->number);
+    }
+
+    /** "{m,n}" style repetition of `item`, or "*" when unbounded. */
+    static std::string repeat(const std::string& item, int64_t min, int64_t max) {
+        if (min == 0 && max < 0) return "(" + item + ")*";
+        if (min == 1 && max < 0) return "(" + item + ")+";
+        std::string out = "(" + item + "){" + std::to_string(min) + ",";
+        if (max >= 0) out += std::to_string(max);
+        return out + "}";
+    }
+
+    std::string resolve_ref(const std::string& ref) {
+        auto known = refs_.find(ref);
+        if (known != refs_.end()) return known->second;
+
+        const char* prefixes[] = {"#/$defs/", "#/definitions/"};
+        for (const char* prefix : prefixes) {
+            std::string p = prefix;
+            if (ref.compare(0, p.size(), p) != 0) continue;
+
+            std::string def_name = ref.substr(p.size());
+            const JsonValue* defs = root_.get(p.substr(2, p.size() - 3));
+            const JsonValue* target = defs ? defs->get(def_name) : nullptr;
+            if (!target) break;
+
+            // Reserve the name first so recursive definitions terminate.
+            std::string name = sanitize_name("ref-" + def_name);
+            refs_[ref] = name;
+            order_.push_back(name);
+            rules_[name] = "";
+            std::string body = visit(*target, name + "-body");
+            rules_[name] = body;
+            return name;
+        }
+
+        error_ = "Unsupported $ref: " + ref;
+        return "value";
+    }
+
+    std::string visit_object(const JsonValue& schema, const std::string& name) {
+        const JsonValue* properties = schema.get("properties");
+        const JsonValue* additional = schema.get("additionalProperties");
+
+        if (!properties || properties->members.empty()) {
+            if (additional && additional->type == JsonValue::Bool && !additional->boolean) {
+                return add_rule(name, "\"{\" space \"}\" space");
+            }
+            if (additional && additional->type == JsonValue::Object) {
+                std::string value = visit(*additional, name + "-value");
+                std::string kv = primitive("string") + " \":\" space " + value;
+                return add_rule(name, "\"{\" space ( " + kv + " (\",\" space " + kv + ")* )? \"}\" space");
+            }
+            return primitive("object");
+        }
+
+        std::set<std::string> required;
+        if (const JsonValue* req = schema.get("required")) {
+            for (const JsonValue& item : req->items) {
+                if (item.type == JsonValue::String) required.insert(item.text);
+            }
+        }
+
+        // Required properties first in declared order, then the optional ones.
+        std::vector<std::string> required_kv;
+        std::vector<std::string> optional_kv;
+        for (const auto& member : properties->members) {
+            JsonValue key;
+            key.type = JsonValue::String;
+            key.text = member.first;
+            std::string value = visit(member.second, name + "-" + member.first);
+            std::string kv = add_rule(name + "-" + member.first + "-kv",
+                json_literal(key) + " \":\" space " + value);
+            (required.count(member.first) ? required_kv : optional_kv).push_back(kv);
+        }
+        primitive("space");
+
+        std::string body = "\"{\" space ";
+        if (!required_kv.empty()) {
+            for (size_t i = 0; i < required_kv.size(); i++) {
+                body += (i == 0 ? "" : "\",\" space ") + required_kv[i] + " ";
+            }
+            for (const std::string& kv : optional_kv) {
+                body += "(\",\" space " + kv + ")? ";
+            }
+        } else {
+            // With nothing required, whichever optional property comes first
+            // has no leading comma.
+            std::string alternatives;
+            for (size_t first = 0; first < optional_kv.size(); first++) {
+                std::string alt = optional_kv[first];
+                for (size_t rest = first + 1; rest < optional_kv.size(); rest++) {
+                    alt += " (\",\" space " + optional_kv[rest] + ")?";
+                }
+                alternatives += (first == 0 ? "" : " | ") + alt;
+            }
+            body += "( " + alternatives + " )? ";
+        }
+        body += "\"}\" space";
+        return add_rule(name, body);
+    }
+
+    std::string visit_array(const JsonValue& schema, const std::string& name) {
+        primitive("space");
+
+        if (const JsonValue* prefix = schema.get("prefixItems")) {
+            std::string body = "\"[\" space ";
+            for (size_t i = 0; i < prefix->items.size(); i++) {
+                std::string item = visit(prefix->items[i], name + "-" + std::to_string(i));
+                body += (i == 0 ? "" : "\",\" space ") + item + " ";
+            }
+            return add_rule(name, body + "\"]\" space");
+        }
+
+        const JsonValue* items = schema.get("items");
+        std::string item = items ? visit(*items, name + "-item") : primitive("value");
+        int64_t min = get_int(schema, "minItems", 0);
+        int64_t max = get_int(schema, "maxItems", -1);
+        if (max >= 0 && max < min) {
+            error_ = "maxItems is less than minItems";
+            return "value";
+        }
+
+        std::string body;
+        if (max == 0) {
+            body = "\"[\" space \"]\" space";
+        } else {
+            std::string tail = repeat("\",\" space " + item, min > 0 ? min - 1 : 0, max >= 0 ? max - 1 : -1);
+            std::string list = item + " " + tail;
+            body = "\"[\" space " + (min == 0 ? "( " + list + " )?" : list) + " \"]\" space";
+        }
+        return add_rule(name, body);
+    }
+
+    std::string visit_string(const JsonValue& schema, const std::string& name) {
+        int64_t min = get_int(schema, "minLength", 0);
+        int64_t max = get_int(schema, "maxLength", -1);
+        if (min == 0 && max < 0) {
+            return primitive("string");
+        }
+        primitive("char");
+        primitive("space");
+        return add_rule(name, "\"\\\"\" " + repeat("char", min, max) + " \"\\\"\" space");
+    }
+
+    std::string visit(const JsonValue& schema, const std::string& name) {
+        if (!error_.empty()) return "value";
+        if (++depth_ > kMaxDepth) {
+            error_ = "Schema nested too deeply";
+            return "value";
+        }
+        std::string rule = visit_inner(schema, name);
+        depth_--;
+        return rule;
+    }
+
+    std::string visit_inner(const JsonValue& schema, const std::string& name) {
+        if (schema.type == JsonValue::Bool) {
+            if (!schema.boolean) {
+                error_ = "Schema 'false' accepts no values";
+            }
+            return primitive("value");
+        }
+        if (schema.type != JsonValue::Object) {
+            error_ = "Schema must be an object";
+            return "value";
+        }
+
+        if (const JsonValue* ref = schema.get("$ref")) {
+            return resolve_ref(ref->text);
+        }
+
+        if (const JsonValue* value = schema.get("const")) {
+            primitive("space");
+            return add_rule(name, json_literal(*value));
+        }
+
+        if (const JsonValue* values = schema.get("enum")) {
+            primitive("space");
+            std::string body;
+            for (size_t i = 0; i < values->items.size(); i++) {
+                body += (i == 0 ? "" : " | ") + json_literal(values->items[i]);
+            }
+            if (body.empty()) {
+                error_ = "Empty enum";
+                return "value";
+            }
+            return add_rule(name, body);
+        }
+
+        const JsonValue* alternatives = schema.get("anyOf");
+        if (!alternatives) alternatives = schema.get("oneOf");
+        if (alternatives) {
+            std::string body;
+            for (size_t i = 0; i < alternatives->items.size(); i++) {
+                std::string alt = visit(alternatives->items[i], name + "-" + std::to_string(i));
+                body += (i == 0 ? "" : " | ") + alt;
+            }
+            return add_rule(name, body.empty() ? "value" : body);
+        }
+
+        if (const JsonValue* all = schema.get("allOf")) {
+            if (all->items.size() != 1) {
+                error_ = "allOf with more than one schema is not supported";
+                return "value";
+            }
+            return visit(all->items[0], name);
+        }
+
+        const JsonValue* type = schema.get("type");
+        if (type && type->type == JsonValue::Array) {
+            std::string body;
+            for (size_t i = 0; i < type->items.size(); i++) {
+                JsonValue single = schema;
+                for (auto& member : single.members) {
+                    if (member.first == "type") member.second = type->items[i];
+                }
+                body += (i == 0 ? "" : " | ") + visit(single, name + "-" + type->items[i].text);
+            }
+            return add_rule(name, body.empty() ? "value" : body);
+        }
+
+        std::string type_name = type ? type->text : "";
+        if (type_name.empty()) {
+            if (schema.get("properties")) type_name = "object";
+            else if (schema.get("items") || schema.get("prefixItems")) type_name = "array";
+        }
+
+        if (type_name == "object") return visit_object(schema, name);
+        if (type_name == "array") return visit_array(schema, name);
+        if (type_name == "string") return visit_string(schema, name);
+        if (type_name == "integer") return primitive("integer");
+        if (type_name == "number") return primitive("number");
+        if (type_name == "boolean") return primitive("boolean");
+        if (type_name == "null") return primitive("null");
+        if (type_name.empty()) return primitive("value");
+
+        error_ = "Unsupported type: " + type_name;
+        return "value";
+    }
+
+    const JsonValue& root_;
+    std::map<std::string, std::string> rules_;
+    std::map<std::string, std::string> bodies_;
+    std::map<std::string, std::string> refs_;
+    std::vector<std::string> order_;
+    std::string error_;
+    int depth_ = 0;
+};
+
+} // anonymous namespace
+
+bool json_schema_to_grammar(const std::string& schema, std::string* grammar, std::string* error) {
+    JsonValue root;
+    JsonParser parser(schema);
+    if (!parser.parse(&root, error)) {
+        *error = "Invalid JSON schema: " + *error;
+        return false;
+    }
+
+    SchemaConverter converter(root);
+    return converter.convert(grammar, error);
+}
+
+} // namespace dartllm
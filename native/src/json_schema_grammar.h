@@ -0,0 +1,30 @@
+/**
+ * @file json_schema_grammar.h
+ * @brief Convert JSON Schema to a GBNF grammar (internal)
+ */
+
+#ifndef DARTLLM_JSON_SCHEMA_GRAMMAR_H
+#define DARTLLM_JSON_SCHEMA_GRAMMAR_H
+
+#include <string>
+
+namespace dartllm {
+
+/**
+ * Convert a JSON Schema document to a GBNF grammar whose root rule accepts
+ * exactly the JSON values the schema allows.
+ *
+ * Supported: type (including type arrays), properties, required,
+ * additionalProperties, items, prefixItems, minItems/maxItems,
+ * minLength/maxLength, enum, const, anyOf/oneOf, single-element allOf and
+ * local $ref into $defs or definitions. Other keywords such as pattern
+ * and format are ignored, so the grammar may be looser than the schema.
+ *
+ * Returns false and sets `error` if the schema is not valid JSON or uses
+ * an unsupported construct such as a remote $ref.
+ */
+bool json_schema_to_grammar(const std::string& schema, std::string* grammar, std::string* error);
+
+} // namespace dartllm
+
+#endif /* DARTLLM_JSON_SCHEMA_GRAMMAR_H */
@@ -0,0 +1,121 @@
+/**
+ * @file prefix_store.cpp
+ * @brief On-disk store of prompt prefix states
+ */
+
+#include "prefix_store.h"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace dartllm {
+
+namespace {
+
+/** Open prefix stores by directory. */
+std::map<std::string, std::weak_ptr<PrefixStore>> g_prefix_stores;
+std::mutex g_prefix_stores_mutex;
+
+std::string prefix_index_file(const std::string& dir) {
+    return dir + "/dartllm_prefix.index";
+}
+
+} // anonymous namespace
+
+std::string prefix_file(const PrefixStore& store, const std::string& key) {
+    return store.dir + "/dartllm_prefix_" + key + ".kv";
+}
+
+std::shared_ptr<PrefixStore> open_prefix_store(const std::string& dir, int64_t budget_bytes) {
+    std::lock_guard<std::mutex> lock(g_prefix_stores_mutex);
+
+    std::shared_ptr<PrefixStore> store = g_prefix_stores[dir].lock();
+    if (!store) {
+        store = std::make_shared<PrefixStore>();
+        store->dir = dir;
+
+        // Entries whose file is gone or has changed size are dropped.
+        std::ifstream index(prefix_index_file(dir));
+        std::string key;
+        int64_t bytes = 0;
+        while (index >> key >> bytes) {
+            struct stat st;
+            if (store->entries.count(key) ||
+                    stat(prefix_file(*store, key).c_str(), &st) != 0 ||
+                    static_cast<int64_t>(st.st_size) != bytes) {
+                continue;
+            }
+            store->lru.push_back({key, bytes});
+            store->entries[key] = std::prev(store->lru.end());
+            store->stored_bytes += bytes;
+        }
+        g_prefix_stores[dir] = store;
+    }
+
+    std::lock_guard<std::mutex> store_lock(store->mutex);
+    store->budget_bytes = budget_bytes;
+    evict_prefixes(store.get(), 0);
+    write_prefix_index(store.get());
+    return store;
+}
+
+void write_prefix_index(PrefixStore* store) {
+    const std::string path = prefix_index_file(store->dir);
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+        if (!file) return;
+        for (const PrefixStore::Entry& entry : store->lru) {
+            file << entry.key << ' ' << entry.bytes << '\n';
+        }
+        if (!file) {
+            file.close();
+            std::remove(temp_path.c_str());
+            return;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+    }
+}
+
+void evict_prefixes(PrefixStore* store, int64_t incoming) {
+    while (!store->lru.empty() && store->stored_bytes + incoming > store->budget_bytes) {
+        const PrefixStore::Entry& victim = store->lru.back();
+        std::remove(prefix_file(*store, victim.key).c_str());
+        store->stored_bytes -= victim.bytes;
+        store->evictions++;
+        store->entries.erase(victim.key);
+        store->lru.pop_back();
+    }
+}
+
+bool touch_prefix(PrefixStore* store, const std::string& key) {
+    auto it = store->entries.find(key);
+    if (it == store->entries.end()) return false;
+    store->lru.splice(store->lru.begin(), store->lru, it->second);
+    return true;
+}
+
+void add_prefix(PrefixStore* store, const std::string& key, int64_t bytes) {
+    store->lru.push_front({key, bytes});
+    store->entries[key] = store->lru.begin();
+    store->stored_bytes += bytes;
+    store->stores++;
+    write_prefix_index(store);
+}
+
+void drop_prefix(PrefixStore* store, const std::string& key) {
+    auto it = store->entries.find(key);
+    if (it == store->entries.end()) return;
+    std::remove(prefix_file(*store, key).c_str());
+    store->stored_bytes -= it->second->bytes;
+    store->lru.erase(it->second);
+    store->entries.erase(it);
+    write_prefix_index(store);
+}
+
+} // namespace dartllm
@@ -0,0 +1,89 @@
+/**
+ * @file prefix_store.h
+ * @brief On-disk store of prompt prefix states (internal)
+ *
+ * Keeps the least recently used order and byte budget of the prefix cache
+ * files in one directory. Only file names and sizes are handled here, so
+ * eviction and the index can be tested without a model; the file contents
+ * are written and read in dartllm.cpp.
+ */
+
+#ifndef DARTLLM_PREFIX_STORE_H
+#define DARTLLM_PREFIX_STORE_H
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace dartllm {
+
+/**
+ * Stored prompt prefix states in one directory, shared by every model set
+ * to use it with dartllm_set_prefix_cache(). Each prefix is one file named
+ * by its key; `lru` lists keys most recently used first and is recorded in
+ * the directory's index file so the order survives restarts. stored_bytes
+ * stays within budget_bytes. All fields are guarded by mutex.
+ */
+struct PrefixStore {
+    struct Entry {
+        std::string key;
+        int64_t bytes = 0;
+    };
+
+    std::string dir;
+    std::mutex mutex;
+    int64_t budget_bytes = 0;
+    int64_t stored_bytes = 0;
+    std::list<Entry> lru;
+    std::map<std::string, std::list<Entry>::iterator> entries;
+
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t tokens_restored = 0;
+    int64_t stores = 0;
+    int64_t evictions = 0;
+};
+
+/** Path of the file holding the prefix `key`. */
+std::string prefix_file(const PrefixStore& store, const std::string& key);
+
+/**
+ * Open the prefix store of `dir` and apply `budget_bytes` to it. The first
+ * open in the process reads the directory's index, dropping entries whose
+ * file is gone or has changed size; later opens share that store while it
+ * is in use.
+ */
+std::shared_ptr<PrefixStore> open_prefix_store(const std::string& dir, int64_t budget_bytes);
+
+/** Record the store's entries in LRU order. Call with store->mutex held. */
+void write_prefix_index(PrefixStore* store);
+
+/**
+ * Delete least recently used prefixes until `incoming` more bytes fit the
+ * budget. Call with store->mutex held.
+ */
+void evict_prefixes(PrefixStore* store, int64_t incoming);
+
+/**
+ * Mark the prefix `key` most recently used. Call with store->mutex held.
+ *
+ * @return false if the store has no such prefix
+ */
+bool touch_prefix(PrefixStore* store, const std::string& key);
+
+/**
+ * Record a prefix file of `bytes` just written for `key` as the most
+ * recently used. Call with store->mutex held, after evict_prefixes() made
+ * room for it.
+ */
+void add_prefix(PrefixStore* store, const std::string& key, int64_t bytes);
+
+/** Delete the prefix `key` and its file. Call with store->mutex held. */
+void drop_prefix(PrefixStore* store, const std::string& key);
+
+} // namespace dartllm
+
+#endif /* DARTLLM_PREFIX_STORE_H */
@@ -0,0 +1,71 @@
+/**
+ * @file registry_policy.cpp
+ * @brief Eviction policy of the model registry
+ */
+
+#include "registry_policy.h"
+
+#include <algorithm>
+
+namespace dartllm {
+
+namespace {
+
+/** Sort slot indices least recently used first. */
+void sort_by_age(const std::vector<ResidencySlot>& slots, std::vector<int32_t>* indices) {
+    std::stable_sort(indices->begin(), indices->end(), [&slots](int32_t a, int32_t b) {
+        return slots[a].last_used < slots[b].last_used;
+    });
+}
+
+} // anonymous namespace
+
+bool plan_evictions(
+    const std::vector<ResidencySlot>& slots,
+    int32_t target,
+    int64_t resident_bytes,
+    int64_t needed,
+    int64_t budget_bytes,
+    std::vector<int32_t>* victims
+) {
+    victims->clear();
+    if (budget_bytes <= 0) return true;
+
+    std::vector<int32_t> candidates;
+    for (int32_t i = 0; i < static_cast<int32_t>(slots.size()); i++) {
+        if (i != target && slots[i].resident && !slots[i].busy) {
+            candidates.push_back(i);
+        }
+    }
+    sort_by_age(slots, &candidates);
+
+    for (int32_t i : candidates) {
+        if (resident_bytes + needed <= budget_bytes) break;
+        victims->push_back(i);
+        resident_bytes -= slots[i].cost_bytes;
+    }
+
+    if (resident_bytes + needed > budget_bytes) {
+        victims->clear();
+        return false;
+    }
+    return true;
+}
+
+std::vector<int32_t> plan_warm_trim(const std::vector<ResidencySlot>& slots, int32_t max_warm) {
+    std::vector<int32_t> warm;
+    for (int32_t i = 0; i < static_cast<int32_t>(slots.size()); i++) {
+        if (slots[i].warm && !slots[i].busy) {
+            warm.push_back(i);
+        }
+    }
+
+    int32_t excess = static_cast<int32_t>(warm.size()) - std::max(max_warm, 0);
+    if (excess <= 0) return {};
+
+    sort_by_age(slots, &warm);
+    warm.resize(excess);
+    return warm;
+}
+
+} // namespace dartllm
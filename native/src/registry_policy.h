@@ -0,0 +1,61 @@
+/**
+ * @file registry_policy.h
+ * @brief Eviction policy of the model registry (internal)
+ *
+ * Works on plain descriptions of the registered models so the choice of
+ * what to evict can be tested without loading any.
+ */
+
+#ifndef DARTLLM_REGISTRY_POLICY_H
+#define DARTLLM_REGISTRY_POLICY_H
+
+#include <cstdint>
+#include <vector>
+
+namespace dartllm {
+
+/** What the eviction policy knows about one registered model. */
+struct ResidencySlot {
+    /** Estimated bytes while resident. */
+    int64_t cost_bytes = 0;
+
+    /** Registry clock value of the last acquire or release. */
+    uint64_t last_used = 0;
+
+    /** Weights and context are loaded. */
+    bool resident = false;
+
+    /** Evicted with its weights kept loaded. */
+    bool warm = false;
+
+    /** Acquired or being loaded; never evicted. */
+    bool busy = false;
+};
+
+/**
+ * Choose resident idle models to evict, least recently used first, until
+ * `needed` more bytes fit within `budget_bytes` (0 for unlimited). The
+ * slot `target`, which the bytes are for, is never chosen; pass -1 if it
+ * has no slot.
+ *
+ * @return false, with `victims` empty, if the bytes cannot fit even with
+ *         every idle model evicted
+ */
+bool plan_evictions(
+    const std::vector<ResidencySlot>& slots,
+    int32_t target,
+    int64_t resident_bytes,
+    int64_t needed,
+    int64_t budget_bytes,
+    std::vector<int32_t>* victims
+);
+
+/**
+ * Choose idle warm models to unload fully, least recently used first, so
+ * that at most `max_warm` stay warm.
+ */
+std::vector<int32_t> plan_warm_trim(const std::vector<ResidencySlot>& slots, int32_t max_warm);
+
+} // namespace dartllm
+
+#endif /* DARTLLM_REGISTRY_POLICY_H */
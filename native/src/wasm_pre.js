@@ -1,13 +1,349 @@
+/*
+ * scripts/build_wasm.sh ships three variants:
+ *   dartllm.js      + dartllm.wasm       scalar, single-threaded
+ *                   + dartllm-simd.wasm  SIMD128, single-threaded
+ *   dartllm-mt.js   + dartllm-mt.wasm    SIMD128 with a pthread worker pool
+ * The two single-threaded binaries share dartllm.js, which loads the SIMD
+ * one whenever the runtime validates SIMD. The threaded glue needs
+ * SharedArrayBuffer, so hosts load it only on cross-origin isolated pages
+ * (self.crossOriginIsolated) and use dartllm.js otherwise; it refuses to
+ * start without shared memory rather than failing later.
+ */
+// Set by the wasm_variant.js pre-js that CMake writes for each build.
+var dartllmThreaded = !!Module['dartllmThreaded'];
+
+Module['dartllmSupportsSimd'] = function() {
+    // Smallest module using a v128 instruction.
+    var simd = new Uint8Array([
+        0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10,
+        10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+    ]);
+    try {
+        return typeof WebAssembly === 'object' && WebAssembly.validate(simd);
+    } catch (e) {
+        return false;
+    }
+};
+
+Module['dartllmCanUseThreads'] = function() {
+    if (typeof SharedArrayBuffer === 'undefined') return false;
+    var isolated = typeof crossOriginIsolated === 'undefined' || crossOriginIsolated;
+    return isolated && Module['dartllmSupportsSimd']();
+};
+
+/** 'scalar', 'simd' or 'threads': the binary this module instance runs. */
+Module['dartllmVariant'] = dartllmThreaded
+    ? 'threads'
+    : (Module['dartllmSupportsSimd']() ? 'simd' : 'scalar');
+
+if (dartllmThreaded && !Module['dartllmThreadPoolSize']) {
+    // One worker per core beyond the calling thread. dartllm_load_model()
+    // plans at most this many threads plus the caller; set it before
+    // startup to trade page responsiveness for speed.
+    var cores = (typeof navigator === 'object' && navigator.hardwareConcurrency) || 4;
+    Module['dartllmThreadPoolSize'] = Math.max(1, Math.min(cores, 16) - 1);
+}
+
+if (dartllmThreaded && !Module['dartllmCanUseThreads']()) {
+    var reason = 'dartllm-mt.js needs SharedArrayBuffer; serve the page with ' +
+        'Cross-Origin-Opener-Policy and Cross-Origin-Embedder-Policy headers ' +
+        'or load dartllm.js instead';
+    if (typeof Module['onError'] === 'function') {
+        Module['onError'](reason);
+    }
+    throw new Error(reason);
+}
+
 Module['locateFile'] = function(path, prefix) {
     if (path.endsWith('.wasm')) {
         if (typeof Module['wasmBinaryFile'] === 'string') {
             return Module['wasmBinaryFile'];
         }
+        if (path === 'dartllm.wasm' && Module['dartllmVariant'] === 'simd') {
+            return prefix + 'dartllm-simd.wasm';
+        }
         return prefix + path;
     }
     return prefix + path;
 };
 
+/**
+ * Reserve `size` bytes of the wasm heap for a model file and expose them at
+ * /models/<name> for dartllm_load_model(). write() copies each chunk
+ * straight into the heap, so the caller never holds the whole model. Load
+ * with use_mmap set: the mapping then aliases the same bytes rather than
+ * copying them. Call free() once the model is freed.
+ */
+Module['dartllmCreateModelFile'] = function(name, size) {
+    var ptr = Module['_malloc'](size);
+    if (!ptr) {
+        throw new Error('Cannot reserve ' + size + ' bytes for model ' + name);
+    }
+    var path = '/models/' + name;
+    try {
+        FS.mkdir('/models');
+    } catch (e) {
+        // Already exists.
+    }
+    FS.writeFile(path, new Uint8Array(0));
+    var node = FS.lookupPath(path).node;
+    // A fresh view on every access: heap growth detaches older ones.
+    Object.defineProperty(node, 'contents', {
+        configurable: true,
+        get: function() { return HEAPU8.subarray(ptr, ptr + size); }
+    });
+    node.usedBytes = size;
+
+    return {
+        path: path,
+        size: size,
+        write: function(chunk, offset) {
+            if (offset < 0 || offset + chunk.length > size) {
+                throw new RangeError('Chunk outside model file ' + name);
+            }
+            HEAPU8.set(chunk, ptr + offset);
+        },
+        free: function() {
+            FS.unlink(path);
+            Module['_free'](ptr);
+        }
+    };
+};
+
+/**
+ * Fetch a model into a file from dartllmCreateModelFile(), one response
+ * chunk at a time. The server must report Content-Length.
+ *
+ * @param onProgress Optional function(bytesDone, bytesTotal)
+ * @return Promise of the file object
+ */
+Module['dartllmFetchModel'] = async function(url, name, onProgress) {
+    var response = await fetch(url);
+    if (!response.ok) {
+        throw new Error('Failed to fetch ' + url + ': HTTP ' + response.status);
+    }
+    var size = Number(response.headers.get('Content-Length'));
+    if (!size) {
+        throw new Error('Missing Content-Length for ' + url);
+    }
+
+    var file = Module['dartllmCreateModelFile'](name, size);
+    try {
+        var reader = response.body.getReader();
+        var offset = 0;
+        for (;;) {
+            var step = await reader.read();
+            if (step.done) break;
+            file.write(step.value, offset);
+            offset += step.value.length;
+            if (onProgress) onProgress(offset, size);
+        }
+        if (offset !== size) {
+            throw new Error('Truncated download of ' + url);
+        }
+    } catch (e) {
+        file.free();
+        throw e;
+    }
+    return file;
+};
+
+/**
+ * Generate from `tokens` one token per turn of the event loop, through a
+ * temporary session and dartllm_stream_next(), so the first token reaches
+ * the page as soon as the prompt is decoded.
+ *
+ * @param options  {maxTokens, temperature, topP, topK, minP, seed}
+ * @param onToken  function(token, text, isFinal, finishReason); return
+ *                 false to stop early
+ * @return Promise of the finish reason (0=stop, 1=length, 2=error, -1 if
+ *         stopped by onToken)
+ */
+Module['dartllmGenerateStream'] = async function(model, tokens, options, onToken) {
+    var session = Module['_dartllm_session_create'](model);
+    if (!session) {
+        throw new Error(UTF8ToString(Module['_dartllm_get_last_error']()));
+    }
+
+    var stream = 0;
+    var report = 0;
+    try {
+        var prompt = Module['_malloc'](tokens.length * 4);
+        HEAP32.set(tokens, prompt >> 2);
+        var appended = Module['_dartllm_session_append'](session, prompt, tokens.length);
+        Module['_free'](prompt);
+        if (appended < 0) {
+            throw new Error(UTF8ToString(Module['_dartllm_get_last_error']()));
+        }
+
+        stream = Module['_dartllm_stream_begin'](
+            session, options.maxTokens, options.temperature, options.topP,
+            options.topK, options.minP, options.seed == null ? -1 : options.seed, 0);
+        if (!stream) {
+            throw new Error(UTF8ToString(Module['_dartllm_get_last_error']()));
+        }
+
+        // DartLLMStreamToken: token, is_final, finish_reason, text[256].
+        report = Module['_malloc'](268);
+        for (;;) {
+            if (Module['_dartllm_stream_next'](stream, report) !== 0) {
+                throw new Error(UTF8ToString(Module['_dartllm_get_last_error']()));
+            }
+            var isFinal = HEAP8[report + 4] !== 0;
+            var finishReason = HEAP32[(report + 8) >> 2];
+            var more = onToken(HEAP32[report >> 2], UTF8ToString(report + 12),
+                               isFinal, finishReason);
+            if (isFinal) return finishReason;
+            if (more === false) return -1;
+            await new Promise(function(resolve) { setTimeout(resolve, 0); });
+        }
+    } finally {
+        if (report) Module['_free'](report);
+        if (stream) Module['_dartllm_stream_free'](stream);
+        Module['_dartllm_session_free'](session);
+    }
+};
+
+/*
+ * The DartLLMWasm interface that lib/src/platform/wasm_binding.dart calls.
+ * Hosts publish the instantiated module as window.DartLLMWasm. Model
+ * handles are the native model pointers; models are loaded from files made
+ * with dartllmFetchModel() or dartllmCreateModelFile().
+ */
+function dartllmLastError() {
+    return UTF8ToString(Module['_dartllm_get_last_error']());
+}
+
+/** Copy an Int32Array into the heap; the caller frees the pointer. */
+function dartllmHeapTokens(tokens) {
+    var ptr = Module['_malloc'](Math.max(tokens.length, 1) * 4);
+    HEAP32.set(tokens, ptr >> 2);
+    return ptr;
+}
+
+/** Read an int64 field; model sizes stay far below 2^53. */
+function dartllmReadInt64(ptr) {
+    return (HEAP32[ptr >> 2] >>> 0) + HEAP32[(ptr + 4) >> 2] * 4294967296;
+}
+
+Module['init'] = async function() {
+    return Module['_dartllm_init']() === 0;
+};
+
+/**
+ * @param path  Path of a model file inside the module's file system
+ * @return Promise of the model handle, or 0 on failure
+ */
+Module['loadModel'] = async function(path, contextSize, gpuLayers, batchSize) {
+    var pathPtr = stringToNewUTF8(path);
+    try {
+        // use_mmap aliases the heap-backed file instead of copying it.
+        return Module['_dartllm_load_model'](pathPtr, contextSize, gpuLayers, 0, batchSize, 1);
+    } finally {
+        Module['_free'](pathPtr);
+    }
+};
+
+Module['unloadModel'] = async function(handle) {
+    Module['_dartllm_free_model'](handle);
+};
+
+Module['getModelInfo'] = async function(handle) {
+    var info = Module['_dartllm_get_model_info'](handle);
+    if (!info) throw new Error(dartllmLastError());
+    // Offsets of the DartLLMModelInfo fields on wasm32.
+    var result = {
+        name: UTF8ToString(info, 256),
+        parameterCount: dartllmReadInt64(info + 256),
+        architecture: UTF8ToString(info + 264, 64),
+        quantization: UTF8ToString(info + 328, 32),
+        contextSize: HEAP32[(info + 360) >> 2],
+        vocabularySize: HEAP32[(info + 364) >> 2],
+        embeddingSize: HEAP32[(info + 368) >> 2],
+        layerCount: HEAP32[(info + 372) >> 2],
+        headCount: HEAP32[(info + 376) >> 2],
+        fileSizeBytes: dartllmReadInt64(info + 384),
+        supportsEmbedding: HEAP8[info + 392] !== 0,
+        supportsVision: HEAP8[info + 393] !== 0,
+        chatTemplate: UTF8ToString(info + 394, 4096) || null
+    };
+    Module['_dartllm_free'](info);
+    return result;
+};
+
+Module['tokenize'] = async function(handle, text, addSpecialTokens) {
+    var textPtr = stringToNewUTF8(text);
+    var lengthPtr = Module['_malloc'](4);
+    try {
+        var tokensPtr = Module['_dartllm_tokenize'](handle, textPtr, addSpecialTokens ? 1 : 0, lengthPtr);
+        if (!tokensPtr) throw new Error(dartllmLastError());
+        var length = HEAP32[lengthPtr >> 2];
+        var tokens = HEAP32.slice(tokensPtr >> 2, (tokensPtr >> 2) + length);
+        Module['_dartllm_free'](tokensPtr);
+        return tokens;
+    } finally {
+        Module['_free'](lengthPtr);
+        Module['_free'](textPtr);
+    }
+};
+
+Module['detokenize'] = async function(handle, tokens) {
+    var tokensPtr = dartllmHeapTokens(tokens);
+    try {
+        var textPtr = Module['_dartllm_detokenize'](handle, tokensPtr, tokens.length);
+        if (!textPtr) throw new Error(dartllmLastError());
+        var text = UTF8ToString(textPtr);
+        Module['_dartllm_free'](textPtr);
+        return text;
+    } finally {
+        Module['_free'](tokensPtr);
+    }
+};
+
+/**
+ * dartllmGenerateStream() under the binding's name. The polled stream
+ * samples with maxTokens, temperature, topP, topK, minP and seed; the
+ * penalty fields of the config are ignored.
+ */
+Module['generateStream'] = function(handle, tokens, config, onToken) {
+    return Module['dartllmGenerateStream'](handle, tokens, config, onToken);
+};
+
+Module['generate'] = async function(handle, tokens, config) {
+    var generated = [];
+    var start = Date.now();
+    var finishReason = await Module['generateStream'](handle, tokens, config,
+        function(token, text, isFinal) {
+            if (!isFinal) generated.push(token);
+        });
+    return {
+        tokens: Int32Array.from(generated),
+        finishReason: finishReason,
+        generationTimeMs: Date.now() - start
+    };
+};
+
+Module['embed'] = async function(handle, tokens, normalize) {
+    var tokensPtr = dartllmHeapTokens(tokens);
+    var dimensionPtr = Module['_malloc'](4);
+    try {
+        var embeddingPtr = Module['_dartllm_embed'](handle, tokensPtr, tokens.length,
+                                                   normalize ? 1 : 0, dimensionPtr);
+        if (!embeddingPtr) throw new Error(dartllmLastError());
+        var dimension = HEAP32[dimensionPtr >> 2];
+        var embedding = HEAPF32.slice(embeddingPtr >> 2, (embeddingPtr >> 2) + dimension);
+        Module['_dartllm_free'](embeddingPtr);
+        return embedding;
+    } finally {
+        Module['_free'](dimensionPtr);
+        Module['_free'](tokensPtr);
+    }
+};
+
+Module['hasWebGPU'] = function() {
+    return Module['_dartllm_has_gpu_support']() !== 0;
+};
+
 Module['onRuntimeInitialized'] = function() {
     if (typeof Module['onReady'] === 'function') {
         Module['onReady']();
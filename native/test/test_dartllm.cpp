@@ -1,7 +1,20 @@
 #include "../src/dartllm.h"
+#include "../src/cpu_topology.h"
+#include "../src/dartllm_internal.h"
+#include "../src/json_schema_grammar.h"
+#include "../src/prefix_store.h"
+#include "../src/registry_policy.h"
+#include <algorithm>
 #include <cassert>
-#include <cstring>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
 
 void test_init() {
     printf("Testing dartllm_init...\n");
@@ -70,6 +83,949 @@ void test_null_model_operations() {
     printf("  PASSED\n");
 }
 
+/** Directory for files written by the tests. */
+std::string temp_path(const char* name) {
+    const char* dir = std::getenv("TMPDIR");
+    return std::string(dir && *dir ? dir : "/tmp") + "/" + name;
+}
+
+/** Writes a little-endian GGUF v3 file piece by piece. */
+class GgufWriter {
+public:
+    void u32(uint32_t v) { raw(&v, sizeof(v)); }
+    void u64(uint64_t v) { raw(&v, sizeof(v)); }
+    void str(const std::string& v) { u64(v.size()); raw(v.data(), v.size()); }
+
+    void kv_u32(const std::string& key, uint32_t v) { str(key); u32(4); u32(v); }
+    void kv_str(const std::string& key, const std::string& v) { str(key); u32(8); str(v); }
+
+    void tensor(const std::string& name, uint64_t ne0, uint64_t ne1, uint32_t type, uint64_t offset) {
+        str(name);
+        u32(2);
+        u64(ne0);
+        u64(ne1);
+        u32(type);
+        u64(offset);
+    }
+
+    /** Pad to the default 32-byte alignment and append `n` bytes of tensor data. */
+    void data(size_t n) {
+        bytes_.resize((bytes_.size() + 31) / 32 * 32, 0);
+        bytes_.resize(bytes_.size() + n, 0);
+    }
+
+    bool save(const std::string& path) const {
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        bool ok = std::fwrite(bytes_.data(), 1, bytes_.size(), file) == bytes_.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+private:
+    void raw(const void* data, size_t n) {
+        const auto* p = static_cast<const uint8_t*>(data);
+        bytes_.insert(bytes_.end(), p, p + n);
+    }
+
+    std::vector<uint8_t> bytes_;
+};
+
+const size_t kTinyTemplateLength = 5000;
+
+/**
+ * A two-layer "llama" model with no usable weights: 64-dim embeddings,
+ * 4 query and 2 KV heads, FFN 128, vocab 100, trained context 256, and
+ * tensors of 64x100 F32 (25600 bytes) and 64x64 F16 (8192 bytes).
+ */
+std::string write_tiny_gguf() {
+    GgufWriter w;
+    w.u32(0x46554747);  // "GGUF"
+    w.u32(3);
+    w.u64(2);           // tensors
+    w.u64(10);          // key/value pairs
+    w.kv_str("general.architecture", "llama");
+    w.kv_str("general.name", "tiny");
+    w.kv_u32("general.file_type", 1);
+    w.kv_u32("llama.block_count", 2);
+    w.kv_u32("llama.embedding_length", 64);
+    w.kv_u32("llama.context_length", 256);
+    w.kv_u32("llama.attention.head_count", 4);
+    w.kv_u32("llama.attention.head_count_kv", 2);
+    w.kv_u32("llama.feed_forward_length", 128);
+    w.kv_str("tokenizer.chat_template", std::string(kTinyTemplateLength, 'x'));
+    w.tensor("token_embd.weight", 64, 100, 0, 0);
+    w.tensor("blk.0.attn_q.weight", 64, 64, 1, 25600);
+    w.data(25600 + 8192);
+
+    std::string path = temp_path("dartllm_test_tiny.gguf");
+    assert(w.save(path));
+    return path;
+}
+
+void test_estimate_memory() {
+    printf("Testing dartllm_estimate_memory...\n");
+
+    DartLLMMemoryEstimate* estimate = dartllm_estimate_memory(nullptr, 0, 0, -1, -1);
+    assert(estimate == nullptr);
+
+    estimate = dartllm_estimate_memory("/nonexistent/path.gguf", 2048, 512, -1, -1);
+    assert(estimate == nullptr);
+    assert(dartllm_get_last_error() != nullptr);
+    dartllm_clear_error();
+
+    std::string path = write_tiny_gguf();
+
+    // Context 128, batch 64, F16 cache. KV: 2 layers x (K + V rows of
+    // 2 heads x 16 dims x 2 bytes) x 128 cells. Compute: attention scores
+    // 4 x 64 x 128 x 4, activations 64 x (4 x 64 + 3 x 128) x 4, logits
+    // 64 x 100 x 4. Output: (100 + 64) x 4.
+    estimate = dartllm_estimate_memory(path.c_str(), 128, 64, -1, -1);
+    assert(estimate != nullptr);
+    assert(estimate->weights_bytes == 25600 + 8192);
+    assert(estimate->kv_cache_bytes == 2 * (64 + 64) * 128);
+    assert(estimate->compute_bytes == 4 * 64 * 128 * 4 + 64 * (4 * 64 + 3 * 128) * 4 + 64 * 100 * 4);
+    assert(estimate->output_bytes == (100 + 64) * 4);
+    assert(estimate->total_bytes == estimate->weights_bytes + estimate->kv_cache_bytes
+        + estimate->compute_bytes + estimate->output_bytes);
+    assert(estimate->context_size == 128);
+    assert(estimate->layer_count == 2);
+    dartllm_free(estimate);
+
+    // The context is clamped to the trained length; 0 means all of it.
+    estimate = dartllm_estimate_memory(path.c_str(), 4096, 64, -1, -1);
+    assert(estimate != nullptr && estimate->context_size == 256);
+    dartllm_free(estimate);
+    estimate = dartllm_estimate_memory(path.c_str(), 0, 64, -1, -1);
+    assert(estimate != nullptr && estimate->context_size == 256);
+    int64_t f16_kv = estimate->kv_cache_bytes;
+    dartllm_free(estimate);
+
+    // An F32 cache doubles the KV bytes.
+    estimate = dartllm_estimate_memory(path.c_str(), 0, 64, 0, 0);
+    assert(estimate != nullptr && estimate->kv_cache_bytes == 2 * f16_kv);
+    dartllm_free(estimate);
+
+    estimate = dartllm_estimate_memory(path.c_str(), 0, 64, 9999, -1);
+    assert(estimate == nullptr);
+    assert(dartllm_get_last_error() != nullptr);
+    dartllm_clear_error();
+
+    std::remove(path.c_str());
+    printf("  PASSED\n");
+}
+
+void test_probe_model() {
+    printf("Testing dartllm_probe_model...\n");
+
+    DartLLMModelInfo* info = dartllm_probe_model(nullptr, nullptr);
+    assert(info == nullptr);
+
+    info = dartllm_probe_model("/nonexistent/path.gguf", nullptr);
+    assert(info == nullptr);
+    assert(dartllm_get_last_error() != nullptr);
+    dartllm_clear_error();
+
+    char* chat_template = dartllm_probe_chat_template("/nonexistent/path.gguf", nullptr);
+    assert(chat_template == nullptr);
+    dartllm_clear_error();
+
+    // A file that is not GGUF fails to probe.
+    std::string bogus = temp_path("dartllm_test_bogus.gguf");
+    FILE* file = std::fopen(bogus.c_str(), "wb");
+    assert(file != nullptr);
+    std::fputs("not a model", file);
+    std::fclose(file);
+    assert(dartllm_probe_model(bogus.c_str(), nullptr) == nullptr);
+    dartllm_clear_error();
+    std::remove(bogus.c_str());
+
+    std::string path = write_tiny_gguf();
+    info = dartllm_probe_model(path.c_str(), nullptr);
+    assert(info != nullptr);
+    assert(std::strcmp(info->name, "tiny") == 0);
+    assert(std::strcmp(info->architecture, "llama") == 0);
+    assert(std::strcmp(info->quantization, "F16") == 0);
+    assert(info->parameter_count == 64 * 100 + 64 * 64);
+    assert(info->context_size == 256);
+    assert(info->embedding_size == 64);
+    assert(info->layer_count == 2);
+    assert(info->head_count == 4);
+    assert(info->supports_embedding == 0);
+    assert(info->file_size_bytes > 25600 + 8192);
+    // The struct holds a truncated template; the full one is separate.
+    assert(std::strlen(info->chat_template) == sizeof(info->chat_template) - 1);
+    dartllm_free(info);
+
+    chat_template = dartllm_probe_chat_template(path.c_str(), nullptr);
+    assert(chat_template != nullptr);
+    assert(std::strlen(chat_template) == kTinyTemplateLength);
+    dartllm_free(chat_template);
+
+    std::remove(path.c_str());
+    printf("  PASSED\n");
+}
+
+void test_warmup() {
+    printf("Testing dartllm_warmup...\n");
+
+    assert(dartllm_warmup(nullptr, DARTLLM_WARMUP_READ) == -1);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid parameters") == 0);
+
+    // The mode is checked before the model.
+    assert(dartllm_warmup(nullptr, 0) == -1);
+    assert(std::strstr(dartllm_get_last_error(), "warm-up mode") != nullptr);
+    assert(dartllm_warmup(nullptr, DARTLLM_WARMUP_DECODE << 1) == -1);
+    assert(std::strstr(dartllm_get_last_error(), "warm-up mode") != nullptr);
+    dartllm_clear_error();
+
+    DartLLMWarmupStatus status;
+    assert(dartllm_warmup_status(nullptr, &status) == -1);
+    assert(dartllm_warmup_wait(nullptr) == -1);
+    dartllm_clear_error();
+
+    printf("  PASSED\n");
+}
+
+void test_registry() {
+    printf("Testing dartllm_registry...\n");
+
+    assert(dartllm_registry_create(-1, 0) == nullptr);
+    dartllm_clear_error();
+
+    void* registry = dartllm_registry_create(1000, 2);
+    assert(registry != nullptr);
+
+    int32_t result = dartllm_registry_register(registry, "missing", "/nonexistent/path.gguf", 2048, 0, 0, 512, 1);
+    assert(result == -1);
+    dartllm_clear_error();
+
+    // Registration only reads the header; the model costs more than the
+    // budget, so acquiring it fails before anything is loaded.
+    std::string path = write_tiny_gguf();
+    assert(dartllm_registry_register(registry, "tiny", path.c_str(), 128, 0, 0, 64, 1) == 0);
+    assert(dartllm_registry_register(registry, "tiny", path.c_str(), 128, 0, 0, 64, 1) == -2);
+    dartllm_clear_error();
+
+    assert(dartllm_registry_acquire(registry, "tiny") == nullptr);
+    assert(std::strstr(dartllm_get_last_error(), "budget") != nullptr);
+    dartllm_clear_error();
+
+    DartLLMRegistryStats stats;
+    assert(dartllm_registry_stats(registry, &stats) == 0);
+    assert(stats.budget_bytes == 1000);
+    assert(stats.registered_models == 1);
+    assert(stats.resident_models == 0);
+    assert(stats.resident_bytes == 0);
+    assert(stats.loads == 0);
+    assert(stats.active_handles == 0);
+
+    assert(dartllm_registry_unregister(registry, "tiny") == 0);
+    assert(dartllm_registry_unregister(registry, "tiny") == -1);
+    dartllm_clear_error();
+
+    int dummy = 0;
+    assert(dartllm_registry_release(registry, &dummy) == -1);
+    dartllm_clear_error();
+
+    dartllm_registry_free(registry);
+    dartllm_registry_free(nullptr);
+    std::remove(path.c_str());
+
+    printf("  PASSED\n");
+}
+
+/** A resident, idle model slot. */
+dartllm::ResidencySlot resident_slot(int64_t cost_bytes, uint64_t last_used) {
+    dartllm::ResidencySlot slot;
+    slot.cost_bytes = cost_bytes;
+    slot.last_used = last_used;
+    slot.resident = true;
+    return slot;
+}
+
+void test_registry_policy() {
+    printf("Testing registry eviction policy...\n");
+
+    // Three resident models fill a budget of 300; 150 more bytes evict the
+    // two least recently used, oldest first.
+    std::vector<dartllm::ResidencySlot> slots = {
+        resident_slot(100, 3),
+        resident_slot(100, 1),
+        resident_slot(100, 2),
+    };
+    std::vector<int32_t> victims;
+    assert(dartllm::plan_evictions(slots, -1, 300, 150, 300, &victims));
+    assert((victims == std::vector<int32_t>{1, 2}));
+
+    // Nothing is evicted while the bytes already fit.
+    assert(dartllm::plan_evictions(slots, -1, 300, 0, 300, &victims));
+    assert(victims.empty());
+
+    // Acquired, loading, warm and target models are never chosen.
+    slots[1].busy = true;
+    slots[2].resident = false;
+    slots[2].warm = true;
+    slots.push_back(resident_slot(100, 0));
+    assert(dartllm::plan_evictions(slots, 3, 300, 100, 300, &victims));
+    assert((victims == std::vector<int32_t>{0}));
+
+    // When even every idle model is not enough, nothing is evicted.
+    assert(!dartllm::plan_evictions(slots, 3, 300, 250, 300, &victims));
+    assert(victims.empty());
+
+    // No budget means no evictions.
+    assert(dartllm::plan_evictions(slots, -1, 1000, 1000, 0, &victims));
+    assert(victims.empty());
+
+    // Warm models beyond the limit are unloaded oldest first; busy ones are
+    // neither counted nor chosen.
+    std::vector<dartllm::ResidencySlot> warm(4);
+    const uint64_t ages[] = {5, 2, 9, 1};
+    for (size_t i = 0; i < warm.size(); i++) {
+        warm[i].warm = true;
+        warm[i].last_used = ages[i];
+    }
+    assert((dartllm::plan_warm_trim(warm, 1) == std::vector<int32_t>{3, 1, 0}));
+    assert(dartllm::plan_warm_trim(warm, 4).empty());
+    warm[3].busy = true;
+    assert((dartllm::plan_warm_trim(warm, 2) == std::vector<int32_t>{1}));
+
+    printf("  PASSED\n");
+}
+
+void test_lora() {
+    printf("Testing dartllm_lora...\n");
+
+    assert(dartllm_lora_load(nullptr, "adapter.gguf") == nullptr);
+    assert(dartllm_lora_free(nullptr, nullptr) == -1);
+    assert(dartllm_session_set_lora(nullptr, nullptr, 1.0f) == -1);
+    dartllm_clear_error();
+
+    // An empty session may take any adapter; one holding tokens keeps the
+    // adapter and scale its KV cache was computed under.
+    int first = 0;
+    int second = 0;
+    assert(dartllm::can_change_lora(0, nullptr, 1.0f, &first, 0.5f));
+    assert(dartllm::can_change_lora(0, &first, 1.0f, &second, 1.0f));
+    assert(dartllm::can_change_lora(8, &first, 1.0f, &first, 1.0f));
+    assert(!dartllm::can_change_lora(8, &first, 1.0f, &first, 0.5f));
+    assert(!dartllm::can_change_lora(8, &first, 1.0f, &second, 1.0f));
+    assert(!dartllm::can_change_lora(8, &first, 1.0f, nullptr, 1.0f));
+    assert(!dartllm::can_change_lora(8, nullptr, 1.0f, &first, 1.0f));
+    assert(dartllm::can_change_lora(8, nullptr, 1.0f, nullptr, 0.5f));
+
+    printf("  PASSED\n");
+}
+
+/** Greedy completion of `prompt`, so runs with the same adapter agree. */
+std::vector<int32_t> greedy(void* model, const std::vector<int32_t>& prompt, void* lora) {
+    DartLLMGenerateResult* result = dartllm_generate(model, prompt.data(), static_cast<int32_t>(prompt.size()),
+                                                     16, 0.0f, 1.0f, 1, 0.0f, 1.0f, 42, lora, 1.0f, nullptr);
+    assert(result != nullptr);
+    std::vector<int32_t> tokens(result->tokens, result->tokens + result->token_count);
+    dartllm_free(result);
+    return tokens;
+}
+
+/**
+ * Switch adapters between requests and sessions on a real model. Needs a
+ * base model and an adapter trained for it, named by DARTLLM_TEST_MODEL and
+ * DARTLLM_TEST_LORA; skipped otherwise.
+ */
+void test_lora_switching() {
+    printf("Testing LoRA adapter switching...\n");
+
+    const char* model_path = std::getenv("DARTLLM_TEST_MODEL");
+    const char* lora_path = std::getenv("DARTLLM_TEST_LORA");
+    if (!model_path || !lora_path) {
+        printf("  SKIPPED (set DARTLLM_TEST_MODEL and DARTLLM_TEST_LORA)\n");
+        return;
+    }
+
+    void* model = dartllm_load_model(model_path, 512, 0, 0, 0, 1);
+    assert(model != nullptr);
+    void* adapter = dartllm_lora_load(model, lora_path);
+    assert(adapter != nullptr);
+
+    int32_t length = 0;
+    int32_t* tokens = dartllm_tokenize(model, "The quick brown fox", 1, &length);
+    assert(tokens != nullptr);
+    std::vector<int32_t> prompt(tokens, tokens + length);
+    dartllm_free(tokens);
+
+    // Each request uses only the adapter it names, whatever ran before it.
+    std::vector<int32_t> base = greedy(model, prompt, nullptr);
+    std::vector<int32_t> tuned = greedy(model, prompt, adapter);
+    assert(base != tuned);
+    assert(greedy(model, prompt, nullptr) == base);
+    assert(greedy(model, prompt, adapter) == tuned);
+
+    // A session keeps its adapter, and only changes it while empty.
+    void* session = dartllm_session_create(model);
+    assert(session != nullptr);
+    assert(dartllm_session_set_lora(session, adapter, 1.0f) == 0);
+    assert(dartllm_session_append(session, prompt.data(), length) == length);
+    assert(dartllm_session_set_lora(session, nullptr, 1.0f) == -2);
+    assert(dartllm_lora_free(model, adapter) == -2);
+
+    std::vector<int32_t> continued(16);
+    int32_t finish_reason = -1;
+    int32_t count = dartllm_session_generate(session, 16, 0.0f, 1.0f, 1, 0.0f, 42, nullptr,
+                                             continued.data(), &finish_reason);
+    assert(count >= 0);
+    size_t common = std::min(static_cast<size_t>(count), tuned.size());
+    assert(std::equal(continued.begin(), continued.begin() + common, tuned.begin()));
+
+    assert(dartllm_session_truncate(session, 0) == 0);
+    assert(dartllm_session_set_lora(session, nullptr, 1.0f) == 0);
+    dartllm_session_free(session);
+    dartllm_clear_error();
+
+    assert(dartllm_lora_free(model, adapter) == 0);
+    dartllm_free_model(model);
+
+    printf("  PASSED\n");
+}
+
+void test_constraints() {
+    printf("Testing constrained sampling...\n");
+
+    int32_t prompt[] = {1, 2, 3};
+    int32_t tokens[] = {1, 2};
+    float biases[] = {1.0f, -INFINITY};
+    DartLLMConstraints constraints = {"root ::= \"yes\"", DARTLLM_GRAMMAR_GBNF, tokens, biases, 2};
+    int32_t out[4];
+    int32_t finish_reason = -1;
+    assert(dartllm_generate_into(nullptr, prompt, 3, 4, 0.7f, 0.9f, 40, 0.05f, 1.0f, 42, nullptr, 1.0f,
+                                 &constraints, out, &finish_reason) == -1);
+    assert(finish_reason == -1);
+    assert(dartllm_session_generate(nullptr, 4, 0.7f, 0.9f, 40, 0.05f, 42, &constraints,
+                                    out, &finish_reason) == -1);
+    assert(dartllm_stream_begin(nullptr, 4, 0.7f, 0.9f, 40, 0.05f, 42, &constraints) == nullptr);
+    dartllm_clear_error();
+
+    // Compiled grammars are cached by kind and source.
+    const std::string gbnf = "root ::= \"yes\"";
+    assert(dartllm::grammar_key(DARTLLM_GRAMMAR_GBNF, gbnf) == dartllm::grammar_key(DARTLLM_GRAMMAR_GBNF, gbnf));
+    assert(dartllm::grammar_key(DARTLLM_GRAMMAR_GBNF, gbnf) != dartllm::grammar_key(DARTLLM_GRAMMAR_JSON_SCHEMA, gbnf));
+    assert(dartllm::grammar_key(DARTLLM_GRAMMAR_GBNF, gbnf) != dartllm::grammar_key(DARTLLM_GRAMMAR_GBNF, "root ::= \"no\""));
+
+    printf("  PASSED\n");
+}
+
+/** Right-hand side of the grammar rule `name`, or "" if it is missing. */
+std::string grammar_rule(const std::string& grammar, const std::string& name) {
+    std::string head = name + " ::= ";
+    size_t at = grammar.find(head);
+    while (at != std::string::npos && at != 0 && grammar[at - 1] != '\n') {
+        at = grammar.find(head, at + 1);
+    }
+    if (at == std::string::npos) {
+        return "";
+    }
+    size_t start = at + head.size();
+    return grammar.substr(start, grammar.find('\n', start) - start);
+}
+
+/** Grammar for `schema`, asserting the conversion succeeds. */
+std::string schema_grammar(const char* schema) {
+    std::string grammar, error;
+    bool ok = dartllm::json_schema_to_grammar(schema, &grammar, &error);
+    if (!ok) {
+        printf("  unexpected error for %s: %s\n", schema, error.c_str());
+    }
+    assert(ok);
+    assert(!grammar_rule(grammar, "root").empty());
+    return grammar;
+}
+
+/** Error message for `schema`, asserting the conversion fails. */
+std::string schema_error(const char* schema) {
+    std::string grammar, error;
+    assert(!dartllm::json_schema_to_grammar(schema, &grammar, &error));
+    assert(!error.empty());
+    return error;
+}
+
+void test_json_schema_grammar() {
+    printf("Testing dartllm::json_schema_to_grammar...\n");
+
+    // Required properties are emitted in order; optional ones may be left out.
+    std::string g = schema_grammar(
+        "{\"type\":\"object\",\"properties\":{\"a\":{\"type\":\"integer\"},\"b\":{\"type\":\"string\"}},"
+        "\"required\":[\"a\"]}");
+    std::string root = grammar_rule(g, "root");
+    assert(root.find("root-a-kv") != std::string::npos);
+    assert(root.find("(\",\" space root-b-kv)?") != std::string::npos);
+    assert(root.find("root-a-kv)?") == std::string::npos);
+
+    // With nothing required every property is optional.
+    g = schema_grammar("{\"type\":\"object\",\"properties\":{\"a\":{\"type\":\"integer\"}}}");
+    assert(grammar_rule(g, "root").find("( root-a-kv )?") != std::string::npos);
+
+    // A recursive $ref becomes a rule that refers to itself.
+    g = schema_grammar(
+        "{\"$defs\":{\"node\":{\"type\":\"object\",\"properties\":{\"next\":{\"$ref\":\"#/$defs/node\"}}}},"
+        "\"$ref\":\"#/$defs/node\"}");
+    assert(grammar_rule(g, "root") == "ref-node");
+    assert(grammar_rule(g, "ref-node-body-next-kv").find("space ref-node") != std::string::npos);
+
+    // Length and item bounds become repetition counts.
+    g = schema_grammar("{\"type\":\"string\",\"minLength\":2,\"maxLength\":3}");
+    assert(grammar_rule(g, "root").find("(char){2,3}") != std::string::npos);
+    g = schema_grammar("{\"type\":\"array\",\"items\":{\"type\":\"boolean\"},\"minItems\":1,\"maxItems\":3}");
+    assert(grammar_rule(g, "root") == "\"[\" space boolean (\",\" space boolean){0,2} \"]\" space");
+    assert(schema_error("{\"type\":\"array\",\"minItems\":3,\"maxItems\":1}").find("maxItems") != std::string::npos);
+
+    // prefixItems fixes each position; items:false forbids more.
+    g = schema_grammar(
+        "{\"type\":\"array\",\"prefixItems\":[{\"type\":\"integer\"},{\"type\":\"string\"}],\"items\":false}");
+    assert(grammar_rule(g, "root") == "\"[\" space integer \",\" space string \"]\" space");
+
+    // enum and const values are escaped twice: once as JSON, once as GBNF.
+    g = schema_grammar("{\"enum\":[\"a\\\"b\",\"c\\\\d\",1,null]}");
+    assert(grammar_rule(g, "root") ==
+           "\"\\\"a\\\\\\\"b\\\"\" space | \"\\\"c\\\\\\\\d\\\"\" space | \"1\" space | \"null\" space");
+    g = schema_grammar("{\"const\":\"x\\\"y\"}");
+    assert(grammar_rule(g, "root") == "\"\\\"x\\\\\\\"y\\\"\" space");
+
+    // Unusable schemas are reported rather than loosened.
+    assert(schema_error("{\"type\":").find("Invalid JSON schema") != std::string::npos);
+    assert(schema_error("{\"$ref\":\"https://example.com/s.json\"}").find("Unsupported $ref") != std::string::npos);
+    assert(schema_error("false").find("accepts no values") != std::string::npos);
+    assert(schema_error("{\"type\":\"object\",\"properties\":{\"a\":false}}").find("accepts no values") !=
+           std::string::npos);
+
+    printf("  PASSED\n");
+}
+
+void test_generate_logprobs() {
+    printf("Testing dartllm_generate_logprobs...\n");
+
+    int32_t prompt[] = {1, 2, 3};
+    DartLLMTokenLogprob* logprobs = nullptr;
+    assert(dartllm_generate_logprobs(nullptr, prompt, 3, 8, 0.7f, 0.9f, 40, 0.05f, 1.0f, 42, nullptr, 1.0f, nullptr, 5, &logprobs) == nullptr);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid parameters") == 0);
+    assert(logprobs == nullptr);
+
+    // Out-of-range arguments are named in the error.
+    assert(dartllm_generate_logprobs(nullptr, prompt, 3, 8, 0.7f, 0.9f, 40, 0.05f, 1.0f, 42, nullptr, 1.0f, nullptr,
+                                     DARTLLM_MAX_TOP_LOGPROBS + 1, &logprobs) == nullptr);
+    assert(std::strstr(dartllm_get_last_error(), "top_n") != nullptr);
+    assert(dartllm_generate_logprobs(nullptr, prompt, 3, 8, 0.7f, 0.9f, 40, 0.05f, 1.0f, 42, nullptr, 1.0f, nullptr,
+                                     -1, &logprobs) == nullptr);
+    assert(std::strstr(dartllm_get_last_error(), "top_n") != nullptr);
+    assert(dartllm_generate_logprobs(nullptr, prompt, 3, -1, 0.7f, 0.9f, 40, 0.05f, 1.0f, 42, nullptr, 1.0f, nullptr,
+                                     5, &logprobs) == nullptr);
+    assert(std::strstr(dartllm_get_last_error(), "max_tokens") != nullptr);
+    assert(logprobs == nullptr);
+    dartllm_clear_error();
+
+    // Log-probabilities of the chosen token and the top_n most likely
+    // ones, best first, under a softmax over all logits.
+    const float logits[] = {0.0f, std::log(3.0f), std::log(2.0f), std::log(4.0f)};
+    std::vector<DartLLMTokenLogprob> entries;
+    assert(std::fabs(dartllm::log_normalizer(logits, 4) - std::log(10.0f)) < 1e-5f);
+    dartllm::collect_logprobs(logits, 4, 2, 2, &entries);
+    assert(entries.size() == 3);
+    assert(entries[0].token == 2 && std::fabs(entries[0].logprob - std::log(0.2f)) < 1e-5f);
+    assert(entries[1].token == 3 && std::fabs(entries[1].logprob - std::log(0.4f)) < 1e-5f);
+    assert(entries[2].token == 1 && std::fabs(entries[2].logprob - std::log(0.3f)) < 1e-5f);
+
+    entries.clear();
+    dartllm::collect_logprobs(logits, 4, 0, 0, &entries);
+    assert(entries.size() == 1 && entries[0].token == 0);
+
+    printf("  PASSED\n");
+}
+
+void test_generate_n() {
+    printf("Testing dartllm_generate_n...\n");
+
+    int32_t prompt[] = {1, 2, 3};
+    DartLLMGenerateResult* results[DARTLLM_MAX_PARALLEL + 1] = {};
+    assert(dartllm_generate_n(nullptr, prompt, 3, 8, 0.7f, 0.9f, 40, 0.05f, 1.0f, 42, nullptr, 1.0f, nullptr, 3, results) == -1);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid parameters") == 0);
+
+    // Out-of-range arguments are named in the error.
+    assert(dartllm_generate_n(nullptr, prompt, 3, 8, 0.7f, 0.9f, 40, 0.05f, 1.0f, 42, nullptr, 1.0f, nullptr,
+                              DARTLLM_MAX_PARALLEL + 1, results) == -1);
+    assert(std::strstr(dartllm_get_last_error(), "n must be") != nullptr);
+    assert(dartllm_generate_n(nullptr, prompt, 3, 8, 0.7f, 0.9f, 40, 0.05f, 1.0f, 42, nullptr, 1.0f, nullptr,
+                              0, results) == -1);
+    assert(std::strstr(dartllm_get_last_error(), "n must be") != nullptr);
+    assert(dartllm_generate_n(nullptr, prompt, 3, -1, 0.7f, 0.9f, 40, 0.05f, 1.0f, 42, nullptr, 1.0f, nullptr,
+                              3, results) == -1);
+    assert(std::strstr(dartllm_get_last_error(), "max_tokens") != nullptr);
+    assert(results[0] == nullptr);
+    dartllm_clear_error();
+
+    // Branch seeds wrap instead of overflowing, and random stays random.
+    assert(dartllm::branch_seed(42, 3) == 45);
+    assert(dartllm::branch_seed(INT32_MAX, 0) == INT32_MAX);
+    assert(dartllm::branch_seed(INT32_MAX, 1) == 0);
+    assert(dartllm::branch_seed(INT32_MAX - 1, 3) == 1);
+    assert(dartllm::branch_seed(-1, 3) == -1);
+
+    printf("  PASSED\n");
+}
+
+void test_score() {
+    printf("Testing dartllm_score...\n");
+
+    int32_t prompt[] = {1, 2, 3};
+    int32_t candidates[] = {4, 5, 6};
+    int32_t lengths[] = {1, 2};
+    float totals[2];
+    assert(dartllm_score(nullptr, prompt, 3, candidates, lengths, 2, nullptr, 1.0f, totals) == nullptr);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid parameters") == 0);
+    assert(dartllm_score(nullptr, prompt, 3, candidates, lengths, 0, nullptr, 1.0f, totals) == nullptr);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid parameters") == 0);
+
+    // Candidate lengths are checked before the model.
+    int32_t empty_lengths[] = {1, 0};
+    assert(dartllm_score(nullptr, prompt, 3, candidates, empty_lengths, 2, nullptr, 1.0f, totals) == nullptr);
+    assert(std::strcmp(dartllm_get_last_error(), "Candidates must not be empty") == 0);
+    dartllm_clear_error();
+
+    // Candidate tokens are checked up front, the last one included: it is
+    // never decoded but still indexes the logits.
+    assert(dartllm::find_invalid_token(candidates, 3, 7) == -1);
+    assert(dartllm::find_invalid_token(candidates, 3, 6) == 2);
+    int32_t negative[] = {4, -1, 6};
+    assert(dartllm::find_invalid_token(negative, 3, 7) == 1);
+    assert(dartllm::find_invalid_token(candidates, 0, 1) == -1);
+
+    printf("  PASSED\n");
+}
+
+void test_into_variants() {
+    printf("Testing caller-buffer variants...\n");
+
+    int32_t tokens[4] = {1, 2, 3, 4};
+    float embedding[8];
+    int32_t finish_reason = -1;
+    assert(dartllm_tokenize_into(nullptr, "hello", 1, tokens, 4) == -1);
+    assert(dartllm_embed_into(nullptr, tokens, 4, 1, embedding, 8) == -1);
+    assert(dartllm_generate_into(nullptr, tokens, 4, 4, 0.7f, 0.9f, 40, 0.05f, 1.0f, 42, nullptr, 1.0f, nullptr, tokens, &finish_reason) == -1);
+    assert(finish_reason == -1);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid parameters") == 0);
+
+    // Output buffers are checked before the model.
+    assert(dartllm_tokenize_into(nullptr, "hello", 1, tokens, -1) == -1);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid output buffer") == 0);
+    assert(dartllm_tokenize_into(nullptr, "hello", 1, nullptr, 4) == -1);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid output buffer") == 0);
+    assert(dartllm_tokenize_into(nullptr, "hello", 1, nullptr, 0) == -1);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid parameters") == 0);
+    assert(dartllm_embed_into(nullptr, tokens, 4, 1, embedding, -1) == -1);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid output buffer") == 0);
+    assert(dartllm_embed_into(nullptr, tokens, 4, 1, nullptr, 8) == -1);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid output buffer") == 0);
+    assert(dartllm_embed_into(nullptr, tokens, 4, 1, nullptr, 0) == -1);
+    assert(std::strcmp(dartllm_get_last_error(), "Invalid parameters") == 0);
+    dartllm_clear_error();
+
+    // generate_into() callers size their buffer for max_tokens, but never
+    // need more than the context holds.
+    assert(dartllm::generate_capacity(64, 2048) == 64);
+    assert(dartllm::generate_capacity(4096, 2048) == 2048);
+    assert(dartllm::generate_capacity(0, 2048) == 0);
+    assert(dartllm::generate_capacity(-1, 2048) == 0);
+
+    printf("  PASSED\n");
+}
+
+void test_chat_template() {
+    printf("Testing dartllm_apply_chat_template...\n");
+
+    const char* roles[] = {"system", "user"};
+    const char* contents[] = {"Be brief.", "Hello"};
+    int32_t prefix = -1;
+    assert(dartllm_get_chat_template(nullptr) == nullptr);
+    assert(dartllm_apply_chat_template(nullptr, roles, contents, 2, 1, 1, &prefix) == nullptr);
+    assert(prefix == -1);
+    dartllm_clear_error();
+
+    // The earlier turns are skipped only when they render as a byte prefix.
+    const std::string full = "<|system|>Be brief.\n<|user|>Hello\n<|assistant|>";
+    const std::string earlier = "<|system|>Be brief.\n";
+    assert(dartllm::chat_delta_prefix(earlier, full.data(), full.size()) == earlier.size());
+    assert(full.substr(dartllm::chat_delta_prefix(earlier, full.data(), full.size())) ==
+           "<|user|>Hello\n<|assistant|>");
+    // A template that rewrites earlier turns (e.g. moving the system prompt
+    // into the first user turn) forces a full rendering.
+    const std::string rewritten = "<|user|>Be brief.\n\nHello\n<|assistant|>";
+    assert(dartllm::chat_delta_prefix(earlier, rewritten.data(), rewritten.size()) == 0);
+    assert(dartllm::chat_delta_prefix(full, earlier.data(), earlier.size()) == 0);
+    assert(dartllm::chat_delta_prefix("", full.data(), full.size()) == 0);
+    assert(dartllm::chat_delta_prefix(full, full.data(), full.size()) == full.size());
+
+    printf("  PASSED\n");
+}
+
+void test_sessions() {
+    printf("Testing dartllm_session...\n");
+
+    int32_t tokens[] = {1, 2, 3};
+    int32_t finish_reason = -1;
+    assert(dartllm_session_create(nullptr) == nullptr);
+    assert(dartllm_session_length(nullptr) == -1);
+    assert(dartllm_session_truncate(nullptr, 0) == -1);
+    assert(dartllm_session_append(nullptr, tokens, 3) == -1);
+    assert(dartllm_session_generate(nullptr, 3, 0.7f, 0.9f, 40, 0.05f, 42, nullptr, tokens, &finish_reason) == -1);
+    assert(finish_reason == -1);
+
+    DartLLMStreamToken report;
+    assert(dartllm_stream_begin(nullptr, 3, 0.7f, 0.9f, 40, 0.05f, 42, nullptr) == nullptr);
+    assert(dartllm_stream_next(nullptr, &report) == -1);
+    dartllm_stream_free(nullptr);
+    dartllm_session_free(nullptr);
+    dartllm_clear_error();
+
+    printf("  PASSED\n");
+}
+
+void test_prefix_cache() {
+    printf("Testing dartllm_set_prefix_cache...\n");
+
+    assert(dartllm_set_prefix_cache(nullptr, "/tmp", 1024 * 1024, 0) == -1);
+    assert(dartllm_set_prefix_cache(nullptr, nullptr, 0, 0) == -1);
+
+    DartLLMPrefixCacheStats stats;
+    assert(dartllm_prefix_cache_stats(nullptr, &stats) == -1);
+    dartllm_clear_error();
+
+    printf("  PASSED\n");
+}
+
+/** Write a prefix file of `bytes` and record it in `store`, as save_prefix() does. */
+void store_prefix(dartllm::PrefixStore* store, const std::string& key, int64_t bytes) {
+    std::ofstream(dartllm::prefix_file(*store, key), std::ios::binary)
+        << std::string(static_cast<size_t>(bytes), 'x');
+    dartllm::evict_prefixes(store, bytes);
+    dartllm::add_prefix(store, key, bytes);
+}
+
+std::vector<std::string> prefix_order(const dartllm::PrefixStore& store) {
+    std::vector<std::string> keys;
+    for (const auto& entry : store.lru) {
+        keys.push_back(entry.key);
+    }
+    return keys;
+}
+
+void test_prefix_store() {
+    printf("Testing prefix store...\n");
+
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "dartllm_test_prefix_store";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    {
+        auto store = dartllm::open_prefix_store(dir.string(), 300);
+        std::lock_guard<std::mutex> lock(store->mutex);
+        store_prefix(store.get(), "a", 100);
+        store_prefix(store.get(), "b", 100);
+        store_prefix(store.get(), "c", 100);
+        assert((prefix_order(*store) == std::vector<std::string>{"c", "b", "a"}));
+
+        // A hit makes "a" the most recent, so "b" is evicted for "d".
+        assert(dartllm::touch_prefix(store.get(), "a"));
+        assert(!dartllm::touch_prefix(store.get(), "missing"));
+        store_prefix(store.get(), "d", 100);
+        assert((prefix_order(*store) == std::vector<std::string>{"d", "a", "c"}));
+        assert(!fs::exists(dartllm::prefix_file(*store, "b")));
+        assert(store->stored_bytes == 300);
+        assert(store->stores == 4);
+        assert(store->evictions == 1);
+
+        dartllm::drop_prefix(store.get(), "c");
+        assert(!fs::exists(dartllm::prefix_file(*store, "c")));
+        assert(store->stored_bytes == 200);
+    }
+
+    // The last store is gone, so this reads the index back in LRU order.
+    {
+        auto store = dartllm::open_prefix_store(dir.string(), 300);
+        assert((prefix_order(*store) == std::vector<std::string>{"d", "a"}));
+        assert(store->stored_bytes == 200);
+
+        std::lock_guard<std::mutex> lock(store->mutex);
+        std::ofstream(dartllm::prefix_file(*store, "a"), std::ios::app) << "more";
+    }
+
+    // Entries whose file has changed size are dropped.
+    {
+        auto store = dartllm::open_prefix_store(dir.string(), 300);
+        assert((prefix_order(*store) == std::vector<std::string>{"d"}));
+
+        std::lock_guard<std::mutex> lock(store->mutex);
+        store_prefix(store.get(), "e", 100);
+    }
+
+    // A smaller budget evicts the least recently used on open.
+    {
+        auto store = dartllm::open_prefix_store(dir.string(), 100);
+        assert((prefix_order(*store) == std::vector<std::string>{"e"}));
+        assert(!fs::exists(dartllm::prefix_file(*store, "d")));
+        assert(store->stored_bytes == 100);
+    }
+
+    fs::remove_all(dir);
+    printf("  PASSED\n");
+}
+
+void test_thread_config() {
+    printf("Testing dartllm_get_thread_config...\n");
+
+    DartLLMThreadConfig config;
+    int32_t result = dartllm_get_thread_config(nullptr, &config);
+    assert(result == 0);
+    assert(config.n_threads >= 1);
+    assert(config.n_threads_batch >= config.n_threads);
+    assert(config.logical_cpus >= config.physical_cores);
+    assert(config.physical_cores >= config.performance_cores);
+    assert(config.performance_cores >= 1);
+    assert(config.calibrated == 0);
+    printf("  Decode threads: %d, prefill threads: %d\n", config.n_threads, config.n_threads_batch);
+
+    result = dartllm_get_thread_config(nullptr, nullptr);
+    assert(result != 0);
+
+    result = dartllm_calibrate_threads(nullptr, nullptr, &config);
+    assert(result != 0);
+    dartllm_clear_error();
+
+    printf("  PASSED\n");
+}
+
+/** A topology of `cores` physical cores with `smt` threads each. */
+dartllm::CpuTopology make_topology(int32_t cores, int32_t smt, int32_t performance) {
+    dartllm::CpuTopology topology;
+    for (int32_t core = 0; core < cores; core++) {
+        for (int32_t thread = 0; thread < smt; thread++) {
+            dartllm::LogicalCpu cpu;
+            cpu.id = thread * cores + core;
+            cpu.core_id = core;
+            cpu.capacity = core < performance ? 1024 : 512;
+            topology.cpus.push_back(cpu);
+        }
+        topology.core_cpu_ids.push_back(core);
+        if (core < performance) topology.performance_cpu_ids.push_back(core);
+    }
+    topology.physical_cores = cores;
+    topology.performance_cores = performance;
+    return topology;
+}
+
+void test_cpu_topology() {
+    printf("Testing CPU mask parsing and thread planning...\n");
+
+    bool mask[16] = {};
+    assert(dartllm::parse_cpu_mask("0-3,8", mask, 16) == 5);
+    assert(mask[0] && mask[3] && !mask[4] && mask[8] && !mask[9]);
+
+    // Overlapping ranges count each CPU once; CPUs beyond the mask are ignored.
+    bool overlap[16] = {};
+    assert(dartllm::parse_cpu_mask("2-5,4-6,15-40", overlap, 16) == 6);
+    assert(overlap[2] && overlap[6] && overlap[15]);
+
+    bool bad[16] = {};
+    assert(dartllm::parse_cpu_mask("3-1", bad, 16) == -1);
+    assert(dartllm::parse_cpu_mask("1,,2", bad, 16) == -1);
+    assert(dartllm::parse_cpu_mask("-1", bad, 16) == -1);
+    assert(dartllm::parse_cpu_mask("1-", bad, 16) == -1);
+    assert(dartllm::parse_cpu_mask("0x2", bad, 16) == -1);
+    bool empty[4] = {};
+    assert(dartllm::parse_cpu_mask("", empty, 4) == 0);
+
+    // Decode uses performance cores only; prefill uses every physical core
+    // and ignores SMT siblings.
+    dartllm::ThreadPlan plan = dartllm::plan_threads(make_topology(8, 2, 4));
+    assert(plan.decode_threads == 4);
+    assert(plan.prefill_threads == 8);
+
+    // A cgroup quota caps both, rounding down but never below one thread.
+    dartllm::CpuTopology limited = make_topology(8, 2, 8);
+    limited.cpu_quota = 2.5;
+    plan = dartllm::plan_threads(limited);
+    assert(plan.decode_threads == 2);
+    assert(plan.prefill_threads == 2);
+    limited.cpu_quota = 0.5;
+    plan = dartllm::plan_threads(limited);
+    assert(plan.decode_threads == 1);
+    assert(plan.prefill_threads == 1);
+
+    // A platform thread limit (the WebAssembly worker pool) caps both.
+    plan = dartllm::plan_threads(make_topology(32, 1, 24), 5);
+    assert(plan.decode_threads == 5);
+    assert(plan.prefill_threads == 5);
+    plan = dartllm::plan_threads(make_topology(32, 1, 24), 0);
+    assert(plan.decode_threads == 24);
+    assert(plan.prefill_threads == 32);
+
+    // Without a known topology the logical CPUs may be SMT siblings or
+    // efficiency cores, so some are left free.
+    dartllm::CpuTopology unknown = make_topology(12, 1, 12);
+    unknown.known = false;
+    plan = dartllm::plan_threads(unknown);
+    assert(plan.decode_threads == 10);
+    assert(plan.prefill_threads == 10);
+    unknown = make_topology(4, 1, 4);
+    unknown.known = false;
+    assert(dartllm::plan_threads(unknown).decode_threads == 3);
+    unknown = make_topology(2, 1, 2);
+    unknown.known = false;
+    assert(dartllm::plan_threads(unknown).decode_threads == 1);
+    unknown = make_topology(12, 1, 12);
+    unknown.known = false;
+    unknown.cpu_quota = 4.0;
+    assert(dartllm::plan_threads(unknown).decode_threads == 4);
+
+    // Prefill never gets fewer threads than decode.
+    plan = dartllm::plan_threads(make_topology(1, 1, 1));
+    assert(plan.decode_threads == 1);
+    assert(plan.prefill_threads == 1);
+
+    // The host signature follows the layout.
+    assert(dartllm::host_signature(make_topology(8, 2, 4))
+        == dartllm::host_signature(make_topology(8, 2, 4)));
+    assert(dartllm::host_signature(make_topology(8, 2, 4))
+        != dartllm::host_signature(make_topology(8, 1, 4)));
+
+    printf("  PASSED\n");
+}
+
+void test_threadpool() {
+    printf("Testing shared threadpool...\n");
+
+    DartLLMThreadpoolParams params;
+    dartllm_threadpool_default_params(&params);
+    params.n_threads = 2;
+
+    void* pool = dartllm_threadpool_create(&params);
+    assert(pool != nullptr);
+    assert(dartllm_threadpool_n_threads(pool) == 2);
+
+    assert(dartllm_attach_threadpool(nullptr, pool, nullptr) != 0);
+    assert(dartllm_detach_threadpool(nullptr) != 0);
+    dartllm_threadpool_free(pool);
+
+    params.cpu_list = "3-1";
+    assert(dartllm_threadpool_create(&params) == nullptr);
+    params.cpu_list = nullptr;
+    params.priority = 7;
+    assert(dartllm_threadpool_create(&params) == nullptr);
+
+    dartllm_threadpool_free(nullptr);
+    assert(dartllm_threadpool_n_threads(nullptr) < 0);
+    dartllm_clear_error();
+
+    printf("  PASSED\n");
+}
+
 void test_free_null() {
     printf("Testing dartllm_free with null...\n");
     dartllm_free(nullptr);
@@ -86,6 +1042,26 @@ int main() {
     test_gpu_backend();
     test_error_handling();
     test_null_model_operations();
+    test_estimate_memory();
+    test_probe_model();
+    test_warmup();
+    test_registry();
+    test_registry_policy();
+    test_lora();
+    test_lora_switching();
+    test_constraints();
+    test_json_schema_grammar();
+    test_generate_logprobs();
+    test_generate_n();
+    test_score();
+    test_into_variants();
+    test_chat_template();
+    test_sessions();
+    test_prefix_cache();
+    test_prefix_store();
+    test_thread_config();
+    test_cpu_topology();
+    test_threadpool();
     test_free_null();
 
     printf("\n=== All tests passed ===\n");
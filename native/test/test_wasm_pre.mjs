@@ -0,0 +1,274 @@
+#!/usr/bin/env node
+/**
+ * @file test_wasm_pre.mjs
+ * @brief Tests of the JavaScript interface in src/wasm_pre.js
+ *
+ * Runs wasm_pre.js against a stand-in module whose exported C functions
+ * are JavaScript fakes over a plain heap, so the DartLLMWasm interface
+ * that lib/src/platform/wasm_binding.dart calls is checked without emcc
+ * or a model:
+ *
+ *   node test/test_wasm_pre.mjs
+ */
+
+import assert from 'node:assert/strict';
+import fs from 'node:fs';
+import path from 'node:path';
+import { fileURLToPath } from 'node:url';
+
+const here = path.dirname(fileURLToPath(import.meta.url));
+const source = fs.readFileSync(path.join(here, '../src/wasm_pre.js'), 'utf8');
+
+const MODEL_PATH = '/models/tiny.gguf';
+const MODEL = 0x100;
+const SESSION = 0x200;
+const STREAM = 0x300;
+
+/** A module with fake natives: one char per token, replying "ok". */
+function createModule() {
+    const buffer = new ArrayBuffer(1 << 20);
+    const HEAP8 = new Int8Array(buffer);
+    const HEAPU8 = new Uint8Array(buffer);
+    const HEAP32 = new Int32Array(buffer);
+    const HEAPF32 = new Float32Array(buffer);
+    let top = 0x1000;
+    const live = new Set();
+    const calls = {};
+
+    const UTF8ToString = (ptr, max = Infinity) => {
+        let end = ptr;
+        while (end - ptr < max && HEAPU8[end] !== 0) end++;
+        return new TextDecoder().decode(HEAPU8.subarray(ptr, end));
+    };
+    const writeString = (text, ptr) => {
+        const bytes = new TextEncoder().encode(text);
+        HEAPU8.set(bytes, ptr);
+        HEAPU8[ptr + bytes.length] = 0;
+    };
+    const malloc = (size) => {
+        const ptr = top;
+        top += (size + 7) & ~7;
+        live.add(ptr);
+        return ptr;
+    };
+    const free = (ptr) => {
+        if (ptr) live.delete(ptr);
+    };
+    const stringToNewUTF8 = (text) => {
+        const ptr = malloc(new TextEncoder().encode(text).length + 1);
+        writeString(text, ptr);
+        return ptr;
+    };
+
+    const files = {};
+    const FS = {
+        mkdir() {},
+        writeFile(file) { files[file] = { contents: null }; },
+        lookupPath(file) { return { node: files[file] }; },
+        unlink(file) { delete files[file]; },
+    };
+
+    let reply = [];
+    const Module = {
+        _malloc: malloc,
+        _free: free,
+        _dartllm_free: free,
+        _dartllm_get_last_error: () => stringToNewUTF8('fake error'),
+        _dartllm_init: () => 0,
+        _dartllm_load_model(pathPtr, contextSize, gpuLayers, threads, batchSize, useMmap) {
+            calls.load = { path: UTF8ToString(pathPtr), contextSize, gpuLayers, threads, batchSize, useMmap };
+            return files[calls.load.path] ? MODEL : 0;
+        },
+        _dartllm_free_model(model) { calls.freeModel = model; },
+        _dartllm_get_model_info(model) {
+            assert.equal(model, MODEL);
+            const info = malloc(4496);
+            HEAPU8.fill(0, info, info + 4496);
+            writeString('tiny', info);
+            HEAP32[(info + 256) >> 2] = 7;
+            HEAP32[(info + 260) >> 2] = 1;  // 2^32 + 7 parameters
+            writeString('llama', info + 264);
+            writeString('Q4_K_M', info + 328);
+            HEAP32[(info + 360) >> 2] = 2048;
+            HEAP32[(info + 364) >> 2] = 256;
+            HEAP32[(info + 368) >> 2] = 64;
+            HEAP32[(info + 372) >> 2] = 2;
+            HEAP32[(info + 376) >> 2] = 4;
+            HEAP32[(info + 384) >> 2] = 1234;
+            HEAP8[info + 392] = 1;
+            return info;
+        },
+        _dartllm_tokenize(model, textPtr, addSpecial, lengthPtr) {
+            const text = UTF8ToString(textPtr);
+            const tokens = [...(addSpecial ? [1] : []), ...[...text].map((c) => c.charCodeAt(0))];
+            const ptr = malloc(tokens.length * 4);
+            HEAP32.set(tokens, ptr >> 2);
+            HEAP32[lengthPtr >> 2] = tokens.length;
+            return ptr;
+        },
+        _dartllm_detokenize(model, tokensPtr, count) {
+            const tokens = HEAP32.subarray(tokensPtr >> 2, (tokensPtr >> 2) + count);
+            return stringToNewUTF8(String.fromCharCode(...tokens));
+        },
+        _dartllm_embed(model, tokensPtr, count, normalize, dimensionPtr) {
+            calls.embed = { count, normalize };
+            const ptr = malloc(8);
+            HEAPF32.set([0.5, -0.5], ptr >> 2);
+            HEAP32[dimensionPtr >> 2] = 2;
+            return ptr;
+        },
+        _dartllm_has_gpu_support: () => 0,
+        _dartllm_session_create: (model) => (model === MODEL ? SESSION : 0),
+        _dartllm_session_append(session, tokensPtr, count) {
+            calls.prompt = Array.from(HEAP32.subarray(tokensPtr >> 2, (tokensPtr >> 2) + count));
+            return count;
+        },
+        _dartllm_stream_begin(session, maxTokens, temperature, topP, topK, minP, seed, constraints) {
+            calls.begin = { maxTokens, temperature, topP, topK, minP, seed, constraints };
+            reply = [...'ok'].map((c) => c.charCodeAt(0));
+            return STREAM;
+        },
+        _dartllm_stream_next(stream, report) {
+            const token = reply.shift();
+            HEAP32[report >> 2] = token === undefined ? 0 : token;
+            HEAP8[report + 4] = token === undefined ? 1 : 0;
+            HEAP32[(report + 8) >> 2] = token === undefined ? 1 : 0;
+            writeString(token === undefined ? '' : String.fromCharCode(token), report + 12);
+            return 0;
+        },
+        _dartllm_stream_free(stream) { calls.streamFree = stream; },
+        _dartllm_session_free(session) { calls.sessionFree = session; },
+    };
+
+    new Function('Module', 'FS', 'HEAP8', 'HEAPU8', 'HEAP32', 'HEAPF32',
+                 'UTF8ToString', 'stringToNewUTF8', source)(
+        Module, FS, HEAP8, HEAPU8, HEAP32, HEAPF32, UTF8ToString, stringToNewUTF8);
+    return { Module, calls, files, live };
+}
+
+/** The config object GenerateConfigJS builds in the Dart binding. */
+function generateConfig(overrides = {}) {
+    return {
+        maxTokens: 8, temperature: 0.5, topP: 0.9, topK: 40, minP: 0.05,
+        repetitionPenalty: 1.1, frequencyPenalty: 0, presencePenalty: 0,
+        repeatLastN: 64, stopTokens: [], seed: null, ...overrides,
+    };
+}
+
+/** dartllmFetchModel() then loadModel(), the way WasmBinding loads. */
+async function loadModel(Module) {
+    const bytes = new Uint8Array([71, 71, 85, 70]);
+    globalThis.fetch = async () => new Response(bytes, {
+        headers: { 'Content-Length': String(bytes.length) },
+    });
+    const file = await Module.dartllmFetchModel('https://example.com/tiny.gguf', 'tiny.gguf', null);
+    return { file, handle: await Module.loadModel(file.path, 2048, 0, 512) };
+}
+
+const tests = {
+    async 'loads a fetched model file by path'() {
+        const { Module, calls, files } = createModule();
+        assert.equal(await Module.init(), true);
+        const { file, handle } = await loadModel(Module);
+        assert.equal(file.path, MODEL_PATH);
+        assert.equal(handle, MODEL);
+        assert.deepEqual(calls.load, {
+            path: MODEL_PATH, contextSize: 2048, gpuLayers: 0, threads: 0, batchSize: 512, useMmap: 1,
+        });
+        assert.deepEqual(Array.from(files[MODEL_PATH].contents), [71, 71, 85, 70]);
+
+        await Module.unloadModel(handle);
+        file.free();
+        assert.equal(calls.freeModel, MODEL);
+        assert.equal(files[MODEL_PATH], undefined);
+        assert.equal(await Module.loadModel('/models/missing.gguf', 0, 0, 0), 0);
+    },
+
+    async 'reads DartLLMModelInfo at its wasm32 offsets'() {
+        const { Module, live } = createModule();
+        const info = await Module.getModelInfo(MODEL);
+        assert.deepEqual(info, {
+            name: 'tiny', parameterCount: 2 ** 32 + 7, architecture: 'llama', quantization: 'Q4_K_M',
+            contextSize: 2048, vocabularySize: 256, embeddingSize: 64, layerCount: 2, headCount: 4,
+            fileSizeBytes: 1234, supportsEmbedding: true, supportsVision: false, chatTemplate: null,
+        });
+        assert.equal(live.size, 0);
+    },
+
+    async 'round-trips tokens and embeds'() {
+        const { Module, calls, live } = createModule();
+        const tokens = await Module.tokenize(MODEL, 'hi', true);
+        assert.ok(tokens instanceof Int32Array);
+        assert.deepEqual(Array.from(tokens), [1, 104, 105]);
+        assert.equal(await Module.detokenize(MODEL, Int32Array.from([104, 105])), 'hi');
+
+        const embedding = await Module.embed(MODEL, tokens, true);
+        assert.ok(embedding instanceof Float32Array);
+        assert.deepEqual(Array.from(embedding), [0.5, -0.5]);
+        assert.deepEqual(calls.embed, { count: 3, normalize: 1 });
+        assert.equal(Module.hasWebGPU(), false);
+        assert.equal(live.size, 0);
+    },
+
+    async 'streams under the name and signature the binding calls'() {
+        const { Module, calls, live } = createModule();
+        const chunks = [];
+        const reason = await Module.generateStream(
+            MODEL, Int32Array.from([1, 104]), generateConfig(),
+            (token, text, isFinal, finishReason) => {
+                chunks.push([token, text, isFinal, finishReason]);
+                return true;
+            });
+
+        assert.equal(reason, 1);
+        assert.deepEqual(chunks, [[111, 'o', false, 0], [107, 'k', false, 0], [0, '', true, 1]]);
+        assert.deepEqual(calls.prompt, [1, 104]);
+        // A null seed from Dart means a random one.
+        assert.equal(calls.begin.seed, -1);
+        assert.equal(calls.begin.maxTokens, 8);
+        assert.equal(calls.begin.topK, 40);
+        assert.equal(calls.begin.constraints, 0);
+        assert.equal(calls.streamFree, STREAM);
+        assert.equal(calls.sessionFree, SESSION);
+        assert.equal(live.size, 0);
+    },
+
+    async 'stops when onToken returns false'() {
+        const { Module, calls } = createModule();
+        const chunks = [];
+        const reason = await Module.generateStream(
+            MODEL, Int32Array.from([1]), generateConfig({ seed: 42 }),
+            (token) => { chunks.push(token); return false; });
+        assert.equal(reason, -1);
+        assert.deepEqual(chunks, [111]);
+        assert.equal(calls.begin.seed, 42);
+        assert.equal(calls.sessionFree, SESSION);
+    },
+
+    async 'generates whole completions from the stream'() {
+        const { Module } = createModule();
+        const result = await Module.generate(MODEL, Int32Array.from([1]), generateConfig());
+        assert.deepEqual(Array.from(result.tokens), [111, 107]);
+        assert.equal(result.finishReason, 1);
+        assert.equal(typeof result.generationTimeMs, 'number');
+    },
+
+    async 'reports native errors'() {
+        const { Module } = createModule();
+        await assert.rejects(Module.generateStream(0, Int32Array.from([1]), generateConfig(), () => true),
+                             /fake error/);
+    },
+};
+
+console.log('=== wasm_pre.js Tests ===\n');
+for (const [name, run] of Object.entries(tests)) {
+    console.log(`Testing ${name}...`);
+    try {
+        await run();
+    } catch (e) {
+        console.error(e);
+        process.exit(1);
+    }
+    console.log('  PASSED');
+}
+console.log('\n=== All tests passed ===');
@@ -0,0 +1,557 @@
+/**
+ * @file dartllm_loadgen.cpp
+ * @brief Concurrency load generator for the DartLLM C API
+ *
+ * Spawns N client threads that issue streaming generation requests against
+ * one or more model handles and reports time-to-first-token (TTFT),
+ * inter-token latency (ITL) and end-to-end latency percentiles together with
+ * aggregate throughput.
+ *
+ * Requests follow either a closed loop (each client sends its next request as
+ * soon as the previous one finishes) or an open loop with Poisson arrivals at
+ * a fixed aggregate rate. In open-loop mode latencies are measured from the
+ * scheduled arrival time, so queueing delay behind busy handles is included.
+ *
+ * Usage:
+ *   dartllm_loadgen --model PATH [--model PATH ...] [options]
+ *
+ * Run with --help for the full option list.
+ */
+
+#include "../src/dartllm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* FILLER_TEXT =
+    "The quick brown fox jumps over the lazy dog while the committee reviews "
+    "the quarterly report, and the engineers benchmark the inference server "
+    "under sustained concurrent load to find where latency starts to climb. ";
+
+/**
+ * Distribution of prompt or output lengths in tokens.
+ *
+ * Parsed from "fixed:N", "uniform:MIN:MAX" or "normal:MEAN:STDDEV".
+ */
+struct LengthDistribution {
+    enum Kind { FIXED, UNIFORM, NORMAL };
+
+    Kind kind = FIXED;
+    double a = 0.0;
+    double b = 0.0;
+
+    int32_t sample(std::mt19937_64& rng) const {
+        double value = a;
+        switch (kind) {
+            case FIXED:
+                value = a;
+                break;
+            case UNIFORM:
+                value = std::uniform_real_distribution<double>(a, b + 1.0)(rng);
+                break;
+            case NORMAL:
+                value = std::normal_distribution<double>(a, b)(rng);
+                break;
+        }
+        return std::max<int32_t>(1, static_cast<int32_t>(value));
+    }
+
+    static bool parse(const std::string& spec, LengthDistribution* out) {
+        size_t first = spec.find(':');
+        std::string kind = spec.substr(0, first);
+        double a = 0.0;
+        double b = 0.0;
+
+        if (first == std::string::npos) {
+            // A bare number is shorthand for fixed:N.
+            kind = "fixed";
+            a = std::atof(spec.c_str());
+        } else {
+            size_t second = spec.find(':', first + 1);
+            a = std::atof(spec.substr(first + 1, second - first - 1).c_str());
+            if (second != std::string::npos) {
+                b = std::atof(spec.substr(second + 1).c_str());
+            }
+        }
+
+        if (kind == "fixed") {
+            out->kind = FIXED;
+        } else if (kind == "uniform") {
+            out->kind = UNIFORM;
+            if (b < a) return false;
+        } else if (kind == "normal") {
+            out->kind = NORMAL;
+            if (b < 0.0) return false;
+        } else {
+            return false;
+        }
+
+        out->a = a;
+        out->b = b;
+        return a > 0.0;
+    }
+};
+
+struct Options {
+    std::vector<std::string> model_paths;
+    int32_t handles_per_model = 1;
+    int32_t clients = 8;
+    int32_t requests = 64;
+    double arrival_rate = 0.0;
+    LengthDistribution prompt_length{LengthDistribution::FIXED, 128.0, 0.0};
+    LengthDistribution output_length{LengthDistribution::FIXED, 64.0, 0.0};
+    int32_t context_size = 0;
+    int32_t gpu_layers = 0;
+    int32_t threads = 0;
+    int32_t batch_size = 0;
+    uint64_t seed = 42;
+    std::string json_path;
+};
+
+/** One scheduled request. */
+struct RequestSpec {
+    int32_t prompt_tokens = 0;
+    int32_t max_tokens = 0;
+    int32_t seed = 0;
+    Clock::duration arrival{};
+};
+
+/** Samples collected by one client thread, merged after the run. */
+struct ClientStats {
+    std::vector<double> ttft_ms;
+    std::vector<double> itl_ms;
+    std::vector<double> e2e_ms;
+    int64_t prompt_tokens = 0;
+    int64_t generated_tokens = 0;
+    int32_t completed = 0;
+    int32_t failed = 0;
+};
+
+/** Per-request state shared with the streaming callback. */
+struct StreamState {
+    Clock::time_point start;
+    Clock::time_point last;
+    bool seen_first = false;
+    int32_t tokens = 0;
+    int32_t finish_reason = -1;
+    ClientStats* stats = nullptr;
+};
+
+double elapsed_ms(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+int32_t on_token(
+    int32_t token,
+    const char* text,
+    int8_t is_final,
+    int32_t finish_reason,
+    void* user_data
+) {
+    (void)token;
+    (void)text;
+
+    auto* state = static_cast<StreamState*>(user_data);
+    Clock::time_point now = Clock::now();
+
+    if (is_final) {
+        state->finish_reason = finish_reason;
+        return 0;
+    }
+
+    if (!state->seen_first) {
+        state->stats->ttft_ms.push_back(elapsed_ms(state->start, now));
+        state->seen_first = true;
+    } else {
+        state->stats->itl_ms.push_back(elapsed_ms(state->last, now));
+    }
+
+    state->last = now;
+    state->tokens++;
+    return 1;
+}
+
+/** Nearest-rank percentile over an already sorted sample vector. */
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+    return sorted[rank - 1];
+}
+
+struct Summary {
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double mean = 0.0;
+    double max = 0.0;
+    size_t count = 0;
+};
+
+Summary summarize(std::vector<double>& samples) {
+    Summary s;
+    if (samples.empty()) return s;
+
+    std::sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for (double v : samples) total += v;
+
+    s.p50 = percentile(samples, 50.0);
+    s.p90 = percentile(samples, 90.0);
+    s.p99 = percentile(samples, 99.0);
+    s.mean = total / samples.size();
+    s.max = samples.back();
+    s.count = samples.size();
+    return s;
+}
+
+/** Build a prompt of exactly `length` tokens by repeating the filler text. */
+std::vector<int32_t> make_prompt(const std::vector<int32_t>& filler, int32_t length) {
+    std::vector<int32_t> prompt;
+    prompt.reserve(length);
+    while (static_cast<int32_t>(prompt.size()) < length) {
+        size_t take = std::min(filler.size(), static_cast<size_t>(length) - prompt.size());
+        prompt.insert(prompt.end(), filler.begin(), filler.begin() + take);
+    }
+    return prompt;
+}
+
+void print_usage(const char* argv0) {
+    printf(
+        "Usage: %s --model PATH [--model PATH ...] [options]\n"
+        "\n"
+        "Options:\n"
+        "  --model PATH           GGUF model to load (repeatable)\n"
+        "  --handles-per-model N  Model handles to load per path (default 1)\n"
+        "  --clients N            Concurrent client threads (default 8)\n"
+        "  --requests N           Total requests to issue (default 64)\n"
+        "  --rate R               Poisson arrival rate in req/s, 0 = closed loop (default 0)\n"
+        "  --prompt-len DIST      Prompt length distribution (default fixed:128)\n"
+        "  --output-len DIST      Output length distribution (default fixed:64)\n"
+        "  --ctx N                Context size per handle (default: model)\n"
+        "  --gpu-layers N         Layers to offload, -1 for all (default 0)\n"
+        "  --threads N            Threads per handle, 0 for auto (default 0)\n"
+        "  --batch N              Prompt batch size, 0 for default (default 0)\n"
+        "  --seed N               Seed for the request schedule (default 42)\n"
+        "  --json PATH            Also write the summary as JSON\n"
+        "\n"
+        "DIST is fixed:N, uniform:MIN:MAX or normal:MEAN:STDDEV.\n",
+        argv0
+    );
+}
+
+bool parse_args(int argc, char** argv, Options* opts) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&](const char** value) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Missing value for %s\n", arg.c_str());
+                return false;
+            }
+            *value = argv[++i];
+            return true;
+        };
+
+        const char* value = nullptr;
+        if (arg == "--help" || arg == "-h") {
+            return false;
+        } else if (arg == "--model") {
+            if (!next(&value)) return false;
+            opts->model_paths.push_back(value);
+        } else if (arg == "--handles-per-model") {
+            if (!next(&value)) return false;
+            opts->handles_per_model = std::atoi(value);
+        } else if (arg == "--clients") {
+            if (!next(&value)) return false;
+            opts->clients = std::atoi(value);
+        } else if (arg == "--requests") {
+            if (!next(&value)) return false;
+            opts->requests = std::atoi(value);
+        } else if (arg == "--rate") {
+            if (!next(&value)) return false;
+            opts->arrival_rate = std::atof(value);
+        } else if (arg == "--prompt-len") {
+            if (!next(&value)) return false;
+            if (!LengthDistribution::parse(value, &opts->prompt_length)) {
+                fprintf(stderr, "Invalid prompt length distribution: %s\n", value);
+                return false;
+            }
+        } else if (arg == "--output-len") {
+            if (!next(&value)) return false;
+            if (!LengthDistribution::parse(value, &opts->output_length)) {
+                fprintf(stderr, "Invalid output length distribution: %s\n", value);
+                return false;
+            }
+        } else if (arg == "--ctx") {
+            if (!next(&value)) return false;
+            opts->context_size = std::atoi(value);
+        } else if (arg == "--gpu-layers") {
+            if (!next(&value)) return false;
+            opts->gpu_layers = std::atoi(value);
+        } else if (arg == "--threads") {
+            if (!next(&value)) return false;
+            opts->threads = std::atoi(value);
+        } else if (arg == "--batch") {
+            if (!next(&value)) return false;
+            opts->batch_size = std::atoi(value);
+        } else if (arg == "--seed") {
+            if (!next(&value)) return false;
+            opts->seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--json") {
+            if (!next(&value)) return false;
+            opts->json_path = value;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    if (opts->model_paths.empty()) {
+        fprintf(stderr, "At least one --model is required\n");
+        return false;
+    }
+    if (opts->clients <= 0 || opts->requests <= 0 || opts->handles_per_model <= 0) {
+        fprintf(stderr, "--clients, --requests and --handles-per-model must be positive\n");
+        return false;
+    }
+    return true;
+}
+
+std::vector<RequestSpec> build_schedule(const Options& opts) {
+    std::mt19937_64 rng(opts.seed);
+    std::vector<RequestSpec> schedule(opts.requests);
+
+    double arrival_s = 0.0;
+    for (int32_t i = 0; i < opts.requests; i++) {
+        RequestSpec& spec = schedule[i];
+        spec.prompt_tokens = opts.prompt_length.sample(rng);
+        spec.max_tokens = opts.output_length.sample(rng);
+        spec.seed = static_cast<int32_t>(rng() & 0x7fffffff);
+
+        if (opts.arrival_rate > 0.0) {
+            arrival_s += std::exponential_distribution<double>(opts.arrival_rate)(rng);
+            spec.arrival = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(arrival_s));
+        }
+    }
+    return schedule;
+}
+
+void print_summary_row(const char* label, const Summary& s) {
+    printf("  %-10s %8zu %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+           label, s.count, s.p50, s.p90, s.p99, s.mean, s.max);
+}
+
+void write_summary_json(
+    FILE* out,
+    const char* key,
+    const Summary& s,
+    bool trailing_comma
+) {
+    fprintf(out,
+            "  \"%s\": {\"count\": %zu, \"p50\": %.3f, \"p90\": %.3f, "
+            "\"p99\": %.3f, \"mean\": %.3f, \"max\": %.3f}%s\n",
+            key, s.count, s.p50, s.p90, s.p99, s.mean, s.max,
+            trailing_comma ? "," : "");
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parse_args(argc, argv, &opts)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    if (dartllm_init() != 0) {
+        fprintf(stderr, "dartllm_init failed\n");
+        return 1;
+    }
+
+    std::vector<void*> handles;
+    std::vector<std::vector<int32_t>> fillers;
+
+    for (const std::string& path : opts.model_paths) {
+        for (int32_t h = 0; h < opts.handles_per_model; h++) {
+            void* handle = dartllm_load_model(
+                path.c_str(),
+                opts.context_size,
+                opts.gpu_layers,
+                opts.threads,
+                opts.batch_size,
+                1
+            );
+            if (!handle) {
+                const char* error = dartllm_get_last_error();
+                fprintf(stderr, "Failed to load %s: %s\n", path.c_str(), error ? error : "unknown");
+                for (void* loaded : handles) dartllm_free_model(loaded);
+                return 1;
+            }
+
+            int32_t length = 0;
+            int32_t* tokens = dartllm_tokenize(handle, FILLER_TEXT, 0, &length);
+            if (!tokens || length <= 0) {
+                fprintf(stderr, "Failed to tokenize filler text for %s\n", path.c_str());
+                dartllm_free(tokens);
+                dartllm_free_model(handle);
+                for (void* loaded : handles) dartllm_free_model(loaded);
+                return 1;
+            }
+
+            handles.push_back(handle);
+            fillers.emplace_back(tokens, tokens + length);
+            dartllm_free(tokens);
+        }
+    }
+
+    std::vector<RequestSpec> schedule = build_schedule(opts);
+    std::vector<ClientStats> stats(opts.clients);
+    std::atomic<int32_t> next_request{0};
+
+    printf("DartLLM load generator\n");
+    printf("  handles: %zu  clients: %d  requests: %d  mode: %s",
+           handles.size(), opts.clients, opts.requests,
+           opts.arrival_rate > 0.0 ? "open loop" : "closed loop");
+    if (opts.arrival_rate > 0.0) {
+        printf(" (%.2f req/s)", opts.arrival_rate);
+    }
+    printf("\n\n");
+
+    Clock::time_point run_start = Clock::now();
+
+    auto client = [&](int32_t client_index) {
+        ClientStats& local = stats[client_index];
+        size_t handle_index = client_index % handles.size();
+        void* handle = handles[handle_index];
+        const std::vector<int32_t>& filler = fillers[handle_index];
+
+        for (;;) {
+            int32_t index = next_request.fetch_add(1);
+            if (index >= opts.requests) break;
+
+            const RequestSpec& spec = schedule[index];
+            std::vector<int32_t> prompt = make_prompt(filler, spec.prompt_tokens);
+
+            StreamState state;
+            state.stats = &local;
+            if (opts.arrival_rate > 0.0) {
+                state.start = run_start + spec.arrival;
+                std::this_thread::sleep_until(state.start);
+            } else {
+                state.start = Clock::now();
+            }
+
+            int32_t rc = dartllm_generate_stream(
+                handle,
+                prompt.data(),
+                static_cast<int32_t>(prompt.size()),
+                spec.max_tokens,
+                0.8f,
+                0.95f,
+                40,
+                0.05f,
+                1.0f,
+                spec.seed,
+                nullptr,
+                1.0f,
+                nullptr,
+                on_token,
+                &state
+            );
+
+            Clock::time_point done = Clock::now();
+            if (rc != 0 || state.finish_reason == 2) {
+                local.failed++;
+                continue;
+            }
+
+            local.e2e_ms.push_back(elapsed_ms(state.start, done));
+            local.prompt_tokens += spec.prompt_tokens;
+            local.generated_tokens += state.tokens;
+            local.completed++;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(opts.clients);
+    for (int32_t i = 0; i < opts.clients; i++) {
+        threads.emplace_back(client, i);
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    double wall_s = elapsed_ms(run_start, Clock::now()) / 1000.0;
+
+    ClientStats total;
+    for (const ClientStats& s : stats) {
+        total.ttft_ms.insert(total.ttft_ms.end(), s.ttft_ms.begin(), s.ttft_ms.end());
+        total.itl_ms.insert(total.itl_ms.end(), s.itl_ms.begin(), s.itl_ms.end());
+        total.e2e_ms.insert(total.e2e_ms.end(), s.e2e_ms.begin(), s.e2e_ms.end());
+        total.prompt_tokens += s.prompt_tokens;
+        total.generated_tokens += s.generated_tokens;
+        total.completed += s.completed;
+        total.failed += s.failed;
+    }
+
+    Summary ttft = summarize(total.ttft_ms);
+    Summary itl = summarize(total.itl_ms);
+    Summary e2e = summarize(total.e2e_ms);
+
+    double output_tps = wall_s > 0.0 ? total.generated_tokens / wall_s : 0.0;
+    double prompt_tps = wall_s > 0.0 ? total.prompt_tokens / wall_s : 0.0;
+    double request_rate = wall_s > 0.0 ? total.completed / wall_s : 0.0;
+
+    printf("  %-10s %8s %10s %10s %10s %10s %10s\n",
+           "latency", "samples", "p50 ms", "p90 ms", "p99 ms", "mean ms", "max ms");
+    print_summary_row("ttft", ttft);
+    print_summary_row("itl", itl);
+    print_summary_row("e2e", e2e);
+    printf("\n");
+    printf("  completed: %d  failed: %d  wall: %.2f s\n", total.completed, total.failed, wall_s);
+    printf("  throughput: %.2f output tok/s, %.2f prompt tok/s, %.2f req/s\n",
+           output_tps, prompt_tps, request_rate);
+
+    if (!opts.json_path.empty()) {
+        FILE* out = std::fopen(opts.json_path.c_str(), "w");
+        if (!out) {
+            fprintf(stderr, "Failed to open %s for writing\n", opts.json_path.c_str());
+        } else {
+            fprintf(out, "{\n");
+            fprintf(out, "  \"handles\": %zu,\n", handles.size());
+            fprintf(out, "  \"clients\": %d,\n", opts.clients);
+            fprintf(out, "  \"arrival_rate\": %.3f,\n", opts.arrival_rate);
+            fprintf(out, "  \"completed\": %d,\n", total.completed);
+            fprintf(out, "  \"failed\": %d,\n", total.failed);
+            fprintf(out, "  \"wall_seconds\": %.3f,\n", wall_s);
+            fprintf(out, "  \"output_tokens_per_second\": %.3f,\n", output_tps);
+            fprintf(out, "  \"prompt_tokens_per_second\": %.3f,\n", prompt_tps);
+            fprintf(out, "  \"requests_per_second\": %.3f,\n", request_rate);
+            write_summary_json(out, "ttft_ms", ttft, true);
+            write_summary_json(out, "itl_ms", itl, true);
+            write_summary_json(out, "e2e_ms", e2e, false);
+            fprintf(out, "}\n");
+            std::fclose(out);
+        }
+    }
+
+    for (void* handle : handles) {
+        dartllm_free_model(handle);
+    }
+
+    return total.completed > 0 ? 0 : 1;
+}
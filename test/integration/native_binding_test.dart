@@ -1,4 +1,6 @@
 import 'dart:io';
+import 'package:dartllm/src/core/exceptions/inference_exception.dart';
+import 'package:dartllm/src/models/chat_message.dart';
 import 'package:dartllm/src/models/model_config.dart';
 import 'package:dartllm/src/platform/native_binding.dart';
 import 'package:dartllm/src/platform/platform_binding.dart';
@@ -123,6 +125,52 @@ void main() {
       await binding.unloadModel(result.handle);
     });
 
+    test('tokenizes text longer than the reused buffer', () async {
+      final initialized = await binding.initialize();
+      if (!initialized) {
+        print('Skipping: Native library not available');
+        return;
+      }
+
+      final modelPath = 'test_models/qwen2.5-0.5b-q4_k_m.gguf';
+      if (!File(modelPath).existsSync()) {
+        print('Skipping: Test model not found');
+        return;
+      }
+
+      final loadResult = await binding.loadModel(
+        LoadModelRequest(
+          modelPath: modelPath,
+          config: const ModelConfig(contextSize: 512, gpuLayers: 0),
+        ),
+      );
+
+      final short = await binding.tokenize(
+        TokenizeRequest(
+          modelHandle: loadResult.handle,
+          text: 'hello world',
+          addSpecialTokens: false,
+        ),
+      );
+      final long = await binding.tokenize(
+        TokenizeRequest(
+          modelHandle: loadResult.handle,
+          text: List.filled(400, 'hello world').join(' '),
+          addSpecialTokens: false,
+        ),
+      );
+
+      expect(long.length, greaterThan(400));
+      expect(long.sublist(0, short.length), equals(short));
+
+      final text = await binding.detokenize(
+        DetokenizeRequest(modelHandle: loadResult.handle, tokens: long),
+      );
+      expect(text, startsWith('hello world hello world'));
+
+      await binding.unloadModel(loadResult.handle);
+    });
+
     test('can generate text', () async {
       final initialized = await binding.initialize();
       if (!initialized) {
@@ -195,5 +243,518 @@ void main() {
 
       await binding.unloadModel(loadResult.handle);
     }, timeout: const Timeout(Duration(minutes: 2)));
+
+    test('constrains output to a JSON schema', () async {
+      final initialized = await binding.initialize();
+      if (!initialized) {
+        print('Skipping: Native library not available');
+        return;
+      }
+
+      final modelPath = 'test_models/qwen2.5-0.5b-q4_k_m.gguf';
+      if (!File(modelPath).existsSync()) {
+        print('Skipping: Test model not found');
+        return;
+      }
+
+      final loadResult = await binding.loadModel(
+        LoadModelRequest(
+          modelPath: modelPath,
+          config: const ModelConfig(contextSize: 512, gpuLayers: 0),
+        ),
+      );
+
+      final tokens = await binding.tokenize(
+        TokenizeRequest(
+          modelHandle: loadResult.handle,
+          text: 'Is Paris in France? Answer:',
+          addSpecialTokens: true,
+        ),
+      );
+
+      final generateResult = await binding.generate(
+        GenerateRequest(
+          modelHandle: loadResult.handle,
+          promptTokens: tokens,
+          maxTokens: 10,
+          temperature: 0.7,
+          topP: 0.9,
+          topK: 40,
+          minP: 0.0,
+          repetitionPenalty: 1.0,
+          frequencyPenalty: 0.0,
+          presencePenalty: 0.0,
+          repeatLastN: 64,
+          stopTokens: [],
+          seed: 42,
+          jsonSchema: '{"enum": ["yes", "no"]}',
+        ),
+      );
+
+      final outputText = await binding.detokenize(
+        DetokenizeRequest(
+          modelHandle: loadResult.handle,
+          tokens: generateResult.tokens,
+        ),
+      );
+      expect(outputText.trim(), isIn(['"yes"', '"no"']));
+
+      await binding.unloadModel(loadResult.handle);
+    }, timeout: const Timeout(Duration(minutes: 2)));
+
+    test('generates several completions from one prefill', () async {
+      final initialized = await binding.initialize();
+      if (!initialized) {
+        print('Skipping: Native library not available');
+        return;
+      }
+
+      final modelPath = 'test_models/qwen2.5-0.5b-q4_k_m.gguf';
+      if (!File(modelPath).existsSync()) {
+        print('Skipping: Test model not found');
+        return;
+      }
+
+      final loadResult = await binding.loadModel(
+        LoadModelRequest(
+          modelPath: modelPath,
+          config: const ModelConfig(contextSize: 512, gpuLayers: 0),
+        ),
+      );
+
+      final tokens = await binding.tokenize(
+        TokenizeRequest(
+          modelHandle: loadResult.handle,
+          text: 'Suggest a name for a cat:',
+          addSpecialTokens: true,
+        ),
+      );
+
+      final results = await binding.generateN(
+        GenerateRequest(
+          modelHandle: loadResult.handle,
+          promptTokens: tokens,
+          maxTokens: 8,
+          temperature: 0.9,
+          topP: 0.9,
+          topK: 40,
+          minP: 0.0,
+          repetitionPenalty: 1.0,
+          frequencyPenalty: 0.0,
+          presencePenalty: 0.0,
+          repeatLastN: 64,
+          stopTokens: [],
+          seed: 42,
+        ),
+        3,
+      );
+
+      expect(results, hasLength(3));
+      for (final result in results) {
+        expect(result.tokens.length, lessThanOrEqualTo(8));
+      }
+
+      await binding.unloadModel(loadResult.handle);
+    }, timeout: const Timeout(Duration(minutes: 2)));
+
+    test('scores candidate continuations', () async {
+      final initialized = await binding.initialize();
+      if (!initialized) {
+        print('Skipping: Native library not available');
+        return;
+      }
+
+      final modelPath = 'test_models/qwen2.5-0.5b-q4_k_m.gguf';
+      if (!File(modelPath).existsSync()) {
+        print('Skipping: Test model not found');
+        return;
+      }
+
+      final loadResult = await binding.loadModel(
+        LoadModelRequest(
+          modelPath: modelPath,
+          config: const ModelConfig(contextSize: 512, gpuLayers: 0),
+        ),
+      );
+
+      Future<List<int>> tokenize(String text, {bool special = false}) {
+        return binding.tokenize(
+          TokenizeRequest(
+            modelHandle: loadResult.handle,
+            text: text,
+            addSpecialTokens: special,
+          ),
+        );
+      }
+
+      final prompt = await tokenize('The capital of France is', special: true);
+      final candidates = [
+        await tokenize(' Paris'),
+        await tokenize(' a banana sandwich'),
+      ];
+
+      final scores = await binding.score(loadResult.handle, prompt, candidates);
+
+      expect(scores, hasLength(2));
+      expect(scores[1].tokenLogprobs, hasLength(candidates[1].length));
+      expect(scores[0].logprob, greaterThan(scores[1].logprob));
+
+      await binding.unloadModel(loadResult.handle);
+    }, timeout: const Timeout(Duration(minutes: 2)));
+
+    test('renders the model chat template incrementally', () async {
+      final initialized = await binding.initialize();
+      if (!initialized) {
+        print('Skipping: Native library not available');
+        return;
+      }
+
+      final modelPath = 'test_models/qwen2.5-0.5b-q4_k_m.gguf';
+      if (!File(modelPath).existsSync()) {
+        print('Skipping: Test model not found');
+        return;
+      }
+
+      final loadResult = await binding.loadModel(
+        LoadModelRequest(
+          modelPath: modelPath,
+          config: const ModelConfig(contextSize: 512, gpuLayers: 0),
+        ),
+      );
+
+      final messages = [
+        const ChatMessage.system('Be brief.'),
+        const ChatMessage.user('Hello'),
+        const ChatMessage.assistant('Hi!'),
+        const ChatMessage.user('Name a colour.'),
+      ];
+
+      final full = await binding.applyChatTemplate(
+        ChatTemplateRequest(
+          modelHandle: loadResult.handle,
+          messages: messages,
+        ),
+      );
+      final delta = await binding.applyChatTemplate(
+        ChatTemplateRequest(
+          modelHandle: loadResult.handle,
+          messages: messages,
+          previousMessageCount: 3,
+        ),
+      );
+
+      expect(full, isNotNull);
+      expect(full!.incremental, isFalse);
+      expect(full.text, contains('Name a colour.'));
+      expect(delta, isNotNull);
+      expect(delta!.incremental, isTrue);
+      expect(full.text, endsWith(delta.text));
+      expect(delta.text, isNot(contains('Be brief.')));
+
+      await binding.unloadModel(loadResult.handle);
+    }, timeout: const Timeout(Duration(minutes: 2)));
+
+    test('continues a session without re-evaluating it', () async {
+      final initialized = await binding.initialize();
+      if (!initialized) {
+        print('Skipping: Native library not available');
+        return;
+      }
+
+      final modelPath = 'test_models/qwen2.5-0.5b-q4_k_m.gguf';
+      if (!File(modelPath).existsSync()) {
+        print('Skipping: Test model not found');
+        return;
+      }
+
+      final loadResult = await binding.loadModel(
+        LoadModelRequest(
+          modelPath: modelPath,
+          config: const ModelConfig(contextSize: 512, gpuLayers: 0),
+        ),
+      );
+      final handle = loadResult.handle;
+
+      final tokens = await binding.tokenize(
+        TokenizeRequest(
+          modelHandle: handle,
+          text: 'The capital of France is',
+          addSpecialTokens: true,
+        ),
+      );
+
+      GenerateRequest greedy(
+        List<int> promptTokens, {
+        int maxTokens = 8,
+        SessionHandle? session,
+        int keep = 0,
+      }) {
+        return GenerateRequest(
+          modelHandle: handle,
+          promptTokens: promptTokens,
+          maxTokens: maxTokens,
+          temperature: 0.0,
+          topP: 1.0,
+          topK: 1,
+          minP: 0.0,
+          repetitionPenalty: 1.0,
+          frequencyPenalty: 0.0,
+          presencePenalty: 0.0,
+          repeatLastN: 64,
+          stopTokens: [],
+          seed: 42,
+          session: session,
+          sessionKeepTokens: keep,
+        );
+      }
+
+      final expected = await binding.generate(greedy(tokens));
+
+      final session = await binding.createSession(handle);
+      expect(session, isNotNull);
+
+      // First turn only fills the session; a stateless request in between
+      // must leave it intact.
+      final split = tokens.length ~/ 2;
+      await binding.generate(
+        greedy(tokens.sublist(0, split), maxTokens: 0, session: session),
+      );
+      await binding.generate(greedy([tokens.first], maxTokens: 4));
+
+      final continued = await binding.generate(
+        greedy(tokens.sublist(split), session: session, keep: split),
+      );
+
+      expect(continued.tokens, equals(expected.tokens));
+
+      await binding.freeSession(session!);
+      await binding.unloadModel(handle);
+    }, timeout: const Timeout(Duration(minutes: 2)));
+
+    test('can warm up model', () async {
+      final initialized = await binding.initialize();
+      if (!initialized) {
+        print('Skipping: Native library not available');
+        return;
+      }
+
+      final modelPath = 'test_models/qwen2.5-0.5b-q4_k_m.gguf';
+      if (!File(modelPath).existsSync()) {
+        print('Skipping: Test model not found at $modelPath');
+        return;
+      }
+
+      final result = await binding.loadModel(
+        LoadModelRequest(
+          modelPath: modelPath,
+          config: const ModelConfig(contextSize: 512, gpuLayers: 0),
+        ),
+      );
+
+      var lastDone = 0;
+      var total = 0;
+      await binding.warmup(
+        result.handle,
+        onProgress: (done, bytesTotal) {
+          expect(done, greaterThanOrEqualTo(lastDone));
+          lastDone = done;
+          total = bytesTotal;
+        },
+      );
+
+      print('Prefetched $lastDone of $total bytes');
+      expect(total, equals(File(modelPath).lengthSync()));
+      expect(lastDone, equals(total));
+
+      await binding.unloadModel(result.handle);
+    }, timeout: const Timeout(Duration(minutes: 2)));
+
+    test('switches LoRA adapters per request and pins them per session',
+        () async {
+      final initialized = await binding.initialize();
+      if (!initialized) {
+        print('Skipping: Native library not available');
+        return;
+      }
+
+      final modelPath = 'test_models/qwen2.5-0.5b-q4_k_m.gguf';
+      final adapterPath = 'test_models/qwen2.5-0.5b-lora.gguf';
+      if (!File(modelPath).existsSync() || !File(adapterPath).existsSync()) {
+        print('Skipping: Test model or LoRA adapter not found');
+        return;
+      }
+
+      final loadResult = await binding.loadModel(
+        LoadModelRequest(
+          modelPath: modelPath,
+          config: const ModelConfig(contextSize: 512, gpuLayers: 0),
+        ),
+      );
+      final adapter =
+          await binding.loadLoraAdapter(loadResult.handle, adapterPath);
+      final prompt = await binding.tokenize(
+        TokenizeRequest(
+          modelHandle: loadResult.handle,
+          text: 'The quick brown fox',
+          addSpecialTokens: true,
+        ),
+      );
+
+      GenerateRequest request({
+        LoraAdapterHandle? lora,
+        SessionHandle? session,
+        int keep = 0,
+      }) {
+        return GenerateRequest(
+          modelHandle: loadResult.handle,
+          promptTokens: prompt,
+          maxTokens: 12,
+          temperature: 0.0,
+          topP: 1.0,
+          topK: 1,
+          minP: 0.0,
+          repetitionPenalty: 1.0,
+          frequencyPenalty: 0.0,
+          presencePenalty: 0.0,
+          repeatLastN: 64,
+          stopTokens: [],
+          seed: 42,
+          loraAdapter: lora,
+          session: session,
+          sessionKeepTokens: keep,
+        );
+      }
+
+      final base = (await binding.generate(request())).tokens;
+      final tuned = (await binding.generate(request(lora: adapter))).tokens;
+      expect(tuned, isNot(equals(base)));
+      // A request never inherits the previous request's adapter.
+      expect((await binding.generate(request())).tokens, equals(base));
+
+      final session = await binding.createSession(loadResult.handle);
+      expect(session, isNotNull);
+      final first = await binding.generate(
+        request(lora: adapter, session: session),
+      );
+      expect(first.tokens, equals(tuned));
+
+      // Keeping tokens decoded with the adapter while asking for the base
+      // model is rejected rather than silently mixed.
+      await expectLater(
+        binding.generate(
+          request(session: session, keep: prompt.length),
+        ),
+        throwsA(isA<GenerationException>()),
+      );
+      await expectLater(
+        binding.unloadLoraAdapter(adapter),
+        throwsA(isA<StateError>()),
+      );
+
+      final reset = await binding.generate(request(session: session));
+      expect(reset.tokens, equals(base));
+
+      await binding.freeSession(session!);
+      await binding.unloadLoraAdapter(adapter);
+      await binding.unloadModel(loadResult.handle);
+    }, timeout: const Timeout(Duration(minutes: 2)));
+
+    test('registry keeps released models resident', () async {
+      final initialized = await binding.initialize();
+      if (!initialized) {
+        print('Skipping: Native library not available');
+        return;
+      }
+
+      final modelPath = 'test_models/qwen2.5-0.5b-q4_k_m.gguf';
+      if (!File(modelPath).existsSync()) {
+        print('Skipping: Test model not found at $modelPath');
+        return;
+      }
+
+      binding.configureRegistry(budgetBytes: 0);
+      await binding.registerModel(
+        'qwen',
+        modelPath,
+        config: const ModelConfig(contextSize: 512, gpuLayers: 0),
+      );
+
+      final first = Stopwatch()..start();
+      final loaded = await binding.acquireModel('qwen');
+      first.stop();
+      await binding.unloadModel(loaded.handle);
+
+      final second = Stopwatch()..start();
+      final reacquired = await binding.acquireModel('qwen');
+      second.stop();
+
+      print('First acquire: ${first.elapsedMilliseconds}ms');
+      print('Second acquire: ${second.elapsedMilliseconds}ms');
+      expect(reacquired.modelInfo.name, equals(loaded.modelInfo.name));
+      expect(second.elapsed, lessThan(first.elapsed));
+
+      await binding.unloadModel(reacquired.handle);
+      await binding.unregisterModel('qwen');
+    }, timeout: const Timeout(Duration(minutes: 2)));
+
+    test('probes model metadata without loading', () async {
+      final initialized = await binding.initialize();
+      if (!initialized) {
+        print('Skipping: Native library not available');
+        return;
+      }
+
+      final modelPath = 'test_models/qwen2.5-0.5b-q4_k_m.gguf';
+      if (!File(modelPath).existsSync()) {
+        print('Skipping: Test model not found at $modelPath');
+        return;
+      }
+
+      final stopwatch = Stopwatch()..start();
+      final info = await binding.probeModel(modelPath);
+      print('Probe took ${stopwatch.elapsedMilliseconds}ms');
+      print('Quantization: ${info.quantization}');
+      print('Parameters: ${info.parameterCount}');
+
+      expect(info.architecture, equals('qwen2'));
+      expect(info.quantization, equals('Q4_K_M'));
+      expect(info.layerCount, greaterThan(0));
+      expect(info.parameterCount, greaterThan(0));
+      expect(info.fileSizeBytes, equals(File(modelPath).lengthSync()));
+      expect(info.chatTemplate, isNotEmpty);
+    });
+
+    test('estimates memory without loading', () async {
+      final initialized = await binding.initialize();
+      if (!initialized) {
+        print('Skipping: Native library not available');
+        return;
+      }
+
+      final modelPath = 'test_models/qwen2.5-0.5b-q4_k_m.gguf';
+      if (!File(modelPath).existsSync()) {
+        print('Skipping: Test model not found at $modelPath');
+        return;
+      }
+
+      final small = await binding.estimateMemory(
+        modelPath,
+        config: const ModelConfig(contextSize: 512),
+      );
+      final large = await binding.estimateMemory(
+        modelPath,
+        config: const ModelConfig(contextSize: 4096),
+      );
+
+      print('Weights: ${small.weightsBytes} bytes');
+      print('KV cache @512: ${small.kvCacheBytes} bytes');
+      print('KV cache @4096: ${large.kvCacheBytes} bytes');
+      print('Total @4096: ${large.totalBytes} bytes');
+
+      expect(small.weightsBytes, greaterThan(0));
+      expect(small.weightsBytes, lessThanOrEqualTo(File(modelPath).lengthSync()));
+      expect(small.layerCount, greaterThan(0));
+      expect(large.kvCacheBytes, greaterThan(small.kvCacheBytes));
+    });
   });
 }
@@ -1,3 +1,7 @@
+import 'dart:convert';
+import 'dart:io';
+
+import 'package:dartllm/src/core/exceptions/network_exception.dart';
 import 'package:dartllm/src/core/huggingface_client.dart';
 import 'package:test/test.dart';
 
@@ -165,4 +169,157 @@ void main() {
       expect(true, isTrue);
     });
   });
+
+  group('HuggingFaceClient metadata cache', () {
+    late _HubServer hub;
+    late Directory tempDir;
+    final clients = <HuggingFaceClient>[];
+
+    HuggingFaceClient createClient({
+      Duration metadataTtl = const Duration(hours: 1),
+      bool offline = false,
+    }) {
+      final client = HuggingFaceClient(
+        endpoint: hub.endpoint,
+        metadataCacheDirectory: tempDir.path,
+        metadataTtl: metadataTtl,
+        offline: offline,
+      );
+      clients.add(client);
+      return client;
+    }
+
+    setUp(() async {
+      hub = _HubServer();
+      await hub.start();
+      tempDir = await Directory.systemTemp.createTemp('dartllm_hf_test_');
+    });
+
+    tearDown(() async {
+      for (final client in clients) {
+        client.close();
+      }
+      clients.clear();
+      await hub.stop();
+      await tempDir.delete(recursive: true);
+    });
+
+    test('answers from the cache while it is fresh', () async {
+      final client = createClient();
+
+      final first = await client.listFiles('org/repo');
+      final second = await client.listFiles('org/repo');
+
+      expect(second.single.filename, equals(first.single.filename));
+      expect(hub.requests, equals(1));
+    });
+
+    test('revalidates with If-None-Match once stale', () async {
+      final client = createClient(metadataTtl: Duration.zero);
+
+      await client.listFiles('org/repo');
+      final files = await client.listFiles('org/repo');
+
+      expect(files.single.filename, equals('model.gguf'));
+      expect(hub.requests, equals(2));
+      expect(hub.notModified, equals(1));
+    });
+
+    test('refetches when the repository changed', () async {
+      final client = createClient(metadataTtl: Duration.zero);
+
+      await client.listFiles('org/repo');
+      hub.etag = '"v2"';
+      hub.filename = 'model-v2.gguf';
+      final files = await client.listFiles('org/repo');
+
+      expect(files.single.filename, equals('model-v2.gguf'));
+      expect(hub.notModified, equals(0));
+    });
+
+    test('persists metadata for offline use', () async {
+      await createClient().listFiles('org/repo');
+      expect(await createClient().getFileSize('org/repo', 'model.gguf'),
+          equals(4096));
+      hub.requests = 0;
+
+      final offline = createClient(offline: true);
+      final files = await offline.listFiles('org/repo');
+      final size = await offline.getFileSize('org/repo', 'model.gguf');
+
+      expect(files.single.filename, equals('model.gguf'));
+      expect(size, equals(4096));
+      expect(hub.requests, equals(0));
+    });
+
+    test('falls back to stale metadata when the Hub is unreachable',
+        () async {
+      final client = createClient(metadataTtl: Duration.zero);
+      await client.listFiles('org/repo');
+      await hub.stop();
+
+      final files = await client.listFiles('org/repo');
+
+      expect(files.single.filename, equals('model.gguf'));
+    });
+
+    test('offline without cached metadata throws', () async {
+      final client = createClient(offline: true);
+
+      await expectLater(
+        client.listFiles('org/repo'),
+        throwsA(isA<ConnectionException>()),
+      );
+    });
+  });
+}
+
+/// A minimal Hub serving one repository with ETag revalidation.
+class _HubServer {
+  late HttpServer _server;
+
+  /// Current ETag of every response.
+  String etag = '"v1"';
+
+  /// Name of the single file in the repository.
+  String filename = 'model.gguf';
+
+  /// Requests received.
+  int requests = 0;
+
+  /// Requests answered with 304 Not Modified.
+  int notModified = 0;
+
+  String get endpoint => 'http://${_server.address.host}:${_server.port}';
+
+  Future<void> start() async {
+    _server = await HttpServer.bind(InternetAddress.loopbackIPv4, 0);
+    _server.listen(_handle);
+  }
+
+  Future<void> stop() => _server.close(force: true);
+
+  Future<void> _handle(HttpRequest request) async {
+    requests++;
+    final response = request.response;
+
+    if (request.headers.value(HttpHeaders.ifNoneMatchHeader) == etag) {
+      notModified++;
+      response.statusCode = HttpStatus.notModified;
+      await response.close();
+      return;
+    }
+
+    response.headers.set(HttpHeaders.etagHeader, etag);
+    if (request.uri.path == '/api/models/org/repo/tree/main') {
+      response.write(jsonEncode([
+        {'type': 'file', 'path': filename, 'size': 4096, 'oid': 'abc'},
+      ]));
+    } else if (request.uri.path == '/org/repo/resolve/main/model.gguf') {
+      response.contentLength = 4096;
+    } else {
+      response.statusCode = HttpStatus.notFound;
+    }
+    await response.close();
+  }
 }
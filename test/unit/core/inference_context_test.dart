@@ -141,6 +141,37 @@ void main() {
       });
     });
 
+    group('rewind', () {
+      test('keeps the first tokens', () {
+        context.addTokens([1, 2, 3, 4, 5]);
+        context.rewind(2);
+
+        expect(context.tokens, equals([1, 2]));
+      });
+
+      test('does nothing when length >= tokenCount', () {
+        context.addTokens([1, 2, 3]);
+        context.rewind(3);
+
+        expect(context.tokens, equals([1, 2, 3]));
+      });
+
+      test('throws for negative length', () {
+        expect(() => context.rewind(-1), throwsArgumentError);
+      });
+    });
+
+    group('commonPrefixLength', () {
+      test('counts matching leading tokens', () {
+        context.addTokens([1, 2, 3, 4]);
+
+        expect(context.commonPrefixLength([1, 2, 9, 4]), equals(2));
+        expect(context.commonPrefixLength([1, 2, 3, 4, 5]), equals(4));
+        expect(context.commonPrefixLength([1]), equals(1));
+        expect(context.commonPrefixLength([]), equals(0));
+      });
+    });
+
     group('isFull', () {
       test('returns false when not full', () {
         context.addTokens([1, 2, 3]);
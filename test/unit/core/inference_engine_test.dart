@@ -0,0 +1,210 @@
+import 'dart:typed_data';
+
+import 'package:dartllm/src/core/inference_engine.dart';
+import 'package:dartllm/src/models/chat_message.dart';
+import 'package:dartllm/src/models/enums.dart';
+import 'package:dartllm/src/models/model_info.dart';
+import 'package:dartllm/src/platform/platform_binding.dart';
+import 'package:test/test.dart';
+
+/// BOS token of [_FakeBinding]'s vocabulary.
+const _bos = 1;
+
+const _modelInfo = ModelInfo(
+  name: 'fake',
+  parameterCount: 1000,
+  architecture: 'llama',
+  quantization: 'F16',
+  contextSize: 4096,
+  vocabularySize: 256,
+  embeddingSize: 16,
+  layerCount: 1,
+  headCount: 1,
+  fileSizeBytes: 1000,
+);
+
+/// A binding whose tokenizer maps each character to its code unit and
+/// whose model template, when enabled, renders `<|role|>content\n`.
+class _FakeBinding implements PlatformBinding {
+  _FakeBinding({required this.hasTemplate, this.reply = 'Hi'});
+
+  final bool hasTemplate;
+  final String reply;
+
+  final List<TokenizeRequest> tokenizeRequests = [];
+  final List<GenerateRequest> generateRequests = [];
+
+  List<int> encode(String text, {bool special = false}) =>
+      [if (special) _bos, ...text.codeUnits];
+
+  @override
+  Future<LoadModelResult> loadModel(LoadModelRequest request) async {
+    return const LoadModelResult(handle: 1, modelInfo: _modelInfo);
+  }
+
+  @override
+  Future<void> unloadModel(ModelHandle handle) async {}
+
+  @override
+  Future<GenerateResult> generate(GenerateRequest request) async {
+    generateRequests.add(request);
+    final tokens = encode(reply);
+    return GenerateResult(
+      tokens: tokens,
+      promptTokenCount: request.promptTokens.length,
+      completionTokenCount: tokens.length,
+      finishReason: FinishReason.stop,
+      generationTimeMs: 0,
+    );
+  }
+
+  @override
+  Stream<GenerateStreamChunk> generateStream(GenerateRequest request) async* {
+    generateRequests.add(request);
+    for (final token in encode(reply)) {
+      yield GenerateStreamChunk(token: token);
+    }
+    yield const GenerateStreamChunk(token: 0, finishReason: FinishReason.stop);
+  }
+
+  @override
+  Future<EmbedResult> embed(EmbedRequest request) async {
+    return EmbedResult(embedding: Float32List(16));
+  }
+
+  @override
+  Future<List<int>> tokenize(TokenizeRequest request) async {
+    tokenizeRequests.add(request);
+    return encode(request.text, special: request.addSpecialTokens);
+  }
+
+  @override
+  Future<String> detokenize(DetokenizeRequest request) async {
+    return String.fromCharCodes(request.tokens.where((t) => t > _bos));
+  }
+
+  @override
+  Future<ModelInfo> getModelInfo(ModelHandle handle) async => _modelInfo;
+
+  @override
+  Future<ChatTemplateResult?> applyChatTemplate(
+    ChatTemplateRequest request,
+  ) async {
+    if (!hasTemplate) return null;
+    final buffer = StringBuffer();
+    for (final message in request.messages) {
+      buffer.write('<|${message.role.name}|>${message.content}\n');
+    }
+    if (request.addGenerationPrompt) buffer.write('<|assistant|>');
+    return ChatTemplateResult(text: buffer.toString(), incremental: false);
+  }
+
+  @override
+  Future<SessionHandle?> createSession(ModelHandle handle) async => 7;
+
+  @override
+  Future<void> freeSession(SessionHandle session) async {}
+
+  @override
+  bool get supportsGpu => false;
+
+  @override
+  bool get supportsMultiThreading => false;
+
+  @override
+  void dispose() {}
+}
+
+void main() {
+  group('InferenceEngine chat prompts', () {
+    test('model template prompts get the vocabulary special tokens', () async {
+      final binding = _FakeBinding(hasTemplate: true);
+      final engine = InferenceEngine(binding: binding);
+      await engine.loadModel('fake.gguf');
+
+      await engine.chat([const ChatMessage.user('Hello')]);
+
+      expect(binding.tokenizeRequests.last.addSpecialTokens, isTrue);
+      final request = binding.generateRequests.single;
+      expect(request.promptTokens.first, equals(_bos));
+      expect(
+        request.promptTokens,
+        equals(binding.encode('<|user|>Hello\n<|assistant|>', special: true)),
+      );
+      await engine.dispose();
+    });
+
+    test('streamed model template prompts get special tokens too', () async {
+      final binding = _FakeBinding(hasTemplate: true);
+      final engine = InferenceEngine(binding: binding);
+      await engine.loadModel('fake.gguf');
+
+      await engine.chatStream([const ChatMessage.user('Hello')]).drain<void>();
+
+      expect(binding.generateRequests.single.promptTokens.first, equals(_bos));
+      await engine.dispose();
+    });
+
+    test('built-in template prompts are tokenized as rendered', () async {
+      final binding = _FakeBinding(hasTemplate: false);
+      final engine = InferenceEngine(binding: binding);
+      await engine.loadModel('fake.gguf');
+
+      await engine.chat([const ChatMessage.user('Hello')]);
+
+      // The Dart templates write BOS themselves.
+      expect(binding.tokenizeRequests.last.addSpecialTokens, isFalse);
+      expect(
+        binding.generateRequests.single.promptTokens.first,
+        isNot(equals(_bos)),
+      );
+      await engine.dispose();
+    });
+
+    test('a follow-up turn only sends the tokens after the session',
+        () async {
+      final binding = _FakeBinding(hasTemplate: true);
+      final engine = InferenceEngine(binding: binding);
+      await engine.loadModel('fake.gguf');
+
+      await engine.chat([const ChatMessage.user('Hello')]);
+      await engine.chat([
+        const ChatMessage.user('Hello'),
+        const ChatMessage.assistant('Hi'),
+        const ChatMessage.user('More'),
+      ]);
+
+      // The session holds the first prompt and the reply, which the second
+      // rendering repeats verbatim.
+      final first =
+          binding.encode('<|user|>Hello\n<|assistant|>', special: true);
+      final second = binding.generateRequests.last;
+      expect(second.session, equals(7));
+      expect(second.sessionKeepTokens, equals(first.length + 2));
+      expect(
+        second.promptTokens,
+        equals(binding.encode('\n<|user|>More\n<|assistant|>')),
+      );
+      expect(
+        engine.context.tokenCount,
+        equals(first.length + 2 + second.promptTokens.length + 2),
+      );
+      await engine.dispose();
+    });
+
+    test('an edited history is resent from where it diverges', () async {
+      final binding = _FakeBinding(hasTemplate: true);
+      final engine = InferenceEngine(binding: binding);
+      await engine.loadModel('fake.gguf');
+
+      await engine.chat([const ChatMessage.user('Hello')]);
+      await engine.chat([const ChatMessage.user('Help')]);
+
+      final shared = binding.encode('<|user|>Hel', special: true);
+      final second = binding.generateRequests.last;
+      expect(second.sessionKeepTokens, equals(shared.length));
+      expect(second.promptTokens, equals(binding.encode('p\n<|assistant|>')));
+      await engine.dispose();
+    });
+  });
+}
@@ -1,5 +1,7 @@
+import 'dart:convert';
 import 'dart:io';
 
+import 'package:crypto/crypto.dart';
 import 'package:dartllm/src/core/model_cache.dart';
 import 'package:dartllm/src/models/model_info.dart';
 import 'package:test/test.dart';
@@ -192,6 +194,134 @@ void main() {
 
         expect(await cache.verifyModel('test-model'), isFalse);
       });
+
+      test('verifyModel checks the recorded SHA-256', () async {
+        final hash = sha256.convert(utf8.encode('test model content'));
+        final info = await cache.addModel(
+          'test-model',
+          testModelFile.path,
+          sha256: hash.toString().toUpperCase(),
+        );
+
+        expect(await cache.verifyModel('test-model'), isTrue);
+
+        // Same size, different bytes.
+        await File(info.filePath).writeAsString('test model CONTENT');
+        expect(await cache.verifyModel('test-model'), isFalse);
+      });
+    });
+
+    group('manifest', () {
+      late File testModelFile;
+
+      setUp(() async {
+        await cache.initialize();
+        testModelFile = File('${tempDir.path}/test_model.gguf');
+        await testModelFile.writeAsString('test model content');
+      });
+
+      test('stores identical content once', () async {
+        final first = await cache.addModel('model1', testModelFile.path);
+        final second = await cache.addModel('model2', testModelFile.path);
+
+        expect(second.filePath, equals(first.filePath));
+        expect(await cache.totalSize(), equals(first.sizeBytes));
+
+        expect(await cache.removeModel('model1'), equals(0));
+        expect(await File(second.filePath).exists(), isTrue);
+
+        expect(await cache.removeModel('model2'), equals(second.sizeBytes));
+        expect(await File(second.filePath).exists(), isFalse);
+      });
+
+      test('reloads entries in a new instance', () async {
+        await cache.addModel(
+          'model1',
+          testModelFile.path,
+          sourceUrl: 'https://example.com/model.gguf',
+        );
+        await cache.addModel('model2', testModelFile.path);
+        await cache.removeModel('model2');
+
+        final reopened = ModelCache(cacheDirectory: tempDir.path);
+        await reopened.initialize();
+
+        final models = await reopened.listModels();
+        expect(models.map((m) => m.modelId), equals(['model1']));
+        expect(models.single.sourceUrl,
+            equals('https://example.com/model.gguf'));
+        expect(await reopened.verifyModel('model1'), isTrue);
+      });
+
+      test('folds a long log into the snapshot', () async {
+        for (var i = 0; i < 100; i++) {
+          await cache.addModel('model$i', testModelFile.path);
+        }
+
+        final manifestDir = '${tempDir.path}/.manifest';
+        expect(File('$manifestDir/snapshot.json').existsSync(), isTrue);
+        expect(
+          File('$manifestDir/log.jsonl').readAsLinesSync().length,
+          lessThan(64),
+        );
+
+        final reopened = ModelCache(cacheDirectory: tempDir.path);
+        await reopened.initialize();
+        expect(await reopened.modelCount(), equals(100));
+      });
+
+      test('imports metadata files of older versions', () async {
+        final legacyDir = Directory('${tempDir.path}/legacy');
+        await legacyDir.create();
+        final modelFile = File('${legacyDir.path}/org_model.gguf');
+        await modelFile.writeAsString('legacy model');
+        await Directory('${legacyDir.path}/.metadata').create();
+        await File('${legacyDir.path}/.metadata/org_model.gguf.json')
+            .writeAsString('''
+modelId=org/model.gguf
+filePath=${modelFile.path}
+sizeBytes=12
+downloadedAt=2024-01-01T00:00:00.000
+sourceUrl=https://example.com/model.gguf
+''');
+
+        final legacy = ModelCache(cacheDirectory: legacyDir.path);
+        await legacy.initialize();
+
+        final info = await legacy.getModel('org/model.gguf');
+        expect(info, isNotNull);
+        expect(info!.filePath, equals(modelFile.path));
+        expect(await legacy.verifyModel('org/model.gguf'), isTrue);
+        expect(Directory('${legacyDir.path}/.metadata').existsSync(), isFalse);
+      });
+
+      test('keeps metadata files it cannot import', () async {
+        final legacyDir = Directory('${tempDir.path}/legacy');
+        final metadataDir = Directory('${legacyDir.path}/.metadata');
+        await metadataDir.create(recursive: true);
+        final modelFile = File('${legacyDir.path}/org_model.gguf');
+        await modelFile.writeAsString('legacy model');
+        await File('${metadataDir.path}/org_model.gguf.json').writeAsString('''
+modelId=org/model.gguf
+filePath=${modelFile.path}
+sizeBytes=12
+downloadedAt=2024-01-01T00:00:00.000
+sourceUrl=https://example.com/model.gguf
+''');
+        final unparsed = File('${metadataDir.path}/org_other.gguf.json');
+        await unparsed.writeAsString('modelId=org/other.gguf\n');
+
+        final legacy = ModelCache(cacheDirectory: legacyDir.path);
+        await legacy.initialize();
+
+        expect(await legacy.hasModel('org/model.gguf'), isTrue);
+        expect(await legacy.hasModel('org/other.gguf'), isFalse);
+        expect(
+          File('${metadataDir.path}/org_model.gguf.json').existsSync(),
+          isFalse,
+        );
+        expect(unparsed.existsSync(), isTrue);
+      });
     });
 
     group('model ID sanitization', () {
@@ -1,5 +1,8 @@
 import 'dart:io';
+import 'dart:typed_data';
 
+import 'package:crypto/crypto.dart';
+import 'package:dartllm/src/core/exceptions/network_exception.dart';
 import 'package:dartllm/src/core/model_downloader.dart';
 import 'package:test/test.dart';
 
@@ -170,5 +173,197 @@ void main() {
         expect(length, isNull);
       });
     });
+
+    group('downloadSegmented', () {
+      final data = Uint8List.fromList(
+        List.generate(1000, (i) => (i * 7) % 256),
+      );
+      late _RangeServer server;
+      late String destination;
+
+      setUp(() async {
+        server = _RangeServer(data);
+        await server.start();
+        destination = '${tempDir.path}/model.gguf';
+      });
+
+      tearDown(() async {
+        await server.stop();
+      });
+
+      test('writes every segment at its offset', () async {
+        final result = await downloader.downloadSegmented(
+          server.url,
+          destination,
+          segments: 4,
+          connections: 2,
+          minSegmentSize: 100,
+        );
+
+        expect(await File(destination).readAsBytes(), equals(data));
+        expect(result.sizeBytes, equals(data.length));
+        expect(result.sha256, equals(sha256.convert(data).toString()));
+        expect(File('$destination.part.segments').existsSync(), isFalse);
+      });
+
+      test('hashes segments that finish out of order', () async {
+        // The first segment arrives last.
+        server.slowFrom = 0;
+
+        final result = await downloader.downloadSegmented(
+          server.url,
+          destination,
+          segments: 4,
+          connections: 4,
+          minSegmentSize: 100,
+          expectedSha256: sha256.convert(data).toString(),
+        );
+
+        expect(await File(destination).readAsBytes(), equals(data));
+        expect(result.sha256, equals(sha256.convert(data).toString()));
+      });
+
+      test('resumes only the unfinished segments', () async {
+        server.cutAt = 650;
+
+        await expectLater(
+          downloader.downloadSegmented(
+            server.url,
+            destination,
+            segments: 4,
+            connections: 2,
+            minSegmentSize: 100,
+          ),
+          throwsA(isA<DownloadException>()),
+        );
+        expect(File('$destination.part.segments').existsSync(), isTrue);
+
+        server.bytesServed = 0;
+        final result = await downloader.downloadSegmented(
+          server.url,
+          destination,
+          segments: 4,
+          connections: 2,
+          minSegmentSize: 100,
+        );
+
+        expect(await File(destination).readAsBytes(), equals(data));
+        expect(server.bytesServed, lessThan(data.length));
+        expect(result.sha256, equals(sha256.convert(data).toString()));
+      });
+
+      test('falls back to one connection without range support', () async {
+        server.ranges = false;
+
+        final result = await downloader.downloadSegmented(
+          server.url,
+          destination,
+          minSegmentSize: 100,
+        );
+
+        expect(await File(destination).readAsBytes(), equals(data));
+        expect(result.sha256, equals(sha256.convert(data).toString()));
+      });
+
+      test('rejects a checksum mismatch', () async {
+        await expectLater(
+          downloader.downloadSegmented(
+            server.url,
+            destination,
+            minSegmentSize: 100,
+            expectedSha256: '0' * 64,
+          ),
+          throwsA(isA<DownloadException>()),
+        );
+        expect(File(destination).existsSync(), isFalse);
+      });
+
+      test('rejects fewer than one segment or connection', () {
+        expect(
+          () => downloader.downloadSegmented(server.url, destination,
+              segments: 0),
+          throwsArgumentError,
+        );
+        expect(
+          () => downloader.downloadSegmented(server.url, destination,
+              connections: 0),
+          throwsArgumentError,
+        );
+      });
+    });
   });
 }
+
+/// Serves [data] on loopback, answering single byte ranges like a CDN.
+class _RangeServer {
+  final Uint8List data;
+
+  /// Whether byte ranges are honoured; if not, every response is whole.
+  bool ranges = true;
+
+  /// Drops the connection of the first response covering this offset
+  /// just before it.
+  int? cutAt;
+
+  /// Holds back the response starting at this offset for a moment, so
+  /// the segments after it finish first.
+  int? slowFrom;
+
+  /// Body bytes sent so far.
+  int bytesServed = 0;
+
+  late HttpServer _server;
+
+  _RangeServer(this.data);
+
+  String get url => 'http://${_server.address.host}:${_server.port}/m.gguf';
+
+  Future<void> start() async {
+    _server = await HttpServer.bind(InternetAddress.loopbackIPv4, 0);
+    _server.listen(_handle);
+  }
+
+  Future<void> stop() => _server.close(force: true);
+
+  Future<void> _handle(HttpRequest request) async {
+    final response = request.response;
+    var start = 0;
+    var end = data.length;
+
+    final range = request.headers.value('range');
+    if (ranges && range != null) {
+      final match = RegExp(r'bytes=(\d+)-(\d*)').firstMatch(range)!;
+      start = int.parse(match[1]!);
+      if (match[2]!.isNotEmpty) {
+        end = int.parse(match[2]!) + 1;
+      }
+      response.statusCode = HttpStatus.partialContent;
+      response.headers
+          .set('content-range', 'bytes $start-${end - 1}/${data.length}');
+    }
+    response.contentLength = end - start;
+
+    if (start == slowFrom) {
+      await Future<void>.delayed(const Duration(milliseconds: 200));
+    }
+
+    final cut = cutAt;
+    if (cut != null && cut > start && cut < end) {
+      cutAt = null;
+      final socket = await response.detachSocket();
+      socket.add(data.sublist(start, cut));
+      bytesServed += cut - start;
+      await socket.flush();
+      socket.destroy();
+      return;
+    }
+
+    try {
+      response.add(data.sublist(start, end));
+      bytesServed += end - start;
+      await response.close();
+    } on Object {
+      // The client may hang up early, as the range probe does.
+    }
+  }
+}
@@ -11,6 +11,7 @@ void main() {
         expect(config.defaultCacheDirectory, isNull);
         expect(config.defaultGpuLayers, equals(-1));
         expect(config.defaultThreadCount, equals(0));
+        expect(config.isolateWorkers, equals(0));
         expect(config.enableLogging, isFalse);
         expect(config.logLevel, equals(LogLevel.warning));
         expect(config.huggingFaceToken, isNull);
@@ -23,6 +24,7 @@ void main() {
           defaultCacheDirectory: '/custom/cache',
           defaultGpuLayers: 32,
           defaultThreadCount: 8,
+          isolateWorkers: 2,
           enableLogging: true,
           logLevel: LogLevel.debug,
           huggingFaceToken: 'hf_token_123',
@@ -31,6 +33,7 @@ void main() {
         expect(config.defaultCacheDirectory, equals('/custom/cache'));
         expect(config.defaultGpuLayers, equals(32));
         expect(config.defaultThreadCount, equals(8));
+        expect(config.isolateWorkers, equals(2));
         expect(config.enableLogging, isTrue);
         expect(config.logLevel, equals(LogLevel.debug));
         expect(config.huggingFaceToken, equals('hf_token_123'));
@@ -1,6 +1,135 @@
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'package:dartllm/src/core/exceptions/exceptions.dart';
+import 'package:dartllm/src/models/enums.dart';
+import 'package:dartllm/src/models/model_config.dart';
+import 'package:dartllm/src/models/model_info.dart';
 import 'package:dartllm/src/platform/isolate_manager.dart';
+import 'package:dartllm/src/platform/platform_binding.dart';
 import 'package:test/test.dart';
 
+const _modelInfo = ModelInfo(
+  name: 'fake',
+  parameterCount: 1000,
+  architecture: 'llama',
+  quantization: 'F16',
+  contextSize: 4096,
+  vocabularySize: 256,
+  embeddingSize: 4,
+  layerCount: 1,
+  headCount: 1,
+  fileSizeBytes: 1000,
+);
+
+/// Runs in the bridge isolate.
+Future<PlatformBinding> _createFakeBinding() async => _FakeBinding();
+
+/// A binding with one model whose tokenizer maps each character to its
+/// code unit and which replies with the prompt reversed.
+class _FakeBinding implements PlatformBinding {
+  static const _handle = 1;
+
+  void _check(ModelHandle handle) {
+    if (handle != _handle) throw StateError('Invalid model handle: $handle');
+  }
+
+  @override
+  Future<LoadModelResult> loadModel(LoadModelRequest request) async {
+    return const LoadModelResult(handle: _handle, modelInfo: _modelInfo);
+  }
+
+  @override
+  Future<void> unloadModel(ModelHandle handle) async {}
+
+  @override
+  Future<GenerateResult> generate(GenerateRequest request) async {
+    _check(request.modelHandle);
+    return GenerateResult(
+      tokens: request.promptTokens.reversed.toList(),
+      promptTokenCount: request.promptTokens.length,
+      completionTokenCount: request.promptTokens.length,
+      finishReason: FinishReason.stop,
+      generationTimeMs: 0,
+    );
+  }
+
+  @override
+  Stream<GenerateStreamChunk> generateStream(GenerateRequest request) async* {
+    _check(request.modelHandle);
+    for (final token in request.promptTokens.reversed) {
+      yield GenerateStreamChunk(token: token, text: String.fromCharCode(token));
+    }
+    yield const GenerateStreamChunk(token: 0, finishReason: FinishReason.stop);
+  }
+
+  @override
+  Future<EmbedResult> embed(EmbedRequest request) async {
+    _check(request.modelHandle);
+    return EmbedResult(
+      embedding: Float32List.fromList(
+        [for (final token in request.tokens) token / 2],
+      ),
+    );
+  }
+
+  @override
+  Future<List<int>> tokenize(TokenizeRequest request) async {
+    _check(request.modelHandle);
+    return request.text.codeUnits;
+  }
+
+  @override
+  Future<String> detokenize(DetokenizeRequest request) async {
+    _check(request.modelHandle);
+    return String.fromCharCodes(request.tokens);
+  }
+
+  @override
+  Future<ModelInfo> getModelInfo(ModelHandle handle) async {
+    _check(handle);
+    return _modelInfo;
+  }
+
+  @override
+  Future<ChatTemplateResult?> applyChatTemplate(
+    ChatTemplateRequest request,
+  ) async =>
+      null;
+
+  @override
+  Future<SessionHandle?> createSession(ModelHandle handle) async => null;
+
+  @override
+  Future<void> freeSession(SessionHandle session) async {}
+
+  @override
+  bool get supportsGpu => false;
+
+  @override
+  bool get supportsMultiThreading => false;
+
+  @override
+  void dispose() {}
+}
+
+GenerateRequest _generateRequest(List<int> promptTokens, {int model = 1}) {
+  return GenerateRequest(
+    modelHandle: model,
+    promptTokens: promptTokens,
+    maxTokens: 8,
+    temperature: 0,
+    topP: 1,
+    topK: 1,
+    minP: 0,
+    repetitionPenalty: 1,
+    frequencyPenalty: 0,
+    presencePenalty: 0,
+    repeatLastN: 64,
+    stopTokens: const [],
+  );
+}
+
 void main() {
   group('IsolateRequest', () {
     test('stores request data', () {
@@ -80,9 +209,34 @@ void main() {
     });
   });
 
+  group('TypedPayload', () {
+    test('carries token IDs across isolates', () async {
+      final payload = TypedPayload.int32([1, 2, 3]);
+
+      final tokens = await Isolate.run(() => payload.asInt32List());
+
+      expect(tokens, equals([1, 2, 3]));
+    });
+
+    test('carries a float vector back from an isolate', () async {
+      final payload = await Isolate.run(
+        () => TypedPayload.float32(Float32List.fromList([0.5, 1.5])),
+      );
+
+      expect(payload.isFloat32, isTrue);
+      expect(payload.asFloat32List(), equals([0.5, 1.5]));
+    });
+
+    test('rejects reading as the wrong element type', () {
+      final payload = TypedPayload.float32(Float32List.fromList([1.0]));
+
+      expect(payload.asInt32List, throwsStateError);
+    });
+  });
+
   group('IsolateRequestType', () {
     test('contains all expected types', () {
-      expect(IsolateRequestType.values, hasLength(9));
+      expect(IsolateRequestType.values, hasLength(12));
       expect(IsolateRequestType.values, contains(IsolateRequestType.loadModel));
       expect(
           IsolateRequestType.values, contains(IsolateRequestType.unloadModel));
@@ -95,8 +249,21 @@ void main() {
           IsolateRequestType.values, contains(IsolateRequestType.detokenize));
       expect(
           IsolateRequestType.values, contains(IsolateRequestType.getModelInfo));
+      expect(IsolateRequestType.values,
+          contains(IsolateRequestType.applyChatTemplate));
+      expect(
+          IsolateRequestType.values, contains(IsolateRequestType.createSession));
+      expect(IsolateRequestType.values, contains(IsolateRequestType.freeSession));
       expect(IsolateRequestType.values, contains(IsolateRequestType.shutdown));
     });
+
+    test('marks read-only requests as lightweight', () {
+      expect(IsolateRequestType.tokenize.isLightweight, isTrue);
+      expect(IsolateRequestType.detokenize.isLightweight, isTrue);
+      expect(IsolateRequestType.getModelInfo.isLightweight, isTrue);
+      expect(IsolateRequestType.generate.isLightweight, isFalse);
+      expect(IsolateRequestType.embed.isLightweight, isFalse);
+    });
   });
 
   group('IsolateManager', () {
@@ -186,4 +353,146 @@ void main() {
       expect(response.success, isTrue);
     });
   });
+
+  group('IsolateManager bridge', () {
+    late IsolateManager manager;
+
+    setUp(() async {
+      manager = IsolateManager(bindingFactory: _createFakeBinding);
+      await manager.start();
+    });
+
+    tearDown(() async {
+      await manager.shutdown();
+    });
+
+    Future<Object?> send(IsolateRequestType type, Object? payload) async {
+      final response = await manager.sendRequest(
+        IsolateRequest(
+          requestId: manager.generateRequestId(),
+          type: type,
+          payload: payload,
+        ),
+      );
+      return response.data;
+    }
+
+    test('loads models on its binding', () async {
+      final result = await send(
+        IsolateRequestType.loadModel,
+        const LoadModelRequest(modelPath: 'fake.gguf', config: ModelConfig()),
+      );
+
+      expect(result, isA<LoadedModel>());
+      final loaded = result! as LoadedModel;
+      expect(loaded.result.handle, equals(1));
+      // The fake binding cannot share its models with another isolate.
+      expect(loaded.address, isNull);
+      expect(
+        await send(IsolateRequestType.getModelInfo, 1),
+        isA<ModelInfo>(),
+      );
+    });
+
+    test('returns tokens as typed lists', () async {
+      final tokens = await send(
+        IsolateRequestType.tokenize,
+        const TokenizeRequest(
+          modelHandle: 1,
+          text: 'abc',
+          addSpecialTokens: false,
+        ),
+      );
+
+      expect(tokens, isA<Int32List>());
+      expect(tokens, equals('abc'.codeUnits));
+      expect(
+        await send(
+          IsolateRequestType.detokenize,
+          const DetokenizeRequest(modelHandle: 1, tokens: [104, 105]),
+        ),
+        equals('hi'),
+      );
+    });
+
+    test('moves prompt and generated tokens', () async {
+      final result = await send(
+        IsolateRequestType.generate,
+        _generateRequest([1, 2, 3]),
+      );
+
+      final generated = result! as GenerateResult;
+      expect(generated.tokens, isA<Int32List>());
+      expect(generated.tokens, equals([3, 2, 1]));
+      expect(generated.promptTokenCount, equals(3));
+      expect(generated.finishReason, equals(FinishReason.stop));
+    });
+
+    test('returns embeddings as Float32List', () async {
+      final result = await send(
+        IsolateRequestType.embed,
+        const EmbedRequest(modelHandle: 1, tokens: [2, 4], normalize: false),
+      );
+
+      expect((result! as EmbedResult).embedding, equals([1.0, 2.0]));
+    });
+
+    test('streams chunks then a last one', () async {
+      final chunks = await manager
+          .sendStreamingRequest(
+            IsolateRequest(
+              requestId: manager.generateRequestId(),
+              type: IsolateRequestType.generateStream,
+              payload: _generateRequest([104, 105]),
+            ),
+          )
+          .toList();
+
+      expect(chunks.last.isLast, isTrue);
+      final tokens = [
+        for (final chunk in chunks)
+          if (chunk.data case final GenerateStreamChunk data) data.token,
+      ];
+      expect(tokens, equals([105, 104, 0]));
+    });
+
+    test('fails requests the binding rejects', () async {
+      await expectLater(
+        send(IsolateRequestType.generate, _generateRequest([1], model: 9)),
+        throwsA(isA<DartLLMException>()),
+      );
+      await expectLater(
+        manager
+            .sendStreamingRequest(
+              IsolateRequest(
+                requestId: manager.generateRequestId(),
+                type: IsolateRequestType.generateStream,
+                payload: _generateRequest([1], model: 9),
+              ),
+            )
+            .toList(),
+        throwsA(isA<DartLLMException>()),
+      );
+    });
+
+    test('hands model addresses to the bridge', () async {
+      // Without the address the request would run on the loaded model 1;
+      // with it the bridge tries to attach, which the fake cannot do.
+      await expectLater(
+        manager.sendRequest(
+          IsolateRequest(
+            requestId: manager.generateRequestId(),
+            type: IsolateRequestType.tokenize,
+            payload: const TokenizeRequest(
+              modelHandle: 1,
+              text: 'abc',
+              addSpecialTokens: false,
+            ),
+            modelAddress: 0x1000,
+          ),
+        ),
+        throwsA(isA<LLMPlatformException>()),
+      );
+    });
+  });
 }
@@ -0,0 +1,347 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:dartllm/src/core/exceptions/exceptions.dart';
+import 'package:dartllm/src/models/enums.dart';
+import 'package:dartllm/src/models/model_config.dart';
+import 'package:dartllm/src/models/model_info.dart';
+import 'package:dartllm/src/platform/isolate_pool.dart';
+import 'package:dartllm/src/platform/platform_binding.dart';
+import 'package:test/test.dart';
+
+/// Model files the fake bindings can load.
+const _paths = ['first.gguf', 'second.gguf'];
+
+/// How long a fake generation blocks its isolate.
+const _generationTime = Duration(milliseconds: 300);
+
+/// Runs in each worker isolate.
+Future<PlatformBinding> _createSharedBinding() async => _FakeSharedBinding();
+
+/// Runs in each worker isolate.
+Future<PlatformBinding> _createBinding() async => _FakeBinding();
+
+ModelInfo _modelInfo(String path) {
+  return ModelInfo(
+    name: path,
+    parameterCount: 1000,
+    architecture: 'llama',
+    quantization: 'F16',
+    contextSize: 4096,
+    vocabularySize: 256,
+    embeddingSize: 4,
+    layerCount: 1,
+    headCount: 1,
+    fileSizeBytes: 1000,
+  );
+}
+
+/// A binding that numbers its handles from 1, tokenizes each character
+/// to its code unit and blocks its isolate while generating.
+class _FakeBinding implements PlatformBinding {
+  final Map<ModelHandle, String> _models = {};
+  final Map<SessionHandle, ModelHandle> _sessions = {};
+  int _nextHandle = 1;
+
+  String _path(ModelHandle handle) {
+    final path = _models[handle];
+    if (path == null) throw StateError('Invalid model handle: $handle');
+    return path;
+  }
+
+  @override
+  Future<LoadModelResult> loadModel(LoadModelRequest request) async {
+    if (!_paths.contains(request.modelPath)) {
+      throw ModelNotFoundException(request.modelPath);
+    }
+    final handle = _nextHandle++;
+    _models[handle] = request.modelPath;
+    return LoadModelResult(
+      handle: handle,
+      modelInfo: _modelInfo(request.modelPath),
+    );
+  }
+
+  @override
+  Future<void> unloadModel(ModelHandle handle) async {
+    _models.remove(handle);
+    _sessions.removeWhere((_, model) => model == handle);
+  }
+
+  @override
+  Future<GenerateResult> generate(GenerateRequest request) async {
+    _path(request.modelHandle);
+    final session = request.session;
+    if (session != null && _sessions[session] != request.modelHandle) {
+      throw StateError('Invalid session handle: $session');
+    }
+
+    sleep(_generationTime);
+    return GenerateResult(
+      tokens: request.promptTokens.reversed.toList(),
+      promptTokenCount: request.promptTokens.length,
+      completionTokenCount: request.promptTokens.length,
+      finishReason: FinishReason.stop,
+      generationTimeMs: _generationTime.inMilliseconds,
+    );
+  }
+
+  @override
+  Stream<GenerateStreamChunk> generateStream(GenerateRequest request) async* {
+    final result = await generate(request);
+    for (final token in result.tokens) {
+      yield GenerateStreamChunk(token: token, text: String.fromCharCode(token));
+    }
+    yield const GenerateStreamChunk(token: 0, finishReason: FinishReason.stop);
+  }
+
+  @override
+  Future<EmbedResult> embed(EmbedRequest request) async {
+    _path(request.modelHandle);
+    return EmbedResult(embedding: Float32List(4));
+  }
+
+  @override
+  Future<List<int>> tokenize(TokenizeRequest request) async {
+    _path(request.modelHandle);
+    return request.text.codeUnits;
+  }
+
+  @override
+  Future<String> detokenize(DetokenizeRequest request) async {
+    _path(request.modelHandle);
+    return String.fromCharCodes(request.tokens);
+  }
+
+  @override
+  Future<ModelInfo> getModelInfo(ModelHandle handle) async {
+    return _modelInfo(_path(handle));
+  }
+
+  @override
+  Future<ChatTemplateResult?> applyChatTemplate(
+    ChatTemplateRequest request,
+  ) async =>
+      null;
+
+  @override
+  Future<SessionHandle?> createSession(ModelHandle handle) async {
+    _path(handle);
+    final session = _nextHandle++;
+    _sessions[session] = handle;
+    return session;
+  }
+
+  @override
+  Future<void> freeSession(SessionHandle session) async {
+    _sessions.remove(session);
+  }
+
+  @override
+  bool get supportsGpu => false;
+
+  @override
+  bool get supportsMultiThreading => false;
+
+  @override
+  void dispose() {}
+}
+
+/// A [_FakeBinding] whose model addresses are their index in [_paths].
+class _FakeSharedBinding extends _FakeBinding implements SharedModelBinding {
+  @override
+  int modelAddress(ModelHandle handle) => _paths.indexOf(_path(handle)) + 1;
+
+  @override
+  ModelHandle attachModel(int address) {
+    final handle = _nextHandle++;
+    _models[handle] = _paths[address - 1];
+    return handle;
+  }
+}
+
+LoadModelRequest _loadRequest(String path) {
+  return LoadModelRequest(modelPath: path, config: const ModelConfig());
+}
+
+GenerateRequest _generateRequest(ModelHandle model, {SessionHandle? session}) {
+  return GenerateRequest(
+    modelHandle: model,
+    promptTokens: const [1, 2, 3],
+    maxTokens: 8,
+    temperature: 0,
+    topP: 1,
+    topK: 1,
+    minP: 0,
+    repetitionPenalty: 1,
+    frequencyPenalty: 0,
+    presencePenalty: 0,
+    repeatLastN: 64,
+    stopTokens: const [],
+    session: session,
+  );
+}
+
+TokenizeRequest _tokenizeRequest(ModelHandle model) {
+  return TokenizeRequest(
+    modelHandle: model,
+    text: 'abc',
+    addSpecialTokens: false,
+  );
+}
+
+void main() {
+  group('IsolatePool', () {
+    late IsolatePool pool;
+
+    setUp(() {
+      pool = IsolatePool(size: 2, bindingFactory: _createSharedBinding);
+    });
+
+    tearDown(() async {
+      await pool.shutdown();
+    });
+
+    test('rejects an empty pool', () {
+      expect(() => IsolatePool(size: 0), throwsArgumentError);
+    });
+
+    test('can start and shutdown', () async {
+      await pool.start();
+      expect(pool.isRunning, isTrue);
+
+      await pool.shutdown();
+      expect(pool.isRunning, isFalse);
+    });
+
+    test('hands out its own handles for models on different workers',
+        () async {
+      final first = await pool.loadModel(_loadRequest('first.gguf'));
+      final second = await pool.loadModel(_loadRequest('second.gguf'));
+
+      // Both workers' bindings numbered their model 1.
+      expect(first.handle, isNot(equals(second.handle)));
+      expect(
+        {pool.workerFor(first.handle), pool.workerFor(second.handle)},
+        equals({0, 1}),
+      );
+      expect(
+        (await pool.getModelInfo(first.handle)).name,
+        equals('first.gguf'),
+      );
+      expect(
+        (await pool.getModelInfo(second.handle)).name,
+        equals('second.gguf'),
+      );
+      expect(
+        (await pool.generate(_generateRequest(second.handle))).tokens,
+        equals([3, 2, 1]),
+      );
+    });
+
+    test('tokenizes on the express isolate while the model generates',
+        () async {
+      final model = await pool.loadModel(_loadRequest('first.gguf'));
+      final finished = <String>[];
+
+      final generation = pool
+          .generate(_generateRequest(model.handle))
+          .then((_) => finished.add('generate'));
+      await Future<void>.delayed(const Duration(milliseconds: 50));
+
+      final tokens = await pool.tokenize(_tokenizeRequest(model.handle));
+      finished.add('tokenize');
+      expect(tokens, equals('abc'.codeUnits));
+      expect(
+        (await pool.getModelInfo(model.handle)).name,
+        equals('first.gguf'),
+      );
+
+      await generation;
+      expect(finished, equals(['tokenize', 'generate']));
+    });
+
+    test('detaches the express isolate before unloading', () async {
+      final model = await pool.loadModel(_loadRequest('first.gguf'));
+
+      final generation = pool.generate(_generateRequest(model.handle));
+      await Future<void>.delayed(const Duration(milliseconds: 50));
+      await pool.tokenize(_tokenizeRequest(model.handle));
+      await generation;
+
+      await pool.unloadModel(model.handle);
+      expect(pool.workerFor(model.handle), isNull);
+      await expectLater(
+        pool.tokenize(_tokenizeRequest(model.handle)),
+        throwsA(isA<StateError>()),
+      );
+    });
+
+    test('maps sessions to their model', () async {
+      final first = await pool.loadModel(_loadRequest('first.gguf'));
+      final second = await pool.loadModel(_loadRequest('second.gguf'));
+
+      final session = await pool.createSession(first.handle);
+      expect(session, isNotNull);
+
+      final result = await pool.generate(
+        _generateRequest(first.handle, session: session),
+      );
+      expect(result.tokens, equals([3, 2, 1]));
+      await expectLater(
+        pool.generate(_generateRequest(second.handle, session: session)),
+        throwsA(isA<StateError>()),
+      );
+
+      await pool.freeSession(session!);
+      await expectLater(
+        pool.generate(_generateRequest(first.handle, session: session)),
+        throwsA(isA<StateError>()),
+      );
+    });
+
+    test('keeps no model for a failed load', () async {
+      await expectLater(
+        pool.loadModel(_loadRequest('missing.gguf')),
+        throwsA(isA<ModelNotFoundException>()),
+      );
+
+      final first = await pool.loadModel(_loadRequest('first.gguf'));
+      final second = await pool.loadModel(_loadRequest('second.gguf'));
+      expect(
+        {pool.workerFor(first.handle), pool.workerFor(second.handle)},
+        equals({0, 1}),
+      );
+    });
+
+    test('rejects requests for a model it did not load', () async {
+      await expectLater(
+        pool.getModelInfo(9),
+        throwsA(isA<StateError>()),
+      );
+    });
+
+    test('waits for the model worker when models cannot be shared',
+        () async {
+      final plain = IsolatePool(size: 1, bindingFactory: _createBinding);
+      addTearDown(plain.shutdown);
+
+      final model = await plain.loadModel(_loadRequest('first.gguf'));
+      final finished = <String>[];
+
+      final generation = plain
+          .generate(_generateRequest(model.handle))
+          .then((_) => finished.add('generate'));
+      await Future<void>.delayed(const Duration(milliseconds: 50));
+
+      expect(
+        await plain.tokenize(_tokenizeRequest(model.handle)),
+        equals('abc'.codeUnits),
+      );
+      finished.add('tokenize');
+
+      await generation;
+      expect(finished, equals(['generate', 'tokenize']));
+    });
+  });
+}
@@ -84,6 +84,48 @@ void main() {
 
       expect(request.seed, isNull);
     });
+
+    test('uses the base model unless an adapter is given', () {
+      const request = GenerateRequest(
+        modelHandle: 1,
+        promptTokens: [1, 2, 3],
+        maxTokens: 50,
+        temperature: 0.7,
+        topP: 0.9,
+        topK: 40,
+        minP: 0.05,
+        repetitionPenalty: 1.1,
+        frequencyPenalty: 0.0,
+        presencePenalty: 0.0,
+        repeatLastN: 64,
+        stopTokens: [],
+      );
+
+      expect(request.loraAdapter, isNull);
+      expect(request.loraScale, equals(1.0));
+    });
+
+    test('is unconstrained unless a grammar or bias is given', () {
+      const request = GenerateRequest(
+        modelHandle: 1,
+        promptTokens: [1, 2, 3],
+        maxTokens: 50,
+        temperature: 0.7,
+        topP: 0.9,
+        topK: 40,
+        minP: 0.05,
+        repetitionPenalty: 1.1,
+        frequencyPenalty: 0.0,
+        presencePenalty: 0.0,
+        repeatLastN: 64,
+        stopTokens: [],
+      );
+
+      expect(request.grammar, isNull);
+      expect(request.jsonSchema, isNull);
+      expect(request.logitBias, isEmpty);
+      expect(request.bannedTokens, isEmpty);
+    });
   });
 
   group('GenerateResult', () {
@@ -103,6 +145,41 @@ void main() {
       expect(result.generationTimeMs, equals(500));
     });
 
+    test('has no log-probabilities unless requested', () {
+      const result = GenerateResult(
+        tokens: [5],
+        promptTokenCount: 4,
+        completionTokenCount: 1,
+        finishReason: FinishReason.length,
+        generationTimeMs: 10,
+      );
+
+      expect(result.logprobs, isNull);
+    });
+
+    test('stores log-probabilities per token', () {
+      const result = GenerateResult(
+        tokens: [5],
+        promptTokenCount: 4,
+        completionTokenCount: 1,
+        finishReason: FinishReason.length,
+        generationTimeMs: 10,
+        logprobs: [
+          TokenLogprobs(
+            sampled: TokenLogprob(token: 5, logprob: -0.5),
+            topAlternatives: [
+              TokenLogprob(token: 5, logprob: -0.5),
+              TokenLogprob(token: 9, logprob: -1.2),
+            ],
+          ),
+        ],
+      );
+
+      expect(result.logprobs, hasLength(1));
+      expect(result.logprobs!.first.sampled.token, equals(5));
+      expect(result.logprobs!.first.topAlternatives.last.logprob, equals(-1.2));
+    });
+
     test('handles different finish reasons', () {
       const lengthResult = GenerateResult(
         tokens: [1, 2, 3],
@@ -0,0 +1,71 @@
+import 'dart:convert';
+import 'dart:io';
+
+import 'package:crypto/crypto.dart';
+import 'package:dartllm/src/utils/hash_utils.dart';
+import 'package:test/test.dart';
+
+void main() {
+  group('Sha256Hasher', () {
+    test('matches a one-shot hash when fed in chunks', () {
+      final data = utf8.encode('The quick brown fox jumps over the lazy dog');
+      final hasher = Sha256Hasher()
+        ..add(data.sublist(0, 10))
+        ..add(data.sublist(10));
+
+      expect(hasher.close(), equals(sha256.convert(data).toString()));
+    });
+  });
+
+  group('HashUtils', () {
+    late Directory tempDir;
+
+    setUp(() async {
+      tempDir = await Directory.systemTemp.createTemp('dartllm_hash_test_');
+    });
+
+    tearDown(() async {
+      await tempDir.delete(recursive: true);
+    });
+
+    test('sha256File hashes files larger than one block', () async {
+      final data = List<int>.generate(
+        HashUtils.blockSize * 2 + 123,
+        (i) => i % 251,
+      );
+      final file = File('${tempDir.path}/model.gguf');
+      await file.writeAsBytes(data);
+
+      expect(
+        await HashUtils.sha256File(file.path),
+        equals(sha256.convert(data).toString()),
+      );
+    });
+
+    test('addFile hashes only the requested prefix', () async {
+      final file = File('${tempDir.path}/model.gguf.part');
+      await file.writeAsString('prefix-and-more');
+
+      final hasher = Sha256Hasher();
+      await hasher.addFile(file, length: 6);
+
+      expect(
+        hasher.close(),
+        equals(sha256.convert(utf8.encode('prefix')).toString()),
+      );
+    });
+
+    test('addFile continues from an offset', () async {
+      final file = File('${tempDir.path}/model.gguf.part');
+      await file.writeAsString('prefix-and-more');
+
+      final hasher = Sha256Hasher()..add(utf8.encode('prefix'));
+      await hasher.addFile(file, offset: 6, length: 4);
+
+      expect(
+        hasher.close(),
+        equals(sha256.convert(utf8.encode('prefix-and')).toString()),
+      );
+    });
+  });
+}